@@ -0,0 +1,13 @@
+# IPLUG2_ROOT should point to the top level IPLUG2 folder from the project folder
+# By default, that is three directories up from /Examples/IPlugEffect/projects
+IPLUG2_ROOT = ../../..
+
+include $(IPLUG2_ROOT)/common-cli.mk
+
+SRC += $(PROJECT_ROOT)/IPlugEffect.cpp
+
+TARGET = ../build-cli/IPlugEffect-cli
+
+$(TARGET): $(SRC)
+	mkdir -p $(dir $@)
+	$(CXX) $(CFLAGS) $(EXTRA_CFLAGS) -o $@ $(SRC) $(LDFLAGS)
@@ -101,4 +101,10 @@ void IPlugInstrument::OnParamChange(int paramIdx)
 {
   mDSP.SetParam(paramIdx, GetParam(paramIdx)->Value());
 }
+
+void IPlugInstrument::GetPerformanceStats(IPerformanceStats& stats) const
+{
+  IPlug::GetPerformanceStats(stats);
+  stats.mNumMidiQueueOverflows += mDSP.GetNumDroppedMidiMsgs();
+}
 #endif
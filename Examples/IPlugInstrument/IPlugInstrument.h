@@ -38,6 +38,7 @@ public:
   void OnReset() override;
   void OnParamChange(int paramIdx) override;
   void OnIdle() override;
+  void GetPerformanceStats(IPerformanceStats& stats) const override;
 private:
   IPlugInstrumentDSP<sample> mDSP {16};
   IVMeterControl<1>::Sender mMeterSender {kCtrlTagMeter};
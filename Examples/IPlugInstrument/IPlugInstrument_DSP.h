@@ -1,6 +1,7 @@
 #pragma once
 
 #include "MidiSynth.h"
+#include "ModMatrix.h"
 #include "Oscillator.h"
 #include "ADSREnvelope.h"
 #include "Smoothers.h"
@@ -12,6 +13,20 @@ enum EModulations
   kNumModulations,
 };
 
+// per voice modulation sources and destinations, routed by the ModMatrix
+enum EModSources
+{
+  kModSrcPressure = 0,
+  kModSrcTimbre,
+  kNumModSources
+};
+
+enum EModDestinations
+{
+  kModDstNoise = 0,
+  kNumModDestinations
+};
+
 template<typename T>
 class IPlugInstrumentDSP
 {
@@ -20,8 +35,9 @@ public:
   class Voice : public SynthVoice
   {
   public:
-    Voice()
+    Voice(ModMatrix<T>& modMatrix)
     : mAMPEnv("gain", [&](){ mOSC.Reset(); }) // capture ok on RT thread?
+    , mModMatrix(modMatrix)
     {
       DBGMSG("new Voice: %i control inputs.\n", static_cast<int>(mInputs.size()));
     }
@@ -53,8 +69,15 @@ public:
       double pitch = mInputs[kVoiceControlPitch].endValue;
       double pitchBend = mInputs[kVoiceControlPitchBend].endValue;
 
-      // or write the entire control ramp to a buffer, like this, to get sample-accurate ramps:
-      mInputs[kVoiceControlTimbre].Write(mTimbreBuffer, startIdx, nFrames);
+      // or write the entire control ramp to a buffer, like this, to get sample-accurate ramps.
+      // here the MPE expressions are written to the modulation matrix sources, and the routings are evaluated
+      mInputs[kVoiceControlPressure].Write(mModMatrix.GetVoiceSource(mVoiceNumber, kModSrcPressure), 0, nFrames);
+      mInputs[kVoiceControlTimbre].Write(mModMatrix.GetVoiceSource(mVoiceNumber, kModSrcTimbre), 0, nFrames);
+      mModMatrix.ProcessVoice(mVoiceNumber, startIdx, nFrames);
+      const T* pNoise = mModMatrix.GetDestination(mVoiceNumber, kModDstNoise);
+
+      // envelopes are cheapest rendered a block at a time
+      mAMPEnv.ProcessBlock(mEnvBuffer + startIdx, inputs[kModSustainSmoother] + startIdx, nFrames);
 
       // convert from "1v/oct" pitch space to frequency in Hertz
       double osc1Freq = 440. * pow(2., pitch + pitchBend);
@@ -62,9 +85,9 @@ public:
       // make sound output for each output channel
       for(auto i = startIdx; i < startIdx + nFrames; i++)
       {
-        float noise = mTimbreBuffer[i] * Rand();
+        float noise = pNoise[i - startIdx] * Rand();
         // an MPE synth can use pressure here in addition to gain
-        outputs[0][i] += (mOSC.Process(osc1Freq) + noise) * mAMPEnv.Process(inputs[kModSustainSmoother][i]) * mGain;
+        outputs[0][i] += (mOSC.Process(osc1Freq) + noise) * mEnvBuffer[i] * mGain;
         outputs[1][i] = outputs[0][i];
       }
     }
@@ -93,7 +116,8 @@ public:
   private:
     // would be allocated dynamically in a real example
     static constexpr int kMaxBlockSize = 1024;
-    float mTimbreBuffer[kMaxBlockSize];
+    T mEnvBuffer[kMaxBlockSize];
+    ModMatrix<T>& mModMatrix;
 
     // noise generator for test
     uint32_t mRandSeed = 0;
@@ -115,9 +139,12 @@ public:
     for (auto i = 0; i < nVoices; i++)
     {
       // add a voice to Zone 0.
-      mSynth.AddVoice(new Voice(), 0);
+      mSynth.AddVoice(new Voice(mModMatrix), 0);
     }
 
+    // timbre (CC74 or MPE Y) adds noise
+    mModMatrix.AddRouting(kModSrcTimbre, kModDstNoise, 1.);
+
     // some MidiSynth API examples:
     // mSynth.SetKeyToPitchFn([](int k){return (k - 69.)/24.;}); // quarter-tone scale
     // mSynth.SetNoteGlideTime(0.5); // portamento
@@ -132,6 +159,7 @@ public:
     }
     
     mParamSmoother.ProcessBlock(mParamsToSmooth, mModulations.GetList(), nFrames);
+    mModMatrix.ProcessQueuedChanges(); // routings changed with QueueRouting(), e.g. from OnParamChange()
     mSynth.ProcessBlock(mModulations.GetList(), outputs, 0, nOutputs, nFrames);
     for(int s=0; s < nFrames;s++)
     {
@@ -145,6 +173,7 @@ public:
   {
     mSynth.SetSampleRateAndBlockSize(sampleRate, blockSize);
     mSynth.Reset();
+    mModMatrix.Resize(static_cast<int>(mSynth.NVoices()), mSynth.GetBlockSize());
     
     mModulationsData.Resize(blockSize);
     mModulations.Empty();
@@ -160,6 +189,11 @@ public:
     mSynth.AddMidiMsgToQueue(msg);
   }
 
+  int GetNumDroppedMidiMsgs() const
+  {
+    return mSynth.GetNumDroppedMidiMsgs();
+  }
+
   void SetParam(int paramIdx, double value)
   {
     using EEnvStage = ADSREnvelope<sample>::EStage;
@@ -190,6 +224,7 @@ public:
   }
   
 public:
+  ModMatrix<T> mModMatrix { kNumModSources, kNumModDestinations }; // declared before mSynth, the voices keep a reference to it
   MidiSynth mSynth { VoiceAllocator::kPolyModePoly, MidiSynth::kDefaultBlockSize };
   WDL_TypedBuf<T> mModulationsData; // Sample data for global modulations (e.g. smoothed sustain)
   WDL_PtrList<T> mModulations; // Ptrlist for global modulations
@@ -41,6 +41,7 @@ public:
   , mNameLabel(label)
   {
     AttachIControl(this, label);
+    SetPollIsDirty(true);
 
     SetColor(kBG, COLOR_WHITE);
 
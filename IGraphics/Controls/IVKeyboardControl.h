@@ -209,7 +209,36 @@ public:
       g.FillRoundRect(color, bounds, 0., 0., mRoundness, mRoundness);
     }
     else
-      g.FillRect(color, bounds);
+      AddKeyRect(bounds, color);
+  }
+
+  /** Queue a rectangle to be filled by the next call to FlushKeyRects() */
+  void AddKeyRect(const IRECT& bounds, const IColor& color)
+  {
+    mKeyRects.Add(bounds);
+    mKeyColors.Add(color);
+  }
+
+  /** Queue a line to be drawn by the next call to FlushKeyLines() */
+  void AddKeyLine(float x1, float y1, float x2, float y2)
+  {
+    const float line[4] = {x1, y1, x2, y2};
+    mKeyLines.Add(line, 4);
+    mKeyLineColors.Add(mFR_COLOR);
+  }
+
+  void FlushKeyRects(IGraphics& g)
+  {
+    g.FillRects(mKeyColors.Get(), mKeyRects.Get(), mKeyRects.GetSize());
+    mKeyRects.Resize(0, false);
+    mKeyColors.Resize(0, false);
+  }
+
+  void FlushKeyLines(IGraphics& g, float thickness)
+  {
+    g.DrawLines(mKeyLineColors.Get(), mKeyLines.Get(), mKeyLineColors.GetSize(), nullptr, thickness);
+    mKeyLines.Resize(0, false);
+    mKeyLineColors.Resize(0, false);
   }
 
   void Draw(IGraphics& g) override
@@ -240,7 +269,7 @@ public:
             shadowBounds.R = shadowBounds.L + 0.35f * shadowBounds.W();
             
             if(!mRoundedKeys)
-              g.FillRect(shadowColor, shadowBounds);
+              AddKeyRect(shadowBounds, shadowColor);
             else {
               g.FillRoundRect(shadowColor, shadowBounds, 0., 0., mRoundness, mRoundness); // this one looks strange with rounded corners
             }
@@ -248,12 +277,16 @@ public:
         }
         if (mDrawFrame && i != 0)
         { // only draw the left border if it doesn't overlay mRECT left border
-          g.DrawLine(mFR_COLOR, kL, mRECT.T, kL, mRECT.B, nullptr, mFrameThickness);
+          AddKeyLine(kL, mRECT.T, kL, mRECT.B);
           if (i == NKeys() - 2 && IsBlackKey(NKeys() - 1))
-            g.DrawLine(mFR_COLOR, kL + mWKWidth, mRECT.T, kL + mWKWidth, mRECT.B, nullptr, mFrameThickness);
+            AddKeyLine(kL + mWKWidth, mRECT.T, kL + mWKWidth, mRECT.B);
         }
       }
     }
+    
+    // Keys don't overlap their neighbours' frame lines, so each layer can be submitted as one batch
+    FlushKeyRects(g);
+    FlushKeyLines(g, mFrameThickness);
 
     // then blacks
     for (int i = 0; i < NKeys(); ++i)
@@ -284,21 +317,24 @@ public:
           // draw pressed black key
           IColor cBP = mPK_COLOR;
           cBP.A = (int) mBKAlpha;
-          g.FillRect(cBP, keyBounds);
+          AddKeyRect(keyBounds, cBP);
         }
 
         if(!mRoundedKeys)
         {
           // draw l, r and bottom if they don't overlay the mRECT borders
           if (mBKHeightRatio != 1.0)
-            g.DrawLine(mFR_COLOR, kL, BKBottom, kL + BKWidth, BKBottom);
+            AddKeyLine(kL, BKBottom, kL + BKWidth, BKBottom);
           if (i > 0)
-            g.DrawLine(mFR_COLOR, kL, mRECT.T, kL, BKBottom);
+            AddKeyLine(kL, mRECT.T, kL, BKBottom);
           if (i != NKeys() - 1)
-            g.DrawLine(mFR_COLOR, kL + BKWidth, mRECT.T, kL + BKWidth, BKBottom);
+            AddKeyLine(kL + BKWidth, mRECT.T, kL + BKWidth, BKBottom);
         }
       }
     }
+    
+    FlushKeyRects(g);
+    FlushKeyLines(g, 1.f);
 
     if (mDrawFrame)
       g.DrawRect(mFR_COLOR, mRECT, nullptr, mFrameThickness);
@@ -698,6 +734,10 @@ protected:
   float mWKWidth = 0.f;
   float mBKWidthRatio = 0.6f;
   float mBKHeightRatio = 0.6f;
+  WDL_TypedBuf<IRECT> mKeyRects; // scratch buffers for batched drawing
+  WDL_TypedBuf<IColor> mKeyColors;
+  WDL_TypedBuf<float> mKeyLines;
+  WDL_TypedBuf<IColor> mKeyLineColors;
   float mBKAlpha = 100.f;
   int mLastTouchedKey = -1;
   float mLastVelocity = 0.f;
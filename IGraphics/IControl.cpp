@@ -187,6 +187,9 @@ void IControl::SetDirty(bool triggerAction, int valIdx)
   
   mDirty = true;
   
+  if (mGraphics)
+    mGraphics->MarkControlDirty(this);
+  
   if (triggerAction)
   {
     auto paramUpdate = [this](int v)
@@ -205,16 +208,6 @@ void IControl::SetDirty(bool triggerAction, int valIdx)
   }
 }
 
-bool IControl::IsDirty()
-{
-  if(GetAnimationFunction()) {
-    mAnimationFunc(this);
-    return true;
-  }
-  
-  return mDirty;
-}
-
 void IControl::Hide(bool hide)
 {
   mHide = hide;
@@ -350,10 +350,18 @@ public:
   virtual void SetClean() { mDirty = false; }
   
   /** Called at each display refresh by the IGraphics draw loop to determine if the control is marked as dirty. 
-   * This is not const, because it is typically  overridden and used to update something at the display refresh rate
-   * The default implementation executes a control's Animation Function, so if you override this you may want to call the base implementation, @see Animation Functions
+   * This is not const, because it is typically  overridden and used to update something at the display refresh rate, @see SetPollIsDirty()
+   * Animation Functions are not run from here, they are ticked by the IGraphics animation scheduler, @see Animation Functions
    * @return \c true if the control is marked dirty. */
-  virtual bool IsDirty();
+  virtual bool IsDirty() { return mDirty; }
+
+  /** By default IGraphics calls IsDirty() on every control on every frame. When the editor opts out of that with IGraphics::SetPollAllControls(false), it only visits controls that have been set dirty,
+   * so a control that overrides IsDirty() to become dirty by polling (e.g. to update something at the display refresh rate) must call this with \c true to still be asked on every frame
+   * @param poll \c true if IsDirty() should be polled on every frame */
+  void SetPollIsDirty(bool poll) { mPollIsDirty = poll; if (mGraphics) mGraphics->UpdateControlPolling(this); }
+
+  /** @return \c true if IsDirty() is polled on every frame, @see SetPollIsDirty() */
+  bool GetPollIsDirty() const { return mPollIsDirty; }
 
   /** Disable/enable right-clicking the control to prompt for user input /todo check this
    * @param disable \c true*/
@@ -388,6 +396,17 @@ public:
     OnInit();
     OnResize();
     OnRescale();
+    
+    if (mGraphics)
+    {
+      if (mDirty)
+        mGraphics->MarkControlDirty(this);
+      
+      if (mAnimationFunc)
+        mGraphics->ScheduleAnimation(this);
+      
+      mGraphics->UpdateControlPolling(this);
+    }
   }
   
   /** @return A pointer to the IGraphics context that owns this control */ 
@@ -420,29 +439,32 @@ public:
   {
     mAnimationStartTime = std::chrono::high_resolution_clock::now();
     mAnimationDuration = Milliseconds(duration);
+    UpdateAnimationProgress(mAnimationStartTime);
   }
   
-  /** Set the animation function
+  /** Set the animation function. While a control has an animation function, it is ticked once per frame by the IGraphics animation scheduler and its bounds are redrawn
    * @param func A std::function conforming to IAnimationFunction */
-  void SetAnimation(IAnimationFunction func) { mAnimationFunc = func;}
+  void SetAnimation(IAnimationFunction func) { mAnimationFunc = func; if (mGraphics && func) mGraphics->ScheduleAnimation(this); }
   
   /** Set the animation function and starts it
    * @param func A std::function conforming to IAnimationFunction
    * @param duration Duration in milliseconds for the animation  */
-  void SetAnimation(IAnimationFunction func, int duration) { mAnimationFunc = func; StartAnimation(duration); }
+  void SetAnimation(IAnimationFunction func, int duration) { SetAnimation(func); StartAnimation(duration); }
 
   IAnimationFunction GetAnimationFunction() { return mAnimationFunc; }
   
   IAnimationFunction GetActionFunction() { return mActionFunc; }
 
-  double GetAnimationProgress()
-  {
-    if(!mAnimationFunc)
-      return 0.;
-    
-    auto elapsed = Milliseconds(std::chrono::high_resolution_clock::now() - mAnimationStartTime);
-    return elapsed.count() / mAnimationDuration.count();
-  }
+  /** Set an easing function applied to the animation progress, @see Easing.h e.g. SetAnimationEasing(EaseQuadraticInOut<double>)
+   * The eased progress is computed once per frame by the IGraphics animation scheduler, @see GetEasedAnimationProgress()
+   * @param func A std::function conforming to IEasingFunction, or nullptr for linear progress */
+  void SetAnimationEasing(IEasingFunction func) { mAnimationEasingFunc = func; }
+  
+  /** @return The linear progress of the current animation as of the current frame. Values greater than 1. mean that the animation has run past its duration */
+  double GetAnimationProgress() const { return mAnimationFunc ? mAnimationProgress : 0.; }
+  
+  /** @return The progress of the current animation as of the current frame, clipped to 0.-1. and passed through the easing function, @see SetAnimationEasing() */
+  double GetEasedAnimationProgress() const { return mAnimationFunc ? mEasedAnimationProgress : 0.; }
   
 #if defined VST3_API || defined VST3C_API
   Steinberg::tresult PLUGIN_API executeMenuItem (Steinberg::int32 tag) override { OnContextSelection(tag); return Steinberg::kResultOk; }
@@ -513,9 +535,26 @@ private:
   IGraphics* mGraphics = nullptr;
   IActionFunction mActionFunc = nullptr;
   IAnimationFunction mAnimationFunc = nullptr;
+  IEasingFunction mAnimationEasingFunc = nullptr;
   TimePoint mAnimationStartTime;
   Milliseconds mAnimationDuration;
+  double mAnimationProgress = 0.;
+  double mEasedAnimationProgress = 0.;
   std::vector<ParamTuple> mVals { {kNoParameter, 0.} };
+  bool mPollIsDirty = false;
+  bool mInDirtyList = false; // maintained by IGraphics
+  bool mPolled = false; // maintained by IGraphics
+  bool mAnimating = false; // maintained by IGraphics
+  
+  /** Called by the IGraphics animation scheduler with a single timestamp per frame */
+  void UpdateAnimationProgress(const TimePoint& now)
+  {
+    mAnimationProgress = mAnimationDuration.count() > 0. ? Milliseconds(now - mAnimationStartTime).count() / mAnimationDuration.count() : 1.;
+    const double progress = Clip(mAnimationProgress, 0., 1.);
+    mEasedAnimationProgress = mAnimationEasingFunc ? mAnimationEasingFunc(progress) : progress;
+  }
+  
+  friend class IGraphics;
 };
 
 #pragma mark - Base Controls
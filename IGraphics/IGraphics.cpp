@@ -150,6 +150,7 @@ void IGraphics::RemoveControls(int fromIdx)
     if (pControl == mInPopupMenu)
       mInPopupMenu = nullptr;
     
+    ForgetControl(pControl);
     mControls.Delete(idx--, true);
   }
   
@@ -160,6 +161,10 @@ void IGraphics::RemoveAllControls()
 {
   mMouseCapture = nullptr;
   ClearMouseOver();
+  
+  mDirtyControls.Empty();
+  mPolledControls.Empty();
+  mAnimatingControls.Empty();
 
   mPopupControl = nullptr;
   mTextEntryControl = nullptr;
@@ -278,8 +283,9 @@ void IGraphics::ShowFPSDisplay(bool enable)
       mPerfDisplay->SetDelegate(*GetDelegate());
     }
   }
-  else
+  else if (mPerfDisplay)
   {
+    ForgetControl(mPerfDisplay.get());
     mPerfDisplay = nullptr;
     ClearMouseOver();
   }
@@ -311,61 +317,28 @@ void IGraphics::GrayOutControl(int paramIdx, bool gray)
   ForMatchingControls(&IControl::GrayOut, paramIdx, gray);
 }
 
-void IGraphics::ForControlWithParam(int paramIdx, std::function<void(IControl& control)> func)
-{
-  for (auto c = 0; c < NControls(); c++)
-  {
-    IControl* pControl = GetControl(c);
-
-    if (pControl->LinkedToParam(paramIdx) > kNoValIdx)
-    {
-      func(*pControl);
-      // Could be more than one, don't break until we check them all.
-    }
-  }
-}
-
-void IGraphics::ForControlInGroup(const char* group, std::function<void(IControl& control)> func)
-{
-  for (auto c = 0; c < NControls(); c++)
-  {
-    IControl* pControl = GetControl(c);
-
-    if (CStringHasContents(pControl->GetGroup()))
-    {
-      if (strcmp(pControl->GetGroup(), group) == 0)
-        func(*pControl);
-      // Could be more than one, don't break until we check them all.
-    }
-  }
-}
-
-void IGraphics::ForStandardControlsFunc(std::function<void(IControl& control)> func)
-{
-  for (auto c = 0; c < NControls(); c++)
-    func(*GetControl(c));
-}
-
-void IGraphics::ForAllControlsFunc(std::function<void(IControl& control)> func)
+int IGraphics::GetSpecialControls(IControl** pControls) const
 {
-  ForStandardControlsFunc(func);
+  int n = 0;
   
   if (mPerfDisplay)
-    func(*mPerfDisplay);
+    pControls[n++] = mPerfDisplay.get();
   
 #if !defined(NDEBUG)
   if (mLiveEdit)
-    func(*mLiveEdit);
+    pControls[n++] = mLiveEdit.get();
 #endif
   
   if (mCornerResizer)
-    func(*mCornerResizer);
+    pControls[n++] = mCornerResizer.get();
   
   if (mTextEntryControl)
-    func(*mTextEntryControl);
+    pControls[n++] = mTextEntryControl.get();
   
   if (mPopupControl)
-    func(*mPopupControl);
+    pControls[n++] = mPopupControl.get();
+  
+  return n;
 }
 
 template<typename T, typename... Args>
@@ -387,7 +360,134 @@ void IGraphics::SetAllControlsDirty()
 
 void IGraphics::SetAllControlsClean()
 {
-  ForAllControls(&IControl::SetClean);
+  for (auto i = 0; i < mDirtyControls.GetSize(); i++)
+  {
+    IControl* pControl = mDirtyControls.Get(i);
+    pControl->mInDirtyList = false;
+    pControl->SetClean();
+  }
+  
+  mDirtyControls.Empty();
+}
+
+void IGraphics::MarkControlDirty(IControl* pControl)
+{
+  if (!pControl->mInDirtyList)
+  {
+    pControl->mInDirtyList = true;
+    mDirtyControls.Add(pControl);
+  }
+  
+  mIdleFrames = 0;
+  
+  if (mThrottled)
+    SetThrottled(false);
+}
+
+void IGraphics::UpdateControlPolling(IControl* pControl)
+{
+  if (!pControl->mPolled && pControl->mPollIsDirty)
+  {
+    pControl->mPolled = true;
+    mPolledControls.Add(pControl);
+  }
+}
+
+void IGraphics::ScheduleAnimation(IControl* pControl)
+{
+  if (!pControl->mAnimating)
+  {
+    pControl->mAnimating = true;
+    mAnimatingControls.Add(pControl);
+  }
+  
+  if (mThrottled)
+    SetThrottled(false);
+}
+
+void IGraphics::TickAnimations()
+{
+  if (!mAnimatingControls.GetSize())
+    return;
+  
+  const TimePoint now = std::chrono::high_resolution_clock::now();
+  
+  for (auto i = 0; i < mAnimatingControls.GetSize();)
+  {
+    IControl* pControl = mAnimatingControls.Get(i);
+    
+    if (pControl->mAnimationFunc)
+    {
+      pControl->UpdateAnimationProgress(now);
+      pControl->mAnimationFunc(pControl);
+      MarkControlDirty(pControl);
+    }
+    
+    // N.B. the animation function may have ended the animation by calling OnEndAnimation()
+    if (pControl->mAnimationFunc)
+    {
+      i++;
+    }
+    else
+    {
+      pControl->mAnimating = false;
+      mAnimatingControls.Delete(i);
+    }
+  }
+}
+
+void IGraphics::ForgetControl(IControl* pControl)
+{
+  if (pControl->mInDirtyList)
+    mDirtyControls.DeletePtr(pControl);
+  
+  if (pControl->mPolled)
+    mPolledControls.DeletePtr(pControl);
+  
+  if (pControl->mAnimating)
+    mAnimatingControls.DeletePtr(pControl);
+  
+  pControl->mInDirtyList = false;
+  pControl->mPolled = false;
+  pControl->mAnimating = false;
+}
+
+void IGraphics::PollMarkedControls()
+{
+  // Only controls that have asked for polling are visited, everything else has already reported into mDirtyControls via SetDirty()
+  for (auto i = 0; i < mPolledControls.GetSize();)
+  {
+    IControl* pControl = mPolledControls.Get(i);
+    
+    if (pControl->IsDirty())
+      MarkControlDirty(pControl);
+    
+    if (pControl->mPollIsDirty)
+    {
+      i++;
+    }
+    else
+    {
+      pControl->mPolled = false;
+      mPolledControls.Delete(i);
+    }
+  }
+}
+
+void IGraphics::SetAdaptiveFPS(bool enable, int idleFPS)
+{
+  mAdaptiveFPS = enable;
+  mIdleFPS = Clip(idleFPS, 1, mFPS);
+  mIdleFrames = 0;
+  
+  if (!enable && mThrottled)
+    SetThrottled(false);
+}
+
+void IGraphics::SetThrottled(bool throttled)
+{
+  mThrottled = throttled;
+  PlatformSetFrameRate(GetCurrentFPS());
 }
 
 void IGraphics::AssignParamNameToolTips()
@@ -626,33 +726,111 @@ void IGraphics::DrawGrid(const IColor& color, const IRECT& bounds, float gridSiz
   }
 }
 
-void IGraphics::DrawData(const IColor& color, const IRECT& bounds, float* normYPoints, int nPoints, float* normXPoints, const IBlend* pBlend, float thickness)
+int IGraphics::GetDataColumns(const IRECT& bounds, int nPoints, const float* normXPoints) const
 {
-  //TODO:
+  if (normXPoints)
+    return 0;
+  
+  const int nColumns = (int) std::ceil(bounds.W() * GetBackingPixelScale());
+  
+  return (nColumns > 1 && nPoints > 2 * nColumns) ? nColumns : 0;
 }
 
-bool IGraphics::IsDirty(IRECTList& rects)
+void IGraphics::DrawData(const IColor& color, const IRECT& bounds, const float* normYPoints, int nPoints, const float* normXPoints, const IBlend* pBlend, float thickness)
 {
-  bool dirty = false;
-    
-  auto func = [&dirty, &rects](IControl& control)
+  if (nPoints < 2)
+    return;
+  
+  const int nColumns = GetDataColumns(bounds, nPoints, normXPoints);
+  
+  if (nColumns)
   {
-    if (control.IsDirty())
-    {
-      // N.B padding outlines for single line outlines
-      rects.Add(control.GetRECT().GetPadded(0.75));
-      dirty = true;
-    }
+    mDecimatedPoints.Resize(2 * nColumns, false);
+    DecimateMinMax(normYPoints, nPoints, nColumns, mDecimatedPoints.Get());
+    normYPoints = mDecimatedPoints.Get();
+    nPoints = 2 * nColumns;
+  }
+  
+  auto getX = [&](int i) {
+    if (nColumns)
+      return bounds.L + (bounds.W() * (float) (i / 2) / (float) (nColumns - 1));
+    else if (normXPoints)
+      return bounds.L + (bounds.W() * normXPoints[i]);
+    else
+      return bounds.L + ((bounds.W() / (float) (nPoints - 1) * i));
   };
+  
+  float x1 = getX(0);
+  float y1 = bounds.B - (bounds.H() * normYPoints[0]);
+  
+  for (auto i = 1; i < nPoints; i++)
+  {
+    const float x2 = getX(i);
+    const float y2 = bounds.B - (bounds.H() * normYPoints[i]);
+    DrawLine(color, x1, y1, x2, y2, pBlend, thickness);
+    x1 = x2;
+    y1 = y2;
+  }
+}
+
+void IGraphics::FillRects(const IColor* colors, const IRECT* rects, int nRects, const IBlend* pBlend)
+{
+  for (auto i = 0; i < nRects; i++)
+    FillRect(colors[i], rects[i], pBlend);
+}
+
+void IGraphics::DrawLines(const IColor* colors, const float* points, int nLines, const IBlend* pBlend, float thickness)
+{
+  for (auto i = 0; i < nLines; i++, points += 4)
+    DrawLine(colors[i], points[0], points[1], points[2], points[3], pBlend, thickness);
+}
+
+void IGraphics::DrawPolylines(const IColor* colors, const float* x, const float* y, const int* nPoints, int nPolylines, const IBlend* pBlend, float thickness)
+{
+  for (auto p = 0; p < nPolylines; p++)
+  {
+    for (auto i = 1; i < nPoints[p]; i++)
+      DrawLine(colors[p], x[i-1], y[i-1], x[i], y[i], pBlend, thickness);
     
-  ForAllControlsFunc(func);
+    x += nPoints[p];
+    y += nPoints[p];
+  }
+}
+
+bool IGraphics::IsDirty(IRECTList& rects)
+{
+  TickAnimations();
+  
+  if (mPollAllControls)
+  {
+    // controls may override IsDirty() to become dirty by polling, so unless the editor has opted out, every one of them is asked
+    ForAllControlsFunc([this](IControl& control) {
+      if (control.IsDirty())
+        MarkControlDirty(&control);
+    });
+  }
+  else
+  {
+    PollMarkedControls();
+  }
+
+  const bool dirty = mDirtyControls.GetSize() > 0;
+
+  for (auto i = 0; i < mDirtyControls.GetSize(); i++)
+  {
+    // N.B padding outlines for single line outlines
+    rects.Add(mDirtyControls.Get(i)->GetRECT().GetPadded(0.75));
+  }
+  
+  if (!dirty && mAdaptiveFPS && !mThrottled && ++mIdleFrames > ADAPTIVE_FPS_IDLE_FRAMES)
+    SetThrottled(true);
   
 #ifdef USE_IDLE_CALLS
   if (dirty)
   {
     mIdleTicks = 0;
   }
-  else if (++mIdleTicks > IDLE_TICKS)
+  else if ((mIdleTicks += mThrottled ? mFPS / mIdleFPS : 1) > IDLE_TICKS) // counted in frames at FPS(), @see SetAdaptiveFPS()
   {
     OnGUIIdle();
     mIdleTicks = 0;
@@ -1243,8 +1421,9 @@ void IGraphics::EnableLiveEdit(bool enable, const char* file, int gridsize)
       mLiveEdit->SetDelegate(*GetDelegate());
     }
   }
-  else
+  else if (mLiveEdit)
   {
+    ForgetControl(mLiveEdit.get());
     mLiveEdit = nullptr;
   }
   
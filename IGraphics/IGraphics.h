@@ -457,15 +457,42 @@ public:
    * @param thickness Optional line thickness */
   virtual void DrawGrid(const IColor& color, const IRECT& bounds, float gridSizeH, float gridSizeV, const IBlend* pBlend = 0, float thickness = 1.f);
 
-  /** /todo
-   * @param color /todo
-   * @param bounds /todo
-   * @param normYPoints /todo
-   * @param nPoints /todo
-   * @param normXPoints /todo
-   * @param pBlend /todo
-   * @param thickness /todo */
-  virtual void DrawData(const IColor& color, const IRECT& bounds, float* normYPoints, int nPoints, float* normXPoints = nullptr, const IBlend* pBlend = 0, float thickness = 1.f);
+  /** Draw a polyline through normalized data points, e.g. a waveform or a scope trace.
+   * If normXPoints is nullptr and there are more than two points per pixel column, the data is drawn as the min/max envelope of each pixel column, which is visually identical but has at most 2 * width vertices. @see IMinMaxDecimator for scrolling displays
+   * @param color The color to draw the line with
+   * @param bounds The rectangular region to draw the data in
+   * @param normYPoints The Y values of the points, normalized 0-1 from the bottom to the top of bounds
+   * @param nPoints The number of points
+   * @param normXPoints Optional X values of the points, normalized 0-1 from the left to the right of bounds. If nullptr, the points are evenly spaced
+   * @param pBlend Optional blend method, see IBlend documentation
+   * @param thickness Optional line thickness */
+  virtual void DrawData(const IColor& color, const IRECT& bounds, const float* normYPoints, int nPoints, const float* normXPoints = nullptr, const IBlend* pBlend = 0, float thickness = 1.f);
+
+  /** Fill an array of rectangles, each with its own color, in a single call. The default implementation calls FillRect() for each rectangle.
+   * Backends may submit the batch natively, e.g. path based backends fill consecutive rectangles of the same color as a single path
+   * @param colors An array of nRects colors, one per rectangle
+   * @param rects An array of nRects rectangles, drawn in order
+   * @param nRects The number of rectangles
+   * @param pBlend Optional blend method, see IBlend documentation */
+  virtual void FillRects(const IColor* colors, const IRECT* rects, int nRects, const IBlend* pBlend = 0);
+
+  /** Draw an array of lines, each with its own color, in a single call. The default implementation calls DrawLine() for each line
+   * @param colors An array of nLines colors, one per line
+   * @param points An array of 4 * nLines coordinates, x1, y1, x2, y2 for each line
+   * @param nLines The number of lines
+   * @param pBlend Optional blend method, see IBlend documentation
+   * @param thickness Optional line thickness */
+  virtual void DrawLines(const IColor* colors, const float* points, int nLines, const IBlend* pBlend = 0, float thickness = 1.f);
+
+  /** Draw an array of open polylines, each with its own color, in a single call. The default implementation calls DrawLine() for each segment
+   * @param colors An array of nPolylines colors, one per polyline
+   * @param x The X coordinates of the vertices of all polylines, one polyline after the other
+   * @param y The Y coordinates of the vertices of all polylines, one polyline after the other
+   * @param nPoints An array of nPolylines vertex counts, one per polyline
+   * @param nPolylines The number of polylines
+   * @param pBlend Optional blend method, see IBlend documentation
+   * @param thickness Optional line thickness */
+  virtual void DrawPolylines(const IColor* colors, const float* x, const float* y, const int* nPoints, int nPolylines, const IBlend* pBlend = 0, float thickness = 1.f);
   
   /** Load a font to be used by the graphics context
    * @param fontID A CString that will be used to reference the font
@@ -987,6 +1014,28 @@ public:
    * @return A whole number representing the desired frame rate at which the graphics context is redrawn. NOTE: the actual frame rate might be different */
   int FPS() const { return mFPS; }
 
+  /** Enable or disable adaptive frame pacing. When enabled, the platform draw timer is slowed down to idleFPS once no control has been dirty for ADAPTIVE_FPS_IDLE_FRAMES frames, and goes back to FPS() as soon as a control is set dirty.
+   * On Windows the timer keeps running at FPS(), so that text entry is still handled promptly, and only the dirty check and drawing are done at idleFPS.
+   * Idle ticks for USE_IDLE_CALLS are counted in frames at FPS(), so OnGUIIdle() is called at the same rate whether or not the UI is throttled
+   * @param enable \c true to enable adaptive frame pacing
+   * @param idleFPS The frame rate to use while the UI is idle */
+  void SetAdaptiveFPS(bool enable, int idleFPS = DEFAULT_IDLE_FPS);
+
+  /** Choose how IsDirty() finds the controls to redraw. By default every control is asked on every frame, so that controls which override IControl::IsDirty() to poll something keep working.
+   * With \c false, an idle frame only visits the controls that have been set dirty with IControl::SetDirty(), are animating, or have asked to be polled with IControl::SetPollIsDirty(),
+   * which is much cheaper for large UIs. Only opt out if every control that overrides IControl::IsDirty(), or sets mDirty directly, calls IControl::SetPollIsDirty(true)
+   * @param poll \c true to poll every control on every frame */
+  void SetPollAllControls(bool poll) { mPollAllControls = poll; }
+
+  /** @return \c true if every control is polled on every frame, @see SetPollAllControls() */
+  bool GetPollAllControls() const { return mPollAllControls; }
+
+  /** @return \c true if adaptive frame pacing is enabled */
+  bool GetAdaptiveFPS() const { return mAdaptiveFPS; }
+
+  /** @return The frame rate at which the platform draw timer should currently run. This is FPS(), unless adaptive frame pacing has throttled an idle UI */
+  int GetCurrentFPS() const { return mThrottled ? mIdleFPS : mFPS; }
+
   /** Gets the graphics context scaling factor.
    * @return The scaling applied to the graphics context */
   float GetDrawScale() const { return mDrawScale; }
@@ -1072,6 +1121,10 @@ private:
   
   /** /todo */
   virtual void PlatformResize(bool parentHasResized) {}
+
+  /** Called when adaptive frame pacing changes the rate at which the platform draw timer should run
+   * @param fps The new frame rate, @see GetCurrentFPS() */
+  virtual void PlatformSetFrameRate(int fps) {}
   
   /** /todo */
   virtual void DrawResize() {}
@@ -1102,9 +1155,20 @@ protected: // TODO: correct?
 #pragma mark - Control management
 public:
   
-  /** /todo
-   * @param func /todo */
-  void ForAllControlsFunc(std::function<void(IControl& control)> func);
+  /** For all standard controls in the main control stack, and any special controls (e.g. the popup menu, text entry, corner resizer) perform a function.
+   * This is a template so that lambdas are inlined on hot paths, a std::function can still be passed
+   * @param func A callable taking an IControl& to perform on each control */
+  template<typename T>
+  void ForAllControlsFunc(T func)
+  {
+    ForStandardControlsFunc(func);
+    
+    IControl* specialControls[kNumSpecialControls];
+    const int nSpecialControls = GetSpecialControls(specialControls);
+    
+    for (auto i = 0; i < nSpecialControls; i++)
+      func(*specialControls[i]);
+  }
   
   /** /todo
    * @tparam T /todo
@@ -1115,8 +1179,14 @@ public:
   void ForAllControls(T method, Args... args);
   
   /** For all standard controls in the main control stack perform a function
-   * @param func A std::function to perform on each control */
-  void ForStandardControlsFunc(std::function<void(IControl& control)> func);
+   * @param func A callable taking an IControl& to perform on each control */
+  template<typename T>
+  void ForStandardControlsFunc(T func)
+  {
+    // NControls() is read on each iteration, func may remove controls
+    for (auto c = 0; c < NControls(); c++)
+      func(*mControls.Get(c));
+  }
   
   /** /todo
    * @tparam T /todo
@@ -1127,15 +1197,30 @@ public:
   template<typename T, typename... Args>
   void ForMatchingControls(T method, int paramIdx, Args... args);
 
-  /** /todo
-   * @param paramIdx /todo
-   * @param func /todo */
-  void ForControlWithParam(int paramIdx, std::function<void(IControl& control)> func);
+  /** For all standard controls linked to a particular parameter perform a function
+   * @param paramIdx The parameter index
+   * @param func A callable taking an IControl& to perform on each matching control */
+  template<typename T>
+  void ForControlWithParam(int paramIdx, T func)
+  {
+    // N.B. generic lambda, so that IControl only needs to be complete where this is instantiated
+    ForStandardControlsFunc([paramIdx, &func](auto& control) {
+      if (control.LinkedToParam(paramIdx) > kNoValIdx)
+        func(control); // Could be more than one, don't break until we check them all.
+    });
+  }
   
-  /** \todo
-   * @param group /todo
-   * @param func /todo */
-  void ForControlInGroup(const char* group, std::function<void(IControl& control)> func);
+  /** For all standard controls in a particular group perform a function
+   * @param group The name of the group
+   * @param func A callable taking an IControl& to perform on each matching control */
+  template<typename T>
+  void ForControlInGroup(const char* group, T func)
+  {
+    ForStandardControlsFunc([group, &func](auto& control) {
+      if (CStringHasContents(control.GetGroup()) && strcmp(control.GetGroup(), group) == 0)
+        func(control); // Could be more than one, don't break until we check them all.
+    });
+  }
   
   /** Attach an IBitmapControl as the lowest IControl in the control stack to be the background for the graphics context
    * @param fileName CString fileName resource id for the bitmap image \todo check this */
@@ -1228,7 +1313,7 @@ public:
   /** Calls SetDirty() on every control */
   void SetAllControlsDirty();
   
-  /** Calls SetClean() on every control */
+  /** Calls SetClean() on every control that has been marked dirty since the last call, and empties the dirty set */
   void SetAllControlsClean();
 
 private:
@@ -1466,6 +1551,12 @@ protected:
   
   /** @return float /todo */
   virtual float GetBackingPixelScale() const = 0;
+
+  /** Used by DrawData() to decide whether to decimate evenly spaced data to a min/max envelope, @see DecimateMinMax()
+   * @return The number of pixel columns to decimate to, or 0 if the data should be drawn as is */
+  int GetDataColumns(const IRECT& bounds, int nPoints, const float* normXPoints) const;
+  
+  WDL_TypedBuf<float> mDecimatedPoints; // scratch buffer for DrawData()
   
 #pragma mark -
 
@@ -1475,8 +1566,38 @@ private:
     mMouseOver = nullptr;
     mMouseOverIdx = -1;
   }
-  
+
+  static constexpr int kNumSpecialControls = 5;
+
+  /** Fills pControls with the special controls that are currently attached, in the order they are drawn after the main control stack
+   * @param pControls An array of kNumSpecialControls pointers
+   * @return The number of special controls */
+  int GetSpecialControls(IControl** pControls) const;
+
+  /** Called by IControl::SetDirty() to add a control to the set of controls that will be redrawn on the next frame */
+  void MarkControlDirty(IControl* pControl);
+
+  /** Called by IControl when it asks for IsDirty() polling. Controls that no longer need polling are dropped lazily by IsDirty() */
+  void UpdateControlPolling(IControl* pControl);
+
+  /** Asks the controls that have called IControl::SetPollIsDirty(true) whether they are dirty, used when SetPollAllControls(false) */
+  void PollMarkedControls();
+
+  /** Called by IControl::SetAnimation() to add a control to the list of active animations. Controls whose animation has ended are dropped lazily by TickAnimations() */
+  void ScheduleAnimation(IControl* pControl);
+
+  /** Runs the animation function of every active animation once, using a single timestamp for the frame, and marks the animating controls dirty */
+  void TickAnimations();
+
+  /** Removes a control that is about to be deleted from the dirty and polled sets */
+  void ForgetControl(IControl* pControl);
+
+  void SetThrottled(bool throttled);
+
   WDL_PtrList<IControl> mControls;
+  WDL_PtrList<IControl> mDirtyControls; // controls that have been set dirty since the last SetAllControlsClean()
+  WDL_PtrList<IControl> mPolledControls; // controls that override IsDirty(), and must be asked every frame
+  WDL_PtrList<IControl> mAnimatingControls; // controls with an active animation function
 
   // Order (front-to-back) ToolTip / PopUp / TextEntry / LiveEdit / Corner / PerfDisplay
   std::unique_ptr<ICornerResizerControl> mCornerResizer;
@@ -1495,6 +1616,11 @@ private:
   float mDrawScale = 1.f; // scale deviation from  default width and height i.e stretching the UI by dragging bottom right hand corner
 
   int mIdleTicks = 0;
+  int mIdleFrames = 0;
+  int mIdleFPS = DEFAULT_IDLE_FPS;
+  bool mAdaptiveFPS = false;
+  bool mThrottled = false;
+  bool mPollAllControls = true;
   IControl* mMouseCapture = nullptr;
   IControl* mMouseOver = nullptr;
   IControl* mInTextEntry = nullptr;
@@ -1533,6 +1659,7 @@ protected:
   float mXTranslation = 0.f;
   float mYTranslation = 0.f;
   
+  friend class IControl;
   friend class IGraphicsLiveEdit;
   friend class ICornerResizerControl;
   friend class ITextEntryControl;
@@ -18,6 +18,11 @@ static constexpr int DEFAULT_FPS = 25; // TODO: default 60 FPS?
 // Only looked at if USE_IDLE_CALLS is defined.
 static constexpr int IDLE_TICKS = 20;
 
+// When adaptive frame pacing is enabled, the draw timer drops to DEFAULT_IDLE_FPS
+// once no control has been dirty for this many consecutive frames.
+static constexpr int ADAPTIVE_FPS_IDLE_FRAMES = 30;
+static constexpr int DEFAULT_IDLE_FPS = 10;
+
 static constexpr int DEFAULT_ANIMATION_DURATION = 100;
 
 #ifndef CONTROL_BOUNDS_COLOR
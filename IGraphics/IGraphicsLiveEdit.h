@@ -34,6 +34,7 @@ public:
   , mMouseOversEnabled(mouseOversEnabled)
   {
     mTargetRECT = mRECT;
+    SetPollIsDirty(true);
   }
   
   ~IGraphicsLiveEdit()
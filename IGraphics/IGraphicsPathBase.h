@@ -83,11 +83,32 @@ public:
     PathStroke(color, thickness, IStrokeOptions(), pBlend);
   }
   
-  void DrawData(const IColor& color, const IRECT& bounds, float* normYPoints, int nPoints, float* normXPoints, const IBlend* pBlend, float thickness) override
+  void DrawData(const IColor& color, const IRECT& bounds, const float* normYPoints, int nPoints, const float* normXPoints, const IBlend* pBlend, float thickness) override
   {
+    if (nPoints < 1)
+      return;
+    
     PathClear();
     
-    float xPos = bounds.L;
+    const int nColumns = GetDataColumns(bounds, nPoints, normXPoints);
+    
+    if (nColumns)
+    {
+      // Many more points than pixels: stroke the min/max envelope of each pixel column instead
+      mDecimatedPoints.Resize(2 * nColumns, false);
+      float* pEnvelope = mDecimatedPoints.Get();
+      DecimateMinMax(normYPoints, nPoints, nColumns, pEnvelope);
+      
+      PathMoveTo(bounds.L, bounds.B - (bounds.H() * pEnvelope[0]));
+      
+      for (auto i = 1; i < 2 * nColumns; i++)
+        PathLineTo(bounds.L + (bounds.W() * (float) (i / 2) / (float) (nColumns - 1)), bounds.B - (bounds.H() * pEnvelope[i]));
+      
+      PathStroke(color, thickness, IStrokeOptions(), pBlend);
+      return;
+    }
+    
+    float xPos = normXPoints ? bounds.L + (bounds.W() * normXPoints[0]) : bounds.L;
 
     PathMoveTo(xPos, bounds.B - (bounds.H() * normYPoints[0]));
 
@@ -104,6 +125,65 @@ public:
     PathStroke(color, thickness, IStrokeOptions(), pBlend);
   }
   
+  void FillRects(const IColor* colors, const IRECT* rects, int nRects, const IBlend* pBlend) override
+  {
+    // N.B. consecutive rects of the same color are filled as one path, so overlaps within a run are only blended once
+    for (auto i = 0; i < nRects;)
+    {
+      const IColor& color = colors[i];
+      
+      PathClear();
+      
+      for (; i < nRects && colors[i] == color; i++)
+        PathRect(rects[i]);
+      
+      PathFill(color, IFillOptions(), pBlend);
+    }
+  }
+  
+  void DrawLines(const IColor* colors, const float* points, int nLines, const IBlend* pBlend, float thickness) override
+  {
+    for (auto i = 0; i < nLines;)
+    {
+      const IColor& color = colors[i];
+      
+      PathClear();
+      
+      for (; i < nLines && colors[i] == color; i++)
+      {
+        const float* line = points + (i * 4);
+        PathMoveTo(line[0], line[1]);
+        PathLineTo(line[2], line[3]);
+      }
+      
+      PathStroke(color, thickness, IStrokeOptions(), pBlend);
+    }
+  }
+  
+  void DrawPolylines(const IColor* colors, const float* x, const float* y, const int* nPoints, int nPolylines, const IBlend* pBlend, float thickness) override
+  {
+    for (auto p = 0; p < nPolylines;)
+    {
+      const IColor& color = colors[p];
+      
+      PathClear();
+      
+      for (; p < nPolylines && colors[p] == color; p++)
+      {
+        if (nPoints[p] > 0)
+          PathMoveTo(x[0], y[0]);
+        
+        for (auto i = 1; i < nPoints[p]; i++)
+          PathLineTo(x[i], y[i]);
+        
+        x += nPoints[p];
+        y += nPoints[p];
+      }
+      
+      PathStroke(color, thickness, IStrokeOptions(), pBlend);
+    }
+  }
+  
   void DrawDottedLine(const IColor& color, float x1, float y1, float x2, float y2, const IBlend* pBlend, float thickness, float dashLen) override
   {
     PathClear();
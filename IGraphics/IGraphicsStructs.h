@@ -50,6 +50,7 @@ struct IColor;
 
 using IActionFunction = std::function<void(IControl*)>;
 using IAnimationFunction = std::function<void(IControl*)>;
+using IEasingFunction = std::function<double(double)>;
 using ILambdaDrawFunction = std::function<void(ILambdaControl*, IGraphics&, IRECT&)>;
 using IKeyHandlerFunc = std::function<bool(const IKeyPress& key, bool isUp)>;
 using IMsgBoxCompletionHanderFunc = std::function<void(EMsgBoxResult result)>;
@@ -310,9 +311,9 @@ struct IColor
   
   IColor(int a = 255, int r = 0, int g = 0, int b = 0) : A(a), R(r), G(g), B(b) {}
 
-  bool operator==(const IColor& rhs) { return (rhs.A == A && rhs.R == R && rhs.G == G && rhs.B == B); }
+  bool operator==(const IColor& rhs) const { return (rhs.A == A && rhs.R == R && rhs.G == G && rhs.B == B); }
   
-  bool operator!=(const IColor& rhs) { return !operator==(rhs); }
+  bool operator!=(const IColor& rhs) const { return !operator==(rhs); }
   
   /** /todo */
   bool Empty() const { return A == 0 && R == 0 && G == 0 && B == 0; }
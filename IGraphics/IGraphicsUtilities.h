@@ -48,6 +48,136 @@ static inline void RadialPoints(float angleDegrees, float cx, float cy, float rM
   }
 }
 
+/** Reduce a column of points to its minimum and maximum, ordered so that the envelope continues from the previous vertex with the shortest segment.
+ * The reduction only looks at values, so compilers can vectorize it
+ * @param pPoints The points in the column
+ * @param nPoints The number of points in the column, must be > 0
+ * @param prev The last vertex emitted for the previous column
+ * @param out Receives the two vertices for this column */
+static inline void DecimateMinMaxColumn(const float* pPoints, int nPoints, float prev, float* out)
+{
+  float minV = pPoints[0];
+  float maxV = pPoints[0];
+  
+  for (auto i = 1; i < nPoints; i++)
+  {
+    minV = std::min(minV, pPoints[i]);
+    maxV = std::max(maxV, pPoints[i]);
+  }
+  
+  const bool minFirst = std::abs(prev - minV) <= std::abs(prev - maxV);
+  out[0] = minFirst ? minV : maxV;
+  out[1] = minFirst ? maxV : minV;
+}
+
+/** Decimate a polyline of evenly spaced points to a min/max envelope with two vertices per column, e.g. per pixel column. Used by IGraphics::DrawData() when there are more points than pixels
+ * @param normYPoints The input points
+ * @param nPoints The number of input points, must be >= nColumns
+ * @param nColumns The number of columns to decimate to
+ * @param outYPoints An array of 2 * nColumns points to receive the envelope */
+static inline void DecimateMinMax(const float* normYPoints, int nPoints, int nColumns, float* outYPoints)
+{
+  float prev = normYPoints[0];
+  
+  for (auto c = 0; c < nColumns; c++)
+  {
+    const int start = (int) (((int64_t) c * nPoints) / nColumns);
+    const int end = (int) (((int64_t) (c + 1) * nPoints) / nColumns);
+    DecimateMinMaxColumn(normYPoints + start, std::max(end - start, 1), prev, outYPoints + (2 * c));
+    prev = outYPoints[(2 * c) + 1];
+  }
+}
+
+/** A streaming min/max decimator for scrolling waveform displays.
+ * Samples are appended with Add(), every samplesPerColumn samples complete a column and the oldest column scrolls out, so nothing is recomputed for the columns already on screen.
+ * The envelope is stored in a mirrored ring, so GetYPoints() is always contiguous. Pass it to IGraphics::DrawData() with GetXPoints(), which puts the minimum and the maximum of a column at the same x */
+class IMinMaxDecimator
+{
+public:
+  IMinMaxDecimator(int nColumns = 256, int samplesPerColumn = 64, float initialValue = 0.5f)
+  {
+    Resize(nColumns, samplesPerColumn, initialValue);
+  }
+  
+  /** Set the number of columns (typically the width of the display in pixels) and the number of samples per column. Clears the envelope */
+  void Resize(int nColumns, int samplesPerColumn, float initialValue = 0.5f)
+  {
+    mNColumns = std::max(nColumns, 1);
+    mSamplesPerColumn = std::max(samplesPerColumn, 1);
+    mEnvelope.Resize(4 * mNColumns);
+    mColumn.Resize(mSamplesPerColumn);
+    mXPoints.Resize(2 * mNColumns);
+    
+    for (auto c = 0; c < mNColumns; c++)
+      mXPoints.Get()[2 * c] = mXPoints.Get()[(2 * c) + 1] = mNColumns > 1 ? (float) c / (float) (mNColumns - 1) : 0.f;
+
+    Clear(initialValue);
+  }
+  
+  /** Reset the envelope to a constant value */
+  void Clear(float value = 0.5f)
+  {
+    std::fill_n(mEnvelope.Get(), mEnvelope.GetSize(), value);
+    mWritePos = 0;
+    mColumnFill = 0;
+  }
+  
+  /** Append normalized samples. Completed columns are added to the envelope
+   * @param normYPoints The samples to add
+   * @param nPoints The number of samples */
+  void Add(const float* normYPoints, int nPoints)
+  {
+    while (nPoints > 0)
+    {
+      const int n = std::min(nPoints, mSamplesPerColumn - mColumnFill);
+      memcpy(mColumn.Get() + mColumnFill, normYPoints, n * sizeof(float));
+      mColumnFill += n;
+      normYPoints += n;
+      nPoints -= n;
+      
+      if (mColumnFill == mSamplesPerColumn)
+      {
+        AddColumn();
+        mColumnFill = 0;
+      }
+    }
+  }
+  
+  /** @return The envelope, oldest column first, 2 points per column. @see NPoints() */
+  const float* GetYPoints() const { return mEnvelope.Get() + (2 * mWritePos); }
+  
+  /** @return The normalized x position of each point of the envelope, the two points of a column share the column's x. @see GetYPoints() */
+  const float* GetXPoints() const { return mXPoints.Get(); }
+  
+  /** @return The number of points in the envelope */
+  int NPoints() const { return 2 * mNColumns; }
+  
+  int NColumns() const { return mNColumns; }
+  
+private:
+  void AddColumn()
+  {
+    float* pEnvelope = mEnvelope.Get();
+    const int prevPos = (mWritePos + mNColumns - 1) % mNColumns;
+    float pair[2];
+    DecimateMinMaxColumn(mColumn.Get(), mSamplesPerColumn, pEnvelope[(2 * prevPos) + 1], pair);
+    
+    // Write each column twice, so that the last mNColumns columns are always contiguous
+    memcpy(pEnvelope + (2 * mWritePos), pair, sizeof(pair));
+    memcpy(pEnvelope + (2 * (mWritePos + mNColumns)), pair, sizeof(pair));
+    
+    mWritePos = (mWritePos + 1) % mNColumns;
+  }
+  
+  WDL_TypedBuf<float> mEnvelope;
+  WDL_TypedBuf<float> mColumn;
+  WDL_TypedBuf<float> mXPoints;
+  int mNColumns = 0;
+  int mSamplesPerColumn = 0;
+  int mWritePos = 0;
+  int mColumnFill = 0;
+};
+
 #ifdef AAX_API
 #include "AAX_Enums.h"
 
@@ -121,6 +121,12 @@ void IGraphicsIOS::PlatformResize(bool parentHasResized)
   }
 }
 
+void IGraphicsIOS::PlatformSetFrameRate(int fps)
+{
+  if (mView)
+    ((IGraphicsIOS_View*) mView).displayLink.preferredFramesPerSecond = fps;
+}
+
 EMsgBoxResult IGraphicsIOS::ShowMessageBox(const char* str, const char* caption, EMsgBoxType type, IMsgBoxCompletionHanderFunc completionHandler)
 {
   ReleaseMouseCapture();
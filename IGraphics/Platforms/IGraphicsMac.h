@@ -31,6 +31,7 @@ public:
   void CloseWindow() override;
   bool WindowIsOpen() override;
   void PlatformResize(bool parentHasResized) override;
+  void PlatformSetFrameRate(int fps) override;
   
   void PointToScreen(float& x, float& y);
   void ScreenToPoint(float& x, float& y);
@@ -153,6 +153,12 @@ bool IGraphicsMac::WindowIsOpen()
   return mView;
 }
 
+void IGraphicsMac::PlatformSetFrameRate(int fps)
+{
+  if (mView)
+    [(IGRAPHICS_VIEW*) mView setFrameRate: fps];
+}
+
 void IGraphicsMac::PlatformResize(bool parentHasResized)
 {
   if (mView)
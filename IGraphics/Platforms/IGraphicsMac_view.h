@@ -111,6 +111,7 @@ inline IColor FromNSColor(const NSColor* c)
 - (void) render;
 - (void) onTimer: (NSTimer*) pTimer;
 - (void) killTimer;
+- (void) setFrameRate: (int) fps;
 //mouse
 - (void) getMouseXY: (NSEvent*) pEvent x: (float&) pX y: (float&) pY;
 - (IMouseInfo) getMouseLeft: (NSEvent*) pEvent;
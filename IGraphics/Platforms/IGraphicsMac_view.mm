@@ -959,6 +959,17 @@ static void MakeCursorFromName(NSCursor*& cursor, const char *name)
   mTimer = 0;
 }
 
+- (void) setFrameRate: (int) fps
+{
+  if (!mTimer)
+    return;
+  
+  [mTimer invalidate];
+  double sec = 1.0 / (double) fps;
+  mTimer = [NSTimer timerWithTimeInterval:sec target:self selector:@selector(onTimer:) userInfo:nil repeats:YES];
+  [[NSRunLoop currentRunLoop] addTimer: mTimer forMode: (NSString*) kCFRunLoopCommonModes];
+}
+
 - (void) removeFromSuperview
 {
   if (mTextFieldView)
@@ -262,6 +262,12 @@ LRESULT CALLBACK IGraphicsWin::WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARA
           return 0; // TODO: check this!
         }
 
+        // adaptive frame pacing skips ticks rather than slowing the timer, so the text entry above is still handled at FPS()
+        if (++pGraphics->mTimerTick < pGraphics->mTimerTicksPerFrame)
+          return 0;
+
+        pGraphics->mTimerTick = 0;
+
         int scale = GetScaleForWindow(pGraphics->mPlugWnd);
         if (scale != pGraphics->GetScreenScale())
           pGraphics->SetScreenScale(scale);
@@ -703,6 +709,12 @@ void IGraphicsWin::ForceEndUserEdit()
 
 #define SETPOS_FLAGS SWP_NOZORDER | SWP_NOMOVE | SWP_NOACTIVATE
 
+void IGraphicsWin::PlatformSetFrameRate(int fps)
+{
+  mTimerTicksPerFrame = Clip(static_cast<int>(std::round(static_cast<double>(FPS()) / fps)), 1, FPS());
+  mTimerTick = 0;
+}
+
 void IGraphicsWin::PlatformResize(bool parentHasResized)
 {
   if (WindowIsOpen())
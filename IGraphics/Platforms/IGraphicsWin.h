@@ -31,6 +31,7 @@ public:
   int GetPlatformWindowScale() const override { return GetScreenScale(); }
 
   void PlatformResize(bool parentHasResized) override;
+  void PlatformSetFrameRate(int fps) override;
 
 #ifdef IGRAPHICS_GL
   void DrawResize() override; // overriden here to deal with GL graphics context capture
@@ -129,6 +130,8 @@ private:
   IRECT mEditRECT;
 
   EParamEditMsg mParamEditMsg = kNone;
+  int mTimerTicksPerFrame = 1; // the draw timer runs at FPS(), adaptive frame pacing only checks for dirty controls on every Nth tick
+  int mTimerTick = 0;
   bool mShowingTooltip = false;
   float mHiddenCursorX;
   float mHiddenCursorY;
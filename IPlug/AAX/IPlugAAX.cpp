@@ -103,6 +103,7 @@ IPlugAAX::IPlugAAX(IPlugInstanceInfo instanceInfo, IPlugConfig c)
   if (MaxNChannels(ERoute::kInput)) 
   {
     mLatencyDelay = std::unique_ptr<NChanDelayLine<PLUG_SAMPLE_DST>>(new NChanDelayLine<PLUG_SAMPLE_DST>(MaxNChannels(ERoute::kInput), MaxNChannels(ERoute::kOutput)));
+    mLatencyDelay->SetMaxDelayTime(MAX_LATENCY);
     mLatencyDelay->SetDelayTime(c.latency);
   }
   
@@ -211,6 +212,7 @@ AAX_Result IPlugAAX::EffectInit()
   AAX_CSampleRate sr;
   Controller()->GetSampleRate(&sr);
   SetSampleRate(sr);
+  mMidiOutputQueue.Resize(GetBlockSize());
   OnReset();
   
   return AAX_SUCCESS;
@@ -253,6 +255,8 @@ void IPlugAAX::RenderAudio(AAX_SIPlugRenderInfo* pRenderInfo)
 {
   TRACE;
 
+  IPerformanceCounters::ScopedBlock perfBlock(mPerformanceCounters, *(pRenderInfo->mNumSamples), GetSampleRate());
+
   // Get bypass parameter value
   bool bypass;
   mBypassParameter->GetValueAsBool(&bypass);
@@ -291,6 +295,9 @@ void IPlugAAX::RenderAudio(AAX_SIPlugRenderInfo* pRenderInfo)
   SetChannelConnections(ERoute::kOutput, numOutChannels, MaxNChannels(ERoute::kOutput) - numOutChannels, false);
   AttachBuffers(ERoute::kOutput, 0, MaxNChannels(ERoute::kOutput), pRenderInfo->mAudioOutputs, numSamples);
   
+  ProcessParamChangesFromUI(numSamples, GetSampleRate());
+  ProcessMessagesFromBus();
+
   if (bypass) 
     PassThroughBuffers(0.0f, numSamples);
   else 
@@ -363,25 +370,27 @@ void IPlugAAX::RenderAudio(AAX_SIPlugRenderInfo* pRenderInfo)
       mMidiOutputQueue.Flush(numSamples);
       
       //Output SYSEX from the editor, which has bypassed ProcessSysEx()
-      if(mSysExDataFromEditor.ElementsAvailable())
+      if(!mSysExDataFromEditor.WasEmpty())
       {
-        while (mSysExDataFromEditor.Pop(mSysexBuf))
+        ISysEx smsg;
+        
+        while (mSysExDataFromEditor.Read(smsg))
         {
-          int numPackets = (int) ceil((float) mSysexBuf.mSize/4.); // each packet can store 4 bytes of data
+          int numPackets = (int) ceil((float) smsg.mSize/4.); // each packet can store 4 bytes of data
           int bytesPos = 0;
           
           for (int p = 0; p < numPackets; p++)
           {
             AAX_CMidiPacket packet;
             
-            packet.mTimestamp = (uint32_t) mSysexBuf.mOffset;
+            packet.mTimestamp = (uint32_t) smsg.mOffset;
             packet.mIsImmediate = true;
             
             int b = 0;
             
-            while (b < 4 && bytesPos < mSysexBuf.mSize)
+            while (b < 4 && bytesPos < smsg.mSize)
             {
-              packet.mData[b++] = mSysexBuf.mData[bytesPos++];
+              packet.mData[b++] = smsg.mData[bytesPos++];
             }
             
             packet.mLength = (uint32_t) b;
@@ -389,6 +398,8 @@ void IPlugAAX::RenderAudio(AAX_SIPlugRenderInfo* pRenderInfo)
             midiOut->PostMIDIPacket (&packet);
           }
         }
+        
+        mSysExDataFromEditor.Release();
       }
     }
   }
@@ -538,6 +549,11 @@ void IPlugAAX::SetLatency(int latency)
 
 bool IPlugAAX::SendMidiMsg(const IMidiMsg& msg)
 {
-  mMidiOutputQueue.Add(msg);
-  return true;
+  return mMidiOutputQueue.Add(msg);
+}
+
+void IPlugAAX::GetPerformanceStats(IPerformanceStats& stats) const
+{
+  IPlugAPIBase::GetPerformanceStats(stats);
+  stats.mNumMidiQueueOverflows += mMidiOutputQueue.GetNumDropped();
 }
@@ -93,6 +93,9 @@ public:
   void SetLatency(int samples) override;
   bool SendMidiMsg(const IMidiMsg& msg) override;
   
+  //IPlugAPIBase Overrides
+  void GetPerformanceStats(IPerformanceStats& stats) const override;
+  
   AAX_Result UpdateParameterNormalizedValue(AAX_CParamID iParameterID, double iValue, AAX_EUpdateSource iSource) override;
   
   //AAX_CIPlugParameters Overrides
@@ -116,7 +119,7 @@ private:
   AAX_CParameter<bool>* mBypassParameter = nullptr;
   AAX_ITransport* mTransport = nullptr;
   WDL_PtrList<WDL_String> mParamIDs;
-  IMidiQueue mMidiOutputQueue;
+  IMidiQueue mMidiOutputQueue { DEFAULT_BLOCK_SIZE, IMidiQueue::kDropNewest }; // sized by EffectInit(), so that SendMidiMsg() never allocates on the audio thread
 };
 
 IPlugAAX* MakePlug();
@@ -95,6 +95,13 @@ bool IPlugAPP::SendSysEx(const ISysEx& msg)
   return false;
 }
 
+void IPlugAPP::GetPerformanceStats(IPerformanceStats& stats) const
+{
+  IPlugAPIBase::GetPerformanceStats(stats);
+  stats.mNumMidiQueueOverflows += mMidiMsgsFromCallback.GetNumFailedPushes();
+  stats.mNumSysExQueueOverflows += mSysExMsgsFromCallback.GetNumFailedPushes();
+}
+
 void IPlugAPP::SendSysexMsgFromUI(const ISysEx& msg)
 {
   SendSysEx(msg);
@@ -102,6 +109,8 @@ void IPlugAPP::SendSysexMsgFromUI(const ISysEx& msg)
 
 void IPlugAPP::AppProcess(double** inputs, double** outputs, int nFrames)
 {
+  IPerformanceCounters::ScopedBlock perfBlock(mPerformanceCounters, GetBlockSize(), GetSampleRate());
+
   SetChannelConnections(ERoute::kInput, 0, MaxNChannels(ERoute::kInput), !IsInstrument()); //TODO: go elsewhere - enable inputs
   SetChannelConnections(ERoute::kOutput, 0, MaxNChannels(ERoute::kOutput), true); //TODO: go elsewhere
   AttachBuffers(ERoute::kInput, 0, NChannelsConnected(ERoute::kInput), inputs, GetBlockSize());
@@ -118,16 +127,17 @@ void IPlugAPP::AppProcess(double** inputs, double** outputs, int nFrames)
     }
   }
   
-  if(mSysExMsgsFromCallback.ElementsAvailable())
+  if(!mSysExMsgsFromCallback.WasEmpty())
   {
-    SysExData data;
+    ISysEx msg;
     
-    while (mSysExMsgsFromCallback.Pop(data))
+    while (mSysExMsgsFromCallback.Read(msg))
     {
-      ISysEx msg { data.mOffset, data.mData, data.mSize };
       ProcessSysEx(msg);
-      mSysExDataFromProcessor.Push(data); // queue incoming Sysex for UI
+      mSysExDataFromProcessor.Push(msg); // queue incoming Sysex for UI
     }
+    
+    mSysExMsgsFromCallback.Release();
   }
   
   if(mMidiMsgsFromEditor.ElementsAvailable())
@@ -142,5 +152,7 @@ void IPlugAPP::AppProcess(double** inputs, double** outputs, int nFrames)
 
   //Do not handle Sysex messages here - SendSysexMsgFromUI overridden
 
+  ProcessParamChangesFromUI(GetBlockSize(), GetSampleRate());
+  ProcessMessagesFromBus();
   ProcessBuffers(0.0, GetBlockSize());
 }
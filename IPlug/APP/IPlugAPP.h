@@ -42,6 +42,7 @@ public:
   void EndInformHostOfParamChange(int idx) override {};
   void InformHostOfProgramChange() override {};
   bool EditorResizeFromDelegate(int viewWidth, int viewHeight) override;
+  void GetPerformanceStats(IPerformanceStats& stats) const override;
 
   //IEditorDelegate
   void SendSysexMsgFromUI(const ISysEx& msg) override;
@@ -56,7 +57,7 @@ public:
 private:
   IPlugAPPHost* mAppHost = nullptr;
   IPlugQueue<IMidiMsg> mMidiMsgsFromCallback {MIDI_TRANSFER_SIZE};
-  IPlugQueue<SysExData> mSysExMsgsFromCallback {SYSEX_TRANSFER_SIZE};
+  IPlugSysExQueue mSysExMsgsFromCallback {SYSEX_TRANSFER_BYTES};
 
   friend class IPlugAPPHost;
 };
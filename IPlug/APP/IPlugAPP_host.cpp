@@ -708,15 +708,11 @@ void IPlugAPPHost::MIDICallback(double deltatime, std::vector<uint8_t>* pMsg, vo
   
   if (pMsg->size() > 3)
   {
-    if(pMsg->size() > MAX_SYSEX_SIZE)
+    if(!_this->mIPlug->mSysExMsgsFromCallback.Push(0, pMsg->data(), static_cast<int>(pMsg->size())))
     {
-      DBGMSG("SysEx message exceeds MAX_SYSEX_SIZE\n");
-      return;
+      DBGMSG("SysEx message dropped, the queue is full or the message exceeds SYSEX_TRANSFER_BYTES\n");
     }
     
-    SysExData data { 0, static_cast<int>(pMsg->size()), pMsg->data() };
-    
-    _this->mIPlug->mSysExMsgsFromCallback.Push(data);
     return;
   }
   else if (pMsg->size())
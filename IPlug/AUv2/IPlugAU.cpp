@@ -1660,6 +1660,8 @@ OSStatus IPlugAU::RenderProc(void* pPlug, AudioUnitRenderActionFlags* pFlags, co
           {
             _this->AttachBuffers(ERoute::kInput, chIdx, 1, (AudioSampleType**) &(pInBufList->mBuffers[i].mData), nFrames);
           }
+
+          _this->SetInputSilenceFlags(pInBus->mPlugChannelStartIdx, pInBus->mNHostChannels, (flags & kAudioUnitRenderAction_OutputIsSilence) ? ~0ULL : 0);
         }
       }
       _this->mLastRenderSampleTime = renderSampleTime;
@@ -1703,6 +1705,7 @@ OSStatus IPlugAU::RenderProc(void* pPlug, AudioUnitRenderActionFlags* pFlags, co
 
   if (_this->IsMidiEffect() || outputBusIdx == lastConnectedOutputBus)
   {
+    IPerformanceCounters::ScopedBlock perfBlock(_this->mPerformanceCounters, nFrames, _this->GetSampleRate());
     int busIdx1based = outputBusIdx+1;
 
     if (busIdx1based < _this->mOutBuses.GetSize() /*&& (_this->GetHost() != kHostAbletonLive)*/)
@@ -1712,6 +1715,9 @@ OSStatus IPlugAU::RenderProc(void* pPlug, AudioUnitRenderActionFlags* pFlags, co
       _this->SetChannelConnections(ERoute::kOutput, nConnected, totalNumChans - nConnected, false); // this will disconnect the channels that are on the unconnected buses
     }
 
+    _this->ProcessParamChangesFromUI(nFrames, _this->GetSampleRate());
+    _this->ProcessMessagesFromBus();
+
     if (_this->GetBypassed())
     {
       _this->PassThroughBuffers((AudioSampleType) 0, nFrames);
@@ -1730,6 +1736,9 @@ OSStatus IPlugAU::RenderProc(void* pPlug, AudioUnitRenderActionFlags* pFlags, co
       
       _this->PreProcess();
       _this->ProcessBuffers((AudioSampleType) 0, nFrames);
+
+      if (_this->GetOutputsSilent())
+        *pFlags |= kAudioUnitRenderAction_OutputIsSilence;
     }
   }
 
@@ -2063,13 +2072,16 @@ bool IPlugAU::SendSysEx(const ISysEx& sysEx)
 void IPlugAU::OutputSysexFromEditor()
 {
   //Output SYSEX from the editor, which has bypassed ProcessSysEx()
-  if(mSysExDataFromEditor.ElementsAvailable())
+  if(!mSysExDataFromEditor.WasEmpty())
   {
-    while (mSysExDataFromEditor.Pop(mSysexBuf))
+    ISysEx smsg;
+
+    while (mSysExDataFromEditor.Read(smsg))
     {
-      ISysEx smsg {mSysexBuf.mOffset, mSysexBuf.mData, mSysexBuf.mSize};
       SendSysEx(smsg);
     }
+
+    mSysExDataFromEditor.Release();
   }
 }
 
@@ -0,0 +1,72 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#include "IPlugCLI.h"
+
+IPlugCLI::IPlugCLI(IPlugInstanceInfo instanceInfo, IPlugConfig c)
+: IPlugAPIBase(c, kAPICLI)
+, IPlugProcessor<PLUG_SAMPLE_DST>(c, kAPICLI)
+{
+  Trace(TRACELOC, "%s%s", c.pluginName, c.channelIOStr);
+
+  SetChannelConnections(ERoute::kInput, 0, MaxNChannels(ERoute::kInput), !IsInstrument());
+  SetChannelConnections(ERoute::kOutput, 0, MaxNChannels(ERoute::kOutput), true);
+
+  SetBlockSize(DEFAULT_BLOCK_SIZE);
+
+  CreateTimer();
+}
+
+void IPlugCLI::Prepare(double sampleRate, int blockSize)
+{
+  SetSampleRate(sampleRate);
+  SetBlockSize(blockSize);
+  OnParamReset(kReset);
+  OnActivate(true);
+  OnReset();
+}
+
+void IPlugCLI::SetParameterFromHost(int paramIdx, double normalizedValue, int sampleOffset)
+{
+  if (paramIdx < 0 || paramIdx >= NParams())
+    return;
+
+  ENTER_PARAMS_MUTEX;
+  GetParam(paramIdx)->SetNormalized(normalizedValue);
+  OnParamChange(paramIdx, kHost, sampleOffset);
+  LEAVE_PARAMS_MUTEX;
+}
+
+void IPlugCLI::ProcessHostBlock(sample** inputs, sample** outputs, int nFrames, const ITimeInfo& timeInfo)
+{
+  IPerformanceCounters::ScopedBlock perfBlock(mPerformanceCounters, nFrames, GetSampleRate());
+
+  SetTimeInfo(timeInfo);
+  AttachBuffers(ERoute::kInput, 0, NChannelsConnected(ERoute::kInput), inputs, nFrames);
+  AttachBuffers(ERoute::kOutput, 0, NChannelsConnected(ERoute::kOutput), outputs, nFrames);
+  ProcessParamChangesFromUI(nFrames, GetSampleRate());
+  ProcessMessagesFromBus();
+  ProcessBuffers((sample) 0, nFrames);
+}
+
+void IPlugCLI::ProcessTimers()
+{
+  // there is no event loop, so service the platform's timers from here
+#if defined OS_LINUX
+  Timer_impl::ProcessTimers();
+#elif defined OS_MAC
+  CFRunLoopRunInMode(kCFRunLoopDefaultMode, 0., false);
+#elif defined OS_WIN
+  MSG msg;
+
+  while (PeekMessage(&msg, NULL, WM_TIMER, WM_TIMER, PM_REMOVE))
+    DispatchMessage(&msg);
+#endif
+}
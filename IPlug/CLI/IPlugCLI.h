@@ -0,0 +1,74 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#ifndef _IPLUGAPI_
+#define _IPLUGAPI_
+
+/**
+ * @file
+ * @copydoc IPlugCLI
+ */
+
+#include "IPlugPlatform.h"
+#include "IPlugAPIBase.h"
+#include "IPlugProcessor.h"
+
+/** Used to pass various instance info to the API class */
+struct IPlugInstanceInfo
+{};
+
+/** Command line API class, which lets IPlugCLI_main.cpp render a plug-in offline and headless, faster than real time, for profiling and regression tests.
+ * The host drives the plug-in from a single thread, so "audio thread" callbacks and parameter changes all happen on the calling thread.
+ * It is also the main thread: the host calls ProcessTimers() between blocks, which calls OnIdle() and the other timer work of IPlugAPIBase::OnTimer().
+ * Build it with CLI_API, NO_IGRAPHICS and IPLUG_DSP=1, see common-cli.mk
+ * @ingroup APIClasses */
+class IPlugCLI : public IPlugAPIBase
+               , public IPlugProcessor<PLUG_SAMPLE_DST>
+{
+public:
+  IPlugCLI(IPlugInstanceInfo instanceInfo, IPlugConfig config);
+
+  //IPlugProcessor
+  bool SendMidiMsg(const IMidiMsg& msg) override { mNumMidiMsgsSent++; return true; }
+  bool SendSysEx(const ISysEx& msg) override { mNumMidiMsgsSent++; return true; }
+
+  //IPlugCLI
+  /** Set up the plug-in for processing, like a host does before it starts the transport
+   * @param sampleRate The sample rate
+   * @param blockSize The maximum number of frames that will be passed to ProcessHostBlock() */
+  void Prepare(double sampleRate, int blockSize);
+
+  /** Change a parameter as host automation would, before the next call to ProcessHostBlock()
+   * @param paramIdx The parameter index
+   * @param normalizedValue The new normalized value
+   * @param sampleOffset The offset of the change in the next block */
+  void SetParameterFromHost(int paramIdx, double normalizedValue, int sampleOffset);
+
+  /** Process one block of audio. Any MIDI messages for the block should have been passed to ProcessMidiMsg() first
+   * @param inputs The input buffers, one per input channel
+   * @param outputs The output buffers, one per output channel
+   * @param nFrames The number of frames to process, up to the block size passed to Prepare()
+   * @param timeInfo The transport state at the start of the block */
+  void ProcessHostBlock(sample** inputs, sample** outputs, int nFrames, const ITimeInfo& timeInfo);
+
+  /** Call the plug-in's timer, and any other timers that are due, on the calling thread. Call this between blocks, it doesn't block.
+   * The timers run on wall clock time, so when rendering faster than real time they fire less often per block than they would in a host */
+  void ProcessTimers();
+
+  /** @return The number of MIDI and SysEx messages the plug-in has sent */
+  int GetNumMidiMsgsSent() const { return mNumMidiMsgsSent; }
+
+private:
+  int mNumMidiMsgsSent = 0;
+};
+
+IPlugCLI* MakePlug();
+
+#endif
@@ -0,0 +1,535 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/**
+ * @file
+ * @brief The command line offline host. Renders a plug-in built with CLI_API from an optional audio file and an optional script of MIDI and
+ * parameter automation events, reports the distribution of the time taken to process each block and a hash of the output.
+ *
+ * Script format, one event per line, times in seconds, lines starting with # are ignored:
+ *   0.0 note <channel> <note> <velocity>     note on, channels are 0 based
+ *   1.0 off <channel> <note>                 note off
+ *   0.5 cc <channel> <controller> <value>    control change, value 0-127
+ *   0.5 bend <channel> <value>               pitch bend, value -1 to 1
+ *   0.5 midi <status> <data1> <data2>        any other short message
+ *   0.5 param <index> <value>                parameter change, normalized value 0-1
+ *
+ * MIDI events are delivered with their sample offset within the block. Blocks are split at parameter changes, so that they apply at the
+ * same sample whatever the block size, and a plug-in whose output does not depend on the block size renders the same output hash at every block size.
+ */
+
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "wdlstring.h"
+#include "heapbuf.h"
+#include "ptrlist.h"
+#include "lineparse.h"
+#include "fnv64.h"
+#include "wavwrite.h"
+
+#include "IPlugCLI.h"
+#include "config.h"
+
+struct CLIMidiEvent
+{
+  int64_t mTime; // in samples
+  IMidiMsg mMsg;
+};
+
+struct CLIParamEvent
+{
+  int64_t mTime; // in samples
+  int mParamIdx;
+  double mValue;
+};
+
+struct CLIScript
+{
+  WDL_TypedBuf<CLIMidiEvent> mMidiEvents;
+  WDL_TypedBuf<CLIParamEvent> mParamEvents;
+};
+
+struct CLIOptions
+{
+  const char* mInputPath = nullptr;
+  const char* mOutputPath = nullptr;
+  const char* mScriptPath = nullptr;
+  double mSampleRate = 0.;
+  WDL_TypedBuf<int> mBlockSizes;
+  double mLength = 0.;
+  int mRepeats = 1;
+  double mTempo = DEFAULT_TEMPO;
+  const char* mExpectedHash = nullptr;
+};
+
+struct CLIRunResult
+{
+  WDL_UINT64 mHash = WDL_FNV64_IV;
+  double mTotalTime = 0.;
+  WDL_TypedBuf<double> mBlockTimes; // in seconds
+  IPerformanceStats mStats;
+  int mNumMidiMsgsSent = 0;
+};
+
+static void PrintUsage(const char* name)
+{
+  printf("usage: %s [options]\n"
+         "  -i, --input <file.wav>   audio input, otherwise the inputs are silent\n"
+         "  -o, --output <file.wav>  write the output of the first run as a 24 bit WAV file\n"
+         "  -s, --script <file>      MIDI and parameter automation events, see IPlugCLI_main.cpp\n"
+         "  -r, --rate <hz>          sample rate, by default the input file's or 44100\n"
+         "  -b, --block <n[,n...]>   block sizes to render at, default 512\n"
+         "  -l, --length <seconds>   length to render, by default the input file's length, or 10 seconds\n"
+         "  -n, --repeat <n>         render each block size n times, to benchmark and check the output is deterministic\n"
+         "  -t, --tempo <bpm>        transport tempo, default %g\n"
+         "  -x, --hash <hex>         the expected output hash, exit with an error if any run differs\n", name, DEFAULT_TEMPO);
+}
+
+static bool ParseOptions(int argc, char* argv[], CLIOptions& options)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    const char* arg = argv[i];
+    auto Is = [arg](const char* shortName, const char* longName) { return !strcmp(arg, shortName) || !strcmp(arg, longName); };
+
+    if (Is("-h", "--help") || i + 1 >= argc)
+      return false;
+
+    const char* value = argv[++i];
+
+    if (Is("-i", "--input")) options.mInputPath = value;
+    else if (Is("-o", "--output")) options.mOutputPath = value;
+    else if (Is("-s", "--script")) options.mScriptPath = value;
+    else if (Is("-r", "--rate")) options.mSampleRate = atof(value);
+    else if (Is("-l", "--length")) options.mLength = atof(value);
+    else if (Is("-n", "--repeat")) options.mRepeats = std::max(1, atoi(value));
+    else if (Is("-t", "--tempo")) options.mTempo = atof(value);
+    else if (Is("-x", "--hash")) options.mExpectedHash = value;
+    else if (Is("-b", "--block"))
+    {
+      for (const char* pSize = value; pSize; pSize = strchr(pSize, ','), pSize = pSize ? pSize + 1 : nullptr)
+      {
+        const int blockSize = atoi(pSize);
+
+        if (blockSize <= 0)
+          return false;
+
+        options.mBlockSizes.Add(blockSize);
+      }
+    }
+    else
+    {
+      fprintf(stderr, "unknown option %s\n", arg);
+      return false;
+    }
+  }
+
+  if (!options.mBlockSizes.GetSize())
+    options.mBlockSizes.Add(512);
+
+  return true;
+}
+
+#pragma mark - WAV input
+
+static uint32_t ReadLE(const unsigned char* p, int nBytes)
+{
+  uint32_t value = 0;
+
+  for (int i = nBytes - 1; i >= 0; i--)
+    value = (value << 8) | p[i];
+
+  return value;
+}
+
+/** Reads 16, 24 or 32 bit PCM, or 32 or 64 bit float WAV files, into interleaved samples */
+static bool ReadWavFile(const char* path, WDL_TypedBuf<sample>& samples, int& nChans, double& sampleRate)
+{
+  FILE* fp = fopen(path, "rb");
+
+  if (!fp)
+    return false;
+
+  WDL_HeapBuf file;
+  fseek(fp, 0, SEEK_END);
+  const long size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  const bool read = size > 12 && file.ResizeOK((int) size, false) && fread(file.Get(), 1, size, fp) == (size_t) size;
+  fclose(fp);
+
+  const unsigned char* pData = (const unsigned char*) file.Get();
+
+  if (!read || memcmp(pData, "RIFF", 4) || memcmp(pData + 8, "WAVE", 4))
+    return false;
+
+  int format = 0, bits = 0;
+  nChans = 0;
+
+  for (long pos = 12; pos + 8 <= size;)
+  {
+    const long chunkSize = (long) ReadLE(pData + pos + 4, 4);
+    const unsigned char* pChunk = pData + pos + 8;
+    const long available = std::min(chunkSize, size - pos - 8);
+
+    if (!memcmp(pData + pos, "fmt ", 4) && available >= 16)
+    {
+      format = (int) ReadLE(pChunk, 2);
+      nChans = (int) ReadLE(pChunk + 2, 2);
+      sampleRate = (double) ReadLE(pChunk + 4, 4);
+      bits = (int) ReadLE(pChunk + 14, 2);
+
+      if (format == 0xFFFE && available >= 26) // WAVE_FORMAT_EXTENSIBLE, the sub format GUID starts with the format tag
+        format = (int) ReadLE(pChunk + 24, 2);
+    }
+    else if (!memcmp(pData + pos, "data", 4) && nChans > 0)
+    {
+      const int bytesPerSample = bits / 8;
+      const bool isFloat = format == 3;
+
+      if ((format != 1 && !isFloat) || (isFloat && bits != 32 && bits != 64) || (!isFloat && (bits < 16 || bits > 32 || bits % 8)))
+        return false;
+
+      const int n = (int) (available / bytesPerSample);
+      samples.Resize(n - n % nChans);
+
+      for (int i = 0; i < samples.GetSize(); i++)
+      {
+        const unsigned char* p = pChunk + i * bytesPerSample;
+
+        if (isFloat && bits == 32)
+        {
+          float f;
+          memcpy(&f, p, 4);
+          samples.Get()[i] = (sample) f;
+        }
+        else if (isFloat)
+        {
+          double d;
+          memcpy(&d, p, 8);
+          samples.Get()[i] = (sample) d;
+        }
+        else
+        {
+          const int shift = 32 - bits;
+          const int32_t v = (int32_t) (ReadLE(p, bytesPerSample) << shift);
+          samples.Get()[i] = (sample) (v / 2147483648.);
+        }
+      }
+
+      return true;
+    }
+
+    pos += 8 + chunkSize + (chunkSize & 1);
+  }
+
+  return false;
+}
+
+#pragma mark - Script
+
+template <class T>
+static void SortByTime(WDL_TypedBuf<T>& events)
+{
+  // a stable sort keeps events at the same time in script order
+  std::stable_sort(events.Get(), events.Get() + events.GetSize(), [](const T& a, const T& b) { return a.mTime < b.mTime; });
+}
+
+static bool ReadScript(const char* path, double sampleRate, CLIScript& script)
+{
+  FILE* fp = fopen(path, "r");
+
+  if (!fp)
+    return false;
+
+  char line[1024];
+  int lineNumber = 0;
+  bool ok = true;
+  LineParser lp;
+
+  while (fgets(line, sizeof(line), fp))
+  {
+    lineNumber++;
+
+    if (lp.parse(line) || !lp.getnumtokens() || lp.gettoken_str(0)[0] == '#')
+      continue;
+
+    const int nTokens = lp.getnumtokens();
+    const char* type = nTokens > 1 ? lp.gettoken_str(1) : "";
+    const int64_t time = (int64_t) (std::max(0., lp.gettoken_float(0)) * sampleRate + 0.5);
+    const int channel = nTokens > 2 ? lp.gettoken_int(2) & 0xF : 0;
+    CLIMidiEvent midiEvent { time, IMidiMsg() };
+
+    if (!strcmp(type, "note") && nTokens == 5)
+      midiEvent.mMsg.MakeNoteOnMsg(lp.gettoken_int(3), lp.gettoken_int(4), 0, channel);
+    else if (!strcmp(type, "off") && nTokens == 4)
+      midiEvent.mMsg.MakeNoteOffMsg(lp.gettoken_int(3), 0, channel);
+    else if (!strcmp(type, "cc") && nTokens == 5)
+      midiEvent.mMsg.MakeControlChangeMsg((IMidiMsg::EControlChangeMsg) lp.gettoken_int(3), lp.gettoken_int(4) / 127., channel);
+    else if (!strcmp(type, "bend") && nTokens == 4)
+      midiEvent.mMsg.MakePitchWheelMsg(lp.gettoken_float(3), channel);
+    else if (!strcmp(type, "midi") && nTokens == 5)
+      midiEvent.mMsg = IMidiMsg(0, (uint8_t) lp.gettoken_int(2), (uint8_t) lp.gettoken_int(3), (uint8_t) lp.gettoken_int(4));
+    else if (!strcmp(type, "param") && nTokens == 4)
+    {
+      script.mParamEvents.Add({ time, lp.gettoken_int(2), Clip(lp.gettoken_float(3), 0., 1.) });
+      continue;
+    }
+    else
+    {
+      fprintf(stderr, "%s:%d: can't parse event: %s", path, lineNumber, line);
+      ok = false;
+      continue;
+    }
+
+    script.mMidiEvents.Add(midiEvent);
+  }
+
+  fclose(fp);
+  SortByTime(script.mMidiEvents);
+  SortByTime(script.mParamEvents);
+  return ok;
+}
+
+#pragma mark - Rendering
+
+/** Renders with a new instance of the plug-in
+ * @return \c false if the output file could not be written */
+static bool Render(const CLIOptions& options, double sampleRate, int blockSize, int64_t nFrames, const WDL_TypedBuf<sample>& input, int nInputFileChans,
+                   const CLIScript& script, const char* outputPath, CLIRunResult& result)
+{
+  std::unique_ptr<IPlugCLI> pPlug(MakePlug());
+  pPlug->SetHost("IPlugCLI", 0);
+  pPlug->Prepare(sampleRate, blockSize);
+
+  const int nIn = pPlug->MaxNChannels(ERoute::kInput);
+  const int nOut = pPlug->MaxNChannels(ERoute::kOutput);
+  std::unique_ptr<WaveWriter> pWriter;
+
+  if (outputPath)
+  {
+    pWriter.reset(new WaveWriter(outputPath, 24, nOut, (int) sampleRate, 0));
+
+    if (!pWriter->Status())
+      return false;
+  }
+
+  WDL_TypedBuf<sample> inputBuf, outputBuf;
+  WDL_TypedBuf<sample*> inputs, outputs;
+  inputBuf.Resize(std::max(nIn, 1) * blockSize);
+  outputBuf.Resize(std::max(nOut, 1) * blockSize);
+  inputs.Resize(nIn);
+  outputs.Resize(nOut);
+
+  for (int c = 0; c < nIn; c++)
+    inputs.Get()[c] = inputBuf.Get() + c * blockSize;
+
+  for (int c = 0; c < nOut; c++)
+    outputs.Get()[c] = outputBuf.Get() + c * blockSize;
+
+  result.mBlockTimes.Resize((int) (nFrames / blockSize) + script.mParamEvents.GetSize() + 1); // preallocate
+  result.mBlockTimes.Resize(0, false);
+  result.mHash = WDL_FNV64_IV;
+
+  ITimeInfo timeInfo;
+  timeInfo.mTempo = options.mTempo;
+  timeInfo.mTransportIsRunning = true;
+  const double samplesPerBeat = sampleRate * 60. / options.mTempo;
+  const int64_t nInputFrames = nInputFileChans ? input.GetSize() / nInputFileChans : 0;
+  const CLIParamEvent* pParamEvent = script.mParamEvents.Get();
+  const CLIParamEvent* pParamEnd = pParamEvent + script.mParamEvents.GetSize();
+  const CLIMidiEvent* pMidiEvent = script.mMidiEvents.Get();
+  const CLIMidiEvent* pMidiEnd = pMidiEvent + script.mMidiEvents.GetSize();
+
+  for (int64_t pos = 0; pos < nFrames;)
+  {
+    int n = (int) std::min<int64_t>(blockSize, nFrames - pos);
+
+    // apply parameter changes at the start of the block, and end the block at the next one
+    for (; pParamEvent < pParamEnd && pParamEvent->mTime <= pos; pParamEvent++)
+      pPlug->SetParameterFromHost(pParamEvent->mParamIdx, pParamEvent->mValue, 0);
+
+    if (pParamEvent < pParamEnd && pParamEvent->mTime < pos + n)
+      n = (int) (pParamEvent->mTime - pos);
+
+    for (; pMidiEvent < pMidiEnd && pMidiEvent->mTime < pos + n; pMidiEvent++)
+    {
+      IMidiMsg msg = pMidiEvent->mMsg;
+      msg.mOffset = (int) (pMidiEvent->mTime - pos);
+      pPlug->ProcessMidiMsg(msg);
+    }
+
+    for (int c = 0; c < nIn; c++)
+    {
+      sample* pIn = inputs.Get()[c];
+
+      for (int s = 0; s < n; s++)
+        pIn[s] = (c < nInputFileChans && pos + s < nInputFrames) ? input.Get()[(pos + s) * nInputFileChans + c] : 0.;
+    }
+
+    timeInfo.mSamplePos = (double) pos;
+    timeInfo.mPPQPos = pos / samplesPerBeat;
+    timeInfo.mLastBar = std::floor(timeInfo.mPPQPos / timeInfo.mNumerator) * timeInfo.mNumerator;
+
+    const auto start = std::chrono::steady_clock::now();
+    pPlug->ProcessHostBlock(inputs.Get(), outputs.Get(), n, timeInfo);
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    result.mBlockTimes.Add(elapsed);
+    result.mTotalTime += elapsed;
+
+    pPlug->ProcessTimers(); // outside the timed block, as the host's main thread would
+
+    // hash interleaved frames, so the hash doesn't depend on the block size
+    for (int s = 0; s < n; s++)
+    {
+      for (int c = 0; c < nOut; c++)
+        result.mHash = WDL_FNV64(result.mHash, (const unsigned char*) (outputs.Get()[c] + s), sizeof(sample));
+    }
+
+    if (pWriter)
+    {
+#ifdef SAMPLE_TYPE_FLOAT
+      pWriter->WriteFloatsNI(outputs.Get(), 0, n, nOut);
+#else
+      pWriter->WriteDoublesNI(outputs.Get(), 0, n, nOut);
+#endif
+    }
+
+    pos += n;
+  }
+
+  pPlug->GetPerformanceStats(result.mStats);
+  result.mNumMidiMsgsSent = pPlug->GetNumMidiMsgsSent();
+  return true;
+}
+
+static double Percentile(const WDL_TypedBuf<double>& sorted, double fraction)
+{
+  if (!sorted.GetSize())
+    return 0.;
+
+  return sorted.Get()[std::min(sorted.GetSize() - 1, (int) (fraction * sorted.GetSize()))];
+}
+
+static void PrintResult(double sampleRate, int blockSize, int64_t nFrames, CLIRunResult& result)
+{
+  WDL_TypedBuf<double>& times = result.mBlockTimes;
+  std::sort(times.Get(), times.Get() + times.GetSize());
+
+  const double duration = nFrames / sampleRate;
+  WDL_String summary;
+  result.mStats.GetSummary(summary);
+
+  printf("block size %d @ %g Hz: %lld frames (%.2f s) in %.3f s, %.1fx real time\n", blockSize, sampleRate, (long long) nFrames, duration,
+         result.mTotalTime, result.mTotalTime > 0. ? duration / result.mTotalTime : 0.);
+  printf("  block time (us): min %.1f  p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n", Percentile(times, 0.) * 1e6, Percentile(times, 0.5) * 1e6,
+         Percentile(times, 0.9) * 1e6, Percentile(times, 0.99) * 1e6, Percentile(times, 1.) * 1e6);
+  printf("  %s\n", summary.Get());
+
+  if (result.mNumMidiMsgsSent)
+    printf("  MIDI messages sent: %d\n", result.mNumMidiMsgsSent);
+
+  printf("  output hash: %016llx\n", (unsigned long long) result.mHash);
+}
+
+int main(int argc, char* argv[])
+{
+  CLIOptions options;
+
+  if (!ParseOptions(argc, argv, options))
+  {
+    PrintUsage(argv[0]);
+    return 2;
+  }
+
+  WDL_TypedBuf<sample> input;
+  int nInputFileChans = 0;
+  double fileSampleRate = DEFAULT_SAMPLE_RATE;
+
+  if (options.mInputPath && !ReadWavFile(options.mInputPath, input, nInputFileChans, fileSampleRate))
+  {
+    fprintf(stderr, "can't read %s, it should be a 16, 24 or 32 bit PCM or a floating point WAV file\n", options.mInputPath);
+    return 2;
+  }
+
+  const double sampleRate = options.mSampleRate > 0. ? options.mSampleRate : fileSampleRate;
+
+  if (options.mInputPath && sampleRate != fileSampleRate)
+    fprintf(stderr, "warning: %s is at %g Hz, rendering at %g Hz without resampling\n", options.mInputPath, fileSampleRate, sampleRate);
+
+  CLIScript script;
+
+  if (options.mScriptPath && !ReadScript(options.mScriptPath, sampleRate, script))
+  {
+    fprintf(stderr, "can't read script %s\n", options.mScriptPath);
+    return 2;
+  }
+
+  int64_t nFrames;
+
+  if (options.mLength > 0.)
+    nFrames = (int64_t) (options.mLength * sampleRate);
+  else if (nInputFileChans)
+    nFrames = input.GetSize() / nInputFileChans;
+  else
+    nFrames = (int64_t) (10. * sampleRate);
+
+  bool hashMismatch = false;
+
+  printf("%s %s (%s), %d MIDI events, %d parameter changes\n", PLUG_NAME, PLUG_VERSION_STR, PLUG_CHANNEL_IO,
+         script.mMidiEvents.GetSize(), script.mParamEvents.GetSize());
+
+  for (int b = 0; b < options.mBlockSizes.GetSize(); b++)
+  {
+    const int blockSize = options.mBlockSizes.Get()[b];
+    CLIRunResult total;
+    WDL_UINT64 firstHash = 0;
+
+    for (int r = 0; r < options.mRepeats; r++)
+    {
+      CLIRunResult result;
+      const char* outputPath = (b == 0 && r == 0) ? options.mOutputPath : nullptr;
+
+      if (!Render(options, sampleRate, blockSize, nFrames, input, nInputFileChans, script, outputPath, result))
+      {
+        fprintf(stderr, "can't write %s\n", outputPath);
+        return 2;
+      }
+
+      if (r == 0)
+        firstHash = result.mHash;
+      else if (result.mHash != firstHash)
+        printf("  run %d output hash %016llx differs from the first run, the output is not deterministic\n", r + 1, (unsigned long long) result.mHash);
+
+      // accumulate the block times of all repeats, the stats are of the last run
+      total.mTotalTime += result.mTotalTime;
+      total.mBlockTimes.Add(result.mBlockTimes.Get(), result.mBlockTimes.GetSize());
+      total.mStats = result.mStats;
+      total.mNumMidiMsgsSent = result.mNumMidiMsgsSent;
+    }
+
+    total.mHash = firstHash;
+    PrintResult(sampleRate, blockSize, nFrames * options.mRepeats, total);
+
+    if (options.mExpectedHash && strtoull(options.mExpectedHash, nullptr, 16) != firstHash)
+    {
+      printf("  output hash differs from the expected %s\n", options.mExpectedHash);
+      hashMismatch = true;
+    }
+  }
+
+  return hashMismatch ? 1 : 0;
+}
@@ -8,6 +8,17 @@
  ==============================================================================
  */
 
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <functional>
+
+#include "IPlugUtilities.h"
+
+/** An ADSR envelope with a linear attack and exponential decay and release.
+ * Process() renders one sample, ProcessBlock() renders a block a stage at a time, without branching per sample */
 template <typename T>
 class ADSREnvelope
 {
@@ -54,6 +65,18 @@ private:
   bool mSustainEnabled = true; // when false env is AD only
   
   std::function<void()> mResetFunc = nullptr; // reset func
+  int mStageFramesLeft = -1; // the samples ProcessBlock() can render before the stage might end, -1 when it needs working out
+
+  /** The current stage as the recursion mEnvValue = mEnvValue * mul + add, where either mul is 1 or add is 0. The result of a sample is
+   * mEnvValue * (envGain - sustainEnvGain * sustainLevel) + sustainGain * sustainLevel, which is then scaled by mLevel */
+  struct Segment
+  {
+    T mul = 1.;
+    T add = 0.;
+    T envGain = 1.;
+    T sustainEnvGain = 0.;
+    T sustainGain = 0.;
+  };
 
 public:
   ADSREnvelope(const char* name = "", std::function<void()> resetFunc = nullptr, bool sustainEnabled = true)
@@ -64,8 +87,16 @@ public:
     SetSampleRate(44100.);
   }
 
+  /** @param resetFunc Called from Process() when a retriggered envelope has faded out and restarts its attack, e.g. to reset an oscillator */
+  void SetResetFunc(std::function<void()> resetFunc)
+  {
+    mResetFunc = resetFunc;
+  }
+
   void SetStageTime(int stage, T timeMS)
   {
+    mStageFramesLeft = -1;
+
     switch(stage)
     {
       case kAttack:
@@ -100,6 +131,7 @@ public:
   
   inline void Start(T level, T timeScalar = 1.)
   {
+    mStageFramesLeft = -1;
     mStage = kAttack;
     mEnvValue = 0.;
     mLevel = level;
@@ -109,6 +141,7 @@ public:
 
   inline void Release()
   {
+    mStageFramesLeft = -1;
     mStage = kRelease;
     mReleaseLevel = mPrevResult;
     mEnvValue = 1.;
@@ -117,6 +150,7 @@ public:
 
   inline void Retrigger(T newStartLevel, T timeScalar = 1.)
   {
+    mStageFramesLeft = -1;
     mEnvValue = 1.;
     mNewStartLevel = newStartLevel;
     mScalar = 1./timeScalar;
@@ -131,6 +165,8 @@ public:
 
   inline void Kill(bool hard)
   {
+    mStageFramesLeft = -1;
+
     if(hard)
     {
       if (mStage != kIdle)
@@ -161,6 +197,7 @@ public:
 
   void SetSampleRate(T sr)
   {
+    mStageFramesLeft = -1;
     mSampleRate = sr;
     mEarlyReleaseIncr = CalcIncrFromTimeLinear(EARLY_RELEASE_TIME, sr);
     mRetriggerReleaseIncr = CalcIncrFromTimeLinear(RETRIGGER_RELEASE_TIME, sr);
@@ -169,6 +206,7 @@ public:
   inline T Process(T sustainLevel = 0.)
   {
     T result = 0.;
+    mStageFramesLeft = -1;
 
     switch(mStage)
     {
@@ -247,7 +285,196 @@ public:
     mPrevOutput = (result * mLevel);
     return mPrevOutput;
   }
+
+  /** Render a block, which gives the same result as calling Process() for each sample, up to rounding.
+   * Each stage is rendered in closed form up to the sample before it ends, only the sample that crosses into the next stage goes through Process().
+   * Where the envelope is right at a threshold, the rounding can end a stage a sample apart. With T = float the closed form is the more accurate:
+   * over a long decay, Process() accumulates errors of up to about 1%
+   * @param pOutput The output buffer
+   * @param pSustainLevels The sustain level of each sample, e.g. from a smoother
+   * @param nFrames The number of samples */
+  void ProcessBlock(T* pOutput, const T* pSustainLevels, int nFrames)
+  {
+    ProcessBlock(pOutput, pSustainLevels, 0., nFrames);
+  }
+
+  /** Render a block with a constant sustain level, see ProcessBlock() */
+  void ProcessBlock(T* pOutput, T sustainLevel, int nFrames)
+  {
+    ProcessBlock(pOutput, nullptr, sustainLevel, nFrames);
+  }
+
 private:
+  void ProcessBlock(T* pOutput, const T* pSustainLevels, T sustainLevel, int nFrames)
+  {
+    auto s = 0;
+
+    while (s < nFrames)
+    {
+      const Segment seg = GetSegment();
+
+      if (mStageFramesLeft < 0)
+        mStageFramesLeft = CalcStageFrames(seg);
+
+      const int n = std::min(mStageFramesLeft, nFrames - s);
+
+      if (n > 0)
+      {
+        RenderSegment(seg, pOutput + s, pSustainLevels ? pSustainLevels + s : nullptr, sustainLevel, n);
+        s += n;
+
+        if (mStageFramesLeft != INT_MAX)
+          mStageFramesLeft -= n;
+      }
+
+      if (s < nFrames)
+      {
+        pOutput[s] = Process(pSustainLevels ? pSustainLevels[s] : sustainLevel);
+        s++;
+      }
+    }
+  }
+
+  /** @return The stage that the envelope is in, see Segment */
+  Segment GetSegment() const
+  {
+    Segment seg;
+
+    switch(mStage)
+    {
+      case kIdle:
+        break;
+      case kAttack:
+        seg.add = mAttackIncr * mScalar;
+        break;
+      case kDecay:
+        seg.mul = 1. - mDecayIncr * mScalar;
+        seg.sustainEnvGain = 1.;
+        seg.sustainGain = 1.;
+        break;
+      case kSustain:
+        seg.envGain = 0.;
+        seg.sustainGain = 1.;
+        break;
+      case kRelease:
+        seg.mul = 1. - mReleaseIncr * mScalar;
+        seg.envGain = mReleaseLevel;
+        break;
+      case kReleasedToRetrigger:
+        seg.add = -mRetriggerReleaseIncr;
+        seg.envGain = mReleaseLevel;
+        break;
+      case kReleasedToEndEarly:
+        seg.add = -mEarlyReleaseIncr;
+        seg.envGain = mReleaseLevel;
+        break;
+      default:
+        break;
+    }
+
+    return seg;
+  }
+
+  /** @return The number of samples of the current stage that can be rendered before it might end, which is worked out once per stage */
+  int CalcStageFrames(const Segment& seg) const
+  {
+    switch(mStage)
+    {
+      case kIdle:
+      case kSustain:
+        return INT_MAX;
+      case kAttack:
+        return mAttackIncr == 0. ? 0 : StepsBefore((ENV_VALUE_HIGH - mEnvValue) / seg.add);
+      case kDecay:
+        return StepsBeforeDecayEnds(seg.mul);
+      case kRelease:
+        return mReleaseIncr == 0. ? 0 : StepsBeforeDecayEnds(seg.mul);
+      case kReleasedToRetrigger:
+      case kReleasedToEndEarly:
+        return StepsBefore((mEnvValue - ENV_VALUE_LOW) / -seg.add);
+      default:
+        return 0;
+    }
+  }
+
+  /** @return The number of steps of an exponential stage before mEnvValue falls below ENV_VALUE_LOW */
+  int StepsBeforeDecayEnds(T mul) const
+  {
+    if (!(mul > 0.))
+      return 0;
+    else if (mul >= 1.)
+      return INT_MAX;
+    else
+      return StepsBefore(std::log(ENV_VALUE_LOW / mEnvValue) / std::log(mul));
+  }
+
+  /** @return The number of whole steps in x, less one so that rounding can't carry a block past the end of a stage */
+  static int StepsBefore(double x)
+  {
+    if (!(x >= 1.))
+      return 0;
+    else if (x >= (double) INT_MAX)
+      return INT_MAX;
+    else
+      return (int) x - 1;
+  }
+
+  void RenderSegment(const Segment& seg, T* pOutput, const T* pSustainLevels, T sustainLevel, int nFrames)
+  {
+    // the recursion is unrolled kStride samples at a time, so that only every kStride-th sample depends on the one before.
+    // A stage is either linear, with mul == 1, or exponential, with add == 0, so sample j of a stride is env * mul^(j+1) + add * (j+1)
+    constexpr int kStride = 8;
+    T muls[kStride];
+    T adds[kStride];
+    muls[0] = seg.mul;
+    muls[1] = seg.mul * seg.mul;
+    muls[2] = muls[1] * seg.mul;
+    muls[3] = muls[1] * muls[1];
+
+    for (auto j = 0; j < 4; j++)
+      muls[4 + j] = muls[3] * muls[j];
+
+    for (auto j = 0; j < kStride; j++)
+      adds[j] = seg.add * T(j + 1);
+
+    T env = mEnvValue;
+    auto s = 0;
+
+    for (; s + kStride <= nFrames; s += kStride)
+    {
+      for (auto j = 0; j < kStride; j++)
+        pOutput[s + j] = env * muls[j] + adds[j];
+
+      env = pOutput[s + kStride - 1];
+    }
+
+    for (auto j = 0; s + j < nFrames; j++)
+      pOutput[s + j] = env * muls[j] + adds[j];
+
+    mEnvValue = pOutput[nFrames - 1];
+
+    const T level = mLevel;
+
+    if (pSustainLevels)
+    {
+      for (auto i = 0; i < nFrames; i++)
+        pOutput[i] = (pOutput[i] * (seg.envGain - seg.sustainEnvGain * pSustainLevels[i]) + seg.sustainGain * pSustainLevels[i]) * level;
+
+      sustainLevel = pSustainLevels[nFrames - 1];
+    }
+    else
+    {
+      const T gain = (seg.envGain - seg.sustainEnvGain * sustainLevel) * level;
+      const T offset = seg.sustainGain * sustainLevel * level;
+
+      for (auto i = 0; i < nFrames; i++)
+        pOutput[i] = pOutput[i] * gain + offset;
+    }
+
+    mPrevResult = mEnvValue * (seg.envGain - seg.sustainEnvGain * sustainLevel) + seg.sustainGain * sustainLevel;
+    mPrevOutput = pOutput[nFrames - 1];
+  }
+
   inline T CalcIncrFromTimeLinear(T timeMS, T sr) const
   {
     if (timeMS <= 0.) return 0.;
@@ -268,3 +495,58 @@ private:
     }
   }
 };
+
+/** NLanes envelopes rendered together, e.g. the amp, filter and modulation envelopes of a voice, or the envelopes of several voices.
+ * Each lane is an ADSREnvelope with its own times, gate and velocity, see GetEnvelope().
+ * The lanes are rendered one after the other, a stage at a time, with loops that vectorise over the samples of a lane.
+ * That's faster than computing the lanes side by side, one sample at a time: the recursion of every sample depends on the one before,
+ * and the lanes would have to be copied out to separate buffers
+ * @tparam NLanes The number of envelopes */
+template <typename T, int NLanes = 4>
+class ADSREnvelopeBank
+{
+public:
+  static constexpr int kNumLanes = NLanes;
+
+  /** @return The envelope of a lane, to start, release or set the stage times of */
+  ADSREnvelope<T>& GetEnvelope(int lane) { return mEnvelopes[lane]; }
+  const ADSREnvelope<T>& GetEnvelope(int lane) const { return mEnvelopes[lane]; }
+
+  void SetSampleRate(T sr)
+  {
+    for (auto& envelope : mEnvelopes)
+      envelope.SetSampleRate(sr);
+  }
+
+  /** @return \c true if any of the lanes is busy */
+  bool GetBusy() const
+  {
+    for (auto& envelope : mEnvelopes)
+    {
+      if (envelope.GetBusy())
+        return true;
+    }
+
+    return false;
+  }
+
+  /** Render a block of every lane, see ADSREnvelope::ProcessBlock()
+   * @param pOutputs The output buffers, one per lane
+   * @param pSustainLevels The sustain level of each sample, shared by all the lanes
+   * @param nFrames The number of samples */
+  void ProcessBlock(T** pOutputs, const T* pSustainLevels, int nFrames)
+  {
+    for (auto l = 0; l < NLanes; l++)
+      mEnvelopes[l].ProcessBlock(pOutputs[l], pSustainLevels, nFrames);
+  }
+
+  /** Render a block with a constant sustain level, see ProcessBlock() */
+  void ProcessBlock(T** pOutputs, T sustainLevel, int nFrames)
+  {
+    for (auto l = 0; l < NLanes; l++)
+      mEnvelopes[l].ProcessBlock(pOutputs[l], sustainLevel, nFrames);
+  }
+
+private:
+  ADSREnvelope<T> mEnvelopes[NLanes];
+};
@@ -0,0 +1,619 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief Band-limited oscillators for synthesisers: PolyBLEP and mip-mapped wavetable oscillators that process blocks,
+ * with optional per-sample frequency inputs, and a bank of PolyBLEP oscillators laid out in lanes for unison voices
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "IPlugConstants.h"
+#include "heapbuf.h"
+#include "Oscillator.h"
+
+/** The waveforms of the band-limited oscillators. All of them start their cycle at phase 0 with a rising edge or slope, and have a peak of about 1 */
+enum EOscWaveform
+{
+  kOscSine = 0,
+  kOscSaw,
+  kOscSquare,
+  kOscTriangle,
+  kNumOscWaveforms
+};
+
+/** Polynomial band-limited step and ramp residuals, see Välimäki et al., "Antialiasing Oscillators in Subtractive Synthesis".
+ * The functions are written without branches on the phase, so that loops over several oscillators vectorise */
+namespace PolyBLEP
+{
+  /** @return max(x, 0), written without a comparison, because GCC won't vectorise a select that feeds arithmetic unless -ffast-math is set */
+  template <typename T>
+  inline T Positive(T x)
+  {
+    return T(0.5) * (x + std::abs(x));
+  }
+
+  /** @return |dt|, but no less than a tiny increment, so that the residuals, which are only non-zero within dt of a discontinuity, stay finite at 0 Hz */
+  template <typename T>
+  inline T SafeIncrement(T dt)
+  {
+    const T minIncr = T(1e-7);
+    return minIncr + Positive(std::abs(dt) - minIncr);
+  }
+
+  /** @param t The phase, from 0 to 1, where 0 is the discontinuity
+   * @param dt The phase increment per sample, see SafeIncrement()
+   * @return The correction for a step of +2 at phase 0 */
+  template <typename T>
+  inline T Step(T t, T dt)
+  {
+    dt = SafeIncrement(dt);
+    const T after = Positive(T(1) - t / dt); // non-zero in the sample after the step
+    const T before = Positive(T(1) + (t - T(1)) / dt); // non-zero in the sample before the next one
+    return before * before - after * after;
+  }
+
+  /** @param t The phase, from 0 to 1, where 0 is the corner
+   * @param dt The phase increment per sample, see SafeIncrement()
+   * @return The correction for a change of slope of +8 per cycle, divided by 4 * dt */
+  template <typename T>
+  inline T Ramp(T t, T dt)
+  {
+    dt = SafeIncrement(dt);
+    const T after = Positive(T(1) - t / dt);
+    const T before = Positive(T(1) + (t - T(1)) / dt);
+    return T(1. / 3.) * (after * after * after + before * before * before);
+  }
+
+  /** Wrap a phase that is at most one cycle outside of [0, 1) */
+  template <typename T>
+  inline T Wrap(T t)
+  {
+    t -= T(t >= T(1));
+    return t + T(t < T(0));
+  }
+
+  /** @return The fractional part of a phase, from 0 to 1, also for negative phases */
+  template <typename T>
+  inline T Fract(T t)
+  {
+    t -= T(static_cast<int>(t));
+    return t + T(t < T(0));
+  }
+
+  /** One sample of a band-limited waveform. The waveform is a template argument so that it is resolved outside the sample loops
+   * @param t The phase, from 0 to 1
+   * @param dt The phase increment per sample, which may be 0 or negative
+   * @param pulseWidth The duty cycle of kOscSquare, from 0 to 1 */
+  template <int waveform, typename T>
+  inline T Sample(T t, T dt, T pulseWidth)
+  {
+    dt = SafeIncrement(dt);
+
+    if (waveform == kOscSaw)
+    {
+      return T(2) * t - T(1) - Step(t, dt);
+    }
+    else if (waveform == kOscSquare)
+    {
+      const T naive = T(2) * T(t < pulseWidth) - T(1);
+      return naive + Step(t, dt) - Step(Fract(t + T(1) - pulseWidth), dt);
+    }
+    else if (waveform == kOscTriangle)
+    {
+      const T naive = T(1) - T(4) * std::abs(t - T(0.5));
+      return naive + T(4) * dt * (Ramp(t, dt) - Ramp(Fract(t + T(0.5)), dt));
+    }
+    else
+    {
+      return std::sin(t * T(PI * 2.));
+    }
+  }
+
+  /** Generate a block of one oscillator. The phase of each sample is computed from the start phase and the increments summed up to that sample,
+   * instead of being accumulated from the previous sample, so that the loop has no dependency between samples and vectorises
+   * @param pOutput The output buffer
+   * @param startPhase The phase at the start of the block
+   * @param incr The phase increment per sample, scaled by pMods
+   * @param pElapsed The sum of pMods before each sample
+   * @param pMods The increment multiplier of each sample
+   * @param total The sum of all of pMods
+   * @param pulseWidth The duty cycle of kOscSquare
+   * @param nFrames The number of samples
+   * @return The phase after the block */
+  template <int waveform, typename T, typename S>
+  inline T Generate(S* pOutput, T startPhase, T incr, const T* pElapsed, const T* pMods, T total, T pulseWidth, int nFrames)
+  {
+    for (auto s = 0; s < nFrames; s++)
+      pOutput[s] = S(Sample<waveform>(Fract(startPhase + incr * pElapsed[s]), incr * pMods[s], pulseWidth));
+
+    return Fract(startPhase + incr * total);
+  }
+}
+
+#pragma mark - PolyBLEPOscillator
+
+/** A band-limited oscillator that corrects the discontinuities of naive saw, pulse and triangle waves with polynomial residuals.
+ * It is cheap enough to run per voice, and its frequency can be modulated per sample.
+ * Aliasing is strongly attenuated, but not removed completely. For the cleanest top octaves use WavetableOscillator */
+template <typename T = double>
+class PolyBLEPOscillator : public IOscillator<T>
+{
+public:
+  PolyBLEPOscillator(EOscWaveform waveform = kOscSaw, double startPhase = 0., double startFreq = 1.)
+  : IOscillator<T>(startPhase, startFreq)
+  , mWaveform(waveform)
+  {
+  }
+
+  void SetWaveform(EOscWaveform waveform) { mWaveform = waveform; }
+  EOscWaveform GetWaveform() const { return mWaveform; }
+
+  /** @param pulseWidth The duty cycle of kOscSquare, from 0 to 1 */
+  void SetPulseWidth(double pulseWidth) { mPulseWidth = std::min(std::max(pulseWidth, 0.01), 0.99); }
+
+  inline T Process(double freqHz) override
+  {
+    IOscillator<T>::SetFreqCPS(freqHz);
+    T output;
+    ProcessBlock(&output, 1);
+    return output;
+  }
+
+  /** Generate a block at the frequency set with SetFreqCPS() */
+  void ProcessBlock(T* pOutput, int nFrames)
+  {
+    Dispatch(pOutput, nullptr, nFrames);
+  }
+
+  /** Generate a block with a frequency input
+   * @param pFreqHz The frequency of each sample, in Hz. May be negative for through-zero FM */
+  void ProcessBlock(T* pOutput, const T* pFreqHz, int nFrames)
+  {
+    Dispatch(pOutput, pFreqHz, nFrames);
+  }
+
+private:
+  void Dispatch(T* pOutput, const T* pFreqHz, int nFrames)
+  {
+    switch (mWaveform)
+    {
+      case kOscSaw: ProcessBlockT<kOscSaw>(pOutput, pFreqHz, nFrames); break;
+      case kOscSquare: ProcessBlockT<kOscSquare>(pOutput, pFreqHz, nFrames); break;
+      case kOscTriangle: ProcessBlockT<kOscTriangle>(pOutput, pFreqHz, nFrames); break;
+      default: ProcessBlockT<kOscSine>(pOutput, pFreqHz, nFrames); break;
+    }
+  }
+
+  template <int waveform>
+  void ProcessBlockT(T* pOutput, const T* pFreqHz, int nFrames)
+  {
+    constexpr int kChunkFrames = 64;
+    double elapsed[kChunkFrames];
+    double incrs[kChunkFrames];
+    const double sampleRateReciprocal = IOscillator<T>::mSampleRateReciprocal;
+
+    for (auto start = 0; start < nFrames; start += kChunkFrames)
+    {
+      const int chunkFrames = std::min(kChunkFrames, nFrames - start);
+      double total = 0.;
+      double incr = 1.;
+
+      if (pFreqHz)
+      {
+        for (auto s = 0; s < chunkFrames; s++)
+        {
+          incrs[s] = pFreqHz[start + s] * sampleRateReciprocal;
+          elapsed[s] = total;
+          total += incrs[s];
+        }
+
+        IOscillator<T>::mPhaseIncr = incrs[chunkFrames - 1];
+      }
+      else
+      {
+        for (auto s = 0; s < chunkFrames; s++)
+        {
+          incrs[s] = 1.;
+          elapsed[s] = s;
+        }
+
+        total = chunkFrames;
+        incr = IOscillator<T>::mPhaseIncr;
+      }
+
+      IOscillator<T>::mPhase = PolyBLEP::Generate<waveform>(pOutput + start, IOscillator<T>::mPhase, incr, elapsed, incrs, total, mPulseWidth, chunkFrames);
+    }
+  }
+
+  EOscWaveform mWaveform;
+  double mPulseWidth = 0.5;
+};
+
+#pragma mark - PolyBLEPOscillatorBank
+
+/** NLanes PolyBLEP oscillators that share a waveform and a frequency modulation input, e.g. the detuned oscillators of a unison voice or a supersaw.
+ * The modulation is integrated once per block for all the lanes, and each lane is then generated by a loop that vectorises,
+ * see PolyBLEP::Generate(). With T = float, four or eight samples are computed per instruction with SSE/NEON or AVX
+ * @tparam NLanes The number of oscillators */
+template <typename T = float, int NLanes = 4>
+class PolyBLEPOscillatorBank
+{
+public:
+  static constexpr int kNumLanes = NLanes;
+
+  PolyBLEPOscillatorBank(EOscWaveform waveform = kOscSaw)
+  : mWaveform(waveform)
+  {
+    for (auto l = 0; l < NLanes; l++)
+    {
+      mPhase[l] = mStartPhase[l] = mIncr[l] = T(0);
+      mGain[l] = T(1);
+    }
+  }
+
+  void SetSampleRate(double sampleRate) { mSampleRateReciprocal = 1. / sampleRate; }
+  void SetWaveform(EOscWaveform waveform) { mWaveform = waveform; }
+  void SetPulseWidth(double pulseWidth) { mPulseWidth = T(std::min(std::max(pulseWidth, 0.01), 0.99)); }
+
+  /** @param lane The lane index
+   * @param freqHz The frequency of the lane, e.g. the note frequency times its detune ratio */
+  void SetFreqCPS(int lane, double freqHz) { mIncr[lane] = T(freqHz * mSampleRateReciprocal); }
+
+  /** @param lane The lane index
+   * @param phase The phase the lane restarts at when Reset() is called, from 0 to 1. Spreading the phases avoids a click at note on */
+  void SetStartPhase(int lane, double phase) { mStartPhase[lane] = T(phase); }
+
+  /** @param lane The lane index
+   * @param gain The weight of the lane in ProcessBlockSummed() */
+  void SetGain(int lane, double gain) { mGain[lane] = T(gain); }
+
+  void Reset()
+  {
+    for (auto l = 0; l < NLanes; l++)
+      mPhase[l] = mStartPhase[l];
+  }
+
+  /** Generate a block for each lane
+   * @param pOutputs NLanes buffers of nFrames samples
+   * @param pFreqMod Optional per-sample ratios that scale the frequency of every lane, for vibrato or FM, or nullptr */
+  void ProcessBlock(T** pOutputs, const T* pFreqMod, int nFrames)
+  {
+    Dispatch<false>(pOutputs, pFreqMod, nFrames);
+  }
+
+  /** Generate a block of the weighted sum of all the lanes
+   * @param pOutput A buffer of nFrames samples
+   * @param pFreqMod Optional per-sample ratios that scale the frequency of every lane, for vibrato or FM, or nullptr */
+  void ProcessBlockSummed(T* pOutput, const T* pFreqMod, int nFrames)
+  {
+    Dispatch<true>(&pOutput, pFreqMod, nFrames);
+  }
+
+private:
+  template <bool summed>
+  void Dispatch(T** pOutputs, const T* pFreqMod, int nFrames)
+  {
+    switch (mWaveform)
+    {
+      case kOscSaw: ProcessBlockT<kOscSaw, summed>(pOutputs, pFreqMod, nFrames); break;
+      case kOscSquare: ProcessBlockT<kOscSquare, summed>(pOutputs, pFreqMod, nFrames); break;
+      case kOscTriangle: ProcessBlockT<kOscTriangle, summed>(pOutputs, pFreqMod, nFrames); break;
+      default: ProcessBlockT<kOscSine, summed>(pOutputs, pFreqMod, nFrames); break;
+    }
+  }
+
+  template <int waveform, bool summed>
+  void ProcessBlockT(T** pOutputs, const T* pFreqMod, int nFrames)
+  {
+    constexpr int kChunkFrames = 64;
+    alignas(32) T elapsed[kChunkFrames];
+    alignas(32) T mods[kChunkFrames];
+    alignas(32) T laneOutput[kChunkFrames];
+
+    for (auto start = 0; start < nFrames; start += kChunkFrames)
+    {
+      const int chunkFrames = std::min(kChunkFrames, nFrames - start);
+      T total = T(0);
+
+      for (auto s = 0; s < chunkFrames; s++)
+      {
+        mods[s] = pFreqMod ? pFreqMod[start + s] : T(1);
+        elapsed[s] = total;
+        total += mods[s];
+      }
+
+      for (auto l = 0; l < NLanes; l++)
+      {
+        T* pLaneOutput = summed ? laneOutput : pOutputs[l] + start;
+        mPhase[l] = PolyBLEP::Generate<waveform>(pLaneOutput, mPhase[l], mIncr[l], elapsed, mods, total, mPulseWidth, chunkFrames);
+
+        if (summed)
+        {
+          T* pOutput = pOutputs[0] + start;
+          const T gain = mGain[l];
+
+          if (l == 0)
+          {
+            for (auto s = 0; s < chunkFrames; s++)
+              pOutput[s] = laneOutput[s] * gain;
+          }
+          else
+          {
+            for (auto s = 0; s < chunkFrames; s++)
+              pOutput[s] += laneOutput[s] * gain;
+          }
+        }
+      }
+    }
+  }
+
+  EOscWaveform mWaveform;
+  T mPulseWidth = T(0.5);
+  double mSampleRateReciprocal = 1. / 44100.;
+  T mPhase[NLanes];
+  T mIncr[NLanes];
+  T mGain[NLanes];
+  T mStartPhase[NLanes];
+};
+
+#pragma mark - Wavetable
+
+/** A single cycle waveform stored as a set of mip-mapped tables, each of which contains the harmonics that can be played
+ * without aliasing in one octave. Tables are built on the main thread, and can be shared by any number of WavetableOscillators.
+ * The standard waveforms are built once per process, see GetShared() */
+template <typename T = double>
+class Wavetable
+{
+public:
+  static constexpr int kTableSize = 2048;
+  static constexpr int kNumLevels = 11; // level l contains harmonics up to (kTableSize / 2) >> l
+
+  Wavetable()
+  {
+    mData.Resize(kNumLevels * (kTableSize + 1));
+    memset(mData.Get(), 0, mData.GetSize() * sizeof(T));
+  }
+
+  Wavetable(const Wavetable&) = delete;
+  Wavetable& operator=(const Wavetable&) = delete;
+
+  /** Build the tables from a harmonic spectrum. The result is normalised to a peak of 1 at the lowest level. Not real-time safe
+   * @param pAmplitudes The amplitudes of the harmonics, starting with the fundamental
+   * @param pPhases The phases of sin(2 pi h t + phase) for each harmonic, in radians, or nullptr for all 0
+   * @param nHarmonics The number of harmonics, at most kTableSize / 2 - 1 are used */
+  void SetHarmonics(const double* pAmplitudes, const double* pPhases, int nHarmonics)
+  {
+    constexpr int mask = kTableSize - 1;
+    std::vector<double> sinTable(kTableSize), accum(kTableSize, 0.);
+
+    for (auto i = 0; i < kTableSize; i++)
+      sinTable[i] = std::sin(2. * PI * i / kTableSize);
+
+    nHarmonics = std::min(nHarmonics, kTableSize / 2 - 1);
+    int h = 1;
+
+    // from the top level, with only the fundamental, down to level 0, adding the harmonics each level allows
+    for (auto level = kNumLevels - 1; level >= 0; level--)
+    {
+      const int maxHarmonic = std::min(nHarmonics, (kTableSize / 2) >> level);
+
+      for (; h <= maxHarmonic; h++)
+      {
+        const double phase = pPhases ? pPhases[h - 1] : 0.;
+        const double sinCoeff = pAmplitudes[h - 1] * std::cos(phase);
+        const double cosCoeff = pAmplitudes[h - 1] * std::sin(phase);
+
+        for (auto i = 0; i < kTableSize; i++)
+        {
+          const int idx = (h * i) & mask;
+          accum[i] += sinCoeff * sinTable[idx] + cosCoeff * sinTable[(idx + kTableSize / 4) & mask];
+        }
+      }
+
+      T* pLevel = GetLevel(level);
+      for (auto i = 0; i < kTableSize; i++)
+        pLevel[i] = T(accum[i]);
+
+      pLevel[kTableSize] = pLevel[0]; // guard point for interpolation
+    }
+
+    T peak = T(0);
+    for (auto i = 0; i < kTableSize; i++)
+      peak = std::max(peak, std::abs(GetLevel(0)[i]));
+
+    if (peak > T(0))
+    {
+      for (auto i = 0; i < mData.GetSize(); i++)
+        mData.Get()[i] /= peak;
+    }
+  }
+
+  /** Build the tables from one cycle of a waveform, e.g. a user drawn or imported wave. Any DC is removed. Not real-time safe
+   * @param pSamples One cycle
+   * @param nSamples The length of the cycle, which is resampled to kTableSize */
+  void SetWaveform(const T* pSamples, int nSamples)
+  {
+    constexpr int mask = kTableSize - 1;
+    constexpr int nHarmonics = kTableSize / 2 - 1;
+    std::vector<double> cycle(kTableSize), sinTable(kTableSize), amps(nHarmonics), phases(nHarmonics);
+
+    for (auto i = 0; i < kTableSize; i++)
+    {
+      const double pos = (double) i * nSamples / kTableSize;
+      const int idx = (int) pos;
+      const double frac = pos - idx;
+      cycle[i] = pSamples[idx] + frac * (pSamples[(idx + 1) % nSamples] - pSamples[idx]);
+      sinTable[i] = std::sin(2. * PI * i / kTableSize);
+    }
+
+    for (auto h = 1; h <= nHarmonics; h++)
+    {
+      double sinSum = 0., cosSum = 0.;
+
+      for (auto i = 0; i < kTableSize; i++)
+      {
+        const int idx = (h * i) & mask;
+        sinSum += cycle[i] * sinTable[idx];
+        cosSum += cycle[i] * sinTable[(idx + kTableSize / 4) & mask];
+      }
+
+      amps[h - 1] = 2. / kTableSize * std::sqrt(sinSum * sinSum + cosSum * cosSum);
+      phases[h - 1] = std::atan2(cosSum, sinSum);
+    }
+
+    SetHarmonics(amps.data(), phases.data(), nHarmonics);
+  }
+
+  /** @return The table of a mip level, kTableSize samples plus a guard point */
+  const T* GetLevel(int level) const { return mData.Get() + level * (kTableSize + 1); }
+
+  /** @param phaseIncr The phase increment per sample, in cycles
+   * @return The lowest level whose harmonics are all below Nyquist at that increment */
+  static int LevelForIncrement(double phaseIncr)
+  {
+    int exponent;
+    std::frexp(std::abs(phaseIncr) * kTableSize, &exponent); // 2^(exponent - 1) <= x < 2^exponent
+    return std::min(std::max(exponent, 0), kNumLevels - 1);
+  }
+
+  /** Linearly interpolated lookup
+   * @param level The mip level, see LevelForIncrement()
+   * @param phase The phase, from 0 to 1 */
+  inline T Lookup(int level, double phase) const
+  {
+    const double pos = phase * kTableSize;
+    const int idx = (int) pos;
+    const T frac = T(pos - idx);
+    const T* pLevel = GetLevel(level) + (idx & (kTableSize - 1)); // phase can round up to 1.
+    return pLevel[0] + frac * (pLevel[1] - pLevel[0]);
+  }
+
+  /** The standard waveforms, built on the first call and then shared. Call it from the main thread before processing, e.g. in a plug-in's constructor
+   * @param waveform The waveform
+   * @return A table that stays valid for the lifetime of the process */
+  static const Wavetable& GetShared(EOscWaveform waveform)
+  {
+    static const SharedTables sTables;
+    return sTables.mTables[waveform];
+  }
+
+private:
+  T* GetLevel(int level) { return mData.Get() + level * (kTableSize + 1); }
+
+  struct SharedTables
+  {
+    Wavetable mTables[kNumOscWaveforms];
+
+    SharedTables()
+    {
+      constexpr int nHarmonics = kTableSize / 2 - 1;
+      std::vector<double> amps(nHarmonics, 0.), phases(nHarmonics, 0.);
+
+      amps[0] = 1.;
+      mTables[kOscSine].SetHarmonics(amps.data(), nullptr, 1);
+
+      // phases match the PolyBLEP waveforms, which rise from -1 at phase 0
+      for (auto h = 1; h <= nHarmonics; h++)
+      {
+        amps[h - 1] = 1. / h;
+        phases[h - 1] = PI;
+      }
+      mTables[kOscSaw].SetHarmonics(amps.data(), phases.data(), nHarmonics);
+
+      for (auto h = 1; h <= nHarmonics; h++)
+        amps[h - 1] = (h & 1) ? 1. / h : 0.;
+      mTables[kOscSquare].SetHarmonics(amps.data(), nullptr, nHarmonics);
+
+      for (auto h = 1; h <= nHarmonics; h++)
+      {
+        amps[h - 1] = (h & 1) ? 1. / (h * h) : 0.;
+        phases[h - 1] = -PI / 2.;
+      }
+      mTables[kOscTriangle].SetHarmonics(amps.data(), phases.data(), nHarmonics);
+    }
+  };
+
+  WDL_TypedBuf<T> mData;
+};
+
+#pragma mark - WavetableOscillator
+
+/** An oscillator that plays a Wavetable, choosing the mip level from the frequency of each sample so that it doesn't alias.
+ * Several oscillators can share one table, which they don't own */
+template <typename T = double>
+class WavetableOscillator : public IOscillator<T>
+{
+public:
+  /** @param pTable The table to play, which must outlive the oscillator. Defaults to the shared saw table */
+  WavetableOscillator(const Wavetable<T>* pTable = nullptr, double startPhase = 0., double startFreq = 1.)
+  : IOscillator<T>(startPhase, startFreq)
+  , mTable(pTable ? pTable : &Wavetable<T>::GetShared(kOscSaw))
+  {
+  }
+
+  /** Switch table, e.g. to one of Wavetable::GetShared(). This is just a pointer swap, so it can be called on the audio thread */
+  void SetWavetable(const Wavetable<T>* pTable) { mTable = pTable; }
+  const Wavetable<T>* GetWavetable() const { return mTable; }
+
+  inline T Process(double freqHz) override
+  {
+    IOscillator<T>::SetFreqCPS(freqHz);
+    T output;
+    ProcessBlock(&output, 1);
+    return output;
+  }
+
+  /** Generate a block at the frequency set with SetFreqCPS() */
+  void ProcessBlock(T* pOutput, int nFrames)
+  {
+    double phase = IOscillator<T>::mPhase;
+    const double dt = IOscillator<T>::mPhaseIncr;
+    const int level = Wavetable<T>::LevelForIncrement(dt);
+
+    for (auto s = 0; s < nFrames; s++)
+    {
+      pOutput[s] = mTable->Lookup(level, phase);
+      phase = PolyBLEP::Wrap(phase + dt);
+    }
+
+    IOscillator<T>::mPhase = phase;
+  }
+
+  /** Generate a block with a frequency input
+   * @param pFreqHz The frequency of each sample, in Hz. May be negative for through-zero FM */
+  void ProcessBlock(T* pOutput, const T* pFreqHz, int nFrames)
+  {
+    if (nFrames <= 0)
+      return;
+
+    double phase = IOscillator<T>::mPhase;
+    const double sampleRateReciprocal = IOscillator<T>::mSampleRateReciprocal;
+
+    for (auto s = 0; s < nFrames; s++)
+    {
+      const double dt = pFreqHz[s] * sampleRateReciprocal;
+      pOutput[s] = mTable->Lookup(Wavetable<T>::LevelForIncrement(dt), phase);
+      phase = PolyBLEP::Wrap(phase + dt);
+    }
+
+    IOscillator<T>::mPhase = phase;
+    IOscillator<T>::mPhaseIncr = pFreqHz[nFrames - 1] * sampleRateReciprocal;
+  }
+
+private:
+  const Wavetable<T>* mTable;
+};
@@ -0,0 +1,530 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief A zero latency multichannel convolver, built on WDL_ConvolutionEngine_Div
+ * Your project needs to compile WDL/convoengine.cpp and WDL/fft.c
+ */
+
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "heapbuf.h"
+#include "ptrlist.h"
+#include "convoengine.h"
+
+#include "WorkerSignal.h"
+
+/** A zero latency convolver for cabinet simulations, reverbs etc.
+ * The impulse is split in two. The head is convolved on the audio thread with no latency, using WDL_ConvolutionEngine_Div.
+ * The tail starts late enough that it can be computed on a background worker thread, using larger, cheaper partitions.
+ * Audio is handed to and from the worker through lock-free sample rings, and the tail output is mixed back in exactly where it belongs.
+ * The worker sleeps until the audio thread signals it, once per block, @see WorkerSignal.
+ * New impulses are partitioned and FFT'd on the thread that calls SetImpulse(), and swapped in on the audio thread with a crossfade.
+ * Channels are processed in pairs, and the impulse can either be mono, or have one channel per processed channel.
+ * The output is the fully wet signal.
+ * @tparam T The sample type of the plug-in's buffers */
+template<typename T = double>
+class Convolver
+{
+public:
+  /** The shortest head, in samples. The head is also at least four host blocks long, so the worker always has time to catch up */
+  static constexpr int kMinHeadSize = 4096;
+
+  /** @param nChans The number of channels to process
+   * @param crossfadeSamples The length of the crossfade when swapping impulses */
+  Convolver(int nChans = 2, int crossfadeSamples = 2048)
+  : mNChans(nChans)
+  , mCrossfadeSamples(std::max(1, crossfadeSamples))
+  {
+    mInPtrs.Resize(mNChans);
+    mMixPtrs.Resize(mNChans);
+  }
+
+  ~Convolver()
+  {
+    StopWorker();
+    DeleteKernels();
+    mImpulses.Empty(true);
+  }
+
+  Convolver(const Convolver&) = delete;
+  Convolver& operator=(const Convolver&) = delete;
+
+  /** Call this from OnReset(), never concurrently with ProcessBlock(). Clears all convolution state and (re)builds the kernel for the current impulse
+   * @param blockSize The maximum number of frames that will be passed to ProcessBlock() */
+  void Reset(int blockSize)
+  {
+    StopWorker();
+    DeleteKernels();
+
+    mBlockSize = std::max(1, blockSize);
+    mHeadSize = kMinHeadSize;
+    while (mHeadSize < 4 * mBlockSize) mHeadSize *= 2;
+
+    mInScratch.Resize(mNChans * mBlockSize);
+    mMixScratch.Resize(mNChans * mBlockSize);
+    mTailScratch.Resize(2 * mBlockSize);
+
+    for (auto c = 0; c < mNChans; c++)
+    {
+      mInPtrs.Get()[c] = mInScratch.Get() + (c * mBlockSize);
+      mMixPtrs.Get()[c] = mMixScratch.Get() + (c * mBlockSize);
+    }
+
+    if (mImpulses.GetSize())
+      mCurrent = CreateKernel();
+
+    if (mCurrent)
+      mSlots[0].store(mCurrent);
+
+    StartWorker();
+  }
+
+  /** Load a new impulse response. The impulse is copied, partitioned and transformed on the calling thread, which must not be the audio thread.
+   * If the convolver is running, the new impulse is crossfaded in on the audio thread.
+   * @param pImpulse Non-interleaved impulse data, either 1 channel or one channel per processed channel
+   * @param nImpulseChans The number of channels in pImpulse
+   * @param length The length of the impulse in samples
+   * @return \c true if the impulse was accepted */
+  bool SetImpulse(const T* const* pImpulse, int nImpulseChans, int length)
+  {
+    if (length < 1 || (nImpulseChans != 1 && nImpulseChans != mNChans))
+      return false;
+
+    mImpulses.Empty(true);
+
+    for (auto pair = 0; pair < NPairs(); pair++)
+    {
+      WDL_ImpulseBuffer* pBuffer = new WDL_ImpulseBuffer;
+      const int firstChan = pair * 2;
+      const int nBufferChans = nImpulseChans == 1 ? 1 : std::min(2, mNChans - firstChan);
+
+      pBuffer->SetNumChannels(nBufferChans);
+      pBuffer->SetLength(length);
+
+      for (auto c = 0; c < nBufferChans; c++)
+      {
+        const T* pSrc = pImpulse[nImpulseChans == 1 ? 0 : firstChan + c];
+        WDL_FFT_REAL* pDest = pBuffer->impulses[c].Get();
+
+        for (auto s = 0; s < length; s++)
+          pDest[s] = (WDL_FFT_REAL) pSrc[s];
+      }
+
+      mImpulses.Add(pBuffer);
+    }
+
+    if (mBlockSize)
+    {
+      Kernel* pOld = mPending.exchange(CreateKernel());
+      delete pOld; // never seen by the audio thread
+    }
+
+    return true;
+  }
+
+  /** Process a block of audio. Call this on the audio thread
+   * @param inputs mNChans input buffers
+   * @param outputs mNChans output buffers, these may be the same as the inputs
+   * @param nFrames The number of frames to process, can be larger than the block size passed to Reset() */
+  void ProcessBlock(T** inputs, T** outputs, int nFrames)
+  {
+    for (auto pos = 0; pos < nFrames; pos += mBlockSize)
+    {
+      const int n = std::min(mBlockSize, nFrames - pos);
+      ProcessSubBlock(inputs, outputs, pos, n);
+    }
+  }
+
+  /** @return The number of times the audio thread had to output silence for the tail, because the worker thread didn't keep up */
+  int GetNumTailUnderruns() const { return mTailUnderruns.load(std::memory_order_relaxed); }
+
+private:
+  /** A lock-free SPSC multichannel sample ring */
+  class SampleRing
+  {
+  public:
+    void Resize(int nChans, int capacity)
+    {
+      mCapacity = 1;
+      while (mCapacity < capacity) mCapacity *= 2;
+      mNChans = nChans;
+      mBuffer.Resize(mNChans * mCapacity);
+      mWriteCount.store(0);
+      mReadCount.store(0);
+    }
+
+    int NumReadable() const { return (int) (mWriteCount.load(std::memory_order_acquire) - mReadCount.load(std::memory_order_relaxed)); }
+    int NumWritable() const { return mCapacity - (int) (mWriteCount.load(std::memory_order_relaxed) - mReadCount.load(std::memory_order_acquire)); }
+
+    /** @param ppSrc mNChans source buffers, or nullptr to write silence */
+    void Write(WDL_FFT_REAL* const* ppSrc, int n)
+    {
+      const size_t writeCount = mWriteCount.load(std::memory_order_relaxed);
+      const int idx = (int) (writeCount & (mCapacity - 1));
+      const int first = std::min(n, mCapacity - idx);
+
+      for (auto c = 0; c < mNChans; c++)
+      {
+        WDL_FFT_REAL* pRing = mBuffer.Get() + (c * mCapacity);
+
+        if (ppSrc)
+        {
+          memcpy(pRing + idx, ppSrc[c], first * sizeof(WDL_FFT_REAL));
+          memcpy(pRing, ppSrc[c] + first, (n - first) * sizeof(WDL_FFT_REAL));
+        }
+        else
+        {
+          memset(pRing + idx, 0, first * sizeof(WDL_FFT_REAL));
+          memset(pRing, 0, (n - first) * sizeof(WDL_FFT_REAL));
+        }
+      }
+
+      mWriteCount.store(writeCount + n, std::memory_order_release);
+    }
+
+    /** @param ppDest mNChans destination buffers, or nullptr to discard the samples */
+    void Read(WDL_FFT_REAL** ppDest, int n)
+    {
+      const size_t readCount = mReadCount.load(std::memory_order_relaxed);
+
+      if (ppDest)
+      {
+        const int idx = (int) (readCount & (mCapacity - 1));
+        const int first = std::min(n, mCapacity - idx);
+
+        for (auto c = 0; c < mNChans; c++)
+        {
+          const WDL_FFT_REAL* pRing = mBuffer.Get() + (c * mCapacity);
+          memcpy(ppDest[c], pRing + idx, first * sizeof(WDL_FFT_REAL));
+          memcpy(ppDest[c] + first, pRing, (n - first) * sizeof(WDL_FFT_REAL));
+        }
+      }
+
+      mReadCount.store(readCount + n, std::memory_order_release);
+    }
+
+  private:
+    WDL_TypedBuf<WDL_FFT_REAL> mBuffer;
+    int mNChans = 0;
+    int mCapacity = 0;
+    std::atomic<size_t> mWriteCount{0};
+    std::atomic<size_t> mReadCount{0};
+  };
+
+  /** The engines and rings for one impulse. The head engines belong to the audio thread, the tail engines to the worker thread */
+  struct Kernel
+  {
+    ~Kernel()
+    {
+      mHead.Empty(true);
+      mTail.Empty(true);
+      mTailIn.Empty(true);
+      mTailOut.Empty(true);
+    }
+
+    WDL_PtrList<WDL_ConvolutionEngine_Div> mHead;
+    WDL_PtrList<WDL_ConvolutionEngine_Div> mTail; // empty if the impulse fits in the head
+    WDL_PtrList<SampleRing> mTailIn;
+    WDL_PtrList<SampleRing> mTailOut;
+    WDL_TypedBuf<WDL_FFT_REAL> mWorkerScratch;
+    int mTailDebt = 0; // tail samples the audio thread skipped during an underrun, discarded once they arrive
+  };
+
+  int NPairs() const { return (mNChans + 1) / 2; }
+  int PairChans(int pair) const { return std::min(2, mNChans - (pair * 2)); }
+
+  Kernel* CreateKernel()
+  {
+    Kernel* pKernel = new Kernel;
+    const int length = mImpulses.Get(0)->GetLength();
+    const bool hasTail = length > mHeadSize;
+
+    for (auto pair = 0; pair < NPairs(); pair++)
+    {
+      WDL_ImpulseBuffer* pImpulse = mImpulses.Get(pair);
+
+      WDL_ConvolutionEngine_Div* pHead = new WDL_ConvolutionEngine_Div;
+      pHead->SetImpulse(pImpulse, mHeadSize, mBlockSize, mHeadSize);
+      pKernel->mHead.Add(pHead);
+
+      if (hasTail)
+      {
+        WDL_ConvolutionEngine_Div* pTail = new WDL_ConvolutionEngine_Div;
+        // the tail starts mHeadSize samples late. Its engine may lag by up to half of that before output is available
+        // (allowing larger partitions), the rest is slack for the worker thread
+        pTail->SetImpulse(pImpulse, 0, 0, 0, mHeadSize, mHeadSize / 2);
+        pKernel->mTail.Add(pTail);
+
+        SampleRing* pTailIn = new SampleRing;
+        SampleRing* pTailOut = new SampleRing;
+        pTailIn->Resize(PairChans(pair), 4 * mHeadSize);
+        pTailOut->Resize(PairChans(pair), 4 * mHeadSize);
+        pTailOut->Write(nullptr, mHeadSize); // the offset of the tail within the impulse
+        pKernel->mTailIn.Add(pTailIn);
+        pKernel->mTailOut.Add(pTailOut);
+      }
+    }
+
+    pKernel->mWorkerScratch.Resize(2 * WorkerChunkSize());
+    return pKernel;
+  }
+
+  int WorkerChunkSize() const { return mHeadSize / 4; }
+
+  void ProcessSubBlock(T** inputs, T** outputs, int offset, int nFrames)
+  {
+    if (!mFading && !mToRetire)
+    {
+      if (Kernel* pNew = mPending.exchange(nullptr))
+      {
+        if (mCurrent)
+        {
+          mFading = mCurrent;
+          mFadePos = 0;
+        }
+
+        mCurrent = pNew;
+        mSlots[mSlots[0].load() ? 1 : 0].store(pNew, std::memory_order_release);
+      }
+    }
+
+    if (mToRetire && !mRetired.load(std::memory_order_acquire))
+    {
+      mRetired.store(mToRetire, std::memory_order_release);
+      mToRetire = nullptr;
+    }
+
+    for (auto c = 0; c < mNChans; c++)
+    {
+      WDL_FFT_REAL* pIn = mInPtrs.Get()[c];
+      const T* pSrc = inputs[c] + offset;
+
+      for (auto s = 0; s < nFrames; s++)
+        pIn[s] = (WDL_FFT_REAL) pSrc[s];
+
+      memset(mMixPtrs.Get()[c], 0, nFrames * sizeof(WDL_FFT_REAL));
+    }
+
+    if (mFading)
+    {
+      const double step = 1. / mCrossfadeSamples;
+      const double start = std::min(1., mFadePos * step);
+      const double end = std::min(1., (mFadePos + nFrames) * step);
+
+      ProcessKernel(mCurrent, nFrames, start, end);
+      ProcessKernel(mFading, nFrames, 1. - start, 1. - end);
+
+      mFadePos += nFrames;
+
+      if (mFadePos >= mCrossfadeSamples)
+      {
+        for (auto& slot : mSlots)
+        {
+          if (slot.load(std::memory_order_relaxed) == mFading)
+            slot.store(nullptr, std::memory_order_release);
+        }
+
+        mToRetire = mFading;
+        mFading = nullptr;
+      }
+    }
+    else if (mCurrent)
+      ProcessKernel(mCurrent, nFrames, 1., 1.);
+
+    // there is new tail input, tail output space, or a kernel to delete
+    if (mCurrent || mRetired.load(std::memory_order_relaxed))
+      mWorkAvailable.Signal();
+
+    for (auto c = 0; c < mNChans; c++)
+    {
+      const WDL_FFT_REAL* pMix = mMixPtrs.Get()[c];
+      T* pDest = outputs[c] + offset;
+
+      for (auto s = 0; s < nFrames; s++)
+        pDest[s] = (T) pMix[s];
+    }
+  }
+
+  void ProcessKernel(Kernel* pKernel, int nFrames, double gainStart, double gainEnd)
+  {
+    const double gainStep = (gainEnd - gainStart) / nFrames;
+
+    for (auto pair = 0; pair < NPairs(); pair++)
+    {
+      const int nChans = PairChans(pair);
+      WDL_FFT_REAL** ppIn = mInPtrs.Get() + (pair * 2);
+      WDL_FFT_REAL** ppMix = mMixPtrs.Get() + (pair * 2);
+
+      WDL_ConvolutionEngine_Div* pHead = pKernel->mHead.Get(pair);
+      pHead->Add(ppIn, nFrames, nChans);
+      const int nHead = std::min(nFrames, pHead->Avail(nFrames));
+      WDL_FFT_REAL** ppHead = pHead->Get();
+
+      for (auto c = 0; c < nChans; c++)
+      {
+        double gain = gainStart;
+
+        for (auto s = 0; s < nHead; s++, gain += gainStep)
+          ppMix[c][s] += (WDL_FFT_REAL) (ppHead[c][s] * gain);
+      }
+
+      pHead->Advance(nHead);
+
+      if (!pKernel->mTail.GetSize())
+        continue;
+
+      SampleRing* pTailIn = pKernel->mTailIn.Get(pair);
+      SampleRing* pTailOut = pKernel->mTailOut.Get(pair);
+
+      pTailIn->Write(ppIn, std::min(nFrames, pTailIn->NumWritable()));
+
+      int available = pTailOut->NumReadable();
+
+      if (pKernel->mTailDebt)
+      {
+        const int skip = std::min(pKernel->mTailDebt, available);
+        pTailOut->Read(nullptr, skip);
+        pKernel->mTailDebt -= skip;
+        available -= skip;
+      }
+
+      const int nTail = std::min(nFrames, available);
+      WDL_FFT_REAL* tailPtrs[2] = { mTailScratch.Get(), mTailScratch.Get() + mBlockSize };
+      pTailOut->Read(tailPtrs, nTail);
+
+      for (auto c = 0; c < nChans; c++)
+      {
+        double gain = gainStart;
+
+        for (auto s = 0; s < nTail; s++, gain += gainStep)
+          ppMix[c][s] += (WDL_FFT_REAL) (tailPtrs[c][s] * gain);
+      }
+
+      if (nTail < nFrames)
+      {
+        pKernel->mTailDebt += nFrames - nTail;
+        mTailUnderruns.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /** Runs on the worker thread. @return \c true if any work was done */
+  bool ProcessTail(Kernel* pKernel)
+  {
+    bool didWork = false;
+    const int chunkSize = WorkerChunkSize();
+
+    for (auto pair = 0; pair < pKernel->mTail.GetSize(); pair++)
+    {
+      const int nChans = PairChans(pair);
+      WDL_ConvolutionEngine_Div* pTail = pKernel->mTail.Get(pair);
+      SampleRing* pTailIn = pKernel->mTailIn.Get(pair);
+      SampleRing* pTailOut = pKernel->mTailOut.Get(pair);
+
+      while (true)
+      {
+        const int n = std::min(chunkSize, pTailIn->NumReadable());
+
+        if (!n || pTailOut->NumWritable() < 2 * chunkSize)
+          break;
+
+        WDL_FFT_REAL* inPtrs[2] = { pKernel->mWorkerScratch.Get(), pKernel->mWorkerScratch.Get() + chunkSize };
+        pTailIn->Read(inPtrs, n);
+        pTail->Add(inPtrs, n, nChans);
+
+        const int nOut = std::min(pTail->Avail(n), pTailOut->NumWritable());
+        pTailOut->Write(pTail->Get(), nOut);
+        pTail->Advance(nOut);
+        didWork = true;
+      }
+    }
+
+    return didWork;
+  }
+
+  void StartWorker()
+  {
+    mRunning.store(true);
+
+    mWorker = std::thread([this]() {
+      while (mRunning.load(std::memory_order_acquire))
+      {
+        bool didWork = false;
+
+        for (auto& slot : mSlots)
+        {
+          if (Kernel* pKernel = slot.load(std::memory_order_acquire))
+            didWork |= ProcessTail(pKernel);
+        }
+
+        // the audio thread has removed a retired kernel from the slots before handing it over, and it isn't in use above
+        delete mRetired.exchange(nullptr, std::memory_order_acq_rel);
+
+        if (!didWork)
+          mWorkAvailable.Wait();
+      }
+    });
+  }
+
+  void StopWorker()
+  {
+    mRunning.store(false);
+    mWorkAvailable.Signal();
+
+    if (mWorker.joinable())
+      mWorker.join();
+  }
+
+  void DeleteKernels()
+  {
+    for (auto& slot : mSlots)
+      slot.store(nullptr);
+
+    delete mCurrent;
+    delete mFading;
+    delete mToRetire;
+    delete mRetired.exchange(nullptr);
+    delete mPending.exchange(nullptr);
+    mCurrent = mFading = mToRetire = nullptr;
+  }
+
+  int mNChans;
+  int mCrossfadeSamples;
+  int mBlockSize = 0;
+  int mHeadSize = kMinHeadSize;
+
+  WDL_PtrList<WDL_ImpulseBuffer> mImpulses; // one per channel pair, owned by the thread calling SetImpulse() and Reset()
+
+  // audio thread
+  Kernel* mCurrent = nullptr;
+  Kernel* mFading = nullptr;
+  Kernel* mToRetire = nullptr;
+  int mFadePos = 0;
+  WDL_TypedBuf<WDL_FFT_REAL> mInScratch, mMixScratch, mTailScratch;
+  WDL_TypedBuf<WDL_FFT_REAL*> mInPtrs, mMixPtrs;
+
+  // handoff between threads
+  std::atomic<Kernel*> mPending{nullptr}; // SetImpulse() -> audio thread
+  std::atomic<Kernel*> mSlots[2] = {{nullptr}, {nullptr}}; // audio thread -> worker, the kernels whose tails need computing
+  std::atomic<Kernel*> mRetired{nullptr}; // audio thread -> worker, for deletion
+  std::atomic<int> mTailUnderruns{0};
+
+  std::atomic<bool> mRunning{false};
+  WorkerSignal mWorkAvailable; // audio thread -> worker
+  std::thread mWorker;
+};
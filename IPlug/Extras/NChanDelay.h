@@ -1,67 +1,139 @@
 /*
  ==============================================================================
- 
- This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers. 
- 
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
  See LICENSE.txt for  more info.
- 
+
  ==============================================================================
 */
 
 #pragma once
 
-// A static delayline used to delay bypassed signals to match mLatency in AAX/VST3/AU
+#include <algorithm>
+#include <cstring>
+
+#include "heapbuf.h"
+
+/** A static delayline used to delay bypassed signals to match mLatency in AAX/VST3/AU
+ * Each channel has its own ring buffer, and blocks are moved in at most two contiguous spans per channel,
+ * so the cost per block is a handful of memcpy calls rather than a modulo per sample.
+ * The ring is sized with some headroom beyond the delay time, so that blocks longer than the delay can be processed in place. */
 template<typename T>
 class NChanDelayLine
 {
 public:
+  /** The minimum number of frames that can be moved through the ring in one go, beyond the delay time */
+  static constexpr int kMinChunkSize = 1024;
+
   NChanDelayLine(int nInputChans = 2, int nOutputChans = 2)
   : mNInChans(nInputChans)
   , mNOutChans(nOutputChans)
   {}
 
+  /** Allocate storage for delay times up to maxDelayTimeSamples. Call this from a non-realtime thread if the delay time may grow later,
+   * so that subsequent calls to SetDelayTime() don't need to reallocate.
+   * @param maxDelayTimeSamples The longest delay time (in samples) that will be set */
+  void SetMaxDelayTime(int maxDelayTimeSamples)
+  {
+    const int capacity = maxDelayTimeSamples + kMinChunkSize;
+
+    if (capacity > mCapacity)
+    {
+      mBuffer.Resize(NDelayedChans() * capacity);
+      mCapacity = capacity;
+      mWriteAddress = 0;
+      ClearBuffer();
+    }
+  }
+
+  /** Set the delay time. Within the storage reserved with SetMaxDelayTime() this only moves the read position, so it can be called on the audio thread.
+   * The ring holds the most recent input, so a longer delay reads back earlier input. A delay beyond the reserved storage reallocates
+   * @param delayTimeSamples The delay time in samples */
   void SetDelayTime(int delayTimeSamples)
   {
+    if (delayTimeSamples + kMinChunkSize > mCapacity)
+      SetMaxDelayTime(delayTimeSamples);
+    else if (mDTSamples == 0 && delayTimeSamples > 0)
+      ClearBuffer(); // nothing is written to the ring while the delay is 0, so what it holds is stale
+
     mDTSamples = delayTimeSamples;
-    mBuffer.Resize(mNInChans * delayTimeSamples);
-    mWriteAddress = 0;
-    ClearBuffer();
   }
 
   void ClearBuffer()
   {
-    memset(mBuffer.Get(), 0, mNInChans * mDTSamples * sizeof(T));
+    memset(mBuffer.Get(), 0, mBuffer.GetSize() * sizeof(T));
   }
 
   void ProcessBlock(T** inputs, T** outputs, int nFrames)
   {
-    T* buffer = mBuffer.Get();
+    const int nChans = NDelayedChans();
 
-    for (auto s = 0 ; s < nFrames; ++s)
+    if (mDTSamples == 0)
     {
-      int32_t readAddress = mWriteAddress - mDTSamples;
-      readAddress %= mDTSamples;
+      for (auto c = 0; c < nChans; c++)
+      {
+        if (outputs[c] != inputs[c])
+          memcpy(outputs[c], inputs[c], nFrames * sizeof(T));
+      }
+    }
+    else
+    {
+      const int maxChunkSize = mCapacity - mDTSamples;
 
-      for (auto c = 0; c < mNInChans; c++)
+      for (auto pos = 0; pos < nFrames;)
       {
-        if (c < mNOutChans)
+        const int chunkSize = std::min(nFrames - pos, maxChunkSize);
+        int readAddress = mWriteAddress - mDTSamples;
+
+        if (readAddress < 0)
+          readAddress += mCapacity;
+
+        for (auto c = 0; c < nChans; c++)
         {
-          T input = inputs[c][s];
-          const int offset = c * mDTSamples;
-          outputs[c][s] = buffer[offset + readAddress];
-          buffer[offset + mWriteAddress] = input;
+          T* pRing = mBuffer.Get() + (c * mCapacity);
+          // write before reading so that delays shorter than the chunk read back this chunk's input
+          WriteRing(pRing, mWriteAddress, inputs[c] + pos, chunkSize);
+          ReadRing(pRing, readAddress, outputs[c] + pos, chunkSize);
         }
+
+        mWriteAddress += chunkSize;
+
+        if (mWriteAddress >= mCapacity)
+          mWriteAddress -= mCapacity;
+
+        pos += chunkSize;
       }
+    }
 
-      mWriteAddress++;
-      mWriteAddress %= mDTSamples;
+    // outputs without a corresponding input are silent
+    for (auto c = nChans; c < mNOutChans; c++)
+    {
+      memset(outputs[c], 0, nFrames * sizeof(T));
     }
   }
 
 private:
+  int NDelayedChans() const { return std::min(mNInChans, mNOutChans); }
+
+  void WriteRing(T* pRing, int address, const T* pSrc, int n) const
+  {
+    const int first = std::min(n, mCapacity - address);
+    memcpy(pRing + address, pSrc, first * sizeof(T));
+    memcpy(pRing, pSrc + first, (n - first) * sizeof(T));
+  }
+
+  void ReadRing(const T* pRing, int address, T* pDest, int n) const
+  {
+    const int first = std::min(n, mCapacity - address);
+    memcpy(pDest, pRing + address, first * sizeof(T));
+    memcpy(pDest + first, pRing, (n - first) * sizeof(T));
+  }
+
   WDL_TypedBuf<T> mBuffer;
-  uint32_t mNInChans, mNOutChans;
-  uint32_t mWriteAddress = 0;
-  uint32_t mDTSamples = 0;
+  int mNInChans, mNOutChans;
+  int mWriteAddress = 0;
+  int mDTSamples = 0;
+  int mCapacity = 0;
 } WDL_FIXALIGN;
 
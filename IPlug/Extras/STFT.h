@@ -0,0 +1,479 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief A short-time Fourier transform framework for spectral processing, built on WDL_real_fft
+ * Your project needs to compile WDL/fft.c
+ */
+
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+#include "IPlugConstants.h"
+#include "heapbuf.h"
+#include "fft.h"
+#include "WorkerSignal.h"
+
+/** A multichannel STFT processor, which handles windowing, hop scheduling and weighted overlap-add, so that a plug-in only has to supply a
+ * function that modifies the spectrum of each frame. Spectra are passed as contiguous arrays of GetNumBins() bins, from DC to Nyquist,
+ * either as complex values (ComplexFunc) or as magnitude and phase (PolarFunc).
+ * The same window is applied before the forward and after the inverse transform, and the synthesis window is normalised so that an
+ * unmodified spectrum reconstructs the input exactly, as long as the overlapping windows don't all vanish at the same sample. The Hann and
+ * Blackman windows are zero at their first sample, so with an overlap of 1 that sample of each hop is lost: use an overlap of at least 2 with them.
+ *
+ * The output is delayed by GetLatency() samples, which the plug-in should report e.g. in OnReset():
+ * @code
+ * mSTFT.Reset();
+ * SetLatency(mSTFT.GetLatency());
+ * @endcode
+ *
+ * For large FFT sizes, the frames can be processed on a worker thread, which spreads the cost of each frame over several host blocks
+ * instead of spiking on the blocks where a hop completes. This adds another FFT size of latency, and the spectral function is then called on the worker thread.
+ * ProcessBlock() never allocates or locks.
+ * @tparam T The sample type of the plug-in's buffers */
+template<typename T = double>
+class STFTProcessor
+{
+public:
+  enum EWindowType
+  {
+    kHannWindow = 0,
+    kHammingWindow,
+    kBlackmanWindow,
+    kRectangularWindow
+  };
+
+  /** Called for each channel of each frame, with the complex spectrum (standard, unnormalised DFT of the windowed frame) to be modified in place.
+   * The imaginary parts of the DC and Nyquist bins are ignored on return. NOTE: std::function can call malloc if you pass in captures */
+  using ComplexFunc = std::function<void(int chan, WDL_FFT_COMPLEX* pBins, int nBins)>;
+
+  /** Called for each channel of each frame, with the magnitudes and phases (in radians) of the spectrum to be modified in place */
+  using PolarFunc = std::function<void(int chan, WDL_FFT_REAL* pMags, WDL_FFT_REAL* pPhases, int nBins)>;
+
+  /** @param nChans The number of channels to process */
+  STFTProcessor(int nChans = 2)
+  : mNChans(nChans)
+  {
+    WDL_fft_init();
+    SetFFTSize(1024);
+  }
+
+  ~STFTProcessor()
+  {
+    StopWorker();
+  }
+
+  STFTProcessor(const STFTProcessor&) = delete;
+  STFTProcessor& operator=(const STFTProcessor&) = delete;
+
+  /** Configure the transform and clear the buffers. This allocates, so call it from a non-realtime thread, then report the new latency
+   * @param fftSize The FFT size, a power of two between 16 and 32768
+   * @param overlap The number of frames overlapping each sample, a power of two less than the FFT size. The hop size is fftSize / overlap
+   * @param window The analysis/synthesis window
+   * @param useWorkerThread If \c true, frames are processed on a worker thread, with an extra fftSize samples of latency */
+  void SetFFTSize(int fftSize, int overlap = 4, EWindowType window = kHannWindow, bool useWorkerThread = false)
+  {
+    StopWorker();
+
+    mFFTSize = std::max(16, std::min(32768, fftSize));
+    mOverlap = std::max(1, std::min(mFFTSize / 2, overlap));
+    mHopSize = mFFTSize / mOverlap;
+    mWindowType = window;
+    mUseWorker = useWorkerThread;
+
+    mInput.Resize(mNChans * mFFTSize);
+    mOutput.Resize(mNChans * mFFTSize);
+    mAudioScratch.Resize(mFFTSize);
+    mWorkerScratch.Resize(mFFTSize);
+
+    mFrameScratch.Resize(mFFTSize);
+    mSlots.reset(mUseWorker ? new Slot[NumSlots()] : nullptr);
+
+    for (auto i = 0; mUseWorker && i < NumSlots(); i++)
+      mSlots[i].mData.Resize(mNChans * mFFTSize);
+
+    CalculateWindows();
+    Reset();
+  }
+
+  /** Set a function that modifies complex spectra. Call this before processing starts, and don't set a PolarFunc as well */
+  void SetComplexFunc(ComplexFunc func) { mComplexFunc = func; }
+
+  /** Set a function that modifies magnitude/phase spectra. Call this before processing starts, and don't set a ComplexFunc as well */
+  void SetPolarFunc(PolarFunc func) { mPolarFunc = func; }
+
+  /** Clear all buffered audio. Call this from OnReset(), never concurrently with ProcessBlock() */
+  void Reset()
+  {
+    StopWorker();
+
+    memset(mInput.Get(), 0, mInput.GetSize() * sizeof(WDL_FFT_REAL));
+    memset(mOutput.Get(), 0, mOutput.GetSize() * sizeof(WDL_FFT_REAL));
+    mHopPos = 0;
+    mFrameCount = 0;
+
+    for (auto i = 0; mUseWorker && i < NumSlots(); i++)
+      mSlots[i].mState.store(kSlotFree);
+
+    if (mUseWorker)
+      StartWorker();
+  }
+
+  /** Process a block of audio. Call this on the audio thread
+   * @param inputs mNChans input buffers
+   * @param outputs mNChans output buffers, these may be the same as the inputs
+   * @param nFrames The number of frames to process */
+  void ProcessBlock(T** inputs, T** outputs, int nFrames)
+  {
+    for (auto pos = 0; pos < nFrames;)
+    {
+      const int n = std::min(nFrames - pos, mHopSize - mHopPos);
+
+      for (auto c = 0; c < mNChans; c++)
+      {
+        WDL_FFT_REAL* pIn = InputBuffer(c) + (mFFTSize - mHopSize + mHopPos);
+        const WDL_FFT_REAL* pOut = OutputBuffer(c) + mHopPos;
+        const T* pSrc = inputs[c] + pos;
+        T* pDest = outputs[c] + pos;
+
+        // read the input before writing, in case the buffers are shared
+        for (auto s = 0; s < n; s++)
+        {
+          pIn[s] = (WDL_FFT_REAL) pSrc[s];
+          pDest[s] = (T) pOut[s];
+        }
+      }
+
+      mHopPos += n;
+      pos += n;
+
+      if (mHopPos == mHopSize)
+      {
+        if (mUseWorker)
+          ExchangeFrames();
+        else
+          ProcessFrame();
+
+        mHopPos = 0;
+        mFrameCount++;
+      }
+    }
+  }
+
+  /** @return The delay of the output relative to the input, in samples */
+  int GetLatency() const { return mFFTSize + (mUseWorker ? WorkerLatencyHops() * mHopSize : 0); }
+
+  /** @return The number of bins passed to the spectral function, from DC to Nyquist inclusive */
+  int GetNumBins() const { return mFFTSize / 2 + 1; }
+
+  int GetFFTSize() const { return mFFTSize; }
+  int GetHopSize() const { return mHopSize; }
+
+  /** @return The number of frames that the worker thread didn't finish in time, and which were dropped from the output */
+  int GetNumWorkerUnderruns() const { return mUnderruns.load(std::memory_order_relaxed); }
+
+private:
+  /** The number of hops that a frame may spend on the worker thread. It is the same as the overlap, so the extra latency is one FFT size */
+  int WorkerLatencyHops() const { return mOverlap; }
+
+  enum ESlotState { kSlotFree, kSlotSubmitted, kSlotDone };
+
+  /** A frame handed to the worker thread. Only the audio thread moves a slot from free to submitted, and from done to free */
+  struct Slot
+  {
+    WDL_TypedBuf<WDL_FFT_REAL> mData; // mNChans * mFFTSize samples, the input frame which is replaced with the output
+    size_t mFrame = 0;
+    std::atomic<int> mState{kSlotFree};
+  };
+
+  /** Per thread buffers for transforming a frame */
+  struct FrameScratch
+  {
+    void Resize(int fftSize)
+    {
+      mFFT.Resize(fftSize + 2); // room for the Nyquist bin when unpacked
+      mMags.Resize(fftSize / 2 + 1);
+      mPhases.Resize(fftSize / 2 + 1);
+    }
+
+    WDL_TypedBuf<WDL_FFT_REAL> mFFT, mMags, mPhases;
+  };
+
+  WDL_FFT_REAL* InputBuffer(int chan) { return mInput.Get() + (chan * mFFTSize); }
+  WDL_FFT_REAL* OutputBuffer(int chan) { return mOutput.Get() + (chan * mFFTSize); }
+  int NumSlots() const { return WorkerLatencyHops() + 2; }
+
+  void CalculateWindows()
+  {
+    const int N = mFFTSize;
+    mAnalysisWindow.Resize(N);
+    mSynthesisWindow.Resize(N);
+    WDL_FFT_REAL* pAnalysis = mAnalysisWindow.Get();
+    WDL_FFT_REAL* pSynthesis = mSynthesisWindow.Get();
+
+    for (auto i = 0; i < N; i++)
+    {
+      const double x = 2. * PI * i / N; // periodic windows
+      double w = 1.;
+
+      switch (mWindowType)
+      {
+        case kHannWindow: w = 0.5 - 0.5 * std::cos(x); break;
+        case kHammingWindow: w = 0.54 - 0.46 * std::cos(x); break;
+        case kBlackmanWindow: w = 0.42 - 0.5 * std::cos(x) + 0.08 * std::cos(2. * x); break;
+        case kRectangularWindow: break;
+      }
+
+      // WDL_real_fft returns twice the DFT
+      pAnalysis[i] = (WDL_FFT_REAL) (0.5 * w);
+      pSynthesis[i] = (WDL_FFT_REAL) w;
+    }
+
+    // normalise the synthesis window by the overlapping sum of both windows at each position, and by the inverse transform's gain of N
+    for (auto i = 0; i < mHopSize; i++)
+    {
+      double sum = 0.;
+
+      for (auto j = i; j < N; j += mHopSize)
+        sum += pSynthesis[j] * pSynthesis[j];
+
+      // Blackman's first sample is zero only up to rounding, don't let it blow up
+      const double scale = sum > 1e-12 ? 1. / (sum * N) : 0.;
+
+      for (auto j = i; j < N; j += mHopSize)
+        pSynthesis[j] = (WDL_FFT_REAL) (pSynthesis[j] * scale);
+    }
+  }
+
+  /** Transform one channel of a frame in place: window, FFT, spectral function, inverse FFT and synthesis window */
+  void TransformFrame(FrameScratch& scratch, int chan, WDL_FFT_REAL* pFrame)
+  {
+    const int N = mFFTSize;
+    const int nBins = GetNumBins();
+    WDL_FFT_REAL* pFFT = scratch.mFFT.Get();
+    WDL_FFT_COMPLEX* pSpectrum = (WDL_FFT_COMPLEX*) pFFT;
+    const WDL_FFT_REAL* pAnalysis = mAnalysisWindow.Get();
+    const WDL_FFT_REAL* pSynthesis = mSynthesisWindow.Get();
+    const int* pPermute = WDL_fft_permute_tab(N / 2);
+
+    for (auto i = 0; i < N; i++)
+      pFrame[i] *= pAnalysis[i];
+
+    WDL_real_fft(pFrame, N, 0);
+
+    // unpack into bin order, WDL_real_fft stores the Nyquist bin in the imaginary part of DC
+    const WDL_FFT_COMPLEX* pPacked = (const WDL_FFT_COMPLEX*) pFrame;
+    pSpectrum[0].re = pPacked[0].re;
+    pSpectrum[0].im = 0.;
+    pSpectrum[N / 2].re = pPacked[0].im;
+    pSpectrum[N / 2].im = 0.;
+
+    for (auto k = 1; k < N / 2; k++)
+      pSpectrum[k] = pPacked[pPermute[k]];
+
+    if (mComplexFunc)
+    {
+      mComplexFunc(chan, pSpectrum, nBins);
+    }
+    else if (mPolarFunc)
+    {
+      WDL_FFT_REAL* pMags = scratch.mMags.Get();
+      WDL_FFT_REAL* pPhases = scratch.mPhases.Get();
+
+      for (auto k = 0; k < nBins; k++)
+      {
+        pMags[k] = std::sqrt(pSpectrum[k].re * pSpectrum[k].re + pSpectrum[k].im * pSpectrum[k].im);
+        pPhases[k] = std::atan2(pSpectrum[k].im, pSpectrum[k].re);
+      }
+
+      mPolarFunc(chan, pMags, pPhases, nBins);
+
+      for (auto k = 0; k < nBins; k++)
+      {
+        pSpectrum[k].re = pMags[k] * std::cos(pPhases[k]);
+        pSpectrum[k].im = pMags[k] * std::sin(pPhases[k]);
+      }
+    }
+
+    WDL_FFT_COMPLEX* pRepacked = (WDL_FFT_COMPLEX*) pFrame;
+    pRepacked[0].re = pSpectrum[0].re;
+    pRepacked[0].im = pSpectrum[N / 2].re;
+
+    for (auto k = 1; k < N / 2; k++)
+      pRepacked[pPermute[k]] = pSpectrum[k];
+
+    WDL_real_fft(pFrame, N, 1);
+
+    for (auto i = 0; i < N; i++)
+      pFrame[i] *= pSynthesis[i];
+  }
+
+  /** Discard the hop that has been output, and add a transformed frame to the overlap-add buffer */
+  void OverlapAdd(int chan, const WDL_FFT_REAL* pFrame)
+  {
+    WDL_FFT_REAL* pOut = OutputBuffer(chan);
+    memmove(pOut, pOut + mHopSize, (mFFTSize - mHopSize) * sizeof(WDL_FFT_REAL));
+    memset(pOut + (mFFTSize - mHopSize), 0, mHopSize * sizeof(WDL_FFT_REAL));
+
+    if (pFrame)
+    {
+      for (auto i = 0; i < mFFTSize; i++)
+        pOut[i] += pFrame[i];
+    }
+  }
+
+  void AdvanceInput(int chan)
+  {
+    WDL_FFT_REAL* pIn = InputBuffer(chan);
+    memmove(pIn, pIn + mHopSize, (mFFTSize - mHopSize) * sizeof(WDL_FFT_REAL));
+  }
+
+  void ProcessFrame()
+  {
+    WDL_FFT_REAL* pFrame = mFrameScratch.Get();
+
+    for (auto c = 0; c < mNChans; c++)
+    {
+      memcpy(pFrame, InputBuffer(c), mFFTSize * sizeof(WDL_FFT_REAL));
+      TransformFrame(mAudioScratch, c, pFrame);
+      OverlapAdd(c, pFrame);
+      AdvanceInput(c);
+    }
+  }
+
+  /** Collect the frame submitted WorkerLatencyHops() ago, and submit the current one */
+  void ExchangeFrames()
+  {
+    const int nSlots = NumSlots();
+    const bool expectFrame = mFrameCount >= (size_t) WorkerLatencyHops();
+    const size_t collectFrame = mFrameCount - WorkerLatencyHops();
+    Slot* pCollect = expectFrame ? &mSlots[collectFrame % nSlots] : nullptr;
+
+    if (pCollect && pCollect->mState.load(std::memory_order_acquire) == kSlotDone && pCollect->mFrame == collectFrame)
+    {
+      for (auto c = 0; c < mNChans; c++)
+        OverlapAdd(c, pCollect->mData.Get() + (c * mFFTSize));
+
+      pCollect->mState.store(kSlotFree, std::memory_order_release);
+    }
+    else
+    {
+      for (auto c = 0; c < mNChans; c++)
+        OverlapAdd(c, nullptr);
+
+      if (expectFrame)
+        mUnderruns.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Slot& submit = mSlots[mFrameCount % nSlots];
+    int state = submit.mState.load(std::memory_order_acquire);
+
+    if (state == kSlotDone) // a late frame that was never collected
+    {
+      submit.mState.store(kSlotFree, std::memory_order_relaxed);
+      state = kSlotFree;
+    }
+
+    // if the worker is still busy with a late frame in this slot, the current frame is dropped, and counted when it is due
+    if (state == kSlotFree)
+    {
+      for (auto c = 0; c < mNChans; c++)
+        memcpy(submit.mData.Get() + (c * mFFTSize), InputBuffer(c), mFFTSize * sizeof(WDL_FFT_REAL));
+
+      submit.mFrame = mFrameCount;
+      submit.mState.store(kSlotSubmitted, std::memory_order_release);
+      mWorkAvailable.Signal();
+    }
+
+    for (auto c = 0; c < mNChans; c++)
+      AdvanceInput(c);
+  }
+
+  /** Runs on the worker thread. @return \c true if a frame was processed */
+  bool ProcessNextSubmittedFrame()
+  {
+    Slot* pNext = nullptr;
+
+    for (auto i = 0; i < NumSlots(); i++)
+    {
+      Slot& slot = mSlots[i];
+
+      if (slot.mState.load(std::memory_order_acquire) == kSlotSubmitted && (!pNext || slot.mFrame < pNext->mFrame))
+        pNext = &slot;
+    }
+
+    if (!pNext)
+      return false;
+
+    for (auto c = 0; c < mNChans; c++)
+      TransformFrame(mWorkerScratch, c, pNext->mData.Get() + (c * mFFTSize));
+
+    pNext->mState.store(kSlotDone, std::memory_order_release);
+    return true;
+  }
+
+  void StartWorker()
+  {
+    mRunning.store(true);
+
+    mWorker = std::thread([this]() {
+      while (mRunning.load(std::memory_order_acquire))
+      {
+        if (!ProcessNextSubmittedFrame())
+          mWorkAvailable.Wait();
+      }
+    });
+  }
+
+  void StopWorker()
+  {
+    mRunning.store(false);
+    mWorkAvailable.Signal();
+
+    if (mWorker.joinable())
+      mWorker.join();
+  }
+
+  int mNChans;
+  int mFFTSize = 0;
+  int mOverlap = 0;
+  int mHopSize = 0;
+  EWindowType mWindowType = kHannWindow;
+  bool mUseWorker = false;
+
+  ComplexFunc mComplexFunc = nullptr;
+  PolarFunc mPolarFunc = nullptr;
+
+  WDL_TypedBuf<WDL_FFT_REAL> mAnalysisWindow, mSynthesisWindow;
+
+  // audio thread
+  WDL_TypedBuf<WDL_FFT_REAL> mInput; // the last mFFTSize input samples of each channel
+  WDL_TypedBuf<WDL_FFT_REAL> mOutput; // the overlap-add accumulator of each channel, the first mHopSize samples are being output
+  WDL_TypedBuf<WDL_FFT_REAL> mFrameScratch;
+  FrameScratch mAudioScratch;
+  int mHopPos = 0;
+  size_t mFrameCount = 0;
+
+  // worker thread
+  FrameScratch mWorkerScratch;
+  std::unique_ptr<Slot[]> mSlots; // NumSlots() frames in flight, only allocated when using the worker thread
+  std::atomic<int> mUnderruns{0};
+  std::atomic<bool> mRunning{false};
+  WorkerSignal mWorkAvailable;
+  std::thread mWorker;
+};
@@ -49,10 +49,11 @@ struct ControlRamp
    * @param buffer Pointer to the start of an output buffer.
    * @param startIdx Sample index of the start of the desired write within the buffer.
    * @param nFrames The number of samples to be written. */
-  void Write(float* buffer, int startIdx, int nFrames)
+  template <typename T>
+  void Write(T* buffer, int startIdx, int nFrames)
   {
-    float val = startValue;
-    float dv = (endValue - startValue)/(transitionEnd - transitionStart);
+    T val = startValue;
+    T dv = (endValue - startValue)/(transitionEnd - transitionStart);
     for(int i=startIdx; i<startIdx + transitionStart; ++i)
     {
       buffer[i] = val;
@@ -286,6 +286,7 @@ void MidiSynth::SetMPEZones(int channel, int nChans)
   else if ((!anyMPEChannelsActive) && (mMPEMode))
   {
     mMPEMode = false;
+    mVoiceAllocator.ClearChannelExpression();
   }
 
   // reset pitch bend ranges as per MPE spec
@@ -332,6 +333,18 @@ void MidiSynth::SetChannelPitchBendRange(int channelParam, int rangeParam)
   }
 }
 
+// the voice control written by an MPE expression event, or -1
+static int ExpressionControlForAction(EVoiceAction action)
+{
+  switch(action)
+  {
+    case kPitchBendAction: return kVoiceControlPitchBend;
+    case kPressureAction: return kVoiceControlPressure;
+    case kTimbreAction: return kVoiceControlTimbre;
+    default: return -1;
+  }
+}
+
 bool IsRPNMessage(IMidiMsg msg)
 {
   if(msg.StatusMsg() != IMidiMsg::kControlChange) return false;
@@ -425,7 +438,14 @@ bool MidiSynth::ProcessBlock(sample** inputs, sample** outputs, int nInputs, int
           // send performance messages to the voice allocator
           // message offset is relative to the start of this processSamples() block
           msg.mOffset -= startIndex;
-          mVoiceAllocator.AddEvent(MidiMessageToEvent(msg));
+          const VoiceInputEvent event = MidiMessageToEvent(msg);
+          const int expressionControl = mMPEMode ? ExpressionControlForAction(event.mAction) : -1;
+
+          // MPE expression goes straight to the voice that owns the member channel, rather than through the input queue
+          if(expressionControl >= 0)
+            mVoiceAllocator.SendExpressionToChannel(event.mAddress.mZone, event.mAddress.mChannel, expressionControl, event.mValue);
+          else
+            mVoiceAllocator.AddEvent(event);
         }
         mMidiQueue.Remove();
       }
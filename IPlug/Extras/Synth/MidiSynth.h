@@ -16,6 +16,8 @@
  */
 
 #include <array>
+#include <cstdlib>
+#include <cstring>
 #include <vector>
 #include <stdint.h>
 
@@ -57,6 +59,12 @@ public:
 
   void SetSampleRateAndBlockSize(double sampleRate, int blockSize);
 
+  /** @return The largest number of samples that a voice processes at once */
+  int GetBlockSize() const
+  {
+    return mBlockSize;
+  }
+
   /** If you are using this class in a non-traditional mode of polyphony (e.g.to stack loads of voices) you might want to manually SetVoicesActive()
    * usually this would happen when you trigger notes
    * @param active should the class report that voices are active */
@@ -121,9 +129,18 @@ public:
     mVoiceAllocator.AddVoice(pVoice, zone);
   }
 
-  void AddMidiMsgToQueue(const IMidiMsg& msg)
+  /** Queues a MIDI message for the next call to ProcessBlock(). The queue is sized by SetSampleRateAndBlockSize() and never allocates here,
+   * if it is full the message is dropped
+   * @return \c false if the message was dropped */
+  bool AddMidiMsgToQueue(const IMidiMsg& msg)
+  {
+    return mMidiQueue.Add(msg);
+  }
+
+  /** @return The number of MIDI messages dropped because the queue was full. Can be called from any thread, e.g. to add it to IPerformanceStats::mNumMidiQueueOverflows */
+  int GetNumDroppedMidiMsgs() const
   {
-    mMidiQueue.Add(msg);
+    return mMidiQueue.GetNumDropped();
   }
 
   /** Processes a block of audio samples
@@ -178,7 +195,7 @@ private:
 
   VoiceAllocator mVoiceAllocator;
   uint16_t mUnisonVoices{1};
-  IMidiQueue mMidiQueue;
+  IMidiQueue mMidiQueue { DEFAULT_BLOCK_SIZE, IMidiQueue::kDropNewest };
   float mVelocityLUT[128];
   float mAfterTouchLUT[128];
   ChannelState mChannelStates[16]{};
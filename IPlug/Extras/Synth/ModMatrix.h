@@ -0,0 +1,366 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc ModMatrix
+ */
+
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+
+#include "heapbuf.h"
+
+#include "IPlugConstants.h"
+#include "IPlugQueue.h"
+
+/** A modulation matrix for a MidiSynth, which routes sources (envelopes, LFOs, MPE expressions, parameters) to destinations with a depth and a curve.
+ *
+ * Sources are either global, a buffer that is shared by all the voices, e.g. a smoothed parameter or a global LFO, see SetGlobalSource(),
+ * or per voice, written by each voice into its own buffer, e.g. envelopes or the MPE expressions in SynthVoice::mInputs, see GetVoiceSource().
+ * Each voice evaluates the matrix once per block with ProcessVoice(), after it has written its sources, and then reads its destinations with GetDestination().
+ * A destination is the sum of depth * curve(source) for all the routings to it.
+ *
+ * The buffers of a voice are contiguous, and only the routings with a non-zero depth are evaluated, each with a loop over the block that vectorises.
+ * Routings live in a fixed number of slots, so they can be added, changed and removed on the audio thread without allocating.
+ * The matrix is not thread safe: AddRouting(), SetRouting() and the other methods that change the routings must be called on the thread that processes the voices,
+ * or before processing starts. OnParamChange() is not always called on the audio thread, so from there, or from the UI, queue the change with QueueRouting().
+ * The audio thread applies the queued changes with ProcessQueuedChanges(), before it processes the voices */
+template <typename T = sample>
+class ModMatrix
+{
+public:
+  static constexpr int kMaxRoutings = 64;
+
+  /** The curves that are applied to a source before it is scaled by the depth of a routing */
+  enum ECurve
+  {
+    kCurveLinear = 0, // x
+    kCurveSquared, // x * |x|, more resolution near 0, keeps the sign of bipolar sources
+    kCurveCubed, // x * x * x
+    kCurveBipolar, // 2x - 1, a unipolar source from 0 to 1 swings from -1 to 1
+    kCurveInverted, // 1 - x
+    kNumCurves
+  };
+
+  /** @param nSources The number of sources
+   * @param nDestinations The number of destinations */
+  ModMatrix(int nSources, int nDestinations)
+  : mNumSources(nSources)
+  , mNumDestinations(nDestinations)
+  {
+    mGlobalSources.Resize(nSources);
+    memset(mGlobalSources.Get(), 0, nSources * sizeof(const T*));
+    mNumRoutingsToDestination.Resize(nDestinations);
+    ClearRoutings();
+  }
+
+  ModMatrix(const ModMatrix&) = delete;
+  ModMatrix& operator=(const ModMatrix&) = delete;
+
+  /** Allocate the buffers of the voices, which are cleared. Call this on the main thread, e.g. when the synth is reset
+   * @param nVoices The number of voices
+   * @param maxFrames The largest block a voice processes at once, see MidiSynth::GetBlockSize() */
+  void Resize(int nVoices, int maxFrames)
+  {
+    mNumVoices = nVoices;
+    mMaxFrames = maxFrames;
+    mVoiceData.Resize(nVoices * VoiceStride());
+    mZeros.Resize(maxFrames);
+    memset(mVoiceData.Get(), 0, mVoiceData.GetSize() * sizeof(T));
+    memset(mZeros.Get(), 0, mZeros.GetSize() * sizeof(T));
+  }
+
+  int NSources() const { return mNumSources; }
+  int NDestinations() const { return mNumDestinations; }
+  int GetMaxFrames() const { return mMaxFrames; }
+
+#pragma mark - Routings
+
+  /** Route a source to a destination
+   * @param source The source index
+   * @param destination The destination index
+   * @param depth The amount of the source that is added to the destination. A routing with depth 0 is kept but not evaluated
+   * @param curve The curve applied to the source
+   * @return The index of the routing, to change or remove it, or -1 if the indices are out of range or all kMaxRoutings slots are used */
+  int AddRouting(int source, int destination, T depth, ECurve curve = kCurveLinear)
+  {
+    for (auto r = 0; r < kMaxRoutings; r++)
+    {
+      if (mRoutings[r].source < 0)
+        return SetRouting(r, source, destination, depth, curve) ? r : -1;
+    }
+
+    return -1;
+  }
+
+  /** Set the routing in a given slot, replacing any routing that is there
+   * @param routingIdx The slot, from 0 to kMaxRoutings - 1
+   * @param source The source index, or -1 to remove the routing
+   * @param destination The destination index
+   * @param depth The amount of the source that is added to the destination
+   * @param curve The curve applied to the source
+   * @return \c false if the indices are out of range, in which case the slot is unchanged */
+  bool SetRouting(int routingIdx, int source, int destination, T depth, ECurve curve = kCurveLinear)
+  {
+    if (!ApplyRouting(RoutingChange { routingIdx, source, destination, depth, curve }))
+      return false;
+
+    UpdateActiveRoutings();
+    return true;
+  }
+
+  /** @param routingIdx The index returned by AddRouting()
+   * @param depth The new depth. Setting a depth of 0 stops the routing from being evaluated until it is non-zero again */
+  void SetRoutingDepth(int routingIdx, T depth)
+  {
+    Routing& routing = mRoutings[routingIdx];
+    const bool wasActive = routing.IsActive();
+    routing.depth = depth;
+
+    if (routing.IsActive() != wasActive)
+      UpdateActiveRoutings();
+  }
+
+  void SetRoutingCurve(int routingIdx, ECurve curve)
+  {
+    mRoutings[routingIdx].curve = curve;
+  }
+
+  void RemoveRouting(int routingIdx)
+  {
+    mRoutings[routingIdx] = Routing();
+    UpdateActiveRoutings();
+  }
+
+  void ClearRoutings()
+  {
+    for (auto& routing : mRoutings)
+      routing = Routing();
+
+    UpdateActiveRoutings();
+  }
+
+  /** Queue a routing to be set by ProcessQueuedChanges(), see SetRouting(). Call this from one thread other than the audio thread, e.g. from OnParamChange() or the UI.
+   * The caller chooses the slot, since the change is only applied later
+   * @return \c false if the queue is full, and the change is dropped */
+  bool QueueRouting(int routingIdx, int source, int destination, T depth, ECurve curve = kCurveLinear)
+  {
+    return mQueuedChanges.Push(RoutingChange { routingIdx, source, destination, depth, curve });
+  }
+
+  /** Apply the changes queued by QueueRouting(), in order. Call this on the audio thread before processing the voices, e.g. at the start of ProcessBlock() */
+  void ProcessQueuedChanges()
+  {
+    if (!mQueuedChanges.ElementsAvailable())
+      return;
+
+    RoutingChange change;
+
+    while (mQueuedChanges.Pop(change))
+      ApplyRouting(change);
+
+    UpdateActiveRoutings();
+  }
+
+  /** @return The number of routings that are evaluated, those with a non-zero depth */
+  int NActiveRoutings() const { return mNumActiveRoutings; }
+
+  /** @return \c true if any routing with a non-zero depth goes to the destination. If not, a voice can skip the work it would do to apply it */
+  bool IsModulated(int destination) const { return mNumRoutingsToDestination.Get()[destination] > 0; }
+
+#pragma mark - Sources
+
+  /** Make a source global, i.e. shared by all the voices
+   * @param source The source index
+   * @param pBuffer The source signal for the whole block that MidiSynth::ProcessBlock() is processing, e.g. the output of a smoother, or nullptr to make it a per voice source again */
+  void SetGlobalSource(int source, const T* pBuffer)
+  {
+    mGlobalSources.Get()[source] = pBuffer;
+  }
+
+  /** @param voiceIdx The voice index, see SynthVoice::mVoiceNumber
+   * @param source The source index
+   * @return The buffer that the voice writes a per voice source to, before ProcessVoice(). Sample 0 is the first sample of the voice's block */
+  T* GetVoiceSource(int voiceIdx, int source)
+  {
+    return GetVoiceBuffer(voiceIdx, source);
+  }
+
+#pragma mark - Evaluation
+
+  /** Evaluate the routings for a voice, for a block of up to GetMaxFrames() samples
+   * @param voiceIdx The voice index
+   * @param startIdx The start of the block within the buffers of the global sources, the startIdx that is passed to SynthVoice::ProcessSamplesAccumulating()
+   * @param nFrames The number of samples */
+  void ProcessVoice(int voiceIdx, int startIdx, int nFrames)
+  {
+    assert(nFrames <= mMaxFrames);
+
+    int prevDestination = -1;
+
+    for (auto i = 0; i < mNumActiveRoutings; i++)
+    {
+      const Routing& routing = mRoutings[mActiveRoutings[i]];
+      const T* pGlobalSource = mGlobalSources.Get()[routing.source];
+      const T* pSource = pGlobalSource ? pGlobalSource + startIdx : GetVoiceBuffer(voiceIdx, routing.source);
+      T* pDestination = GetVoiceBuffer(voiceIdx, mNumSources + routing.destination);
+
+      // the active routings are sorted by destination, so the first one to each destination overwrites the previous block
+      const bool overwrite = routing.destination != prevDestination;
+      prevDestination = routing.destination;
+
+      switch (routing.curve)
+      {
+        case kCurveSquared: Accumulate<kCurveSquared>(pSource, pDestination, routing.depth, overwrite, nFrames); break;
+        case kCurveCubed: Accumulate<kCurveCubed>(pSource, pDestination, routing.depth, overwrite, nFrames); break;
+        case kCurveBipolar: Accumulate<kCurveBipolar>(pSource, pDestination, routing.depth, overwrite, nFrames); break;
+        case kCurveInverted: Accumulate<kCurveInverted>(pSource, pDestination, routing.depth, overwrite, nFrames); break;
+        default: Accumulate<kCurveLinear>(pSource, pDestination, routing.depth, overwrite, nFrames); break;
+      }
+    }
+  }
+
+  /** @param voiceIdx The voice index
+   * @param destination The destination index
+   * @return The modulation of the destination for the block evaluated by ProcessVoice(), or a buffer of zeros if nothing is routed to it */
+  const T* GetDestination(int voiceIdx, int destination) const
+  {
+    if (!IsModulated(destination))
+      return mZeros.Get();
+
+    return mVoiceData.Get() + (voiceIdx * VoiceStride()) + ((mNumSources + destination) * mMaxFrames);
+  }
+
+private:
+  struct Routing
+  {
+    int source = -1; // -1 if the slot is free
+    int destination = -1;
+    T depth = 0.;
+    ECurve curve = kCurveLinear;
+
+    bool IsActive() const { return source >= 0 && depth != 0.; }
+  };
+
+  struct RoutingChange
+  {
+    int routingIdx;
+    int source; // -1 to remove the routing
+    int destination;
+    T depth;
+    ECurve curve;
+  };
+
+  /** Set a slot without updating the list of routings to evaluate, so that several changes only rebuild it once */
+  bool ApplyRouting(const RoutingChange& change)
+  {
+    if (change.routingIdx < 0 || change.routingIdx >= kMaxRoutings)
+      return false;
+
+    Routing& routing = mRoutings[change.routingIdx];
+
+    if (change.source < 0)
+    {
+      routing = Routing();
+      return true;
+    }
+
+    if (change.source >= mNumSources || change.destination < 0 || change.destination >= mNumDestinations)
+      return false;
+
+    routing.source = change.source;
+    routing.destination = change.destination;
+    routing.depth = change.depth;
+    routing.curve = change.curve;
+    return true;
+  }
+
+  template <int curve>
+  static inline T Curve(T x)
+  {
+    switch (curve)
+    {
+      case kCurveSquared: return x * std::abs(x);
+      case kCurveCubed: return x * x * x;
+      case kCurveBipolar: return T(2) * x - T(1);
+      case kCurveInverted: return T(1) - x;
+      default: return x;
+    }
+  }
+
+  template <int curve>
+  static void Accumulate(const T* pSource, T* pDestination, T depth, bool overwrite, int nFrames)
+  {
+    if (overwrite)
+    {
+      for (auto s = 0; s < nFrames; s++)
+        pDestination[s] = depth * Curve<curve>(pSource[s]);
+    }
+    else
+    {
+      for (auto s = 0; s < nFrames; s++)
+        pDestination[s] += depth * Curve<curve>(pSource[s]);
+    }
+  }
+
+  /** Rebuild the list of routings to evaluate, sorted by destination so that each destination is written by consecutive routings */
+  void UpdateActiveRoutings()
+  {
+    mNumActiveRoutings = 0;
+    memset(mNumRoutingsToDestination.Get(), 0, mNumDestinations * sizeof(int));
+
+    for (auto r = 0; r < kMaxRoutings; r++)
+    {
+      const Routing& routing = mRoutings[r];
+
+      if (!routing.IsActive())
+        continue;
+
+      // insertion sort, there are few routings and this only runs when they change
+      auto i = mNumActiveRoutings++;
+
+      for (; i > 0 && mRoutings[mActiveRoutings[i - 1]].destination > routing.destination; i--)
+        mActiveRoutings[i] = mActiveRoutings[i - 1];
+
+      mActiveRoutings[i] = static_cast<int16_t>(r);
+      mNumRoutingsToDestination.Get()[routing.destination]++;
+    }
+  }
+
+  int VoiceStride() const { return (mNumSources + mNumDestinations) * mMaxFrames; }
+
+  T* GetVoiceBuffer(int voiceIdx, int buffer)
+  {
+    assert(voiceIdx < mNumVoices);
+    return mVoiceData.Get() + (voiceIdx * VoiceStride()) + (buffer * mMaxFrames);
+  }
+
+  const int mNumSources;
+  const int mNumDestinations;
+  int mNumVoices = 0;
+  int mMaxFrames = 0;
+
+  std::array<Routing, kMaxRoutings> mRoutings;
+  std::array<int16_t, kMaxRoutings> mActiveRoutings;
+  int mNumActiveRoutings = 0;
+
+  WDL_TypedBuf<const T*> mGlobalSources; // nullptr for per voice sources
+  WDL_TypedBuf<int> mNumRoutingsToDestination;
+  WDL_TypedBuf<T> mVoiceData; // per voice, the source buffers followed by the destination buffers, mMaxFrames each
+  WDL_TypedBuf<T> mZeros;
+
+  IPlugQueue<RoutingChange> mQueuedChanges { kMaxRoutings };
+};
@@ -16,6 +16,8 @@
  */
 
 #include <array>
+#include <cstdlib>
+#include <cstring>
 #include <vector>
 #include <stdint.h>
 
@@ -101,7 +103,7 @@ public:
 protected:
   VoiceInputs mInputs;
   int64_t mLastTriggeredTime{-1};
-  uint8_t mVoiceNumber{0};
+  uint8_t mVoiceNumber{0}; // the index of the voice in the synth, e.g. for ModMatrix
   uint8_t mZone{0};
   uint8_t mChannel{0};
   uint8_t mKey{0};
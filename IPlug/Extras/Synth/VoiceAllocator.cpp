@@ -25,9 +25,7 @@ VoiceAllocator::VoiceAllocator()
 {
   // setup default key->pitch fn
   mKeyToPitchFn = [](int k){return (k - 69.)/12.;};
-
-  mSustainedNotes.reserve(128);
-  mHeldKeys.reserve(128);
+  CalcKeyPitches();
 }
 
 VoiceAllocator::~VoiceAllocator()
@@ -36,9 +34,10 @@ VoiceAllocator::~VoiceAllocator()
 
 void VoiceAllocator::Clear()
 {
-  mHeldKeys.clear();
-  mSustainedNotes.clear();
+  mHeldKeys.Clear();
+  mSustainedNotes.Clear();
   HardKillAllVoices();
+  ClearChannelExpression();
 }
 
 void VoiceAllocator::ClearVoiceInputs(SynthVoice* pVoice)
@@ -51,12 +50,17 @@ void VoiceAllocator::ClearVoiceInputs(SynthVoice* pVoice)
 
 void VoiceAllocator::AddVoice(SynthVoice* pVoice, uint8_t zone)
 {
-  if(mVoicePtrs.size() + 1 < UCHAR_MAX)
+  if(mVoicePtrs.size() < kMaxVoices)
   {
+    const int voiceIdx = static_cast<int>(mVoicePtrs.size());
     mVoicePtrs.push_back(pVoice);
     ClearVoiceInputs(pVoice);
     pVoice->mKey = -1;
     pVoice->mZone = zone;
+    pVoice->mVoiceNumber = static_cast<uint8_t>(voiceIdx);
+
+    mVoiceStates.PushBack(kVoiceFree, voiceIdx);
+    mVoicesByChannel.PushBack(pVoice->mChannel % kNumChannels, voiceIdx);
 
     // make a glides structures for the control ramps of the new voice
     mVoiceGlides.emplace_back(ControlRampProcessor::Create(pVoice->mInputs));
@@ -67,124 +71,137 @@ void VoiceAllocator::AddVoice(SynthVoice* pVoice, uint8_t zone)
   }
 }
 
-VoiceAllocator::VoiceBitsArray VoiceAllocator::VoicesMatchingAddress(VoiceAddress addr)
+bool VoiceAllocator::VoiceMatchesAddress(int voiceIdx, VoiceAddress addr) const
 {
-  const int n = static_cast<int>(mVoicePtrs.size());
-  VoiceBitsArray v;
+  const SynthVoice* pVoice = mVoicePtrs[voiceIdx];
 
-  // set all bits to true
-  for(int i=0; i<n; ++i)
-  {
-    v[i] = true;
-  }
+  if(addr.mZone != kAllZones && pVoice->mZone != addr.mZone)
+    return false;
 
-  // for each criterion present in address, clear any voice bits not matching
+  // setting the flag kVoicesAll matches all voices in the zone of the address.
+  if(addr.mFlags & kVoicesAll)
+    return true;
 
-  // zone
-  if(addr.mZone != kAllZones)
-  {
-    for(int i=0; i<n; ++i)
-    {
-      v[i] = v[i] & (mVoicePtrs[i]->mZone == addr.mZone);
-    }
-  }
+  if(addr.mChannel != kAllChannels && pVoice->mChannel != addr.mChannel)
+    return false;
 
-  // setting the flag kVoicesAll returns all voices matching the zone of the address.
-  if(addr.mFlags & kVoicesAll) return v;
+  if(addr.mKey != kAllKeys && pVoice->mKey != addr.mKey)
+    return false;
 
-  // channel
-  if(addr.mChannel != kAllChannels)
-  {
-    for(int i=0; i<n; ++i)
-    {
-      v[i] = v[i] & (mVoicePtrs[i]->mChannel == addr.mChannel);
-    }
-  }
+  if((addr.mFlags & kVoicesBusy) && !pVoice->GetBusy())
+    return false;
 
-  // Key
-  if(addr.mKey != kAllKeys)
-  {
-    for(int i=0; i<n; ++i)
-    {
-      v[i] = v[i] & (mVoicePtrs[i]->mKey == addr.mKey);
-    }
-  }
+  return true;
+}
 
-  // busy flag
-  if(addr.mFlags & kVoicesBusy)
-  {
-    for(int i=0; i<n; ++i)
-    {
-      v[i] = v[i] & mVoicePtrs[i]->GetBusy();
-    }
-  }
+template <typename F>
+void VoiceAllocator::ForEachVoiceMatching(VoiceAddress addr, F func)
+{
+  const bool mostRecent = !(addr.mFlags & kVoicesAll) && (addr.mFlags & kVoicesMostRecent);
+  int64_t maxT = -1;
+  int maxIdx = -1;
 
-  // most recent
-  if(addr.mFlags & kVoicesMostRecent)
-  {
-    int64_t maxT = -1;
-    int maxIdx = -1;
-    for(int i=0; i<n; ++i)
+  auto visit = [&](int i) {
+    if(!VoiceMatchesAddress(i, addr))
+      return;
+
+    if(mostRecent)
     {
-      if(v[i])
+      const int64_t vt = mVoicePtrs[i]->mLastTriggeredTime;
+      if(vt > maxT || (vt == maxT && i < maxIdx))
       {
-        int64_t vt = mVoicePtrs[i]->mLastTriggeredTime;
-        if(vt > maxT)
-        {
-          maxT = vt;
-          maxIdx = i;
-        }
+        maxT = vt;
+        maxIdx = i;
       }
     }
+    else
+      func(i);
+  };
 
-    // set all bits to false
-    //v.reset();
-    for(int i=0; i<n; ++i)
+  // func may unlink the voice it is called with, so the next voice is fetched first
+  auto visitList = [&](const auto& lists, int list) {
+    for(int i = lists.Front(list); i != lists.kNone;)
     {
-      v[i] = 0;
+      const int next = lists.Next(i);
+      visit(i);
+      i = next;
     }
+  };
 
-    if(maxIdx >= 0)
+  if(addr.mFlags & kVoicesAll)
+  {
+    for(int i=0; i<mVoicePtrs.size(); ++i)
+      visit(i);
+  }
+  else if(addr.mKey != kAllKeys)
+  {
+    // only voices whose gate is on have a key, so these are all in the key index
+    if(addr.mChannel != kAllChannels)
+      visitList(mVoicesByKey, KeySlot(addr.mChannel, addr.mKey));
+    else
     {
-      v[maxIdx] = true;
+      for(int c=0; c<kNumChannels; ++c)
+        visitList(mVoicesByKey, KeySlot(c, addr.mKey));
     }
   }
-  return v;
+  else if(addr.mChannel != kAllChannels)
+  {
+    visitList(mVoicesByChannel, addr.mChannel % kNumChannels);
+  }
+  else
+  {
+    for(int i=0; i<mVoicePtrs.size(); ++i)
+      visit(i);
+  }
+
+  if(maxIdx >= 0)
+  {
+    func(maxIdx);
+  }
 }
 
-void VoiceAllocator::SendControlToVoiceInputs(VoiceBitsArray v, int ctlIdx, float val, int glideSamples)
+void VoiceAllocator::SendControlToVoiceInputs(VoiceAddress addr, int ctlIdx, float val, int glideSamples)
 {
   // send control change to all matched voices through glide generators
-  for(int i=0; i<mVoicePtrs.size(); ++i)
+  ForEachVoiceMatching(addr, [&](int i) {
+    mVoiceGlides[i]->at(ctlIdx).SetTarget(val, 0, glideSamples, mBlockSize);
+  });
+}
+
+void VoiceAllocator::SendExpressionToChannel(uint8_t zone, int channel, int ctlIdx, float value)
+{
+  const int c = channel % kNumChannels;
+  mChannelExpression[c][ctlIdx - kVoiceControlPitchBend] = value;
+  mChannelHasExpression[c] = true;
+
+  for(int i = mBusyVoicesByChannel.Front(c); i != mBusyVoicesByChannel.kNone; i = mBusyVoicesByChannel.Next(i))
   {
-    if(v[i])
-    {
-      mVoiceGlides[i]->at(ctlIdx).SetTarget(val, 0, glideSamples, mBlockSize);
-    }
+    if(zone == kAllZones || mVoicePtrs[i]->mZone == zone)
+      mVoiceGlides[i]->at(ctlIdx).SetTarget(value, 0, mControlGlideSamples, mBlockSize);
   }
 }
 
-void VoiceAllocator::SendControlToVoicesDirect(VoiceBitsArray v, int ctlIdx, float val)
+void VoiceAllocator::ClearChannelExpression()
+{
+  for(auto& values : mChannelExpression)
+    values.fill(0.f);
+
+  mChannelHasExpression.fill(false);
+}
+
+void VoiceAllocator::SendControlToVoicesDirect(VoiceAddress addr, int ctlIdx, float val)
 {
   // send generic control change directly to voice
-  for(int i=0; i<mVoicePtrs.size(); ++i)
-  {
-    if(v[i])
-    {
-      mVoicePtrs[i]->SetControl(ctlIdx, val);
-    }
-  }
+  ForEachVoiceMatching(addr, [&](int i) {
+    mVoicePtrs[i]->SetControl(ctlIdx, val);
+  });
 }
 
-void VoiceAllocator::SendProgramChangeToVoices(VoiceBitsArray v, int pgm)
+void VoiceAllocator::SendProgramChangeToVoices(VoiceAddress addr, int pgm)
 {
-  for(int i=0; i<mVoicePtrs.size(); ++i)
-  {
-    if(v[i])
-    {
-      mVoicePtrs[i]->SetProgramNumber(pgm);
-    }
-  }
+  ForEachVoiceMatching(addr, [&](int i) {
+    mVoicePtrs[i]->SetProgramNumber(pgm);
+  });
 }
 
 void VoiceAllocator::ProcessEvents(int blockSize, int64_t sampleTime)
@@ -193,7 +210,7 @@ void VoiceAllocator::ProcessEvents(int blockSize, int64_t sampleTime)
   {
     VoiceInputEvent event;
     mInputQueue.Pop(event);
-    VoiceAllocator::VoiceBitsArray voices = VoicesMatchingAddress(event.mAddress);
+    const VoiceAddress voices = event.mAddress;
 
     switch(event.mAction)
     {
@@ -235,20 +252,15 @@ void VoiceAllocator::ProcessEvents(int blockSize, int64_t sampleTime)
         if (!mSustainPedalDown) // sustain pedal released
         {
           // if notes are sustaining, check that they're not still held and if not then stop voice
-          if (!mSustainedNotes.empty())
+          for (int key = mSustainedNotes.Front(0); key != KeyList::kNone;)
           {
-            for (auto susNotesItr = mSustainedNotes.begin(); susNotesItr != mSustainedNotes.end();)
+            const int next = mSustainedNotes.Next(key);
+            if (!mHeldKeys.Contains(0, key))
             {
-              uint8_t key = *susNotesItr;
-              bool held = std::find(mHeldKeys.begin(), mHeldKeys.end(), key) != mHeldKeys.end();
-              if (!held)
-              {
-                StopVoices(VoicesMatchingAddress({event.mAddress.mZone, kAllChannels, key, 0}), event.mSampleOffset);
-                susNotesItr = mSustainedNotes.erase(susNotesItr);
-              }
-              else
-                susNotesItr++;
+              StopVoices({event.mAddress.mZone, kAllChannels, static_cast<uint8_t>(key), 0}, event.mSampleOffset);
+              mSustainedNotes.Remove(key);
             }
+            key = next;
           }
         }
         break;
@@ -288,36 +300,43 @@ void VoiceAllocator::CalcGlideTimesInSamples()
   mControlGlideSamples = mControlGlideTime*mSampleRate;
 }
 
-int VoiceAllocator::FindFreeVoiceIndex(int startIndex) const
+void VoiceAllocator::CalcKeyPitches()
 {
-  size_t voices = mVoicePtrs.size();
-  for(int i=0; i<voices; ++i)
+  for(int k=0; k<kNumKeys; ++k)
   {
-    int j = (startIndex + i)%voices;
-    SynthVoice* pv = mVoicePtrs[j];
-    if(!pv->GetBusy())
-    {
-      return j;
-    }
+    mKeyPitches[k] = mKeyToPitchFn(k + mPitchOffset);
   }
-  return -1;
 }
 
-int VoiceAllocator::FindVoiceIndexToSteal(int64_t sampleTime) const
+int VoiceAllocator::FindFreeVoiceIndex() const
 {
-  size_t voices = mVoicePtrs.size();
-  int64_t earliestTime = sampleTime;
-  int longestPlayingVoiceIdx = 0;
-  for(int i=0; i<voices; ++i)
+  // the voice that has been free the longest, so that voices rotate
+  return mVoiceStates.Front(kVoiceFree);
+}
+
+int VoiceAllocator::FindVoiceIndexToSteal() const
+{
+  // prefer the voice that was released the longest ago, its envelope should be the quietest, otherwise steal the oldest held voice
+  const int releasedIdx = mVoiceStates.Front(kVoiceReleased);
+  return releasedIdx != mVoiceStates.kNone ? releasedIdx : mVoiceStates.Front(kVoiceHeld);
+}
+
+void VoiceAllocator::UpdateFreeVoices()
+{
+  // voices become free when their envelopes finish, which only happens while they are processed
+  for(int state = kVoiceHeld; state < kNumVoiceStates; ++state)
   {
-    SynthVoice* pv = mVoicePtrs[i];
-    if(pv->mLastTriggeredTime < earliestTime)
+    for(int i = mVoiceStates.Front(state); i != mVoiceStates.kNone;)
     {
-      earliestTime = pv->mLastTriggeredTime;
-      longestPlayingVoiceIdx = i;
+      const int next = mVoiceStates.Next(i);
+      if(!mVoicePtrs[i]->GetBusy())
+      {
+        mVoiceStates.PushBack(kVoiceFree, i);
+        mBusyVoicesByChannel.Remove(i);
+      }
+      i = next;
     }
   }
-  return longestPlayingVoiceIdx;
 }
 
 // start a single voice and set its current channel and key.
@@ -339,20 +358,30 @@ void VoiceAllocator::StartVoice(int voiceIdx, int channel, int key, float pitch,
   pVoice->mKey = key;
   pVoice->mGain = 1.;
 
-  // call voice's Trigger method
-  pVoice->Trigger(velocity, retrig);
-}
+  mVoiceStates.PushBack(kVoiceHeld, voiceIdx);
+  mVoicesByKey.PushBack(KeySlot(channel, key), voiceIdx);
+  mVoicesByChannel.PushBack(channel % kNumChannels, voiceIdx);
+  mBusyVoicesByChannel.PushBack(channel % kNumChannels, voiceIdx);
 
-// start all of the voice indexes marked in the VoieBitsArray and set the current channel and key of each.
-void VoiceAllocator::StartVoices(VoiceBitsArray vbits, int channel, int key, float pitch, float velocity, int sampleOffset, int64_t sampleTime, bool retrig)
-{
-  for(int i=0; i<mVoicePtrs.size(); ++i)
+  // start from the channel's expression, which may have been sent before the note on
+  if(mChannelHasExpression[channel % kNumChannels])
   {
-    if(vbits[i])
+    for(int e=0; e<kNumExpressionControls; ++e)
     {
-      StartVoice(i, channel, key, pitch, velocity, sampleOffset, sampleTime, retrig);
+      mVoiceGlides[voiceIdx]->at(kVoiceControlPitchBend + e).SetTarget(mChannelExpression[channel % kNumChannels][e], sampleOffset, 1, mBlockSize);
     }
   }
+
+  // call voice's Trigger method
+  pVoice->Trigger(velocity, retrig);
+}
+
+// start all of the voices matching the address and set the current channel and key of each.
+void VoiceAllocator::StartVoices(VoiceAddress addr, int channel, int key, float pitch, float velocity, int sampleOffset, int64_t sampleTime, bool retrig)
+{
+  ForEachVoiceMatching(addr, [&](int i) {
+    StartVoice(i, channel, key, pitch, velocity, sampleOffset, sampleTime, retrig);
+  });
 }
 
 void VoiceAllocator::StopVoice(int voiceIdx, int sampleOffset)
@@ -360,24 +389,27 @@ void VoiceAllocator::StopVoice(int voiceIdx, int sampleOffset)
   mVoiceGlides[voiceIdx]->at(kVoiceControlGate).SetTarget(0.0, sampleOffset, 1, mBlockSize);
   mVoicePtrs[voiceIdx]->mKey = -1;
   mVoicePtrs[voiceIdx]->Release();
-}
 
-// stop all voices marked in the VoiceBitsArray.
-void VoiceAllocator::StopVoices(VoiceBitsArray vbits, int sampleOffset)
-{
-  for(int i=0; i<mVoicePtrs.size(); ++i)
+  mVoicesByKey.Remove(voiceIdx);
+
+  if(mVoiceStates.Contains(kVoiceHeld, voiceIdx))
   {
-    if(vbits[i])
-    {
-      StopVoice(i, sampleOffset);
-    }
+    mVoiceStates.PushBack(kVoiceReleased, voiceIdx);
   }
 }
 
+// stop all voices matching the address.
+void VoiceAllocator::StopVoices(VoiceAddress addr, int sampleOffset)
+{
+  ForEachVoiceMatching(addr, [&](int i) {
+    StopVoice(i, sampleOffset);
+  });
+}
+
 void VoiceAllocator::SoftKillAllVoices()
 {
-  mHeldKeys.clear();
-  mSustainedNotes.clear();
+  mHeldKeys.Clear();
+  mSustainedNotes.Clear();
   mSustainPedalDown = false;
 
   size_t voices = mVoicePtrs.size();
@@ -402,7 +434,7 @@ void VoiceAllocator::NoteOn(VoiceInputEvent e, int64_t sampleTime)
   int key = e.mAddress.mKey;
   int offset = e.mSampleOffset;
   float velocity = e.mValue;
-  double pitch = mKeyToPitchFn(key + mPitchOffset);
+  double pitch = KeyToPitch(key);
 
   switch(mPolyMode)
   {
@@ -412,22 +444,18 @@ void VoiceAllocator::NoteOn(VoiceInputEvent e, int64_t sampleTime)
       bool retrig = false;
 
       // trigger all voices in zone
-      StartVoices(VoicesMatchingAddress({e.mAddress.mZone, kAllChannels, kAllKeys, 0}), channel, key, pitch, velocity, offset, sampleTime, retrig);
+      StartVoices({e.mAddress.mZone, kAllChannels, kAllKeys, 0}, channel, key, pitch, velocity, offset, sampleTime, retrig);
 
       // in mono modes only ever 1 sustained note
-      mSustainedNotes.clear();
+      mSustainedNotes.Clear();
       break;
     }
     case kPolyModePoly:
     {
-      int i = FindFreeVoiceIndex(mVoiceRotateIndex);
+      int i = FindFreeVoiceIndex();
       if(i < 0)
       {
-        i = FindVoiceIndexToSteal(sampleTime);
-      }
-      if(mRotateVoices)
-      {
-        mVoiceRotateIndex = i + 1;
+        i = FindVoiceIndexToSteal();
       }
       if(i >= 0)
       {
@@ -441,17 +469,20 @@ void VoiceAllocator::NoteOn(VoiceInputEvent e, int64_t sampleTime)
       break;
   }
 
+  if(key >= kNumKeys)
+    return;
+
   // add to held keys
-  if(std::find(mHeldKeys.begin(), mHeldKeys.end(), key) == mHeldKeys.end())
+  if(!mHeldKeys.Contains(0, key))
   {
-    mHeldKeys.push_back(key);
+    mHeldKeys.PushBack(0, key);
     mMinHeldVelocity = std::min(velocity, mMinHeldVelocity);
   }
 
   // add to sustained notes
-  if(std::find(mSustainedNotes.begin(), mSustainedNotes.end(), key) == mSustainedNotes.end())
+  if(!mSustainedNotes.Contains(0, key))
   {
-    mSustainedNotes.push_back(key);
+    mSustainedNotes.PushBack(0, key);
   }
 }
 
@@ -462,8 +493,11 @@ void VoiceAllocator::NoteOff(VoiceInputEvent e, int64_t sampleTime)
   int offset = e.mSampleOffset;
 
   // remove from held keys
-  mHeldKeys.erase(std::remove(mHeldKeys.begin(), mHeldKeys.end(), key), mHeldKeys.end());
-  if(mHeldKeys.empty())
+  if(key < kNumKeys)
+  {
+    mHeldKeys.Remove(key);
+  }
+  if(mHeldKeys.Empty(0))
   {
     mMinHeldVelocity = 1.0f;
   }
@@ -474,25 +508,25 @@ void VoiceAllocator::NoteOff(VoiceInputEvent e, int64_t sampleTime)
     int queuedKey = 0;
 
     // if there are still held keys...
-    if(!mHeldKeys.empty())
+    if(!mHeldKeys.Empty(0))
     {
-      queuedKey = mHeldKeys.back();
+      queuedKey = mHeldKeys.Back(0);
       if (queuedKey != mVoicePtrs[0]->mKey)
       {
         doPlayQueuedKey = true;
         if(mSustainPedalDown)
         {
           // in mono modes only ever 1 sustained note
-          mSustainedNotes.clear();
-          mSustainedNotes.push_back(queuedKey);
+          mSustainedNotes.Clear();
+          mSustainedNotes.PushBack(0, queuedKey);
         }
       }
     }
     else if(mSustainPedalDown)
     {
-      if(!mSustainedNotes.empty())
+      if(!mSustainedNotes.Empty(0))
       {
-        queuedKey = mSustainedNotes.back();
+        queuedKey = mSustainedNotes.Back(0);
         if (queuedKey != mVoicePtrs[0]->mKey)
         {
           doPlayQueuedKey = true;
@@ -502,29 +536,62 @@ void VoiceAllocator::NoteOff(VoiceInputEvent e, int64_t sampleTime)
     else
     {
       // there are no held keys, so no voices in the zone should be playing.
-      StopVoices(VoicesMatchingAddress({e.mAddress.mZone, kAllChannels, kAllKeys, 0}), offset);
+      StopVoices({e.mAddress.mZone, kAllChannels, kAllKeys, 0}, offset);
     }
 
     if(doPlayQueuedKey)
     {
       // trigger the queued key for all voices in the zone at the minimum held velocity.
       // alternatively the release velocity of the note off could be used here.
-      double pitch = mKeyToPitchFn(queuedKey + mPitchOffset);
+      double pitch = KeyToPitch(queuedKey);
       bool retrig = false;
 
-      StartVoices(VoicesMatchingAddress({e.mAddress.mZone, kAllChannels, kAllKeys, 0}), channel, queuedKey, pitch, mMinHeldVelocity, offset, sampleTime, retrig);
+      StartVoices({e.mAddress.mZone, kAllChannels, kAllKeys, 0}, channel, queuedKey, pitch, mMinHeldVelocity, offset, sampleTime, retrig);
     }
   }
   else // poly
   {
     if (!mSustainPedalDown)
     {
-      StopVoices(VoicesMatchingAddress(e.mAddress), e.mSampleOffset);
-      mSustainedNotes.erase(std::remove(mSustainedNotes.begin(), mSustainedNotes.end(), key), mSustainedNotes.end());
+      StopVoices(e.mAddress, e.mSampleOffset);
+      if(key < kNumKeys)
+      {
+        mSustainedNotes.Remove(key);
+      }
     }
   }
 }
 
+bool VoiceAllocator::IndexesAreConsistent() const
+{
+  for(int i=0; i<mVoicePtrs.size(); ++i)
+  {
+    const SynthVoice* pVoice = mVoicePtrs[i];
+    const int state = mVoiceStates.GetList(i);
+    const int channel = pVoice->mChannel % kNumChannels;
+
+    if(state == mVoiceStates.kNone || (state == kVoiceFree) == pVoice->GetBusy())
+      return false;
+
+    // a voice that finished while its key was held can stay in the key index until the note off, but a held voice must be there
+    const int keySlot = mVoicesByKey.GetList(i);
+
+    if(keySlot != mVoicesByKey.kNone && (pVoice->mKey >= kNumKeys || keySlot != KeySlot(channel, pVoice->mKey)))
+      return false;
+
+    if(state == kVoiceHeld && keySlot == mVoicesByKey.kNone)
+      return false;
+
+    if(!mVoicesByChannel.Contains(channel, i))
+      return false;
+
+    if(state == kVoiceFree ? mBusyVoicesByChannel.GetList(i) != mBusyVoicesByChannel.kNone : !mBusyVoicesByChannel.Contains(channel, i))
+      return false;
+  }
+
+  return true;
+}
+
 void VoiceAllocator::ProcessVoices(sample** inputs, sample** outputs, int nInputs, int nOutputs, int startIndex, int blockSize)
 {
   for(auto pVoice : mVoicePtrs)
@@ -535,4 +602,6 @@ void VoiceAllocator::ProcessVoices(sample** inputs, sample** outputs, int nInput
       pVoice->ProcessSamplesAccumulating(inputs, outputs, nInputs, nOutputs, startIndex, blockSize);
     }
   }
+
+  UpdateFreeVoices();
 }
@@ -16,10 +16,12 @@
  */
 
 #include <array>
+#include <memory>
+#include <stdexcept>
 #include <vector>
 #include <stdint.h>
 #include <functional>
-#include <bitset>
+#include <climits>
 //#include <iostream>
 
 #include "IPlugLogger.h"
@@ -76,6 +78,94 @@ struct VoiceInputEvent
   int mSampleOffset;
 };
 
+#pragma mark - IndexLists class
+
+/** Fixed capacity intrusive doubly linked lists of small integer indices, used by the VoiceAllocator to keep track of voices and keys without allocating or scanning on the audio thread.
+ * Each of the NumItems items is in at most one of the NumLists lists at a time. Adding, removing and moving an item is constant time. */
+template <int NumItems, int NumLists>
+class IndexLists final
+{
+public:
+  static constexpr int kNone = -1;
+
+  IndexLists() { Clear(); }
+
+  /** Empty all the lists. Linear in NumItems + NumLists */
+  void Clear()
+  {
+    for (auto& l : mLists)
+      l = {kNone, kNone};
+
+    for (auto& n : mNodes)
+      n = {kNone, kNone, kNone};
+  }
+
+  /** @return The list the item is in, or kNone */
+  int GetList(int item) const { return mNodes[item].mList; }
+
+  bool Contains(int list, int item) const { return mNodes[item].mList == list; }
+  bool Empty(int list) const { return mLists[list].mHead == kNone; }
+
+  /** @return The first (oldest) item in the list, or kNone */
+  int Front(int list) const { return mLists[list].mHead; }
+
+  /** @return The last (newest) item in the list, or kNone */
+  int Back(int list) const { return mLists[list].mTail; }
+
+  /** @return The item after this one in its list, or kNone */
+  int Next(int item) const { return mNodes[item].mNext; }
+
+  /** Append the item to a list, removing it from the list it was in */
+  void PushBack(int list, int item)
+  {
+    Remove(item);
+
+    Node& n = mNodes[item];
+    List& l = mLists[list];
+    n.mList = list;
+    n.mPrev = l.mTail;
+
+    if (l.mTail != kNone)
+      mNodes[l.mTail].mNext = item;
+    else
+      l.mHead = item;
+
+    l.mTail = item;
+  }
+
+  /** Remove the item from the list it is in, if any */
+  void Remove(int item)
+  {
+    Node& n = mNodes[item];
+
+    if (n.mList == kNone)
+      return;
+
+    List& l = mLists[n.mList];
+
+    if (n.mPrev != kNone)
+      mNodes[n.mPrev].mNext = n.mNext;
+    else
+      l.mHead = n.mNext;
+
+    if (n.mNext != kNone)
+      mNodes[n.mNext].mPrev = n.mPrev;
+    else
+      l.mTail = n.mPrev;
+
+    n = {kNone, kNone, kNone};
+  }
+
+private:
+  struct Node { int16_t mList, mPrev, mNext; };
+  struct List { int16_t mHead, mTail; };
+
+  static_assert(NumItems <= SHRT_MAX && NumLists <= SHRT_MAX, "IndexLists indices are stored as int16_t");
+
+  std::array<Node, NumItems> mNodes;
+  std::array<List, NumLists> mLists;
+};
+
 #pragma mark - VoiceAllocator class
 
 class VoiceAllocator final
@@ -98,6 +188,10 @@ public:
 
   static constexpr int kVoiceMostRecent = 1 << 7;
 
+  static constexpr int kMaxVoices = UCHAR_MAX - 1;
+  static constexpr int kNumKeys = 128;
+  static constexpr int kNumChannels = 16;
+
   // one voice worth of ramp generators
   using VoiceControlRamps = ControlRampProcessor::ProcessorArray<kNumVoiceControlRamps>;
 
@@ -135,37 +229,75 @@ public:
    */
   void HardKillAllVoices();
 
-  void SetKeyToPitchFunction(const std::function<double(int)>& fn) {mKeyToPitchFn = fn;}
+  /** Set the function that maps MIDI keys to pitch. It is evaluated for all keys here, not per note on the audio thread */
+  void SetKeyToPitchFunction(const std::function<double(int)>& fn) { mKeyToPitchFn = fn; CalcKeyPitches(); }
 
   /** Send the event to the voices matching its address.
    */
   void SendEventToVoices(VoiceInputEvent event);
 
+  /** Set an expression control of the voices playing on a channel, bypassing the input queue. This is the fast path for MPE, where each note has a channel of its own
+   * and sends continuous pitch bend, pressure and timbre: the busy voices are indexed by channel, so the ramp targets are written straight to the voice that owns it.
+   * The value is also kept for the channel, and a voice started on the channel later begins at it, so expression sent just before a note on is not lost.
+   * Call it in the order of the events, before ProcessEvents() for the block
+   * @param zone The zone of the voices, or kAllZones
+   * @param channel The MIDI channel
+   * @param ctlIdx kVoiceControlPitchBend, kVoiceControlPressure or kVoiceControlTimbre
+   * @param value The new value */
+  void SendExpressionToChannel(uint8_t zone, int channel, int ctlIdx, float value);
+
+  /** Forget the values kept by SendExpressionToChannel(), e.g. when leaving MPE mode */
+  void ClearChannelExpression();
+
   void ProcessVoices(sample** inputs, sample** outputs, int nInputs, int nOutputs, int startIndex, int blockSize);
 
   size_t GetNVoices() const {return mVoicePtrs.size();}
   SynthVoice* GetVoice(int voiceIndex) const {return mVoicePtrs[voiceIndex];}
-  void SetPitchOffset(float offset) { mPitchOffset = offset; }
+  void SetPitchOffset(float offset) { mPitchOffset = offset; CalcKeyPitches(); }
+
+  /** Check that the voice state lists and the key and channel indexes agree with the voices, for tests and debugging. Linear in the number of voices.
+   * It holds after ProcessVoices(), when the voices that finished have been freed
+   * @return true if every voice is free exactly when it is not busy, every voice with its gate on is in the index of its key, and the channel indexes match the channel of each voice */
+  bool IndexesAreConsistent() const;
 
 private:
-  using VoiceBitsArray = std::bitset<UCHAR_MAX>;
+  // the lists in mVoiceStates
+  enum EVoiceState
+  {
+    kVoiceFree = 0, // not busy, in the order they became free
+    kVoiceHeld, // gate on, in the order they were triggered
+    kVoiceReleased, // gate off but still busy, in the order they were released
+    kNumVoiceStates
+  };
 
-  VoiceBitsArray VoicesMatchingAddress(VoiceAddress va);
+  using KeyList = IndexLists<kNumKeys, 1>;
 
-  void SendControlToVoiceInputs(VoiceBitsArray v, int ctlIdx, float val, int glideSamples);
-  void SendControlToVoicesDirect(VoiceBitsArray v, int ctlIdx, float val);
-  void SendProgramChangeToVoices(VoiceBitsArray v, int pgm);
+  static constexpr int kNumExpressionControls = kVoiceControlTimbre - kVoiceControlPitchBend + 1;
+
+  /** Call func(voiceIdx) for each voice matching the address. Uses the key and channel indexes where the address allows, rather than testing every voice */
+  template <typename F>
+  void ForEachVoiceMatching(VoiceAddress addr, F func);
+  bool VoiceMatchesAddress(int voiceIdx, VoiceAddress addr) const;
+
+  void SendControlToVoiceInputs(VoiceAddress addr, int ctlIdx, float val, int glideSamples);
+  void SendControlToVoicesDirect(VoiceAddress addr, int ctlIdx, float val);
+  void SendProgramChangeToVoices(VoiceAddress addr, int pgm);
 
   void StartVoice(int voiceIdx, int channel, int key, float pitch, float velocity, int sampleOffset, int64_t sampleTime, bool retrig);
-  void StartVoices(VoiceBitsArray voices, int channel, int key, float pitch, float velocity, int sampleOffset, int64_t sampleTime, bool retrig);
+  void StartVoices(VoiceAddress addr, int channel, int key, float pitch, float velocity, int sampleOffset, int64_t sampleTime, bool retrig);
 
   void StopVoice(int voiceIdx, int sampleOffset);
-  void StopVoices(VoiceBitsArray voices, int sampleOffset);
+  void StopVoices(VoiceAddress addr, int sampleOffset);
 
   void CalcGlideTimesInSamples();
+  void CalcKeyPitches();
+  double KeyToPitch(int key) const { return key < kNumKeys ? mKeyPitches[key] : mKeyToPitchFn(key + mPitchOffset); }
   void ClearVoiceInputs(SynthVoice* pVoice);
-  int FindFreeVoiceIndex(int startIndex) const;
-  int FindVoiceIndexToSteal(int64_t sampleTime) const;
+  int FindFreeVoiceIndex() const;
+  int FindVoiceIndexToSteal() const;
+  void UpdateFreeVoices();
+
+  static int KeySlot(int channel, int key) { return ((channel % kNumChannels) * kNumKeys) + (key % kNumKeys); }
 
   void NoteOn(VoiceInputEvent e, int64_t sampleTime);
   void NoteOff(VoiceInputEvent e, int64_t sampleTime);
@@ -174,10 +306,19 @@ private:
 
   std::vector<SynthVoice*> mVoicePtrs;
   std::vector<std::unique_ptr<VoiceControlRamps>> mVoiceGlides;
-  std::vector<int> mHeldKeys; // The currently physically held keys on the keyboard
-  std::vector<int> mSustainedNotes; // Any notes that are sustained, including those that are physically held
+  KeyList mHeldKeys; // The currently physically held keys on the keyboard, in the order they were pressed
+  KeyList mSustainedNotes; // Any notes that are sustained, including those that are physically held
+
+  IndexLists<kMaxVoices, kNumVoiceStates> mVoiceStates; // free, held and released voices, for constant time allocation and stealing
+  IndexLists<kMaxVoices, kNumChannels * kNumKeys> mVoicesByKey; // the voices whose gate is on, by channel and key
+  IndexLists<kMaxVoices, kNumChannels> mVoicesByChannel; // every voice, by the channel it last played on
+  IndexLists<kMaxVoices, kNumChannels> mBusyVoicesByChannel; // the voices that are not free, by the channel they play on, see SendExpressionToChannel()
+
+  std::array<std::array<float, kNumExpressionControls>, kNumChannels> mChannelExpression{}; // pitch bend, pressure and timbre
+  std::array<bool, kNumChannels> mChannelHasExpression{};
 
   std::function<double(int)> mKeyToPitchFn;
+  std::array<double, kNumKeys> mKeyPitches;
   double mPitchOffset{0.};
 
   double mNoteGlideTime{0.};
@@ -187,8 +328,6 @@ private:
   double mSampleRate;
   int mBlockSize;
 
-  bool mRotateVoices{true};
-  int mVoiceRotateIndex{0};
   bool mSustainPedalDown{false};
   float mModWheel{0.f};
   float mMinHeldVelocity{1.f};
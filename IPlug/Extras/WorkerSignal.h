@@ -0,0 +1,60 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc WorkerSignal
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+/** Wakes a background worker thread when the audio thread has work for it, so that the worker can sleep while there is nothing to do instead of polling.
+ * It is a binary semaphore for one waiting thread: signals are merged until the worker calls Wait() again.
+ * Signal() is a single atomic operation while the worker is awake. Only when the worker is asleep does it take a lock, which the worker only holds while going to sleep, to wake it
+ * Used by Convolver and STFT */
+class WorkerSignal
+{
+public:
+  /** Wake the worker, or make its next Wait() return straight away. Called by the audio thread */
+  void Signal()
+  {
+    int count = mCount.load(std::memory_order_relaxed);
+
+    while (count < 1 && !mCount.compare_exchange_weak(count, count + 1, std::memory_order_release, std::memory_order_relaxed)) {}
+
+    if (count < 0)
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mWake = true;
+      mCondition.notify_one();
+    }
+  }
+
+  /** Sleep until Signal() is called, or return straight away if it has been called since the last Wait(). Called by the worker */
+  void Wait()
+  {
+    if (mCount.fetch_sub(1, std::memory_order_acquire) > 0)
+      return;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondition.wait(lock, [this]() { return mWake; });
+    mWake = false;
+  }
+
+private:
+  std::atomic<int> mCount{0}; // 1 signalled, 0 idle, -1 the worker is asleep
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  bool mWake = false;
+};
@@ -16,6 +16,7 @@
 #include <cmath>
 #include <cstdio>
 #include <ctime>
+#include <chrono>
 #include <cassert>
 
 #include "IPlugAPIBase.h"
@@ -123,7 +124,124 @@ void IPlugAPIBase::SetParameterValue(int idx, double normalizedValue)
   Trace(TRACELOC, "%d:%f", idx, normalizedValue);
   GetParam(idx)->SetNormalized(normalizedValue);
   InformHostOfParamChange(idx, normalizedValue);
-  OnParamChange(idx, kUI);
+
+  const double sampleRate = mUIParamSampleRate.load(std::memory_order_acquire);
+
+  if (sampleRate > 0.)
+  {
+    // the audio thread calls OnParamChange(), so that it doesn't race with the DSP. If the queue is full, all the parameters are updated on the next block
+    if (!mParamChangesFromUI.Push(ParamChangeFromUI { idx, EstimateSampleTimeFromUI(sampleRate) }))
+      mUIParamQueueOverflowed.store(true, std::memory_order_release);
+  }
+  else
+    OnParamChange(idx, kUI);
+}
+
+static double SteadyClockSeconds()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t IPlugAPIBase::EstimateSampleTimeFromUI(double sampleRate) const
+{
+  return static_cast<int64_t>((SteadyClockSeconds() - mUIParamTimeOrigin.load(std::memory_order_relaxed)) * sampleRate);
+}
+
+void IPlugAPIBase::ApplyParamChangeFromUI(const ParamChangeFromUI& change, int sampleOffset)
+{
+  ENTER_PARAMS_MUTEX;
+  // the UI has already set the parameter, so this reads its latest value. Setting it here to the value queued with the change would undo later
+  // changes, from the host or from the UI when the queue was full
+  OnParamChange(change.idx, kUI, sampleOffset);
+  LEAVE_PARAMS_MUTEX;
+}
+
+void IPlugAPIBase::ProcessParamChangesFromUI(int nFrames, double sampleRate)
+{
+  const int64_t blockStart = mUIParamBlockStart + mUIParamBlockFrames;
+  const int lastFrame = std::max(nFrames - 1, 0);
+  int sampleOffset = 0;
+
+  // if the idle timer is applying the changes, because this hasn't been called for a while, leave them to it rather than wait
+  if (!mUIParamQueueBusy.exchange(true, std::memory_order_acquire))
+  {
+    ParamChangeFromUI p;
+
+    while (mParamChangesFromUI.Pop(p))
+    {
+      // the change was made while the previous block was processed, its offset in this block is its offset from the start of that one
+      sampleOffset = Clip(static_cast<int>(std::min<int64_t>(p.sampleTime - mUIParamBlockStart, lastFrame)), sampleOffset, lastFrame);
+
+      ApplyParamChangeFromUI(p, sampleOffset);
+
+      const double delay = sampleRate > 0. ? (blockStart + sampleOffset - p.sampleTime) / sampleRate : 0.;
+
+      if (delay > mMaxUIParamDelay.load(std::memory_order_relaxed))
+        mMaxUIParamDelay.store(delay, std::memory_order_relaxed);
+
+      mNumUIParamChanges.store(mNumUIParamChanges.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    if (mUIParamQueueOverflowed.exchange(false, std::memory_order_acquire))
+    {
+      ENTER_PARAMS_MUTEX;
+      for (auto i = 0; i < NParams(); i++)
+        OnParamChange(i, kUI, sampleOffset);
+      LEAVE_PARAMS_MUTEX;
+    }
+
+    mUIParamQueueBusy.store(false, std::memory_order_release);
+  }
+
+  mUIParamBlockStart = blockStart;
+  mUIParamBlockFrames = nFrames;
+
+  if (sampleRate > 0.)
+  {
+    const double now = SteadyClockSeconds();
+    mUIParamTimeOrigin.store(now - blockStart / sampleRate, std::memory_order_relaxed);
+    mUIParamIdleTimeout.store(std::max(UI_PARAM_IDLE_TIMEOUT, 4. * nFrames / sampleRate), std::memory_order_relaxed);
+    // sequentially consistent, so that ProcessParamChangesFromUIWhenIdle() sees processing resume
+    mUIParamLastProcessTime.store(now);
+    mUIParamSampleRate.store(sampleRate);
+  }
+}
+
+void IPlugAPIBase::ProcessParamChangesFromUIWhenIdle()
+{
+  const double lastProcessTime = mUIParamLastProcessTime.load(std::memory_order_relaxed);
+
+  if (lastProcessTime == 0. || SteadyClockSeconds() - lastProcessTime < mUIParamIdleTimeout.load(std::memory_order_relaxed))
+    return;
+
+  if (mUIParamQueueBusy.exchange(true, std::memory_order_acquire))
+    return;
+
+  // until the audio thread calls ProcessParamChangesFromUI() again, SetParameterValue() calls OnParamChange() directly.
+  // If processing resumed since the check above, it may already have set the rate, so that is put back and the audio thread keeps the queue
+  const double sampleRate = mUIParamSampleRate.exchange(0.);
+
+  if (mUIParamLastProcessTime.load() != lastProcessTime)
+  {
+    mUIParamSampleRate.store(sampleRate);
+    mUIParamQueueBusy.store(false, std::memory_order_release);
+    return;
+  }
+
+  ParamChangeFromUI p;
+
+  while (mParamChangesFromUI.Pop(p))
+    ApplyParamChangeFromUI(p, -1);
+
+  if (mUIParamQueueOverflowed.exchange(false, std::memory_order_acquire))
+  {
+    ENTER_PARAMS_MUTEX;
+    for (auto i = 0; i < NParams(); i++)
+      OnParamChange(i, kUI);
+    LEAVE_PARAMS_MUTEX;
+  }
+
+  mUIParamQueueBusy.store(false, std::memory_order_release);
 }
 
 void IPlugAPIBase::DirtyParametersFromUI()
@@ -145,6 +263,17 @@ void IPlugAPIBase::SendParameterValueFromAPI(int paramIdx, double value, bool no
   mParamChangeFromProcessor.Push(ParamTuple { paramIdx, value } );
 }
 
+void IPlugAPIBase::GetPerformanceStats(IPerformanceStats& stats) const
+{
+  mPerformanceCounters.GetStats(stats);
+  stats.mNumParamQueueOverflows = mParamChangeFromProcessor.GetNumFailedPushes() + mParamChangesFromUI.GetNumFailedPushes();
+  stats.mNumUIParamChanges = mNumUIParamChanges.load(std::memory_order_relaxed);
+  stats.mMaxUIParamDelay = mMaxUIParamDelay.load(std::memory_order_relaxed);
+  stats.mNumMidiQueueOverflows = mMidiMsgsFromEditor.GetNumFailedPushes() + mMidiMsgsFromProcessor.GetNumFailedPushes();
+  stats.mNumSysExQueueOverflows = mSysExDataFromEditor.GetNumFailedPushes() + mSysExDataFromProcessor.GetNumFailedPushes();
+  stats.mNumMessageBusOverflows = mMessageBus.GetNumFailedPushes();
+}
+
 void IPlugAPIBase::OnTimer(Timer& t)
 {
   if(HasUI())
@@ -165,12 +294,14 @@ void IPlugAPIBase::OnTimer(Timer& t)
       SendMidiMsgFromDelegate(msg);
     }
     
-    while (mSysExDataFromProcessor.ElementsAvailable())
+    ISysEx msg;
+    
+    while (mSysExDataFromProcessor.Read(msg))
     {
-      SysExData msg;
-      mSysExDataFromProcessor.Pop(msg);
-      SendSysexMsgFromDelegate({msg.mOffset, msg.mData, msg.mSize});
+      SendSysexMsgFromDelegate(msg);
     }
+    
+    mSysExDataFromProcessor.Release();
   #endif
     
     // Midi messages from the processor to the controller, are sent as IMessages and SendMidiMsgFromDelegate gets triggered on the other side's notify
@@ -182,15 +313,18 @@ void IPlugAPIBase::OnTimer(Timer& t)
       TransmitMidiMsgFromProcessor(msg);
     }
     
-    while (mSysExDataFromProcessor.ElementsAvailable())
+    ISysEx msg;
+    
+    while (mSysExDataFromProcessor.Read(msg))
     {
-      SysExData data;
-      mSysExDataFromProcessor.Pop(data);
-      TransmitSysExDataFromProcessor(data);
+      TransmitSysExDataFromProcessor(msg);
     }
+    
+    mSysExDataFromProcessor.Release();
   #endif
   }
-  
+
+  ProcessParamChangesFromUIWhenIdle();
   OnIdle();
 }
 
@@ -10,9 +10,11 @@
 
 #pragma once
 
+#include <cstdlib>
 #include <cstring>
 #include <cstdint>
 #include <memory>
+#include <atomic>
 
 #include "ptrlist.h"
 #include "mutex.h"
@@ -24,7 +26,9 @@
 #include "IPlugUtilities.h"
 #include "IPlugParameter.h"
 #include "IPlugQueue.h"
+#include "IPlugMessageBus.h"
 #include "IPlugTimer.h"
+#include "IPlugPerformance.h"
 
 /**
  * @file
@@ -103,6 +107,16 @@ public:
 
   /** Override this method to get an "idle"" call on the main thread */
   virtual void OnIdle() {}
+
+  /** Override this method to receive the messages sent with SendMessageToProcessor(). It is called on the audio thread, before processing a block, so it must not allocate or block.
+   * A message that is larger than MESSAGE_BUS_CHUNK_BYTES arrives in several chunks, in order, see IPlugMessageBus::Chunk.
+   * The default implementation calls OnMessage() for the messages that fit in one chunk
+   * @param chunk The chunk, whose data is only valid until this method returns */
+  virtual void OnMessageFromBus(const IPlugMessageBus::Chunk& chunk)
+  {
+    if (chunk.IsWholeMessage())
+      OnMessage(chunk.messageTag, chunk.controlTag, chunk.size, chunk.pData);
+  }
     
 #pragma mark - Methods you can call - some of which have custom implementations in the API classes, some implemented in IPlugAPIBase.cpp
   /** Helper method, used to print some info to the console in debug builds. Can be overridden in other IPlugAPIBases, for specific functionality, such as printing UI details. */
@@ -128,7 +142,8 @@ public:
   virtual void EndInformHostOfParamChange(int paramIdx) {};
 
   /** SetParameterValue is called from the UI in the middle of a parameter change gesture (possibly via delegate) in order to update a parameter's value.
-   * It will update mParams[paramIdx], call InformHostOfParamChange and IPlugAPIBase::OnParamChange();
+   * It will update mParams[paramIdx], call InformHostOfParamChange and IPlugAPIBase::OnParamChange(). Once the API class is processing audio,
+   * OnParamChange() is not called here, the change is queued with a sample time and OnParamChange() is called on the audio thread, see ProcessParamChangesFromUI()
    * @param paramIdx The index of the parameter that changed
    * @param normalizedValue The new (normalised) value */
   void SetParameterValue(int paramIdx, double normalizedValue);
@@ -151,6 +166,22 @@ public:
    * @param normalized /true if value is normalised */
   virtual void SendParameterValueFromAPI(int paramIdx, double value, bool normalized);
 
+  /** Called by the API class on the audio thread at the start of each processing call, before ProcessBuffers(), to deliver the parameter changes made in the UI.
+   * OnParamChange() is called with source kUI for each change, in the order they were made, with a sample offset that preserves the spacing between them.
+   * The parameter is not set here: the UI has already set it, so OnParamChange() reads its latest value, and a later change from the host is not undone.
+   * If the queue was full, OnParamChange() is then called for every parameter. The changes were made while the previous block was being processed, so they are delayed by one block. Until this is first called, SetParameterValue()
+   * calls OnParamChange() on the UI thread, so API classes that don't call it are unaffected. If the host stops calling it, e.g. while the plug-in is bypassed or suspended,
+   * the idle timer applies the queued changes on the main thread after UI_PARAM_IDLE_TIMEOUT, and SetParameterValue() calls OnParamChange() directly until processing resumes
+   * @param nFrames The number of frames in the block that is about to be processed
+   * @param sampleRate The sample rate */
+  void ProcessParamChangesFromUI(int nFrames, double sampleRate);
+
+  /** Called by the API class on the audio thread at the start of each processing call, before ProcessBuffers(), to deliver the messages sent with SendMessageToProcessor() to OnMessageFromBus() */
+  void ProcessMessagesFromBus()
+  {
+    mMessageBus.Process([this](const IPlugMessageBus::Chunk& chunk) { OnMessageFromBus(chunk); });
+  }
+
   /** Called to set the name of the current host, if known (calls on to HostSpecificInit() and OnHostIdentified()).
   * @param host The name of the plug-in host
   * @param version The version of the plug-in host where version in hex = 0xVVVVRRMM */
@@ -186,12 +217,46 @@ public:
   
   void DeferSysexMsg(const ISysEx& msg) override
   {
-    SysExData data(msg.mOffset, msg.mSize, msg.mData); // copies data
-    mSysExDataFromEditor.Push(data);
+    mSysExDataFromEditor.Push(msg); // copies data
+  }
+
+  /** Send a binary message to the audio thread, where it is delivered to OnMessageFromBus() before the next block is processed.
+   * Unlike SendArbitraryMsgFromUI(), this can be called from any thread other than the audio thread, e.g. the UI, an OSC or a websocket thread,
+   * it doesn't allocate after the first message, which allocates the bus's pool, and the same transport is used by every API class.
+   * Large messages, up to MESSAGE_BUS_CHUNK_BYTES * MESSAGE_BUS_NUM_CHUNKS, are split into chunks.
+   * In a distributed VST3 plug-in the controller forwards the message to the processor with an IMessage, so it must be called on the main thread, and it allocates
+   * @param messageTag A tag that identifies the message
+   * @param controlTag A tag that identifies the control that sent it, or kNoTag
+   * @param dataSize The size of the message in bytes
+   * @param pData The message bytes, which are copied
+   * @param timeoutMs How long to wait if the audio thread has not yet consumed enough of the previous messages. 0 to fail straight away
+   * @return \c true if the message was queued, \c false if there was no space for it, which is counted in IPerformanceStats::mNumMessageBusOverflows */
+  virtual bool SendMessageToProcessor(int messageTag, int controlTag, int dataSize, const void* pData, int timeoutMs = 0)
+  {
+    return mMessageBus.Push(messageTag, controlTag, dataSize, pData, timeoutMs);
+  }
+
+  /** Send a value of a trivially copyable type to the audio thread, to be read with IPlugMessageBus::Chunk::GetValue(), see SendMessageToProcessor() */
+  template <typename T>
+  bool SendValueToProcessor(int messageTag, int controlTag, const T& value, int timeoutMs = 0)
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "messages are copied bytewise");
+    return SendMessageToProcessor(messageTag, controlTag, (int) sizeof(T), &value, timeoutMs);
   }
 
   /** /todo */
   void CreateTimer();
+
+  /** Get a snapshot of the audio thread performance counters: CPU load per processing call relative to its deadline, and how often the
+   * transfer queues overflowed since the plug-in was created. Call this on the main thread, e.g. from OnIdle(), to display or log the figures
+   * @param stats The structure to fill in */
+  virtual void GetPerformanceStats(IPerformanceStats& stats) const;
+
+  /** Zero the CPU load counters and the longest UI parameter delay (not the queue overflow counts) */
+  void ResetPerformanceStats() { mPerformanceCounters.Reset(); mMaxUIParamDelay.store(0., std::memory_order_relaxed); }
+
+  /** @param load The CPU load, as a fraction of the block duration, above which a block is counted as an xrun risk */
+  void SetXRunRiskThreshold(double load) { mPerformanceCounters.SetXRunRiskThreshold(load); }
   
 private:
   /** Implemented by the API class, called by the UI via SetParameterValue() with the value of a parameter change gesture
@@ -204,10 +269,19 @@ private:
   virtual void TransmitMidiMsgFromProcessor(const IMidiMsg& msg) {};
   
   /** /todo */
-  virtual void TransmitSysExDataFromProcessor(const SysExData& data) {};
+  virtual void TransmitSysExDataFromProcessor(const ISysEx& msg) {};
 
   void OnTimer(Timer& t);
 
+  /** @return An estimate of the sample time now, extrapolated from the start of the last block by the time elapsed since */
+  int64_t EstimateSampleTimeFromUI(double sampleRate) const;
+
+  /** Call OnParamChange() for a change from the UI, with the params mutex held. The parameter is not set, it already has the latest value */
+  void ApplyParamChangeFromUI(const ParamChangeFromUI& change, int sampleOffset);
+
+  /** Called by the idle timer, applies the queued changes from the UI if the API class has stopped calling ProcessParamChangesFromUI() */
+  void ProcessParamChangesFromUIWhenIdle();
+
 protected:
   WDL_String mParamDisplayStr;
   std::unique_ptr<Timer> mTimer;
@@ -215,7 +289,24 @@ protected:
   IPlugQueue<ParamTuple> mParamChangeFromProcessor {PARAM_TRANSFER_SIZE};
   IPlugQueue<IMidiMsg> mMidiMsgsFromEditor {MIDI_TRANSFER_SIZE}; // a queue of midi messages generated in the editor by clicking keyboard UI etc
   IPlugQueue<IMidiMsg> mMidiMsgsFromProcessor {MIDI_TRANSFER_SIZE}; // a queue of MIDI messages received (potentially on the high priority thread), by the processor to send to the editor
-  IPlugQueue<SysExData> mSysExDataFromEditor {SYSEX_TRANSFER_SIZE}; // a queue of SYSEX data to send to the processor
-  IPlugQueue<SysExData> mSysExDataFromProcessor {SYSEX_TRANSFER_SIZE}; // a queue of SYSEX data to send to the editor
-  SysExData mSysexBuf;
+  IPlugSysExQueue mSysExDataFromEditor {SYSEX_TRANSFER_BYTES}; // a queue of SYSEX data to send to the processor
+  IPlugSysExQueue mSysExDataFromProcessor {SYSEX_TRANSFER_BYTES}; // a queue of SYSEX data to send to the editor
+  IPerformanceCounters mPerformanceCounters; // the API classes time each processing call with an IPerformanceCounters::ScopedBlock
+
+  IPlugQueue<ParamChangeFromUI> mParamChangesFromUI {PARAM_TRANSFER_SIZE}; // parameter changes made in the UI, applied on the audio thread by ProcessParamChangesFromUI()
+  IPlugMessageBus mMessageBus {MESSAGE_BUS_CHUNK_BYTES, MESSAGE_BUS_NUM_CHUNKS}; // messages from any thread to the audio thread, see SendMessageToProcessor()
+
+private:
+  // written by ProcessParamChangesFromUI() on the audio thread, read by SetParameterValue() to timestamp the changes
+  std::atomic<double> mUIParamSampleRate {0.}; // 0 until the API class first calls ProcessParamChangesFromUI()
+  std::atomic<double> mUIParamTimeOrigin {0.}; // the steady clock time in seconds at which sample time 0 would have been processed, at the current rate
+  std::atomic<double> mUIParamLastProcessTime {0.}; // the steady clock time in seconds of the last call to ProcessParamChangesFromUI()
+  std::atomic<double> mUIParamIdleTimeout {UI_PARAM_IDLE_TIMEOUT}; // how long without a call before the idle timer takes over, at least a few blocks
+  std::atomic<bool> mUIParamQueueBusy {false}; // held by whichever of the audio thread and the idle timer is popping mParamChangesFromUI
+  std::atomic<bool> mUIParamQueueOverflowed {false};
+  std::atomic<uint32_t> mNumUIParamChanges {0};
+  std::atomic<double> mMaxUIParamDelay {0.};
+  // audio thread only
+  int64_t mUIParamBlockStart = 0; // the sample time of the previous block
+  int mUIParamBlockFrames = 0;
 };
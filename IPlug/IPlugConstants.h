@@ -33,6 +33,8 @@ using PLUG_SAMPLE_SRC = double;
 using sample = PLUG_SAMPLE_DST;
 
 #define LOGFILE "IPlugLog.txt"
+#define TRACEFILE "IPlugTrace.bin"
+#define TRACE_RING_SIZE 16384
 #define MAX_PROCESS_TRACE_COUNT 100
 #define MAX_IDLE_TRACE_COUNT 15
 
@@ -102,17 +104,33 @@ static const int MAX_PARAM_DISPLAY_PRECISION = 6;
 #define MAX_BLOB_LENGTH 2048
 #endif
 
+#ifndef MAX_LATENCY
+#define MAX_LATENCY 8192 // the latency in samples that SetLatency() can change to without allocating the delay that aligns bypassed signals
+#endif
+
 #ifndef IDLE_TIMER_RATE
 #define IDLE_TIMER_RATE 20 // this controls the frequency of data going from processor to editor (and OnIdle calls)
 #endif
 
-#ifndef MAX_SYSEX_SIZE
-#define MAX_SYSEX_SIZE 512
+#define PARAM_TRANSFER_SIZE 512
+
+#ifndef UI_PARAM_IDLE_TIMEOUT
+#define UI_PARAM_IDLE_TIMEOUT 0.25 // seconds without processing after which parameter changes from the UI are applied on the main thread, see IPlugAPIBase::ProcessParamChangesFromUI()
 #endif
 
-#define PARAM_TRANSFER_SIZE 512
 #define MIDI_TRANSFER_SIZE 32
-#define SYSEX_TRANSFER_SIZE 4
+
+#ifndef SYSEX_TRANSFER_BYTES
+#define SYSEX_TRANSFER_BYTES 65536 // the byte budget of each SysEx queue between the editor and processor
+#endif
+
+#ifndef MESSAGE_BUS_CHUNK_BYTES
+#define MESSAGE_BUS_CHUNK_BYTES 1024 // the size of each pooled chunk of the message bus to the processor, see IPlugAPIBase::SendMessageToProcessor()
+#endif
+
+#ifndef MESSAGE_BUS_NUM_CHUNKS
+#define MESSAGE_BUS_NUM_CHUNKS 256 // the number of chunks in the pool, which limits the size of a message
+#endif
 
 // All version ints are stored as 0xVVVVRRMM: V = version, R = revision, M = minor revision.
 #define IPLUG_VERSION 0x010000
@@ -178,7 +196,8 @@ enum EAPI
   kAPIAAX = 4,
   kAPIAPP = 5,
   kAPIWAM = 6,
-  kAPIWEB = 7
+  kAPIWEB = 7,
+  kAPICLI = 8
 };
 
 /** @enum EHost
@@ -16,6 +16,7 @@
  */
 
 #include <cassert>
+#include <cstdlib>
 #include <cstring>
 #include <stdint.h>
 
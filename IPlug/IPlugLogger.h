@@ -17,6 +17,9 @@
  * To trace some arbitrary data:                 Trace(TRACELOC, "%s:%d", myStr, myInt);
  * To simply create a trace entry in the log:    TRACE;
  * No need to wrap tracer calls in #ifdef TRACER_BUILD because Trace is a no-op unless TRACER_BUILD is defined.
+ *
+ * Trace() formats text and writes it to the log file under a mutex, so on the audio thread use the binary event macros instead:
+ * TRACE_SCOPE; TRACE_EVENT; TRACE_VALUES(value1, value2); see IPlugTraceRecorder.h
  */
 
 #include <cstdio>
@@ -45,6 +48,7 @@
 
 #if defined TRACER_BUILD
   #define TRACE Trace(TRACELOC, "");
+  #include "IPlugTraceRecorder.h"
 
   #if defined OS_WIN
     #define SYS_THREAD_ID (intptr_t) GetCurrentThreadId()
@@ -54,6 +58,9 @@
 
   #else
     #define TRACE
+    #define TRACE_SCOPE
+    #define TRACE_EVENT
+    #define TRACE_VALUES(value1, value2)
   #endif
 
   #define TRACELOC __FUNCTION__,__LINE__
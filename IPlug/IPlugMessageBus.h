@@ -0,0 +1,235 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IPlugMessageBus
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+#include "heapbuf.h"
+#include "mutex.h"
+
+#include "IPlugQueue.h"
+
+/** A multi-producer, single-consumer bus that carries tagged binary messages to the audio thread, e.g. wavetable edits or sample data from the UI,
+ * from an OSC thread or from websocket connections.
+ *
+ * Messages are copied into a pool of fixed size chunks, which is allocated by the first Push(), so a bus that is never used costs little. A message that is larger than a chunk is split over several,
+ * and the consumer receives it chunk by chunk, in order, so it can copy the data into place without allocating. All the chunks of a message are queued at once,
+ * so a message is either delivered whole or not at all.
+ * Producers are serialised with a mutex, which the consumer never takes. The consumer hands chunks back to the producers through a lock-free queue.
+ * When there are not enough free chunks for a message, Push() fails or waits without holding the mutex, which is the back-pressure on producers that send faster than the audio thread consumes */
+class IPlugMessageBus final
+{
+public:
+  /** One chunk of a message, as it is delivered to the consumer. The data is only valid until the handler returns */
+  struct Chunk
+  {
+    int messageTag = 0;
+    int controlTag = 0;
+    int totalSize = 0; // the size of the whole message in bytes
+    int offset = 0; // the position of this chunk's data in the message
+    int size = 0; // the number of bytes in this chunk
+    const uint8_t* pData = nullptr;
+
+    bool IsFirst() const { return offset == 0; }
+    bool IsLast() const { return offset + size == totalSize; }
+
+    /** @return \c true if the message fits in this one chunk */
+    bool IsWholeMessage() const { return IsFirst() && IsLast(); }
+
+    /** Read a message that was sent with PushValue()
+     * @param value Set to the message's value
+     * @return \c true if the message is whole and the size of a T */
+    template <typename T>
+    bool GetValue(T& value) const
+    {
+      static_assert(std::is_trivially_copyable<T>::value, "messages are copied bytewise");
+
+      if (!IsWholeMessage() || size != (int) sizeof(T))
+        return false;
+
+      memcpy(&value, pData, sizeof(T));
+      return true;
+    }
+  };
+
+  /** IPlugMessageBus constructor
+   * @param chunkBytes The size of the payload of a chunk
+   * @param nChunks The number of chunks in the pool. The largest message that can be sent is chunkBytes * nChunks */
+  IPlugMessageBus(int chunkBytes, int nChunks)
+  : mChunkBytes(std::max(chunkBytes, 1))
+  , mNumChunks(std::max(nChunks, 1))
+  , mFreeChunks(mNumChunks)
+  , mQueuedChunks(mNumChunks)
+  {
+  }
+
+  IPlugMessageBus(const IPlugMessageBus&) = delete;
+  IPlugMessageBus& operator=(const IPlugMessageBus&) = delete;
+
+  /** @return The size in bytes of the largest message that can be sent */
+  int GetMaxMessageSize() const { return mChunkBytes * mNumChunks; }
+
+  int GetChunkSize() const { return mChunkBytes; }
+
+  /** @return The number of chunks that are not queued, an indication of how far behind the consumer is */
+  int GetNumFreeChunks() const { return mIsAllocated.load(std::memory_order_acquire) ? (int) mFreeChunks.ElementsAvailable() : mNumChunks; }
+
+  /** @return The number of messages that Push() rejected because there was not enough space or they were too large */
+  uint32_t GetNumFailedPushes() const { return mNumFailedPushes.load(std::memory_order_relaxed); }
+
+#pragma mark - Producers
+
+  /** Copy a message into the bus. Called by any thread but the consumer's
+   * @param messageTag A tag that identifies the message
+   * @param controlTag A tag that identifies the control that sent it, or kNoTag
+   * @param dataSize The size of the message in bytes
+   * @param pData The message bytes
+   * @param timeoutMs How long to wait for the consumer to free enough chunks, if there are not enough. 0 to fail straight away
+   * @return \c true if the message was queued, \c false if there was not enough space in time or it is larger than GetMaxMessageSize() */
+  bool Push(int messageTag, int controlTag, int dataSize, const void* pData, int timeoutMs = 0)
+  {
+    if (dataSize < 0 || dataSize > GetMaxMessageSize() || (dataSize > 0 && !pData))
+    {
+      mNumFailedPushes.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    const int nChunks = std::max(1, (dataSize + mChunkBytes - 1) / mChunkBytes);
+
+    // the mutex is released while waiting, so that other producers can send the messages there is space for
+    for (auto waited = 0; !TryPush(messageTag, controlTag, dataSize, pData, nChunks); waited++)
+    {
+      if (waited >= timeoutMs)
+      {
+        mNumFailedPushes.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return true;
+  }
+
+  /** Send a value of a trivially copyable type as a message, to be read with Chunk::GetValue()
+   * @see Push() */
+  template <typename T>
+  bool PushValue(int messageTag, int controlTag, const T& value, int timeoutMs = 0)
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "messages are copied bytewise");
+    return Push(messageTag, controlTag, (int) sizeof(T), &value, timeoutMs);
+  }
+
+#pragma mark - Consumer
+
+  /** Deliver the queued chunks, in the order their messages were pushed. Called by the consumer thread, usually the audio thread. Does not allocate
+   * @param handler Called with each chunk, as handler(const Chunk&). The chunk's data must be copied before the handler returns
+   * @param maxChunks The most chunks to deliver, to bound the work done per call. The rest are delivered by the next call
+   * @return The number of chunks that were delivered */
+  template <typename F>
+  int Process(F&& handler, int maxChunks = INT_MAX)
+  {
+    int* pFirst;
+    int* pSecond;
+    int nFirst, nSecond;
+    const int nChunks = std::min(mQueuedChunks.PeekSpans(pFirst, nFirst, pSecond, nSecond), maxChunks);
+
+    if (nChunks <= 0)
+      return 0;
+
+    const int nFromFirst = std::min(nFirst, nChunks);
+
+    for (auto i = 0; i < nFromFirst; i++)
+      handler(mChunks.Get()[pFirst[i]]);
+
+    for (auto i = 0; i < nChunks - nFromFirst; i++)
+      handler(mChunks.Get()[pSecond[i]]);
+
+    mFreeChunks.PushN(pFirst, nFromFirst);
+    mFreeChunks.PushN(pSecond, nChunks - nFromFirst);
+    mQueuedChunks.Discard(nChunks);
+    return nChunks;
+  }
+
+private:
+  /** Queue a message if there are enough free chunks for it, allocating the pool the first time
+   * @return \c false if there are not enough free chunks */
+  bool TryPush(int messageTag, int controlTag, int dataSize, const void* pData, int nChunks)
+  {
+    WDL_MutexLock lock(&mProducerMutex);
+
+    if (!mIsAllocated.load(std::memory_order_relaxed))
+      Allocate();
+
+    if ((int) mFreeChunks.ElementsAvailable() < nChunks)
+      return false;
+
+    int* pIndices = mProducerIndices.Get();
+    mFreeChunks.PopN(pIndices, nChunks);
+
+    for (auto c = 0; c < nChunks; c++)
+    {
+      Chunk& chunk = mChunks.Get()[pIndices[c]];
+      chunk.messageTag = messageTag;
+      chunk.controlTag = controlTag;
+      chunk.totalSize = dataSize;
+      chunk.offset = c * mChunkBytes;
+      chunk.size = std::min(mChunkBytes, dataSize - chunk.offset);
+
+      if (chunk.size > 0)
+        memcpy(const_cast<uint8_t*>(chunk.pData), static_cast<const uint8_t*>(pData) + chunk.offset, chunk.size);
+    }
+
+    // a single index update publishes every chunk of the message
+    mQueuedChunks.PushN(pIndices, nChunks);
+    return true;
+  }
+
+  /** Allocate the pool and hand every chunk to the producers. Called by the first producer, with the mutex held.
+   * The consumer only reaches the pool through the indices it pops from mQueuedChunks, which are published after this */
+  void Allocate()
+  {
+    mPool.Resize(mChunkBytes * mNumChunks);
+    mChunks.Resize(mNumChunks);
+    mProducerIndices.Resize(mNumChunks);
+
+    for (auto i = 0; i < mNumChunks; i++)
+    {
+      mChunks.Get()[i] = Chunk();
+      mChunks.Get()[i].pData = mPool.Get() + (i * mChunkBytes);
+      mFreeChunks.Push(i);
+    }
+
+    mIsAllocated.store(true, std::memory_order_release);
+  }
+
+  const int mChunkBytes;
+  const int mNumChunks;
+  WDL_TypedBuf<uint8_t> mPool;
+  WDL_TypedBuf<Chunk> mChunks; // the header of each chunk in the pool, written by the producer that holds it
+  WDL_TypedBuf<int> mProducerIndices; // scratch space for the producer that holds the mutex
+  IPlugQueue<int> mFreeChunks; // from the consumer to the producers
+  IPlugQueue<int> mQueuedChunks; // from the producers to the consumer
+  WDL_Mutex mProducerMutex;
+  std::atomic<uint32_t> mNumFailedPushes{0};
+  std::atomic<bool> mIsAllocated{false};
+};
@@ -20,6 +20,7 @@
 #include <cstdint>
 #include <cstdio>
 #include <algorithm>
+#include <atomic>
 
 #include "IPlugLogger.h"
 
@@ -511,14 +512,32 @@ void MyPlug::ProcessBlock(double** inputs, double** outputs, int nFrames)
 #endif
 
 /** A class to help with queuing timestamped MIDI messages
+  * By default the queue grows when it is full, as it always has, which allocates. For a queue that is used on the audio thread, choose kDropNewest or kDropOldest
+  * and size it with the constructor or Resize(): the capacity is then fixed, Add() never allocates, and the overflow policy decides which message is dropped when it is full.
+  * Dropped messages are reported by the return values of Add() and Merge(), and counted by GetNumDropped().
   * @ingroup IPlugUtilities */
 class IMidiQueue
 {
 public:
-  IMidiQueue(int size = DEFAULT_BLOCK_SIZE)
-  : mBuf(NULL), mSize(0), mGrow(Granulize(size)), mFront(0), mBack(0)
+  /** What to do when a message is added to a full queue */
+  enum EOverflowPolicy
   {
-    Expand();
+    kDropNewest = 0, // the message being added is discarded
+    kDropOldest,     // the message at the front of the queue is discarded to make room
+    kGrow            // the queue grows, which allocates. Messages are only dropped if the allocation fails
+  };
+
+  /** A sorted run of MIDI messages to be merged into the queue, see Merge() */
+  struct Source
+  {
+    const IMidiMsg* mMsgs;
+    int mNMsgs;
+  };
+
+  IMidiQueue(int size = DEFAULT_BLOCK_SIZE, EOverflowPolicy policy = kGrow)
+  : mBuf(NULL), mSize(0), mGrow(0), mFront(0), mBack(0), mPolicy(policy)
+  {
+    Resize(size);
   }
   
   ~IMidiQueue()
@@ -526,17 +545,31 @@ public:
     free(mBuf);
   }
 
-  // Adds a MIDI message at the back of the queue. If the queue is full,
-  // it will automatically expand itself.
-  void Add(const IMidiMsg& msg)
+  IMidiQueue(const IMidiQueue&) = delete;
+  IMidiQueue& operator=(const IMidiQueue&) = delete;
+
+  // Adds a MIDI message at the back of the queue, keeping the queue sorted
+  // by offset. If the queue is full, the message is handled according to the
+  // overflow policy, only kGrow allocates. Returns false if a message was
+  // dropped.
+  bool Add(const IMidiMsg& msg)
   {
-    if (mBack >= mSize)
+    bool dropped = false;
+
+    if (mBack >= mSize && mFront == 0 && !(mPolicy == kGrow && Expand(mSize + 1)))
     {
-      if (mFront > 0)
-        Compact();
-      else if (!Expand()) return;
+      mNDropped.fetch_add(1, std::memory_order_relaxed);
+
+      if (mPolicy != kDropOldest || !mSize)
+        return false;
+
+      ++mFront; // kDropOldest
+      dropped = true;
     }
 
+    if (mBack >= mSize)
+      Compact();
+
 #ifndef DONT_SORT_IMIDIQUEUE
     // Insert the MIDI message at the right offset.
     if (mBack > mFront && msg.mOffset < mBuf[mBack - 1].mOffset)
@@ -546,11 +579,97 @@ public:
       i++;
       memmove(&mBuf[i + 1], &mBuf[i], (mBack - i) * sizeof(IMidiMsg));
       mBuf[i] = msg;
+      ++mNOutOfOrder;
     }
     else
 #endif
       mBuf[mBack] = msg;
     ++mBack;
+
+    mHighWaterMark = std::max(mHighWaterMark, ToDo());
+    return !dropped;
+  }
+
+  // Merges several runs of messages, each already sorted by offset (e.g.
+  // host MIDI, messages from the editor, sequencer generated events), into
+  // the queue in a single pass. The merge runs backwards from the end of the
+  // queue, so nothing that is already queued is moved more than once. Messages
+  // with the same offset keep the order queue, pSources[0], pSources[1]...
+  // The sources are consumed. If the queue is full, kGrow grows it once to fit,
+  // kDropNewest drops the latest messages and kDropOldest the earliest queued
+  // ones, then the earliest incoming ones. Returns the number of messages that
+  // were dropped.
+  int Merge(Source* pSources, int nSources)
+  {
+    int nIncoming = 0;
+
+    for (int s = 0; s < nSources; ++s)
+      nIncoming += pSources[s].mNMsgs;
+
+    if (!nIncoming)
+      return 0;
+
+    Compact();
+
+    const int total = mBack + nIncoming;
+
+    if (total > mSize && mPolicy == kGrow)
+      Expand(total);
+
+    const int nDropped = std::max(0, total - mSize);
+    int shift = 0; // how far the merged sequence moves towards the front, for kDropOldest
+
+    if (nDropped > 0 && mPolicy == kDropOldest)
+    {
+      const int nFromQueue = std::min(nDropped, mBack);
+      mFront = nFromQueue;
+      Compact();
+      shift = nDropped - nFromQueue; // with the queue empty, the earliest incoming messages go too
+    }
+
+    int queueIdx = mBack - 1;
+
+    // v is the position of the next message from the back in the merged sequence of all the messages, including the dropped ones
+    for (int v = (mBack + nIncoming) - 1; v > queueIdx; --v)
+    {
+      Source* pNext = nullptr;
+      int nextOffset = 0;
+
+      if (queueIdx >= 0)
+        nextOffset = mBuf[queueIdx].mOffset;
+
+      // later sources win ties, so that they come after earlier ones and after the queue
+      for (int s = 0; s < nSources; ++s)
+      {
+        Source& src = pSources[s];
+
+        if (src.mNMsgs > 0 && ((!pNext && queueIdx < 0) || src.mMsgs[src.mNMsgs - 1].mOffset >= nextOffset))
+        {
+          pNext = &src;
+          nextOffset = src.mMsgs[src.mNMsgs - 1].mOffset;
+        }
+      }
+
+      const IMidiMsg& msg = pNext ? pNext->mMsgs[--pNext->mNMsgs] : mBuf[queueIdx--];
+      const int w = v - shift;
+
+      if (w >= 0 && w < mSize)
+        mBuf[w] = msg;
+    }
+
+    for (int s = 0; s < nSources; ++s)
+    {
+      pSources[s].mMsgs += pSources[s].mNMsgs;
+      pSources[s].mNMsgs = 0;
+    }
+
+    mBack = total - nDropped;
+
+    if (nDropped)
+      mNDropped.fetch_add(nDropped, std::memory_order_relaxed);
+
+    mHighWaterMark = std::max(mHighWaterMark, ToDo());
+    return nDropped;
   }
 
   // Removes a MIDI message from the front of the queue (but does *not*
@@ -571,9 +690,43 @@ public:
   // queue), but does *not* remove it from the queue.
   inline IMidiMsg& Peek() const { return mBuf[mFront]; }
 
+  // Returns the offset of the next MIDI message, or nFrames if there are
+  // no messages before the end of the block. Useful for splitting a block
+  // into sub-blocks between events.
+  inline int NextOffset(int nFrames) const
+  {
+    return Empty() ? nFrames : std::min(nFrames, mBuf[mFront].mOffset);
+  }
+
+  // Splits a block of nFrames into sub-blocks at the offsets of the queued
+  // messages. Calls msgFunc(const IMidiMsg&) for each message that is due,
+  // then blockFunc(int startFrame, int nFrames) for the audio up to the next
+  // message, and finally flushes the queue.
+  template <typename MsgFunc, typename BlockFunc>
+  void ProcessSubBlocks(int nFrames, MsgFunc msgFunc, BlockFunc blockFunc)
+  {
+    int start = 0;
+
+    while (start < nFrames)
+    {
+      while (!Empty() && mBuf[mFront].mOffset <= start)
+      {
+        msgFunc(mBuf[mFront]);
+        Remove();
+      }
+
+      const int end = NextOffset(nFrames);
+      blockFunc(start, end - start);
+      start = end;
+    }
+
+    Flush(nFrames);
+  }
+
   // Moves back MIDI messages all the way to the front of the queue, thus
   // freeing up space at the back, and updates the sample offset of the
-  // remaining MIDI messages by substracting nFrames.
+  // remaining MIDI messages by substracting nFrames. Only the messages that
+  // are still pending (normally few, if any) are touched.
   inline void Flush(int nFrames)
   {
     // Move everything all the way to the front.
@@ -586,7 +739,8 @@ public:
   // Clears the queue.
   inline void Clear() { mFront = mBack = 0; }
 
-  // Resizes (grows or shrinks) the queue, returns the new size.
+  // Resizes (grows or shrinks) the queue, returns the new size. This may
+  // allocate, so call it from OnReset() rather than on the audio thread.
   int Resize(int size)
   {
     if (mFront > 0) Compact();
@@ -603,12 +757,32 @@ public:
     return size;
   }
 
+  // Sets what happens when a message is added to a full queue.
+  inline void SetOverflowPolicy(EOverflowPolicy policy) { mPolicy = policy; }
+
+  inline EOverflowPolicy GetOverflowPolicy() const { return mPolicy; }
+
+  // Returns the number of messages dropped because the queue was full. This
+  // can be called from any thread, e.g. for IPlugAPIBase::GetPerformanceStats().
+  inline int GetNumDropped() const { return mNDropped.load(std::memory_order_relaxed); }
+
+  // Returns the number of messages that arrived out of order and had to be
+  // inserted rather than appended.
+  inline int GetNumOutOfOrder() const { return mNOutOfOrder; }
+
+  // Returns the largest number of messages queued at once.
+  inline int GetHighWaterMark() const { return mHighWaterMark; }
+
+  // Resets the statistics above.
+  inline void ResetStats() { mNDropped.store(0, std::memory_order_relaxed); mNOutOfOrder = mHighWaterMark = 0; }
+
 protected:
-  // Automatically expands the queue.
-  bool Expand()
+  // Grows the queue, in steps of the size it was created or last resized
+  // with, to hold at least minSize messages.
+  bool Expand(int minSize)
   {
     if (!mGrow) return false;
-    int size = (mSize / mGrow + 1) * mGrow;
+    int size = ((minSize + mGrow - 1) / mGrow) * mGrow;
 
     void* buf = realloc(mBuf, size * sizeof(IMidiMsg));
     if (!buf) return false;
@@ -639,4 +813,9 @@ protected:
 
   int mSize, mGrow;
   int mFront, mBack;
+  EOverflowPolicy mPolicy;
+
+  std::atomic<int> mNDropped { 0 };
+  int mNOutOfOrder = 0;
+  int mHighWaterMark = 0;
 };
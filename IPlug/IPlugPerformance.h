@@ -0,0 +1,183 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief Lock-free counters that measure the audio thread's CPU load per block, for display and logging on the main thread
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "wdlstring.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <xmmintrin.h>
+  #define IPLUG_PERF_DENORMAL_FLAG
+#endif
+
+/** A snapshot of the performance counters, see IPlugAPIBase::GetPerformanceStats() */
+struct IPerformanceStats
+{
+  static constexpr int kNumLoadBins = 11;
+
+  uint64_t mNumBlocks = 0;
+  double mLastLoad = 0.; // the time taken to process the last block, as a fraction of the block's duration
+  double mMaxLoad = 0.;
+  double mMeanLoad = 0.;
+  uint32_t mLoadHistogram[kNumLoadBins] = {}; // blocks by load, in steps of 10%. The last bin counts the blocks that took longer than real time
+  uint32_t mNumXRunRiskBlocks = 0; // blocks whose load exceeded the xrun risk threshold
+  uint32_t mNumDenormalBlocks = 0; // blocks that operated on denormal numbers (SSE only)
+  uint32_t mNumParamQueueOverflows = 0;
+  uint32_t mNumMidiQueueOverflows = 0;
+  uint32_t mNumSysExQueueOverflows = 0;
+  uint32_t mNumMessageBusOverflows = 0; // messages that IPlugAPIBase::SendMessageToProcessor() could not send
+  uint32_t mNumUIParamChanges = 0; // parameter changes from the UI that were applied on the audio thread, see IPlugAPIBase::ProcessParamChangesFromUI()
+  double mMaxUIParamDelay = 0.; // the longest time in seconds that a parameter change from the UI waited for the block that applied it
+
+  /** Write a one line summary, for logging */
+  void GetSummary(WDL_String& str) const
+  {
+    str.SetFormatted(256, "blocks:%llu load:%.1f%% max:%.1f%% mean:%.1f%% xrun-risk:%u denormal:%u ui-params:%u max-delay:%.1fms overflows(param:%u midi:%u sysex:%u msg:%u)",
+                     (unsigned long long) mNumBlocks, mLastLoad * 100., mMaxLoad * 100., mMeanLoad * 100.,
+                     mNumXRunRiskBlocks, mNumDenormalBlocks, mNumUIParamChanges, mMaxUIParamDelay * 1000.,
+                     mNumParamQueueOverflows, mNumMidiQueueOverflows, mNumSysExQueueOverflows, mNumMessageBusOverflows);
+  }
+};
+
+/** Measures the CPU load of each processing call relative to its deadline. The API classes time each call to the processor with a ScopedBlock.
+ * The audio thread only does relaxed atomic stores and increments, and the main thread reads a snapshot with GetStats() */
+class IPerformanceCounters
+{
+public:
+  /** Times a processing call, from construction to destruction */
+  class ScopedBlock
+  {
+  public:
+    ScopedBlock(IPerformanceCounters& counters, int nFrames, double sampleRate)
+    : mCounters(counters)
+    , mNFrames(nFrames)
+    , mSampleRate(sampleRate)
+    {
+      mCounters.BeginBlock();
+    }
+
+    ~ScopedBlock()
+    {
+      mCounters.EndBlock(mNFrames, mSampleRate);
+    }
+
+    ScopedBlock(const ScopedBlock&) = delete;
+    ScopedBlock& operator=(const ScopedBlock&) = delete;
+
+  private:
+    IPerformanceCounters& mCounters;
+    int mNFrames;
+    double mSampleRate;
+  };
+
+  IPerformanceCounters() = default;
+  IPerformanceCounters(const IPerformanceCounters&) = delete;
+  IPerformanceCounters& operator=(const IPerformanceCounters&) = delete;
+
+  /** Called on the audio thread at the start of a processing call */
+  void BeginBlock()
+  {
+#ifdef IPLUG_PERF_DENORMAL_FLAG
+    _mm_setcsr(_mm_getcsr() & ~kDenormalFlag);
+#endif
+    mBlockStart = std::chrono::steady_clock::now();
+  }
+
+  /** Called on the audio thread at the end of a processing call
+   * @param nFrames The number of frames that were processed
+   * @param sampleRate The sample rate, to determine the block's deadline */
+  void EndBlock(int nFrames, double sampleRate)
+  {
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - mBlockStart).count();
+
+#ifdef IPLUG_PERF_DENORMAL_FLAG
+    if (_mm_getcsr() & kDenormalFlag)
+      Increment(mNumDenormalBlocks);
+#endif
+
+    if (nFrames <= 0 || sampleRate <= 0.)
+      return;
+
+    const double load = elapsed * sampleRate / nFrames;
+    const int bin = load < 0.1 * (IPerformanceStats::kNumLoadBins - 1) ? (int) (load * 10.) : IPerformanceStats::kNumLoadBins - 1;
+
+    Increment(mLoadHistogram[bin]);
+
+    if (load > mXRunRiskThreshold.load(std::memory_order_relaxed))
+      Increment(mNumXRunRiskBlocks);
+
+    mLastLoad.store(load, std::memory_order_relaxed);
+
+    if (load > mMaxLoad.load(std::memory_order_relaxed))
+      mMaxLoad.store(load, std::memory_order_relaxed);
+
+    mLoadSum.store(mLoadSum.load(std::memory_order_relaxed) + load, std::memory_order_relaxed);
+    mNumBlocks.store(mNumBlocks.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  /** Set the load above which a block counts as being at risk of an xrun, 0.8 by default */
+  void SetXRunRiskThreshold(double load) { mXRunRiskThreshold.store(load, std::memory_order_relaxed); }
+
+  /** Fill in the load statistics. The queue overflow counts are filled in by IPlugAPIBase::GetPerformanceStats(). Call this from any thread */
+  void GetStats(IPerformanceStats& stats) const
+  {
+    stats.mNumBlocks = mNumBlocks.load(std::memory_order_acquire);
+    stats.mLastLoad = mLastLoad.load(std::memory_order_relaxed);
+    stats.mMaxLoad = mMaxLoad.load(std::memory_order_relaxed);
+    stats.mMeanLoad = stats.mNumBlocks ? mLoadSum.load(std::memory_order_relaxed) / stats.mNumBlocks : 0.;
+    stats.mNumXRunRiskBlocks = mNumXRunRiskBlocks.load(std::memory_order_relaxed);
+    stats.mNumDenormalBlocks = mNumDenormalBlocks.load(std::memory_order_relaxed);
+
+    for (auto i = 0; i < IPerformanceStats::kNumLoadBins; i++)
+      stats.mLoadHistogram[i] = mLoadHistogram[i].load(std::memory_order_relaxed);
+  }
+
+  /** Zero the counters. Called on the main thread, a block that is being processed at the same time may be partially counted */
+  void Reset()
+  {
+    mNumBlocks.store(0, std::memory_order_relaxed);
+    mLastLoad.store(0., std::memory_order_relaxed);
+    mMaxLoad.store(0., std::memory_order_relaxed);
+    mLoadSum.store(0., std::memory_order_relaxed);
+    mNumXRunRiskBlocks.store(0, std::memory_order_relaxed);
+    mNumDenormalBlocks.store(0, std::memory_order_relaxed);
+
+    for (auto& bin : mLoadHistogram)
+      bin.store(0, std::memory_order_relaxed);
+  }
+
+private:
+  static constexpr unsigned int kDenormalFlag = 0x0002; // MXCSR DE, a denormal operand was encountered
+
+  /** Only the audio thread writes the counters, so a load and store is enough and avoids a locked instruction */
+  static void Increment(std::atomic<uint32_t>& counter)
+  {
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  std::chrono::steady_clock::time_point mBlockStart; // audio thread only
+  std::atomic<uint64_t> mNumBlocks{0};
+  std::atomic<double> mLastLoad{0.};
+  std::atomic<double> mMaxLoad{0.};
+  std::atomic<double> mLoadSum{0.};
+  std::atomic<double> mXRunRiskThreshold{0.8};
+  std::atomic<uint32_t> mLoadHistogram[IPerformanceStats::kNumLoadBins] = {};
+  std::atomic<uint32_t> mNumXRunRiskBlocks{0};
+  std::atomic<uint32_t> mNumDenormalBlocks{0};
+};
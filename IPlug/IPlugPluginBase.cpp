@@ -77,6 +77,7 @@ const char* IPluginBase::GetAPIStr() const
     case kAPIAPP: return "Standalone";
     case kAPIWAM: return "WAM";
     case kAPIWEB: return "WEB";
+    case kAPICLI: return "CLI";
     default: return "";
   }
 }
@@ -40,6 +40,10 @@ IPlugProcessor<T>::IPlugProcessor(IPlugConfig c, EAPI plugAPI)
 
   mScratchData[ERoute::kInput].Resize(totalNInChans);
   mScratchData[ERoute::kOutput].Resize(totalNOutChans);
+  mAltScratchData[ERoute::kInput].Resize(totalNInChans);
+  mAltScratchData[ERoute::kOutput].Resize(totalNOutChans);
+  memset(mAltScratchData[ERoute::kInput].Get(), 0, totalNInChans * sizeof(PLUG_SAMPLE_SRC*));
+  memset(mAltScratchData[ERoute::kOutput].Get(), 0, totalNOutChans * sizeof(PLUG_SAMPLE_SRC*));
 
   T** ppInData = mScratchData[ERoute::kInput].Get();
 
@@ -61,6 +65,10 @@ IPlugProcessor<T>::IPlugProcessor(IPlugConfig c, EAPI plugAPI)
     pOutChannel->mIncomingData = nullptr;
     mChannelData[ERoute::kOutput].Add(pOutChannel);
   }
+
+#ifdef TRACER_BUILD
+  IPlugTraceRecorder::Get().AddRef();
+#endif
 }
 
 template<typename T>
@@ -68,6 +76,10 @@ IPlugProcessor<T>::~IPlugProcessor()
 {
   TRACE;
 
+#ifdef TRACER_BUILD
+  IPlugTraceRecorder::Get().Release();
+#endif
+
   mChannelData[ERoute::kInput].Empty(true);
   mChannelData[ERoute::kOutput].Empty(true);
   mIOConfigs.Empty(true);
@@ -75,6 +87,19 @@ IPlugProcessor<T>::~IPlugProcessor()
 
 template<typename T>
 void IPlugProcessor<T>::ProcessBlock(T** inputs, T** outputs, int nFrames)
+{
+  PassThroughBlock(inputs, outputs, nFrames);
+}
+
+template<typename T>
+void IPlugProcessor<T>::ProcessBlockAltPrecision(PLUG_SAMPLE_SRC** inputs, PLUG_SAMPLE_SRC** outputs, int nFrames)
+{
+  PassThroughBlock(inputs, outputs, nFrames);
+}
+
+template<typename T>
+template<typename S>
+void IPlugProcessor<T>::PassThroughBlock(S** inputs, S** outputs, int nFrames)
 {
   int i, nIn = mChannelData[ERoute::kInput].GetSize(), nOut = mChannelData[ERoute::kOutput].GetSize();
   int j = 0;
@@ -82,14 +107,14 @@ void IPlugProcessor<T>::ProcessBlock(T** inputs, T** outputs, int nFrames)
   {
     if (i < nIn)
     {
-      memcpy(outputs[i], inputs[i], nFrames * sizeof(T));
+      memcpy(outputs[i], inputs[i], nFrames * sizeof(S));
       j++;
     }
   }
   // zero remaining outs
   for (/* same j */; j < nOut; ++j)
   {
-    memset(outputs[j], 0, nFrames * sizeof(T));
+    memset(outputs[j], 0, nFrames * sizeof(S));
   }
 }
 
@@ -353,7 +378,10 @@ void IPlugProcessor<T>::SetChannelConnections(ERoute direction, int idx, int n,
     pChannel->mConnected = connected;
 
     if (!connected)
+    {
       *(pChannel->mData) = pChannel->mScratchBuf.Get();
+      mAltScratchData[direction].Get()[i] = pChannel->mIncomingScratchBuf.Get();
+    }
   }
 }
 
@@ -380,6 +408,27 @@ void IPlugProcessor<T>::AttachBuffers(ERoute direction, int idx, int n, PLUG_SAM
 
   const auto endIdx = std::min(idx + n, channelData.GetSize());
 
+  if (mDualPrecision)
+  {
+    // keep the host's buffers, they are only converted if the plug-in is bypassed with latency, see PassThroughBuffers()
+    PLUG_SAMPLE_SRC** ppAltData = mAltScratchData[direction].Get();
+
+    for (auto i = idx; i < endIdx; ++i)
+    {
+      IChannelData<>* pChannel = channelData.Get(i);
+
+      if (pChannel->mConnected)
+      {
+        *(pChannel->mData) = pChannel->mScratchBuf.Get();
+        pChannel->mIncomingData = ppAltData[i] = *(ppData++);
+      }
+      else
+        ppAltData[i] = pChannel->mIncomingScratchBuf.Get();
+    }
+
+    return;
+  }
+
   for (auto i = idx; i < endIdx; ++i)
   {
     IChannelData<>* pChannel = channelData.Get(i);
@@ -413,6 +462,17 @@ void IPlugProcessor<T>::PassThroughBuffers(PLUG_SAMPLE_DST type, int nFrames)
 template<typename T>
 void IPlugProcessor<T>::PassThroughBuffers(PLUG_SAMPLE_SRC type, int nFrames)
 {
+  if (mDualPrecision)
+  {
+    if (!(mLatency && mLatencyDelay))
+    {
+      PassThroughBlock(mAltScratchData[ERoute::kInput].Get(), mAltScratchData[ERoute::kOutput].Get(), nFrames);
+      return;
+    }
+
+    ConvertAltPrecisionInputs(nFrames);
+  }
+
   // for PLUG_SAMPLE_SRC bit buffers, first run the delay (if mLatency) on the PLUG_SAMPLE_DST IPlug buffers
   PassThroughBuffers(PLUG_SAMPLE_DST(0.), nFrames);
 
@@ -432,13 +492,28 @@ void IPlugProcessor<T>::PassThroughBuffers(PLUG_SAMPLE_SRC type, int nFrames)
 template<typename T>
 void IPlugProcessor<T>::ProcessBuffers(PLUG_SAMPLE_DST type, int nFrames)
 {
-  ProcessBlock(mScratchData[ERoute::kInput].Get(), mScratchData[ERoute::kOutput].Get(), nFrames);
+  TRACE_SCOPE;
+
+  if (!ProcessSilence(mScratchData[ERoute::kInput].Get(), mScratchData[ERoute::kOutput].Get(), nFrames))
+    ProcessBlock(mScratchData[ERoute::kInput].Get(), mScratchData[ERoute::kOutput].Get(), nFrames);
 }
 
 template<typename T>
 void IPlugProcessor<T>::ProcessBuffers(PLUG_SAMPLE_SRC type, int nFrames)
 {
-  ProcessBlock(mScratchData[ERoute::kInput].Get(), mScratchData[ERoute::kOutput].Get(), nFrames);
+  TRACE_SCOPE;
+
+  if (mDualPrecision)
+  {
+    if (!ProcessSilence(mAltScratchData[ERoute::kInput].Get(), mAltScratchData[ERoute::kOutput].Get(), nFrames))
+      ProcessBlockAltPrecision(mAltScratchData[ERoute::kInput].Get(), mAltScratchData[ERoute::kOutput].Get(), nFrames);
+
+    return;
+  }
+
+  if (!ProcessSilence(mScratchData[ERoute::kInput].Get(), mScratchData[ERoute::kOutput].Get(), nFrames))
+    ProcessBlock(mScratchData[ERoute::kInput].Get(), mScratchData[ERoute::kOutput].Get(), nFrames);
+
   int i, n = MaxNChannels(ERoute::kOutput);
   IChannelData<>** ppOutChannel = mChannelData[ERoute::kOutput].GetList();
 
@@ -456,7 +531,16 @@ void IPlugProcessor<T>::ProcessBuffers(PLUG_SAMPLE_SRC type, int nFrames)
 template<typename T>
 void IPlugProcessor<T>::ProcessBuffersAccumulating(int nFrames)
 {
-  ProcessBlock(mScratchData[ERoute::kInput].Get(), mScratchData[ERoute::kOutput].Get(), nFrames);
+  TRACE_SCOPE;
+
+  if (mDualPrecision)
+    ConvertAltPrecisionInputs(nFrames);
+
+  if (!ProcessSilence(mScratchData[ERoute::kInput].Get(), mScratchData[ERoute::kOutput].Get(), nFrames))
+    ProcessBlock(mScratchData[ERoute::kInput].Get(), mScratchData[ERoute::kOutput].Get(), nFrames);
+  else if (mOutputsSilent)
+    return; // nothing to accumulate
+
   int i, n = MaxNChannels(ERoute::kOutput);
   IChannelData<>** ppOutChannel = mChannelData[ERoute::kOutput].GetList();
 
@@ -475,21 +559,116 @@ void IPlugProcessor<T>::ProcessBuffersAccumulating(int nFrames)
   }
 }
 
+template<typename T>
+void IPlugProcessor<T>::SetInputSilenceFlags(int idx, int n, uint64_t silenceFlags)
+{
+  WDL_PtrList<IChannelData<>>& channelData = mChannelData[ERoute::kInput];
+
+  const auto endIdx = std::min(idx + n, channelData.GetSize());
+  int bit = 0;
+
+  for (auto i = idx; i < endIdx; ++i)
+  {
+    IChannelData<>* pChannel = channelData.Get(i);
+
+    if (pChannel->mConnected)
+    {
+      pChannel->mSilenceHint = bit < 64 && (silenceFlags >> bit) & 1;
+      bit++;
+    }
+  }
+}
+
+template<typename T>
+template<typename S>
+bool IPlugProcessor<T>::ProcessSilence(S** inputs, S** outputs, int nFrames)
+{
+  mOutputsSilent = false;
+
+  if (!mSilenceDetection)
+    return false;
+
+  int i, n = MaxNChannels(ERoute::kInput);
+  IChannelData<>** ppInChannel = mChannelData[ERoute::kInput].GetList();
+  bool allSilent = true;
+
+  for (i = 0; i < n; ++i, ++ppInChannel)
+  {
+    IChannelData<>* pInChannel = *ppInChannel;
+    bool silent = !pInChannel->mConnected || pInChannel->mSilenceHint;
+
+    if (!silent)
+    {
+      const S* pSamples = inputs[i];
+      int j = 0;
+
+      while (j < nFrames && pSamples[j] == S(0))
+        j++;
+
+      silent = j == nFrames;
+    }
+
+    pInChannel->mSilent = silent;
+    allSilent &= silent;
+  }
+
+  if (!allSilent)
+  {
+    mNumSilentFrames = 0;
+    return false;
+  }
+
+  // the tail and any latency must have been flushed out by silent input before the outputs can be assumed to be silent too
+  if (mTailSize >= 0 && mNumSilentFrames >= (int64_t) mTailSize + mLatency)
+  {
+    n = MaxNChannels(ERoute::kOutput);
+
+    for (i = 0; i < n; ++i)
+      memset(outputs[i], 0, nFrames * sizeof(S));
+
+    mOutputsSilent = true;
+    return true;
+  }
+
+  mNumSilentFrames += nFrames;
+  return CallProcessSilentBlock(outputs, nFrames);
+}
+
+template<typename T>
+void IPlugProcessor<T>::ConvertAltPrecisionInputs(int nFrames)
+{
+  int i, n = MaxNChannels(ERoute::kInput);
+  IChannelData<>** ppInChannel = mChannelData[ERoute::kInput].GetList();
+
+  for (i = 0; i < n; ++i, ++ppInChannel)
+  {
+    IChannelData<>* pInChannel = *ppInChannel;
+
+    if (pInChannel->mConnected)
+    {
+      CastCopy(*(pInChannel->mData), pInChannel->mIncomingData, nFrames);
+    }
+  }
+}
+
 template<typename T>
 void IPlugProcessor<T>::ZeroScratchBuffers()
 {
   int i, nIn = MaxNChannels(ERoute::kInput), nOut = MaxNChannels(ERoute::kOutput);
+  const int altSize = mDualPrecision ? mBlockSize : 0;
 
   for (i = 0; i < nIn; ++i)
   {
     IChannelData<>* pInChannel = mChannelData[ERoute::kInput].Get(i);
     memset(pInChannel->mScratchBuf.Get(), 0, mBlockSize * sizeof(PLUG_SAMPLE_DST));
+    memset(pInChannel->mIncomingScratchBuf.Get(), 0, altSize * sizeof(PLUG_SAMPLE_SRC));
   }
 
   for (i = 0; i < nOut; ++i)
   {
     IChannelData<>* pOutChannel = mChannelData[ERoute::kOutput].Get(i);
     memset(pOutChannel->mScratchBuf.Get(), 0, mBlockSize * sizeof(PLUG_SAMPLE_DST));
+    memset(pOutChannel->mIncomingScratchBuf.Get(), 0, altSize * sizeof(PLUG_SAMPLE_SRC));
   }
 }
 
@@ -500,11 +679,18 @@ void IPlugProcessor<T>::SetBlockSize(int blockSize)
   {
     int i, nIn = MaxNChannels(ERoute::kInput), nOut = MaxNChannels(ERoute::kOutput);
 
+    const int altSize = mDualPrecision ? blockSize : 0;
+
     for (i = 0; i < nIn; ++i)
     {
       IChannelData<>* pInChannel = mChannelData[ERoute::kInput].Get(i);
       pInChannel->mScratchBuf.Resize(blockSize);
       memset(pInChannel->mScratchBuf.Get(), 0, blockSize * sizeof(PLUG_SAMPLE_DST));
+      pInChannel->mIncomingScratchBuf.Resize(altSize);
+      memset(pInChannel->mIncomingScratchBuf.Get(), 0, altSize * sizeof(PLUG_SAMPLE_SRC));
+
+      if (!pInChannel->mConnected)
+        mAltScratchData[ERoute::kInput].Get()[i] = pInChannel->mIncomingScratchBuf.Get();
     }
 
     for (i = 0; i < nOut; ++i)
@@ -512,6 +698,11 @@ void IPlugProcessor<T>::SetBlockSize(int blockSize)
       IChannelData<>* pOutChannel = mChannelData[ERoute::kOutput].Get(i);
       pOutChannel->mScratchBuf.Resize(blockSize);
       memset(pOutChannel->mScratchBuf.Get(), 0, blockSize * sizeof(PLUG_SAMPLE_DST));
+      pOutChannel->mIncomingScratchBuf.Resize(altSize);
+      memset(pOutChannel->mIncomingScratchBuf.Get(), 0, altSize * sizeof(PLUG_SAMPLE_SRC));
+
+      if (!pOutChannel->mConnected)
+        mAltScratchData[ERoute::kOutput].Get()[i] = pOutChannel->mIncomingScratchBuf.Get();
     }
 
     mBlockSize = blockSize;
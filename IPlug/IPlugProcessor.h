@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <cstdlib>
 #include <cstring>
 #include <cstdint>
 #include <memory>
@@ -57,6 +58,35 @@ public:
    * @param nFrames The block size for this block: number of samples per channel.*/
   virtual void ProcessBlock(T** inputs, T** outputs, int nFrames);
 
+  /** Override in your plug-in class to process audio at the host's alternative precision (PLUG_SAMPLE_SRC), when dual precision processing
+   * has been enabled with SetDualPrecision(). This is called instead of ProcessBlock() whenever the host supplies PLUG_SAMPLE_SRC buffers,
+   * avoiding the conversion of every channel into and out of the PLUG_SAMPLE_DST scratch buffers.
+   * The simplest way to implement both methods is to forward them to a single templated method in your plug-in class, e.g.
+   * \code
+   * void ProcessBlock(sample** inputs, sample** outputs, int nFrames) override { ProcessBlockT(inputs, outputs, nFrames); }
+   * void ProcessBlockAltPrecision(PLUG_SAMPLE_SRC** inputs, PLUG_SAMPLE_SRC** outputs, int nFrames) override { ProcessBlockT(inputs, outputs, nFrames); }
+   * \endcode
+   * The same guarantees as ProcessBlock() apply regarding unconnected channels.
+   * THIS METHOD IS CALLED BY THE HIGH PRIORITY AUDIO THREAD - You should be careful not to do any unbounded, blocking operations such as file I/O which could cause audio dropouts
+   * @param inputs Two-dimensional array containing the non-interleaved input buffers of audio samples for all channels
+   * @param outputs Two-dimensional array for audio output (non-interleaved).
+   * @param nFrames The block size for this block: number of samples per channel.*/
+  virtual void ProcessBlockAltPrecision(PLUG_SAMPLE_SRC** inputs, PLUG_SAMPLE_SRC** outputs, int nFrames);
+
+  /** Override in your plug-in class to provide a cheaper processing path for blocks where all the inputs are silent, but the tail has not yet decayed.
+   * Only called when silence detection is enabled, see SetSilenceDetection(). For example a reverb could skip its input stage and only render the tail
+   * THIS METHOD IS CALLED BY THE HIGH PRIORITY AUDIO THREAD - You should be careful not to do any unbounded, blocking operations such as file I/O which could cause audio dropouts
+   * @param outputs Two-dimensional array for audio output (non-interleaved).
+   * @param nFrames The block size for this block: number of samples per channel.
+   * @return \c true if the outputs have been written, \c false to call ProcessBlock() as normal (the default) */
+  virtual bool ProcessSilentBlock(T** outputs, int nFrames) { return false; }
+
+  /** The equivalent of ProcessSilentBlock() when processing in dual precision mode, see ProcessBlockAltPrecision()
+   * @param outputs Two-dimensional array for audio output (non-interleaved).
+   * @param nFrames The block size for this block: number of samples per channel.
+   * @return \c true if the outputs have been written, \c false to call ProcessBlockAltPrecision() as normal (the default) */
+  virtual bool ProcessSilentBlockAltPrecision(PLUG_SAMPLE_SRC** outputs, int nFrames) { return false; }
+
   /** Override this method to handle incoming MIDI messages. The method is called prior to ProcessBlock().
    * You can use IMidiQueue in combination with this method in order to queue the message and process at the appropriate time in ProcessBlock()
    * THIS METHOD IS CALLED BY THE HIGH PRIORITY AUDIO THREAD - You should be careful not to do any unbounded, blocking operations such as file I/O which could cause audio dropouts
@@ -232,6 +262,7 @@ public:
 
   /** Call this if the latency of your plug-in changes after initialization (perhaps from OnReset() )
    * This may not be supported by the host. The method is virtual because it's overridden in API classes.
+   * In AAX and VST3, bypassed signals are delayed to match the latency. Storage for that is reserved up to MAX_LATENCY samples, define it in your config.h if the latency can be longer, or a change will allocate
    @param latency Latency in samples */
   virtual void SetLatency(int latency);
 
@@ -241,6 +272,30 @@ public:
    * @param tailSize the new tailsize in samples*/
   void SetTailSize(int tailSize) { mTailSize = tailSize; }
 
+  /** Call this in the constructor of your plug-in class to receive the host's PLUG_SAMPLE_SRC buffers directly in ProcessBlockAltPrecision(),
+   * rather than having them converted to PLUG_SAMPLE_DST for ProcessBlock(). Must be called before the host sets the block size.
+   * @param enable \c true to enable dual precision processing */
+  void SetDualPrecision(bool enable) { mDualPrecision = enable; }
+
+  /** @return \c true if the plug-in processes PLUG_SAMPLE_SRC buffers natively via ProcessBlockAltPrecision() */
+  bool GetDualPrecision() const { return mDualPrecision; }
+
+  /** Call this to let the API class skip processing while the inputs are silent. When every input channel has been digitally silent for longer than the
+   * tail size plus the latency, ProcessBlock() is no longer called, the outputs are zeroed and the host is told they are silent, where the API supports it (VST3, AUv2).
+   * Processing resumes as soon as any input is non-zero. Set the tail size with SetTailSize(), an infinite tail (-1, i.e. 0xffffffff) disables sleeping.
+   * Only enable this for plug-ins whose output depends on their audio input alone, not for instruments or plug-ins that make sound in response to MIDI or parameter changes
+   * @param enable \c true to enable silence detection */
+  void SetSilenceDetection(bool enable) { mSilenceDetection = enable; mNumSilentFrames = 0; }
+
+  /** @return \c true if silence detection is enabled, see SetSilenceDetection() */
+  bool GetSilenceDetection() const { return mSilenceDetection; }
+
+  /** Call this from ProcessBlock() to find out if an input channel is silent in the current block, for example to skip a silent sidechain.
+   * Only valid when silence detection is enabled, see SetSilenceDetection()
+   * @param chIdx The input channel index
+   * @return \c true if the channel is unconnected or all of its samples are zero in the current block */
+  bool IsInputChannelSilent(int chIdx) const { return mChannelData[ERoute::kInput].Get(chIdx)->mSilent; }
+
   /** A static method to parse the config.h channel I/O string.
    * @param IOStr Space separated cstring list of I/O configurations for this plug-in in the format ninchans-noutchans.
    * A hypen character \c(-) deliminates input-output. Supports multiple buses, which are indicated using a period \c(.) character.
@@ -274,8 +329,25 @@ protected:
   void SetTimeInfo(const ITimeInfo& timeInfo) { mTimeInfo = timeInfo; }
   void SetRenderingOffline(bool renderingOffline) { mRenderingOffline = renderingOffline; }
   const WDL_String& GetChannelLabel(ERoute direction, int idx) { return mChannelData[direction].Get(idx)->mLabel; }
+  /** Called by the API class after AttachBuffers() for inputs, when the host tells us which channels are silent, e.g. VST3's AudioBusBuffers::silenceFlags.
+   * Like AttachBuffers(), consecutive bits are assigned to consecutive connected channels */
+  void SetInputSilenceFlags(int idx, int n, uint64_t silenceFlags);
+  /** @return \c true if processing was skipped in the last call to ProcessBuffers() and the outputs are all zero, see SetSilenceDetection() */
+  bool GetOutputsSilent() const { return mOutputsSilent; }
 
 private:
+  /** Copies inputs to outputs and zeros any remaining outputs, the default behaviour of both ProcessBlock methods */
+  template <typename S>
+  void PassThroughBlock(S** inputs, S** outputs, int nFrames);
+  /** In dual precision mode, converts the connected PLUG_SAMPLE_SRC inputs into the PLUG_SAMPLE_DST scratch buffers, only needed when bypassed with latency */
+  void ConvertAltPrecisionInputs(int nFrames);
+  /** When silence detection is enabled, updates the input channels' silence and decides whether ProcessBlock() can be skipped. If so the outputs have been written
+   * @return \c true if the outputs have been zeroed, or written by ProcessSilentBlock() */
+  template <typename S>
+  bool ProcessSilence(S** inputs, S** outputs, int nFrames);
+  bool CallProcessSilentBlock(T** outputs, int nFrames) { return ProcessSilentBlock(outputs, nFrames); }
+  bool CallProcessSilentBlock(PLUG_SAMPLE_SRC** outputs, int nFrames) { return ProcessSilentBlockAltPrecision(outputs, nFrames); }
+
   /** See EIPlugPluginTypes */
   EIPlugPluginType mPlugType;
   /** \c true if the plug-in accepts MIDI input */
@@ -296,10 +368,20 @@ private:
   bool mBypassed = false;
   /** \c true if the plug-in is rendering off-line*/
   bool mRenderingOffline = false;
+  /** \c true if PLUG_SAMPLE_SRC buffers are processed natively via ProcessBlockAltPrecision() */
+  bool mDualPrecision = false;
+  /** \c true if processing may be skipped while the inputs are silent */
+  bool mSilenceDetection = false;
+  /** \c true if the outputs of the last block are all zero because processing was skipped */
+  bool mOutputsSilent = false;
+  /** The number of consecutive silent input frames that have been processed, compared with the tail size to decide when to stop processing */
+  int64_t mNumSilentFrames = 0;
   /** A list of IOConfig structures populated by ParseChannelIOStr in the IPlugProcessor constructor */
   WDL_PtrList<IOConfig> mIOConfigs;
   /* Manages pointers to the actual data for each channel */
   WDL_TypedBuf<T*> mScratchData[2];
+  /* Manages pointers to the PLUG_SAMPLE_SRC data for each channel, when processing in dual precision mode */
+  WDL_TypedBuf<PLUG_SAMPLE_SRC*> mAltScratchData[2];
   /* A list of IChannelData structures corresponding to every input/output channel */
   WDL_PtrList<IChannelData<>> mChannelData[2];
 protected: // these members are protected because they need to be access by the API classes, and don't want a setter/getter
@@ -15,18 +15,28 @@
  * @copydoc IPlugQueue
  */
 
+#include <algorithm>
 #include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "IPlugMidi.h"
 
 /** A lock-free SPSC queue used to transfer data between threads
  * based on MLQueue.h by Randy Jones
- * based on https://kjellkod.wordpress.com/2012/11/28/c-debt-paid-in-full-wait-free-lock-free-queue/ */
+ * based on https://kjellkod.wordpress.com/2012/11/28/c-debt-paid-in-full-wait-free-lock-free-queue/
+ *
+ * The capacity is a power of two, so the indices run freely and are masked rather than wrapped with a modulo.
+ * The producer's and the consumer's indices live on separate cache lines, and each side keeps a copy of the other's index,
+ * so it only reads the shared one (and takes the cache miss) when the copy says the queue is full or empty.
+ * PushN(), PopN() and PeekSpans() transfer many items for the cost of one index update */
 template<typename T>
 class IPlugQueue final
 {
 public:
   /** IPlugQueue constructor 
-   * @param size /todo */
+   * @param size The number of items the queue must be able to hold, rounded up to a power of two */
   IPlugQueue(int size)
   {
     Resize(size);
@@ -37,91 +47,370 @@ public:
   IPlugQueue(const IPlugQueue&) = delete;
   IPlugQueue& operator=(const IPlugQueue&) = delete;
     
-  /** /todo 
-   * @param size /todo */
+  /** Resize the queue, discarding any queued items. Not thread safe, call it before either side is running
+   * @param size The number of items the queue must be able to hold, rounded up to a power of two */
   void Resize(int size)
   {
-    mData.Resize(size + 1);
+    size_t capacity = 1;
+
+    while (capacity < (size_t) size)
+      capacity <<= 1;
+
+    mData.Resize((int) capacity);
+    mMask = capacity - 1;
+    mWriteIndex.store(0);
+    mReadIndex.store(0);
+    mCachedReadIndex = 0;
+    mCachedWriteIndex = 0;
   }
 
-  /** /todo 
-   * @param item /todo
-   * @return true /todo
-   * @return false /todo */
+  /** @return The number of items the queue can hold */
+  int GetCapacity() const { return (int) (mMask + 1); }
+
+  /** Copy an item into the queue. Called by the producer thread
+   * @param item The item
+   * @return \c true on success, \c false if the queue was full */
   bool Push(const T& item)
   {
     const auto currentWriteIndex = mWriteIndex.load(std::memory_order_relaxed);
-    const auto nextWriteIndex = Increment(currentWriteIndex);
-    if(nextWriteIndex != mReadIndex.load(std::memory_order_acquire))
+
+    if (currentWriteIndex - mCachedReadIndex > mMask)
     {
-      mData.Get()[currentWriteIndex] = item;
-      mWriteIndex.store(nextWriteIndex, std::memory_order_release);
-      return true;
+      mCachedReadIndex = mReadIndex.load(std::memory_order_acquire);
+
+      if (currentWriteIndex - mCachedReadIndex > mMask)
+      {
+        mNumFailedPushes.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
     }
-    return false;
+
+    mData.Get()[currentWriteIndex & mMask] = item;
+    mWriteIndex.store(currentWriteIndex + 1, std::memory_order_release);
+    return true;
+  }
+
+  /** Copy as many items as there is space for into the queue, in order. Called by the producer thread
+   * @param pItems The items
+   * @param nItems The number of items
+   * @return The number of items that were pushed. The others count as failed pushes */
+  int PushN(const T* pItems, int nItems)
+  {
+    if (nItems <= 0)
+      return 0;
+
+    const auto currentWriteIndex = mWriteIndex.load(std::memory_order_relaxed);
+
+    if (mCachedReadIndex + mMask + 1 - currentWriteIndex < (size_t) nItems)
+      mCachedReadIndex = mReadIndex.load(std::memory_order_acquire);
+
+    const int nPushed = (int) std::min((size_t) nItems, mCachedReadIndex + mMask + 1 - currentWriteIndex);
+
+    if (nPushed < nItems)
+      mNumFailedPushes.fetch_add(nItems - nPushed, std::memory_order_relaxed);
+
+    if (nPushed == 0)
+      return 0;
+
+    const size_t start = currentWriteIndex & mMask;
+    const size_t nFirst = std::min((size_t) nPushed, mMask + 1 - start);
+    std::copy(pItems, pItems + nFirst, mData.Get() + start);
+    std::copy(pItems + nFirst, pItems + nPushed, mData.Get());
+    mWriteIndex.store(currentWriteIndex + nPushed, std::memory_order_release);
+    return nPushed;
   }
 
-  /** /todo 
-   * @param item /todo
-   * @return true /todo
-   * @return false /todo */
+  /** Copy the oldest item out of the queue. Called by the consumer thread
+   * @param item Set to the item
+   * @return \c true if an item was popped, \c false if the queue was empty */
   bool Pop(T& item)
   {
     const auto currentReadIndex = mReadIndex.load(std::memory_order_relaxed);
-    if(currentReadIndex == mWriteIndex.load(std::memory_order_acquire))
+
+    if (currentReadIndex == mCachedWriteIndex)
     {
-      return false; // empty the queue
+      mCachedWriteIndex = mWriteIndex.load(std::memory_order_acquire);
+
+      if (currentReadIndex == mCachedWriteIndex)
+        return false; // empty the queue
     }
-    item = mData.Get()[currentReadIndex];
-    mReadIndex.store(Increment(currentReadIndex), std::memory_order_release);
+
+    item = mData.Get()[currentReadIndex & mMask];
+    mReadIndex.store(currentReadIndex + 1, std::memory_order_release);
     return true;
   }
 
-  /** /todo 
-   * @return size_t /todo */
+  /** Copy up to maxItems of the oldest items out of the queue, in order. Called by the consumer thread
+   * @param pItems The buffer to copy the items to
+   * @param maxItems The size of the buffer
+   * @return The number of items that were popped */
+  int PopN(T* pItems, int maxItems)
+  {
+    T* pFirst;
+    T* pSecond;
+    int nFirst, nSecond;
+    const int nPopped = std::min(PeekSpans(pFirst, nFirst, pSecond, nSecond), maxItems);
+    const int nFromFirst = std::min(nFirst, nPopped);
+    std::copy(pFirst, pFirst + nFromFirst, pItems);
+    std::copy(pSecond, pSecond + (nPopped - nFromFirst), pItems + nFromFirst);
+    Discard(nPopped);
+    return nPopped;
+  }
+
+  /** Get the queued items in place, without copying or popping them. The items are in at most two contiguous spans, because the queue is a ring.
+   * They stay valid until they are popped or discarded. Called by the consumer thread
+   * @param pFirst Set to the oldest items
+   * @param nFirst Set to the number of items in the first span
+   * @param pSecond Set to the items that follow on from the first span, at the start of the ring
+   * @param nSecond Set to the number of items in the second span, which may be 0
+   * @return The number of queued items, nFirst + nSecond */
+  int PeekSpans(T*& pFirst, int& nFirst, T*& pSecond, int& nSecond)
+  {
+    const auto currentReadIndex = mReadIndex.load(std::memory_order_relaxed);
+    mCachedWriteIndex = mWriteIndex.load(std::memory_order_acquire);
+
+    const size_t nItems = mCachedWriteIndex - currentReadIndex;
+    const size_t start = currentReadIndex & mMask;
+    nFirst = (int) std::min(nItems, mMask + 1 - start);
+    nSecond = (int) nItems - nFirst;
+    pFirst = mData.Get() + start;
+    pSecond = mData.Get();
+    return (int) nItems;
+  }
+
+  /** Pop items without copying them, e.g. after reading them with PeekSpans(). Called by the consumer thread
+   * @param nItems The number of items, which must be no more than are queued */
+  void Discard(int nItems)
+  {
+    if (nItems > 0)
+      mReadIndex.store(mReadIndex.load(std::memory_order_relaxed) + nItems, std::memory_order_release);
+  }
+
+  /** @return The number of queued items. It may be out of date by the time it is used, unless it is called by the consumer, which only sees the count grow */
   size_t ElementsAvailable() const
   {
-    return (mWriteIndex.load(std::memory_order_acquire) - mReadIndex.load(std::memory_order_relaxed))%mData.GetSize();
+    return mWriteIndex.load(std::memory_order_acquire) - mReadIndex.load(std::memory_order_relaxed);
   }
 
-  /** /todo
+  /** Get the oldest item in place without popping it. The queue must not be empty. Called by the consumer thread
    * useful for reading elements while a criterion is met. Can be used like
    * while IPlugQueue.ElementsAvailable() && q.peek().mTime < 100 { elem = q.pop() ... }
-   * @return const T& /todo */
+   * @return The oldest item */
   const T& Peek()
   {
     const auto currentReadIndex = mReadIndex.load(std::memory_order_relaxed);
-    return mData[currentReadIndex];
+    return mData.Get()[currentReadIndex & mMask];
   }
 
-  /** /todo 
-   * @return true /todo
-   * @return false /todo */
+  /** @return \c true if the queue was empty */
   bool WasEmpty() const
   {
     return (mWriteIndex.load() == mReadIndex.load());
   }
 
-  /** /todo 
-   * @return true /todo
-   * @return false /todo */
+  /** @return \c true if the queue was full */
   bool WasFull() const
   {
-    const auto nextWriteIndex = Increment(mWriteIndex.load());
-    return (nextWriteIndex == mReadIndex.load());
+    return (mWriteIndex.load() - mReadIndex.load() > mMask);
   }
 
+  /** @return The number of items that Push() and PushN() failed to push because the queue was full, see IPlugAPIBase::GetPerformanceStats() */
+  uint32_t GetNumFailedPushes() const { return mNumFailedPushes.load(std::memory_order_relaxed); }
+
 private:
-  /** /todo 
-   * @param idx /todo
-   * @return size_t /todo */
-  size_t Increment(size_t idx) const
-  {
-    return (idx + 1) % (mData.GetSize());
-  }
+  static constexpr size_t kCacheLineSize = 64;
 
+  // the groups of members are a cache line apart, so they are never on the same line. They are padded rather than declared alignas(kCacheLineSize),
+  // because with C++14 operator new doesn't honour extended alignment, and the queues are members of the heap allocated plug-in
+
+  // read-only while both sides are running
   WDL_TypedBuf<T> mData;
+  size_t mMask = 0;
+  char mPad0[kCacheLineSize];
+
+  // written by the producer. The indices only ever increase, and are masked to index mData
   std::atomic<size_t> mWriteIndex{0};
+  size_t mCachedReadIndex = 0;
+  std::atomic<uint32_t> mNumFailedPushes{0};
+  char mPad1[kCacheLineSize];
+
+  // written by the consumer
   std::atomic<size_t> mReadIndex{0};
+  size_t mCachedWriteIndex = 0;
+  char mPad2[kCacheLineSize];
 };
 
+/** A lock-free SPSC queue used to transfer variable length SysEx messages between threads.
+ * Messages are stored length-prefixed in a byte ring, each one contiguous, so the consumer reads them in place without copying.
+ * The ring is sized in bytes, so a few large patch dumps or many small messages can be queued, up to the same budget.
+ * Messages read with Read() stay valid until Release() is called, which hands their space back to the producer. */
+class IPlugSysExQueue final
+{
+public:
+  /** IPlugSysExQueue constructor
+   * @param capacityBytes The size of the byte ring. The largest message that can be queued is GetMaxMessageSize(), about half of this */
+  IPlugSysExQueue(int capacityBytes)
+  {
+    Resize(capacityBytes);
+  }
+
+  IPlugSysExQueue(const IPlugSysExQueue&) = delete;
+  IPlugSysExQueue& operator=(const IPlugSysExQueue&) = delete;
+
+  /** Resize the ring, discarding any queued messages. Not thread safe, call it before either side is running
+   * @param capacityBytes The size of the byte ring */
+  void Resize(int capacityBytes)
+  {
+    mData.Resize((int) Align(capacityBytes));
+    mWriteIndex.store(0);
+    mReadIndex.store(0);
+    mPeekIndex = 0;
+  }
+
+  /** Messages are never split, so a record may not take up more than half the ring, otherwise an empty queue might not have room for it
+   * @return The size in bytes of the largest message that can be queued */
+  int GetMaxMessageSize() const
+  {
+    return std::max(0, (int) (((size_t) mData.GetSize() / 2) & ~(kHeaderSize - 1)) - (int) kHeaderSize);
+  }
+
+  /** Copy a message into the queue. Called by the producer thread
+   * @param offset The sample offset of the message
+   * @param pData The message bytes
+   * @param size The number of bytes
+   * @return \c true on success, \c false if there is not enough space in the queue or the message is larger than GetMaxMessageSize() */
+  bool Push(int offset, const uint8_t* pData, int size)
+  {
+    if (!TryPush(offset, pData, size))
+    {
+      mNumFailedPushes.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    return true;
+  }
+
+  /** Copy a message into the queue. Called by the producer thread
+   * @param msg The message
+   * @return \c true on success, \c false if there is not enough space in the queue */
+  bool Push(const ISysEx& msg)
+  {
+    return Push(msg.mOffset, msg.mData, msg.mSize);
+  }
+
+  /** Get the next unread message, without copying it. Called by the consumer thread
+   * @param msg Will point at the message data inside the queue, valid until Release() is called
+   * @return \c true if a message was read, \c false if there are no more messages */
+  bool Read(ISysEx& msg)
+  {
+    size_t currentPeekIndex = mPeekIndex;
+
+    if (currentPeekIndex == mWriteIndex.load(std::memory_order_acquire))
+      return false;
+
+    int32_t size, offset;
+    ReadHeader(currentPeekIndex, size, offset);
+
+    if (size == kWrapMarker)
+    {
+      currentPeekIndex = 0;
+      ReadHeader(currentPeekIndex, size, offset);
+    }
+
+    msg = ISysEx(offset, mData.Get() + currentPeekIndex + kHeaderSize, size);
+
+    currentPeekIndex += kHeaderSize + Align(size);
+
+    if (currentPeekIndex == (size_t) mData.GetSize())
+      currentPeekIndex = 0;
+
+    mPeekIndex = currentPeekIndex;
+    return true;
+  }
+
+  /** Give back the space of all the messages returned by Read() so far to the producer. Called by the consumer thread */
+  void Release()
+  {
+    mReadIndex.store(mPeekIndex, std::memory_order_release);
+  }
+
+  /** @return \c true if there are no unread messages. Called by the consumer thread */
+  bool WasEmpty() const
+  {
+    return mPeekIndex == mWriteIndex.load(std::memory_order_acquire);
+  }
+
+  /** @return The number of messages that Push() rejected because the queue was full or they were too large */
+  uint32_t GetNumFailedPushes() const { return mNumFailedPushes.load(std::memory_order_relaxed); }
+
+private:
+  static constexpr size_t kHeaderSize = 2 * sizeof(int32_t);
+  static constexpr int32_t kWrapMarker = -1;
+
+  /** Records are kept 8 byte aligned, so a header always fits before the end of the ring */
+  static size_t Align(int size) { return ((size_t) size + kHeaderSize - 1) & ~(kHeaderSize - 1); }
+
+  bool TryPush(int offset, const uint8_t* pData, int size)
+  {
+    if (size < 0 || size > GetMaxMessageSize())
+      return false;
+
+    const size_t capacity = mData.GetSize();
+    const size_t recordSize = kHeaderSize + Align(size);
+    const size_t currentWriteIndex = mWriteIndex.load(std::memory_order_relaxed);
+    const size_t currentReadIndex = mReadIndex.load(std::memory_order_acquire);
+    size_t start = currentWriteIndex;
+
+    if (currentWriteIndex >= currentReadIndex)
+    {
+      const size_t spaceAtEnd = capacity - currentWriteIndex;
+
+      // the write index may not catch up with the read index, that would look empty
+      if (spaceAtEnd < recordSize || (spaceAtEnd == recordSize && currentReadIndex == 0))
+      {
+        if (recordSize >= currentReadIndex)
+          return false;
+
+        start = 0; // wrap, the record must be contiguous
+      }
+    }
+    else if (currentReadIndex - currentWriteIndex <= recordSize)
+      return false;
+
+    if (start != currentWriteIndex)
+      WriteHeader(currentWriteIndex, kWrapMarker, 0);
+
+    WriteHeader(start, size, offset);
+
+    if (size)
+      memcpy(mData.Get() + start + kHeaderSize, pData, size);
+
+    size_t nextWriteIndex = start + recordSize;
+
+    if (nextWriteIndex == capacity)
+      nextWriteIndex = 0;
+
+    mWriteIndex.store(nextWriteIndex, std::memory_order_release);
+    return true;
+  }
+
+  void WriteHeader(size_t idx, int32_t size, int32_t offset)
+  {
+    const int32_t header[2] = { size, offset };
+    memcpy(mData.Get() + idx, header, kHeaderSize);
+  }
+
+  void ReadHeader(size_t idx, int32_t& size, int32_t& offset) const
+  {
+    int32_t header[2];
+    memcpy(header, mData.Get() + idx, kHeaderSize);
+    size = header[0];
+    offset = header[1];
+  }
+
+  WDL_TypedBuf<uint8_t> mData;
+  std::atomic<size_t> mWriteIndex{0};
+  std::atomic<size_t> mReadIndex{0};
+  size_t mPeekIndex = 0; // consumer side only
+  std::atomic<uint32_t> mNumFailedPushes{0};
+};
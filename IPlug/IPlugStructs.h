@@ -18,6 +18,7 @@
  */
 
 #include <algorithm>
+#include <cstdint>
 #include "wdlstring.h"
 #include "ptrlist.h"
 
@@ -38,24 +39,17 @@ struct ParamTuple
   {}
 };
 
-/** This structure is used when queueing Sysex messages. You may need to set MAX_SYSEX_SIZE to reflect the max sysex payload in bytes */
-struct SysExData
+/** A parameter change made in the user interface, queued for the audio thread with an estimate of the host sample time at which it was made, see IPlugAPIBase::ProcessParamChangesFromUI().
+ * It has no value: the UI sets the parameter, and the audio thread reads it when it applies the change */
+struct ParamChangeFromUI
 {
-  SysExData(int offset = 0, int size = 0, const void* pData = 0)
-  : mOffset(offset)
-  , mSize(size)
-  {
-    assert(size < MAX_SYSEX_SIZE);
-    
-    if (pData)
-      memcpy(mData, pData, size);
-    else
-      memset(mData, 0, MAX_SYSEX_SIZE);
-  }
-  
-  int mOffset;
-  int mSize;
-  uint8_t mData[MAX_SYSEX_SIZE];
+  int idx;
+  int64_t sampleTime; // in samples processed since the plug-in started processing
+
+  ParamChangeFromUI(int idx = kNoParameter, int64_t sampleTime = 0)
+  : idx(idx)
+  , sampleTime(sampleTime)
+  {}
 };
 
 /** A helper class for IByteChunk and IByteStream that avoids code duplication **/
@@ -399,7 +393,10 @@ struct IChannelData
   TOUT** mData = nullptr; // If this is for an input channel, points into IPlugProcessor::mInData, if it's for an output channel points into IPlugProcessor::mOutData
   TIN* mIncomingData = nullptr;
   WDL_TypedBuf<TOUT> mScratchBuf;
+  WDL_TypedBuf<TIN> mIncomingScratchBuf; // Only allocated in dual precision mode, holds zeros for an unconnected channel
   WDL_String mLabel = WDL_String("");
+  bool mSilenceHint = false; // Set by the API class if the host has flagged this input channel as silent, so it needn't be scanned
+  bool mSilent = false; // Whether this input channel was silent in the current block, only updated when silence detection is enabled
 };
 
 /** Used to manage information about a bus such as whether it's an input or output, channel count and if it has a label */
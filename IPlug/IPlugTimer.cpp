@@ -116,4 +116,242 @@ void CALLBACK Timer_impl::TimerProc(HWND hwnd, UINT uMsg, UINT_PTR idEvent, DWOR
   }
 }
 
+#elif defined OS_LINUX
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <cerrno>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <time.h>
+
+static int64_t MonotonicTimeNs()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+Timer* Timer::Create(ITimerFunction func, uint32_t intervalMs)
+{
+  return new Timer_impl(func, intervalMs);
+}
+
+WDL_Mutex Timer_impl::sMutex;
+WDL_PtrList<Timer_impl> Timer_impl::sTimers;
+
+static int sTimerFD = -1; // guarded by Timer_impl::sMutex
+
+/** The thread that waits on the timerfd, only after UseTimerThread(). Once started it idles between timers, until exit or UseHostRunLoop() */
+static struct TimerThread
+{
+  ~TimerThread() { Stop(); }
+
+  /** Called with mMutex locked */
+  void Start()
+  {
+    if (mStarted.load() || mUseHostRunLoop)
+      return;
+
+    if (mWakeFD < 0)
+      mWakeFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    mThread = std::thread([this]() { Run(); });
+    mStarted.store(true);
+  }
+
+  /** Called with mMutex locked, or at exit */
+  void Stop()
+  {
+    if (!mStarted.load())
+      return;
+
+    mStarted.store(false);
+
+    const uint64_t one = 1;
+    (void) !write(mWakeFD, &one, sizeof(one));
+
+    if (mThread.get_id() == std::this_thread::get_id()) // the last timer was stopped by its own callback
+      mThread.detach();
+    else
+      mThread.join();
+  }
+
+  void Run()
+  {
+    pollfd fds[2] = { { sTimerFD, POLLIN, 0 }, { mWakeFD, POLLIN, 0 } };
+
+    while (true)
+    {
+      if (poll(fds, 2, -1) < 0)
+      {
+        if (errno == EINTR)
+          continue;
+
+        break;
+      }
+
+      if (fds[1].revents & POLLIN)
+      {
+        uint64_t value;
+        (void) !read(mWakeFD, &value, sizeof(value));
+        break;
+      }
+
+      if (fds[0].revents & POLLIN)
+        Timer_impl::ProcessTimers();
+    }
+  }
+
+  std::mutex mMutex; // serializes Start() and Stop(), never taken while holding Timer_impl::sMutex
+  std::atomic<bool> mStarted{false}; // checked first, so that timers created by timer callbacks don't need mMutex
+  std::thread mThread;
+  int mWakeFD = -1;
+  bool mUseHostRunLoop = true;
+} sTimerThread;
+
+Timer_impl::Timer_impl(ITimerFunction func, uint32_t intervalMs)
+: mTimerFunc(func)
+, mIntervalMs(std::max(intervalMs, 1u))
+{
+  {
+    WDL_MutexLock lock(&sMutex);
+
+    if (sTimerFD < 0)
+      sTimerFD = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    if (sTimerFD < 0)
+      return;
+
+    mDeadlineNs = MonotonicTimeNs() + (int64_t) mIntervalMs * 1000000;
+    mRunning = true;
+    sTimers.Add(this);
+    ArmTimerFD();
+  }
+
+  if (!sTimerThread.mStarted.load())
+  {
+    std::lock_guard<std::mutex> lock(sTimerThread.mMutex);
+    sTimerThread.Start();
+  }
+}
+
+Timer_impl::~Timer_impl()
+{
+  Stop();
+}
+
+void Timer_impl::Stop()
+{
+  WDL_MutexLock lock(&sMutex);
+
+  if (!mRunning)
+    return;
+
+  mRunning = false;
+  sTimers.DeletePtr(this);
+  ArmTimerFD();
+}
+
+int Timer_impl::UseHostRunLoop()
+{
+  {
+    std::lock_guard<std::mutex> lock(sTimerThread.mMutex);
+    sTimerThread.mUseHostRunLoop = true;
+    sTimerThread.Stop();
+  }
+
+  WDL_MutexLock lock(&sMutex);
+
+  if (sTimerFD < 0)
+    sTimerFD = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+  return sTimerFD;
+}
+
+void Timer_impl::UseTimerThread()
+{
+  bool haveTimers;
+
+  {
+    WDL_MutexLock lock(&sMutex);
+    haveTimers = sTimers.GetSize() > 0;
+  }
+
+  std::lock_guard<std::mutex> lock(sTimerThread.mMutex);
+  sTimerThread.mUseHostRunLoop = false;
+
+  if (haveTimers)
+    sTimerThread.Start();
+}
+
+void Timer_impl::ArmTimerFD()
+{
+  int64_t earliest = INT64_MAX;
+
+  for (auto i = 0; i < sTimers.GetSize(); i++)
+    earliest = std::min(earliest, sTimers.Get(i)->mDeadlineNs);
+
+  itimerspec spec = {};
+
+  if (earliest != INT64_MAX)
+  {
+    earliest = std::max<int64_t>(earliest, 1); // zero would disarm
+    spec.it_value.tv_sec = (time_t) (earliest / 1000000000);
+    spec.it_value.tv_nsec = (long) (earliest % 1000000000);
+  }
+
+  timerfd_settime(sTimerFD, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+void Timer_impl::ProcessTimers()
+{
+  WDL_MutexLock lock(&sMutex);
+
+  if (sTimerFD < 0)
+    return;
+
+  uint64_t expirations;
+  (void) !read(sTimerFD, &expirations, sizeof(expirations));
+
+  const int64_t now = MonotonicTimeNs();
+  const int64_t coalesceNs = (int64_t) kCoalesceMs * 1000000;
+
+  for (auto i = 0; i < sTimers.GetSize(); i++)
+  {
+    Timer_impl* pTimer = sTimers.Get(i);
+    pTimer->mDue = pTimer->mDeadlineNs <= now + coalesceNs;
+  }
+
+  // callbacks may create or stop timers, so look for the next due one from the start each time
+  while (true)
+  {
+    Timer_impl* pTimer = nullptr;
+
+    for (auto i = 0; i < sTimers.GetSize() && !pTimer; i++)
+    {
+      if (sTimers.Get(i)->mDue)
+        pTimer = sTimers.Get(i);
+    }
+
+    if (!pTimer)
+      break;
+
+    const int64_t intervalNs = (int64_t) pTimer->mIntervalMs * 1000000;
+    pTimer->mDue = false;
+    pTimer->mDeadlineNs += intervalNs;
+
+    if (pTimer->mDeadlineNs <= now) // skip missed ticks, keeping the phase
+      pTimer->mDeadlineNs += ((now - pTimer->mDeadlineNs) / intervalNs + 1) * intervalNs;
+
+    pTimer->mTimerFunc(*pTimer); // may delete pTimer
+  }
+
+  ArmTimerFD();
+}
+
 #endif
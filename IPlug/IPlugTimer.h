@@ -17,9 +17,9 @@
  * rewritten using SWELL: base/source/timer.cpp, so thanks to them 
  * */
 
+#include <cstdlib>
 #include <cstring>
 #include <stdint.h>
-#include <cstring>
 #include <functional>
 #include "ptrlist.h"
 #include "mutex.h"
@@ -96,7 +96,47 @@ private:
   ITimerFunction mTimerFunc;
   uint32_t mIntervalMs;
 };
+#elif defined OS_LINUX
+/** All Linux timers share one timerfd on CLOCK_MONOTONIC, armed for the earliest deadline. Each wakeup services every timer that is due
+ * within kCoalesceMs, so timers that run at similar rates share wakeups. Deadlines advance by whole intervals from the previous deadline,
+ * so the timers don't drift, and ticks missed while the process was stalled are skipped rather than delivered in a burst.
+ * As on the other platforms, timer functions are called on the main thread: the host's run loop (e.g. VST3's Linux IRunLoop) or the
+ * application's event loop must watch the file descriptor returned by UseHostRunLoop(), and call ProcessTimers() when it is readable.
+ * Until then no timer fires. IPlugCLI, which has no event loop, calls ProcessTimers() between blocks, see IPlugCLI::ProcessTimers().
+ * Code that doesn't need main thread callbacks, e.g. a headless tool without an event loop, can call UseTimerThread()
+ * to have the timers serviced on a dedicated thread instead. */
+class Timer_impl : public Timer
+{
+public:
+  Timer_impl(ITimerFunction func, uint32_t intervalMs);
+  ~Timer_impl();
+  void Stop() override;
+
+  /** Have the host's run loop service all timers on the main thread, which is the default. This stops the timer thread, if UseTimerThread() started it
+   * @return The timerfd, which becomes readable when timers are due, or -1 if it could not be created */
+  static int UseHostRunLoop();
+
+  /** Service timers on a dedicated thread, for code that has no run loop. Timer functions are then called on that thread, not the main thread */
+  static void UseTimerThread();
+
+  /** Call the function of each timer that is due. Call this on the main thread when the file descriptor returned by UseHostRunLoop() is readable.
+   * It doesn't block, so it may also be called from an idle callback */
+  static void ProcessTimers();
+
+  static constexpr uint32_t kCoalesceMs = 2;
+
+private:
+  static void ArmTimerFD();
+
+  static WDL_Mutex sMutex;
+  static WDL_PtrList<Timer_impl> sTimers;
+  ITimerFunction mTimerFunc;
+  uint32_t mIntervalMs;
+  int64_t mDeadlineNs = 0; // CLOCK_MONOTONIC
+  bool mDue = false;
+  bool mRunning = false;
+};
 #elif defined OS_WEB
-#elif
+#else
   #error NOT IMPLEMENTED
 #endif
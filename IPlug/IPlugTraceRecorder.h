@@ -0,0 +1,325 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief A lock-free binary event tracer for TRACER_BUILD, cheap enough to use on the audio thread
+ *
+ * To mark the duration of a scope:              TRACE_SCOPE;
+ * To record an instant event:                   TRACE_EVENT;
+ * To record an instant event with two values:   TRACE_VALUES(nFrames, cpuLoad);
+ *
+ * Each thread writes fixed size events (timestamp, interned TRACELOC id, two doubles) to its own ring, and a background thread drains the rings
+ * to TRACEFILE in the home directory. Convert the file to Chrome trace JSON (chrome://tracing, Perfetto) with Scripts/trace_to_chrome.py
+ * The first event at each location, and the first event on each thread, take a lock and allocate; after that recording an event never blocks.
+ * If a ring is full the event is dropped, and the number of dropped events is written to the file.
+ * The drain thread runs while at least one plug-in instance exists, see IPlugTraceRecorder::AddRef()
+ * Unlike Trace(), nothing is formatted, so these macros are not filtered or limited.
+ */
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "ptrlist.h"
+#include "wdlstring.h"
+
+#include "IPlugConstants.h"
+
+/** One trace event, written to the trace file as is */
+struct IPlugTraceEvent
+{
+  enum EType : uint32_t
+  {
+    kInstant = 0,
+    kBegin,
+    kEnd
+  };
+
+  uint64_t mTime; // nanoseconds since the recorder started
+  uint32_t mLocation; // interned TRACELOC id
+  uint32_t mType; // EType
+  double mValues[2];
+};
+
+/** A single producer, single consumer ring of trace events, one per tracing thread */
+class IPlugTraceRing
+{
+public:
+  IPlugTraceRing(uint32_t threadIdx)
+  : mThreadIdx(threadIdx)
+  {
+  }
+
+  /** Called on the owning thread */
+  void Push(const IPlugTraceEvent& event)
+  {
+    const uint32_t writeIdx = mWriteIdx.load(std::memory_order_relaxed);
+
+    if (writeIdx - mReadIdx.load(std::memory_order_acquire) == TRACE_RING_SIZE)
+    {
+      mNumDropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    mEvents[writeIdx & (TRACE_RING_SIZE - 1)] = event;
+    mWriteIdx.store(writeIdx + 1, std::memory_order_release);
+  }
+
+  /** Called on the drain thread
+   * @return The number of events copied to pDest */
+  int Pop(IPlugTraceEvent* pDest, int maxEvents)
+  {
+    const uint32_t readIdx = mReadIdx.load(std::memory_order_relaxed);
+    const uint32_t available = mWriteIdx.load(std::memory_order_acquire) - readIdx;
+    const int n = available < (uint32_t) maxEvents ? (int) available : maxEvents;
+
+    for (auto i = 0; i < n; i++)
+      pDest[i] = mEvents[(readIdx + i) & (TRACE_RING_SIZE - 1)];
+
+    mReadIdx.store(readIdx + n, std::memory_order_release);
+    return n;
+  }
+
+  uint32_t TakeNumDropped() { return mNumDropped.exchange(0, std::memory_order_relaxed); }
+
+  uint32_t GetThreadIdx() const { return mThreadIdx; }
+
+private:
+  static_assert((TRACE_RING_SIZE & (TRACE_RING_SIZE - 1)) == 0, "TRACE_RING_SIZE must be a power of two");
+
+  IPlugTraceEvent mEvents[TRACE_RING_SIZE];
+  std::atomic<uint32_t> mWriteIdx{0};
+  std::atomic<uint32_t> mReadIdx{0};
+  std::atomic<uint32_t> mNumDropped{0};
+  const uint32_t mThreadIdx;
+};
+
+/** The process wide recorder, which owns the rings of all threads that have traced, and the thread that drains them to disk.
+ * File layout: the 8 byte magic "IPTRACE1", then records that each start with a uint32_t ERecord tag:
+ * - kLocationRecord: uint32_t id, int32_t line, uint32_t length, then length chars of function name
+ * - kEventsRecord: uint32_t thread index, uint32_t count, then count IPlugTraceEvents
+ * - kDroppedRecord: uint32_t thread index, uint32_t count of events dropped since the last such record */
+class IPlugTraceRecorder
+{
+public:
+  enum ERecord : uint32_t
+  {
+    kLocationRecord = 1,
+    kEventsRecord,
+    kDroppedRecord
+  };
+
+  static IPlugTraceRecorder& Get()
+  {
+    // never destroyed, so that no static destructor has to stop the drain thread: on Windows that would run under the loader lock
+    static IPlugTraceRecorder* sRecorder = new IPlugTraceRecorder;
+    return *sRecorder;
+  }
+
+  /** Called by each plug-in instance when it is created. The first one starts the drain thread */
+  void AddRef()
+  {
+    std::lock_guard<std::mutex> lock(mThreadMutex);
+
+    if (mNumRefs++ > 0 || !mFP)
+      return;
+
+    mRunning = true;
+    mDrainThread = std::thread([this]() {
+      std::unique_lock<std::mutex> wakeLock(mWakeMutex);
+
+      while (mRunning)
+      {
+        wakeLock.unlock();
+        Drain();
+        wakeLock.lock();
+        mWake.wait_for(wakeLock, std::chrono::milliseconds(10), [this]() { return !mRunning; });
+      }
+    });
+  }
+
+  /** Called by each plug-in instance when it is destroyed. The last one stops the drain thread and writes out everything recorded so far.
+   * Events recorded while no instance exists stay in the rings until the next instance is created */
+  void Release()
+  {
+    std::lock_guard<std::mutex> lock(mThreadMutex);
+
+    if (--mNumRefs > 0 || !mDrainThread.joinable())
+      return;
+
+    {
+      std::lock_guard<std::mutex> wakeLock(mWakeMutex);
+      mRunning = false;
+    }
+
+    mWake.notify_one();
+    mDrainThread.join();
+    Drain();
+  }
+
+  /** Intern a TRACELOC, this locks, so the macros call it once per call site
+   * @return The id written with each event from this location */
+  int RegisterLocation(const char* funcName, int line)
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Location* pLocation = new Location;
+    pLocation->mFuncName.Set(funcName);
+    pLocation->mLine = line;
+    mLocations.Add(pLocation);
+    return mLocations.GetSize() - 1;
+  }
+
+  /** Record an event on the calling thread's ring */
+  void Record(int location, IPlugTraceEvent::EType type, double value1 = 0., double value2 = 0.)
+  {
+    thread_local IPlugTraceRing* tRing = nullptr;
+
+    if (!tRing)
+      tRing = AddRing();
+
+    const uint64_t time = (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - mStartTime).count();
+    tRing->Push({time, (uint32_t) location, (uint32_t) type, {value1, value2}});
+  }
+
+private:
+  struct Location
+  {
+    WDL_String mFuncName;
+    int mLine = 0;
+  };
+
+  IPlugTraceRecorder()
+  : mStartTime(std::chrono::steady_clock::now())
+  {
+    char filePath[1024];
+#ifdef OS_WIN
+    snprintf(filePath, sizeof(filePath), "%s/%s", "C:\\", TRACEFILE);
+#else
+    snprintf(filePath, sizeof(filePath), "%s/%s", getenv("HOME"), TRACEFILE);
+#endif
+    mFP = fopen(filePath, "wb");
+
+    // the file is flushed after each drain, and closed when the process exits
+    if (mFP)
+      fwrite("IPTRACE1", 1, 8, mFP);
+  }
+
+  IPlugTraceRecorder(const IPlugTraceRecorder&) = delete;
+  IPlugTraceRecorder& operator=(const IPlugTraceRecorder&) = delete;
+
+  IPlugTraceRing* AddRing()
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    IPlugTraceRing* pRing = new IPlugTraceRing(mRings.GetSize());
+    mRings.Add(pRing);
+    return pRing;
+  }
+
+  void WriteU32(uint32_t value) { fwrite(&value, sizeof(value), 1, mFP); }
+
+  /** Runs on the drain thread, and in Release() once that has stopped */
+  void Drain()
+  {
+    static const int kChunkSize = 1024;
+    IPlugTraceEvent events[kChunkSize];
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    // locations are registered before their first event is pushed, so writing them first means the file never refers to an unknown id
+    for (; mNumLocationsWritten < mLocations.GetSize(); mNumLocationsWritten++)
+    {
+      const Location* pLocation = mLocations.Get(mNumLocationsWritten);
+      const uint32_t length = (uint32_t) pLocation->mFuncName.GetLength();
+      WriteU32(kLocationRecord);
+      WriteU32(mNumLocationsWritten);
+      WriteU32((uint32_t) pLocation->mLine);
+      WriteU32(length);
+      fwrite(pLocation->mFuncName.Get(), 1, length, mFP);
+    }
+
+    // rings are never removed, so a copy of the list can be read without the lock
+    while (mDrainRings.GetSize() < mRings.GetSize())
+      mDrainRings.Add(mRings.Get(mDrainRings.GetSize()));
+
+    lock.unlock();
+
+    for (auto i = 0; i < mDrainRings.GetSize(); i++)
+    {
+      IPlugTraceRing* pRing = mDrainRings.Get(i);
+      int n;
+
+      while ((n = pRing->Pop(events, kChunkSize)) > 0)
+      {
+        WriteU32(kEventsRecord);
+        WriteU32(pRing->GetThreadIdx());
+        WriteU32((uint32_t) n);
+        fwrite(events, sizeof(IPlugTraceEvent), n, mFP);
+      }
+
+      if (const uint32_t nDropped = pRing->TakeNumDropped())
+      {
+        WriteU32(kDroppedRecord);
+        WriteU32(pRing->GetThreadIdx());
+        WriteU32(nDropped);
+      }
+    }
+
+    fflush(mFP);
+  }
+
+  const std::chrono::steady_clock::time_point mStartTime;
+  FILE* mFP = nullptr;
+  std::mutex mMutex; // guards mLocations and mRings
+  WDL_PtrList<Location> mLocations;
+  WDL_PtrList<IPlugTraceRing> mRings;
+  WDL_PtrList<IPlugTraceRing> mDrainRings; // drain thread
+  int mNumLocationsWritten = 0;
+  std::mutex mThreadMutex; // guards mNumRefs and starting and stopping the drain thread
+  int mNumRefs = 0;
+  std::mutex mWakeMutex; // guards mRunning
+  std::condition_variable mWake;
+  bool mRunning = false;
+  std::thread mDrainThread;
+};
+
+/** Records a begin event when constructed and an end event when destroyed, see TRACE_SCOPE */
+class IPlugTraceScope
+{
+public:
+  IPlugTraceScope(int location)
+  : mLocation(location)
+  {
+    IPlugTraceRecorder::Get().Record(mLocation, IPlugTraceEvent::kBegin);
+  }
+
+  ~IPlugTraceScope()
+  {
+    IPlugTraceRecorder::Get().Record(mLocation, IPlugTraceEvent::kEnd);
+  }
+
+private:
+  int mLocation;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_LOCATION_ID(name) static const int name = IPlugTraceRecorder::Get().RegisterLocation(TRACELOC)
+
+#define TRACE_SCOPE TRACE_LOCATION_ID(TRACE_CONCAT(sTraceLocation, __LINE__)); IPlugTraceScope TRACE_CONCAT(traceScope, __LINE__)(TRACE_CONCAT(sTraceLocation, __LINE__))
+#define TRACE_EVENT do { TRACE_LOCATION_ID(sTraceLocation); IPlugTraceRecorder::Get().Record(sTraceLocation, IPlugTraceEvent::kInstant); } while (0)
+#define TRACE_VALUES(value1, value2) do { TRACE_LOCATION_ID(sTraceLocation); IPlugTraceRecorder::Get().Record(sTraceLocation, IPlugTraceEvent::kInstant, (double) (value1), (double) (value2)); } while (0)
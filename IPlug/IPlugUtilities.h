@@ -30,6 +30,14 @@
 #include "IPlugConstants.h"
 #include "IPlugPlatform.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define IPLUG_CASTCOPY_SSE2
+#elif defined(__aarch64__)
+  #include <arm_neon.h>
+  #define IPLUG_CASTCOPY_NEON
+#endif
+
 #ifdef OS_WIN
 #undef _WIN32_WINNT
 #define _WIN32_WINNT 0x0501
@@ -132,14 +140,14 @@ static inline void GetVersionStr(int version, WDL_String& str)
   str.SetFormatted(MAX_VERSION_STR_LEN, "v%d.%d.%d", ver, rmaj, rmin);
 }
 
-/** /todo  
- * @tparam SRC 
- * @tparam DEST 
- * @param pDest /todo
- * @param pSrc /todo
- * @param n /todo */
+/** Copy n samples from pSrc to pDest, converting each one to the destination type
+ * @tparam SRC The source sample type
+ * @tparam DEST The destination sample type
+ * @param pDest Destination buffer (must not overlap pSrc)
+ * @param pSrc Source buffer
+ * @param n Number of samples to copy */
 template <class SRC, class DEST>
-void CastCopy(DEST* pDest, SRC* pSrc, int n)
+void CastCopy(DEST* pDest, const SRC* pSrc, int n)
 {
   for (int i = 0; i < n; ++i, ++pDest, ++pSrc)
   {
@@ -147,6 +155,57 @@ void CastCopy(DEST* pDest, SRC* pSrc, int n)
   }
 }
 
+/** Widening float to double conversion, four samples per iteration where SSE2 or NEON is available
+ * @param pDest Destination buffer (must not overlap pSrc)
+ * @param pSrc Source buffer
+ * @param n Number of samples to copy */
+static inline void CastCopy(double* pDest, const float* pSrc, int n)
+{
+  int i = 0;
+#if defined IPLUG_CASTCOPY_SSE2
+  for (; i + 4 <= n; i += 4)
+  {
+    const __m128 v = _mm_loadu_ps(pSrc + i);
+    _mm_storeu_pd(pDest + i, _mm_cvtps_pd(v));
+    _mm_storeu_pd(pDest + i + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+  }
+#elif defined IPLUG_CASTCOPY_NEON
+  for (; i + 4 <= n; i += 4)
+  {
+    const float32x4_t v = vld1q_f32(pSrc + i);
+    vst1q_f64(pDest + i, vcvt_f64_f32(vget_low_f32(v)));
+    vst1q_f64(pDest + i + 2, vcvt_high_f64_f32(v));
+  }
+#endif
+  for (; i < n; ++i)
+    pDest[i] = (double) pSrc[i];
+}
+
+/** Narrowing double to float conversion, four samples per iteration where SSE2 or NEON is available
+ * @param pDest Destination buffer (must not overlap pSrc)
+ * @param pSrc Source buffer
+ * @param n Number of samples to copy */
+static inline void CastCopy(float* pDest, const double* pSrc, int n)
+{
+  int i = 0;
+#if defined IPLUG_CASTCOPY_SSE2
+  for (; i + 4 <= n; i += 4)
+  {
+    const __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(pSrc + i));
+    const __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(pSrc + i + 2));
+    _mm_storeu_ps(pDest + i, _mm_movelh_ps(lo, hi));
+  }
+#elif defined IPLUG_CASTCOPY_NEON
+  for (; i + 4 <= n; i += 4)
+  {
+    const float32x2_t lo = vcvt_f32_f64(vld1q_f64(pSrc + i));
+    vst1q_f32(pDest + i, vcvt_high_f32_f64(lo, vld1q_f64(pSrc + i + 2)));
+  }
+#endif
+  for (; i < n; ++i)
+    pDest[i] = (float) pSrc[i];
+}
+
 /** /todo  
  * @param cDest /todo
  * @param cSrc /todo */
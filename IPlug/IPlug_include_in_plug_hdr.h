@@ -70,6 +70,10 @@
 #elif defined WEB_API
   #include "IPlugWeb.h"
   using IPlug = IPlugWeb;
+#elif defined CLI_API
+  #include "IPlugCLI.h"
+  using IPlug = IPlugCLI;
+  #define API_EXT "cli"
 #elif defined VST3_API
   #define IPLUG_VST3
   #include "IPlugVST3.h"
@@ -98,7 +102,7 @@
   #define BUNDLE_ID BUNDLE_DOMAIN "." BUNDLE_MFR "." API_EXT "." BUNDLE_NAME API_EXT2
   #define EXPORT __attribute__ ((visibility("default")))
 #elif defined OS_LINUX
-  //TODO:
+  #define BUNDLE_ID ""
 #elif defined OS_WEB
   #define BUNDLE_ID ""
 #else
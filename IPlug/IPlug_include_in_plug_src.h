@@ -335,6 +335,13 @@ extern "C"
       return (void*) pWAM;
     }
   }
+#pragma mark - CLI
+#elif defined CLI_API
+  IPlug* MakePlug()
+  {
+    IPlugInstanceInfo instanceInfo;
+    return new PLUG_CLASS_NAME(instanceInfo);
+  }
 #pragma mark - WEB
 #elif defined WEB_API
 #include <memory>
@@ -822,6 +822,8 @@ void IPlugVST2::VSTPreProcess(SAMPLETYPE** inputs, SAMPLETYPE** outputs, VstInt3
 
   SetTimeInfo(timeInfo);
   SetRenderingOffline(renderingOffline);
+  ProcessParamChangesFromUI(nFrames, GetSampleRate());
+  ProcessMessagesFromBus();
 
   IMidiMsg msg;
 
@@ -836,6 +838,7 @@ void VSTCALLBACK IPlugVST2::VSTProcess(AEffect* pEffect, float** inputs, float**
 {
   TRACE;
   IPlugVST2* _this = (IPlugVST2*) pEffect->object;
+  IPerformanceCounters::ScopedBlock perfBlock(_this->mPerformanceCounters, nFrames, _this->GetSampleRate());
   _this->VSTPreProcess(inputs, outputs, nFrames);
   _this->ProcessBuffersAccumulating(nFrames);
   _this->OutputSysexFromEditor();
@@ -845,6 +848,7 @@ void VSTCALLBACK IPlugVST2::VSTProcessReplacing(AEffect* pEffect, float** inputs
 {
   TRACE;
   IPlugVST2* _this = (IPlugVST2*) pEffect->object;
+  IPerformanceCounters::ScopedBlock perfBlock(_this->mPerformanceCounters, nFrames, _this->GetSampleRate());
   _this->VSTPreProcess(inputs, outputs, nFrames);
   _this->ProcessBuffers((float) 0.0f, nFrames);
   _this->OutputSysexFromEditor();
@@ -854,6 +858,7 @@ void VSTCALLBACK IPlugVST2::VSTProcessDoubleReplacing(AEffect* pEffect, double**
 {
   TRACE;
   IPlugVST2* _this = (IPlugVST2*) pEffect->object;
+  IPerformanceCounters::ScopedBlock perfBlock(_this->mPerformanceCounters, nFrames, _this->GetSampleRate());
   _this->VSTPreProcess(inputs, outputs, nFrames);
   _this->ProcessBuffers((double) 0.0, nFrames);
   _this->OutputSysexFromEditor();
@@ -891,12 +896,15 @@ void VSTCALLBACK IPlugVST2::VSTSetParameter(AEffect *pEffect, VstInt32 idx, floa
 void IPlugVST2::OutputSysexFromEditor()
 {
   //Output SYSEX from the editor, which has bypassed ProcessSysEx()
-  if(mSysExDataFromEditor.ElementsAvailable())
+  if(!mSysExDataFromEditor.WasEmpty())
   {
-    while (mSysExDataFromEditor.Pop(mSysexBuf))
+    ISysEx smsg;
+
+    while (mSysExDataFromEditor.Read(smsg))
     {
-      ISysEx smsg {mSysexBuf.mOffset, mSysexBuf.mData, mSysexBuf.mSize};
       SendSysEx(smsg);
     }
+
+    mSysExDataFromEditor.Release();
   }
 }
@@ -89,7 +89,10 @@ tresult PLUGIN_API IPlugVST3::process(ProcessData& data)
 {
   TRACE;
 
-  Process(data, processSetup, audioInputs, audioOutputs, mMidiMsgsFromEditor, mMidiMsgsFromProcessor, mSysExDataFromEditor, mSysexBuf);
+  IPerformanceCounters::ScopedBlock perfBlock(mPerformanceCounters, data.numSamples, GetSampleRate());
+  ProcessParamChangesFromUI(data.numSamples, GetSampleRate());
+  ProcessMessagesFromBus();
+  Process(data, processSetup, audioInputs, audioOutputs, mMidiMsgsFromEditor, mMidiMsgsFromProcessor, mSysExDataFromEditor);
   return kResultOk;
 }
 
@@ -269,6 +272,12 @@ bool IPlugVST3::EditorResizeFromDelegate(int viewWidth, int viewHeight)
   return true;
 }
 
+void IPlugVST3::GetPerformanceStats(IPerformanceStats& stats) const
+{
+  IPlugAPIBase::GetPerformanceStats(stats);
+  stats.mNumMidiQueueOverflows += GetNumDroppedMidiOutputMsgs();
+}
+
 void IPlugVST3::DirtyParametersFromUI()
 {
   startGroupEdit();
@@ -59,6 +59,7 @@ public:
   void InformHostOfProgramChange() override {}
   void InformHostOfParameterDetailsChange() override;
   bool EditorResizeFromDelegate(int viewWidth, int viewHeight) override;
+  void GetPerformanceStats(IPerformanceStats& stats) const override;
 
   // IEditorDelegate
   void DirtyParametersFromUI() override;
@@ -273,3 +273,22 @@ void IPlugVST3Controller::SendArbitraryMsgFromUI(int messageTag, int controlTag,
   message->getAttributes()->setBinary("D", pData, dataSize);
   sendMessage(message);
 }
+
+bool IPlugVST3Controller::SendMessageToProcessor(int messageTag, int controlTag, int dataSize, const void* pData, int timeoutMs)
+{
+  // the controller's own message bus has no consumer, the message is pushed to the processor's bus when the processor receives it
+  OPtr<IMessage> message = allocateMessage();
+  
+  if (!message)
+    return false;
+  
+  const uint8_t dummy = 0; // allow sending messages with no data
+  
+  message->setMessageID("SMTP");
+  message->getAttributes()->setInt("MT", messageTag);
+  message->getAttributes()->setInt("CT", controlTag);
+  message->getAttributes()->setInt("TO", timeoutMs);
+  message->getAttributes()->setInt("S", dataSize);
+  message->getAttributes()->setBinary("D", dataSize > 0 ? pData : &dummy, dataSize > 0 ? dataSize : 1);
+  return sendMessage(message) == kResultOk;
+}
@@ -75,6 +75,7 @@ public:
   void InformHostOfProgramChange() override  { /* TODO: */}
   bool EditorResizeFromDelegate(int viewWidth, int viewHeight) override;
   void DirtyParametersFromUI() override;
+  bool SendMessageToProcessor(int messageTag, int controlTag, int dataSize, const void* pData, int timeoutMs = 0) override;
   
   // IEditorDelegate
   void SendMidiMsgFromUI(const IMidiMsg& msg) override;
@@ -71,7 +71,9 @@ tresult PLUGIN_API IPlugVST3Processor::process(ProcessData& data)
 {
   TRACE;
   
-  Process(data, processSetup, audioInputs, audioOutputs, mMidiMsgsFromEditor, mMidiMsgsFromProcessor, mSysExDataFromEditor, mSysexBuf);
+  IPerformanceCounters::ScopedBlock perfBlock(mPerformanceCounters, data.numSamples, GetSampleRate());
+  ProcessMessagesFromBus();
+  Process(data, processSetup, audioInputs, audioOutputs, mMidiMsgsFromEditor, mMidiMsgsFromProcessor, mSysExDataFromEditor);
   return kResultOk;
 }
 
@@ -145,6 +147,12 @@ void IPlugVST3Processor::SendArbitraryMsgFromDelegate(int messageTag, int dataSi
   sendMessage(message);
 }
 
+void IPlugVST3Processor::GetPerformanceStats(IPerformanceStats& stats) const
+{
+  IPlugAPIBase::GetPerformanceStats(stats);
+  stats.mNumMidiQueueOverflows += GetNumDroppedMidiOutputMsgs();
+}
+
 #pragma mark IConnectionPoint override
 
 tresult PLUGIN_API IPlugVST3Processor::notify(IMessage* message)
@@ -188,6 +196,20 @@ tresult PLUGIN_API IPlugVST3Processor::notify(IMessage* message)
       return kResultFalse;
     }
   }
+  else if (!strcmp(message->getMessageID(), "SMTP")) // message for the message bus, see IPlugVST3Controller::SendMessageToProcessor()
+  {
+    int64 messageTag, controlTag, timeoutMs, dataSize;
+
+    if (message->getAttributes()->getInt("MT", messageTag) == kResultOk && message->getAttributes()->getInt("CT", controlTag) == kResultOk &&
+        message->getAttributes()->getInt("TO", timeoutMs) == kResultOk && message->getAttributes()->getInt("S", dataSize) == kResultOk &&
+        message->getAttributes()->getBinary("D", data, size) == kResultOk && (int64) size >= dataSize)
+    {
+      if (IPlugAPIBase::SendMessageToProcessor((int) messageTag, (int) controlTag, (int) dataSize, dataSize > 0 ? data : nullptr, (int) timeoutMs))
+        return kResultOk;
+    }
+
+    return kResultFalse;
+  }
   
   return AudioEffect::notify(message);
 }
@@ -206,7 +228,7 @@ void IPlugVST3Processor::TransmitMidiMsgFromProcessor(const IMidiMsg& msg)
   sendMessage(message);
 }
 
-void IPlugVST3Processor::TransmitSysExDataFromProcessor(const SysExData& data)
+void IPlugVST3Processor::TransmitSysExDataFromProcessor(const ISysEx& msg)
 {
   OPtr<IMessage> message = allocateMessage();
   
@@ -214,7 +236,7 @@ void IPlugVST3Processor::TransmitSysExDataFromProcessor(const SysExData& data)
     return;
   
   message->setMessageID("SSMFD");
-  message->getAttributes()->setBinary("D", (void*) data.mData, data.mSize);
-  message->getAttributes()->setInt("O", data.mOffset);
+  message->getAttributes()->setBinary("D", (void*) msg.mData, msg.mSize);
+  message->getAttributes()->setInt("O", msg.mOffset);
   sendMessage(message);
 }
@@ -63,16 +63,18 @@ public:
   void SendControlMsgFromDelegate(int controlTag, int messageTag, int dataSize, const void* pData) override;
   void SendParameterValueFromDelegate(int paramIdx, double value, bool normalized) override {} // NOOP in VST3 processor -> param change gets there via IPlugVST3Controller::setParamNormalized
   void SendArbitraryMsgFromDelegate(int messageTag, int dataSize = 0, const void* pData = nullptr) override;
+
+  // IPlugAPIBase
+  void GetPerformanceStats(IPerformanceStats& stats) const override;
   
 private:
   void TransmitMidiMsgFromProcessor(const IMidiMsg& msg) override;
-  void TransmitSysExDataFromProcessor(const SysExData& data) override;
+  void TransmitSysExDataFromProcessor(const ISysEx& msg) override;
 
   // IConnectionPoint
   tresult PLUGIN_API notify(IMessage* message) override;
   
   ParameterChanges mOutputParamChanges;
-  IMidiQueue mMidiOutputQueue;
 };
 
 IPlugVST3Processor* MakeProcessor();
@@ -56,6 +56,7 @@ IPlugVST3ProcessorBase::IPlugVST3ProcessorBase(IPlugConfig c, IPlugAPIBase& plug
   if (MaxNChannels(ERoute::kInput))
   {
     mLatencyDelay = std::unique_ptr<NChanDelayLine<PLUG_SAMPLE_DST>>(new NChanDelayLine<PLUG_SAMPLE_DST>(MaxNChannels(ERoute::kInput), MaxNChannels(ERoute::kOutput)));
+    mLatencyDelay->SetMaxDelayTime(MAX_LATENCY);
     mLatencyDelay->SetDelayTime(GetLatency());
   }
   
@@ -119,7 +120,7 @@ void IPlugVST3ProcessorBase::ProcessMidiIn(IEventList* eventList, IPlugQueue<IMi
   }
 }
 
-void IPlugVST3ProcessorBase::ProcessMidiOut(IPlugQueue<SysExData>& sysExQueue, SysExData& sysExBuf, IEventList* outputEvents, int32 numSamples)
+void IPlugVST3ProcessorBase::ProcessMidiOut(IPlugSysExQueue& sysExQueue, IEventList* outputEvents, int32 numSamples)
 {
   // MIDI
   if (!mMidiOutputQueue.Empty() && outputEvents)
@@ -187,17 +188,21 @@ void IPlugVST3ProcessorBase::ProcessMidiOut(IPlugQueue<SysExData>& sysExQueue, S
   mMidiOutputQueue.Flush(numSamples);
   
   // Output SYSEX from the editor, which has bypassed the processors' ProcessSysEx()
-  if (sysExQueue.ElementsAvailable())
+  // The host reads the event data after process() returns, so the messages sent in the previous block are only released now
+  sysExQueue.Release();
+  
+  if (!sysExQueue.WasEmpty())
   {
     Event toAdd = {0};
+    ISysEx smsg;
     
-    while (sysExQueue.Pop(sysExBuf))
+    while (sysExQueue.Read(smsg))
     {
       toAdd.type = Event::kDataEvent;
-      toAdd.sampleOffset = sysExBuf.mOffset;
+      toAdd.sampleOffset = smsg.mOffset;
       toAdd.data.type = DataEvent::kMidiSysEx;
-      toAdd.data.size = sysExBuf.mSize;
-      toAdd.data.bytes = (uint8*) sysExBuf.mData; // TODO!  this is a problem if more than one message in this block!
+      toAdd.data.size = smsg.mSize;
+      toAdd.data.bytes = (uint8*) smsg.mData; // points into the queue, valid until the next block
       outputEvents->addEvent(toAdd);
     }
   }
@@ -254,6 +259,9 @@ void IPlugVST3ProcessorBase::AttachBuffers(ERoute direction, int idx, int n, Aud
     IPlugProcessor::AttachBuffers(direction, idx, n, pBus.channelBuffers32, nFrames);
   else if (sampleSize == kSample64)
     IPlugProcessor::AttachBuffers(direction, idx, n, pBus.channelBuffers64, nFrames);
+
+  if (direction == ERoute::kInput)
+    SetInputSilenceFlags(idx, n, pBus.silenceFlags);
 }
 
 bool IPlugVST3ProcessorBase::SetupProcessing(const ProcessSetup& setup, ProcessSetup& storedSetup)
@@ -423,10 +431,18 @@ void IPlugVST3ProcessorBase::ProcessAudio(ProcessData& data, ProcessSetup& setup
       else
         ProcessBuffers(0.0, data.numSamples); // double precision
     }
+
+    const bool outputsSilent = !GetBypassed() && GetOutputsSilent();
+
+    for (int outBus = 0; outBus < data.numOutputs; outBus++)
+    {
+      const int busChannels = data.outputs[outBus].numChannels;
+      data.outputs[outBus].silenceFlags = outputsSilent ? (busChannels < 64 ? (1ULL << busChannels) - 1 : ~0ULL) : 0;
+    }
   }
 }
 
-void IPlugVST3ProcessorBase::Process(ProcessData& data, ProcessSetup& setup, const BusList& ins, const BusList& outs, IPlugQueue<IMidiMsg>& fromEditor, IPlugQueue<IMidiMsg>& fromProcessor, IPlugQueue<SysExData>& sysExFromEditor, SysExData& sysExBuf)
+void IPlugVST3ProcessorBase::Process(ProcessData& data, ProcessSetup& setup, const BusList& ins, const BusList& outs, IPlugQueue<IMidiMsg>& fromEditor, IPlugQueue<IMidiMsg>& fromProcessor, IPlugSysExQueue& sysExFromEditor)
 {
   PrepareProcessContext(data, setup);
   ProcessParameterChanges(data);
@@ -440,12 +456,11 @@ void IPlugVST3ProcessorBase::Process(ProcessData& data, ProcessSetup& setup, con
   
   if (DoesMIDIOut())
   {
-    ProcessMidiOut(sysExFromEditor, sysExBuf, data.outputEvents, data.numSamples);
+    ProcessMidiOut(sysExFromEditor, data.outputEvents, data.numSamples);
   }
 }
 
 bool IPlugVST3ProcessorBase::SendMidiMsg(const IMidiMsg& msg)
 {
-  mMidiOutputQueue.Add(msg);
-  return true;
+  return mMidiOutputQueue.Add(msg);
 }
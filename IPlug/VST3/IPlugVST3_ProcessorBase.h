@@ -79,7 +79,7 @@ public:
   
   // MIDI Processing
   void ProcessMidiIn(Vst::IEventList* eventList, IPlugQueue<IMidiMsg>& editorQueue, IPlugQueue<IMidiMsg>& processorQueue);
-  void ProcessMidiOut(IPlugQueue<SysExData>& sysExQueue, SysExData& sysExBuf, Vst::IEventList* outputEvents, int32 numSamples);
+  void ProcessMidiOut(IPlugSysExQueue& sysExQueue, Vst::IEventList* outputEvents, int32 numSamples);
   
   // Audio Processing Setup
   void SetBusArrangments(Vst::SpeakerArrangement* pInputBusArrangements, int32 numInBuses, Vst::SpeakerArrangement* pOutputBusArrangements, int32 numOutBuses);
@@ -91,14 +91,17 @@ public:
   void PrepareProcessContext(Vst::ProcessData& data, Vst::ProcessSetup& setup);
   void ProcessParameterChanges(Vst::ProcessData& data);
   void ProcessAudio(Vst::ProcessData& data, Vst::ProcessSetup& setup, const Vst::BusList& ins, const Vst::BusList& outs);
-  void Process(Vst::ProcessData& data, Vst::ProcessSetup& setup, const Vst::BusList& ins, const Vst::BusList& outs, IPlugQueue<IMidiMsg>& fromEditor, IPlugQueue<IMidiMsg>& fromProcessor, IPlugQueue<SysExData>& sysExFromEditor, SysExData& sysExBuf);
+  void Process(Vst::ProcessData& data, Vst::ProcessSetup& setup, const Vst::BusList& ins, const Vst::BusList& outs, IPlugQueue<IMidiMsg>& fromEditor, IPlugQueue<IMidiMsg>& fromProcessor, IPlugSysExQueue& sysExFromEditor);
   
   // IPlugProcessor overrides
   bool SendMidiMsg(const IMidiMsg& msg) override;
 
+  /** @return The number of MIDI messages that SendMidiMsg() dropped because the output queue was full */
+  int GetNumDroppedMidiOutputMsgs() const { return mMidiOutputQueue.GetNumDropped(); }
+
 private:
   IPlugAPIBase& mPlug;
   Vst::ProcessContext mProcessContext;
-  IMidiQueue mMidiOutputQueue;
+  IMidiQueue mMidiOutputQueue { DEFAULT_BLOCK_SIZE, IMidiQueue::kDropNewest }; // sized by SetupProcessing(), so that SendMidiMsg() never allocates on the audio thread
   bool mSidechainActive = false;
 };
@@ -57,11 +57,13 @@ const char* IPlugWAM::init(uint32_t bufsize, uint32_t sr, void* pDesc)
 void IPlugWAM::onProcess(WAM::AudioBus* pAudio, void* pData)
 {
   const int blockSize = GetBlockSize();
+  IPerformanceCounters::ScopedBlock perfBlock(mPerformanceCounters, blockSize, GetSampleRate());
   
   SetChannelConnections(ERoute::kInput, 0, MaxNChannels(ERoute::kInput), !IsInstrument()); //TODO: go elsewhere
   SetChannelConnections(ERoute::kOutput, 0, MaxNChannels(ERoute::kOutput), true); //TODO: go elsewhere
   AttachBuffers(ERoute::kInput, 0, NChannelsConnected(ERoute::kInput), pAudio->inputs, blockSize);
   AttachBuffers(ERoute::kOutput, 0, NChannelsConnected(ERoute::kOutput), pAudio->outputs, blockSize);
+  ProcessMessagesFromBus();
   ProcessBuffers((float) 0.0f, blockSize);
   
   //emulate IPlugAPIBase::OnTimer - should be called on the main thread - how to do that in audio worklet processor?
@@ -0,0 +1,88 @@
+# Converts a binary trace written by IPlugTraceRecorder (TRACER_BUILD) to Chrome trace event JSON,
+# which can be opened in chrome://tracing or https://ui.perfetto.dev
+# usage: python trace_to_chrome.py ~/IPlugTrace.bin [trace.json]
+
+import sys, struct, json
+
+LOCATION_RECORD = 1
+EVENTS_RECORD = 2
+DROPPED_RECORD = 3
+
+EVENT_FORMAT = '<QII2d'
+EVENT_SIZE = struct.calcsize(EVENT_FORMAT)
+PHASES = { 0: 'i', 1: 'B', 2: 'E' }
+
+def read_trace(path):
+  with open(path, 'rb') as f:
+    data = f.read()
+
+  if data[:8] != b'IPTRACE1':
+    raise ValueError(path + ' is not an IPlug trace file')
+
+  locations = {}
+  events = []
+  dropped = {}
+  pos = 8
+
+  # a trace from a process that was killed may end with a partial record
+  while pos + 4 <= len(data):
+    tag, = struct.unpack_from('<I', data, pos)
+    pos += 4
+
+    if tag == LOCATION_RECORD:
+      if pos + 12 > len(data): break
+      loc, line, length = struct.unpack_from('<IiI', data, pos)
+      pos += 12
+      name = data[pos:pos + length].decode('utf-8', 'replace')
+      pos += length
+      locations[loc] = '%s:%d' % (name, line)
+    elif tag == EVENTS_RECORD:
+      if pos + 8 > len(data): break
+      thread, count = struct.unpack_from('<II', data, pos)
+      pos += 8
+      count = min(count, (len(data) - pos) // EVENT_SIZE)
+      for i in range(count):
+        time, loc, phase, value1, value2 = struct.unpack_from(EVENT_FORMAT, data, pos)
+        pos += EVENT_SIZE
+        events.append((time, thread, loc, phase, value1, value2))
+    elif tag == DROPPED_RECORD:
+      if pos + 8 > len(data): break
+      thread, count = struct.unpack_from('<II', data, pos)
+      pos += 8
+      dropped[thread] = dropped.get(thread, 0) + count
+    else:
+      raise ValueError('unknown record %d at offset %d' % (tag, pos - 4))
+
+  return locations, events, dropped
+
+def main():
+  locations, events, dropped = read_trace(sys.argv[1])
+  output = sys.argv[2] if len(sys.argv) > 2 else 'trace.json'
+
+  events.sort(key=lambda e: e[0])
+  threads = sorted(set(e[1] for e in events))
+
+  trace = []
+
+  for thread in threads:
+    trace.append({ 'name': 'thread_name', 'ph': 'M', 'pid': 0, 'tid': thread, 'args': { 'name': 'thread %d' % thread } })
+
+  for time, thread, loc, phase, value1, value2 in events:
+    event = { 'name': locations.get(loc, 'location %d' % loc), 'ph': PHASES.get(phase, 'i'), 'ts': time / 1000.0, 'pid': 0, 'tid': thread }
+
+    if phase == 0:
+      event['s'] = 't'
+      event['args'] = { 'value1': value1, 'value2': value2 }
+
+    trace.append(event)
+
+  with open(output, 'w') as f:
+    json.dump({ 'traceEvents': trace, 'displayTimeUnit': 'ns' }, f)
+
+  print('wrote %d events on %d threads to %s' % (len(events), len(threads), output))
+
+  for thread, count in sorted(dropped.items()):
+    print('thread %d dropped %d events, its ring was full' % (thread, count))
+
+if __name__ == '__main__':
+  main()
@@ -3,6 +3,8 @@
 
 #include "IControls.h"
 
+#include <chrono>
+
 IGraphicsStressTest::IGraphicsStressTest(IPlugInstanceInfo instanceInfo)
 : IPLUG_CTOR(kNumParams, 1, instanceInfo)
 {
@@ -55,10 +57,11 @@ void IGraphicsStressTest::LayoutUI(IGraphics* pGraphics)
     GetUI()->SetAllControlsDirty();
   };
   
-  pGraphics->SetKeyHandlerFunc([DoFunc](const IKeyPress& key, bool isUp)
+  pGraphics->SetKeyHandlerFunc([this, DoFunc](const IKeyPress& key, bool isUp)
   {
     if(!isUp) {
       switch (key.VK) {
+        case kVK_B: BenchmarkControlIteration(); return true;
         case kVK_UP: DoFunc(EFunc::More); return true;
         case kVK_DOWN: DoFunc(EFunc::Less); return true;
         case kVK_TAB: key.S ? DoFunc(EFunc::Prev) : DoFunc(EFunc::Next); return true;
@@ -152,4 +155,58 @@ void IGraphicsStressTest::LayoutUI(IGraphics* pGraphics)
   }
 
 }
+
+void IGraphicsStressTest::BenchmarkControlIteration()
+{
+  IGraphics* pGraphics = GetUI();
+  const int firstIdx = pGraphics->NControls();
+  const bool pollAll = pGraphics->GetPollAllControls();
+  WDL_String result;
+  
+  auto timeUs = [](auto func) {
+    const int nReps = 100;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int rep=0; rep<nReps; rep++)
+      func();
+    return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count() / nReps;
+  };
+  
+  for (auto nControls : {1000, 10000})
+  {
+    for (int i=0; i<nControls; i++)
+      pGraphics->AttachControl(new IPanelControl(IRECT(), COLOR_TRANSPARENT), kNoTag, "benchmark");
+    
+    int nVisible = 0;
+    
+    const double forAll = timeUs([&]() {
+      pGraphics->ForAllControlsFunc([&nVisible](IControl& control) { nVisible += control.IsHidden() ? 0 : 1; });
+    });
+    
+    const double inGroup = timeUs([&]() {
+      pGraphics->ForControlInGroup("benchmark", [&nVisible](IControl& control) { nVisible += control.IsHidden() ? 0 : 1; });
+    });
+    
+    const double allDirty = timeUs([&]() {
+      IRECTList rects;
+      pGraphics->SetAllControlsDirty();
+      pGraphics->IsDirty(rects);
+      pGraphics->SetAllControlsClean();
+    });
+    
+    pGraphics->SetPollAllControls(true);
+    const double idlePollAll = timeUs([&]() { IRECTList rects; pGraphics->IsDirty(rects); });
+    pGraphics->SetPollAllControls(false);
+    const double idlePollMarked = timeUs([&]() { IRECTList rects; pGraphics->IsDirty(rects); });
+    pGraphics->SetPollAllControls(pollAll);
+    
+    result.AppendFormatted(1024, "%i controls: ForAllControlsFunc %.1f us, ForControlInGroup %.1f us, all dirty frame %.1f us, idle frame %.1f us (%.1f us with SetPollAllControls(false))\n",
+                           nControls, forAll, inGroup, allDirty, idlePollAll, idlePollMarked);
+    
+    pGraphics->RemoveControls(firstIdx);
+  }
+  
+  DBGMSG("%s", result.Get());
+  pGraphics->ShowMessageBox(result.Get(), "Control iteration", kMB_OK);
+  pGraphics->SetAllControlsDirty();
+}
 #endif
@@ -25,6 +25,8 @@ public:
   IGraphicsStressTest(IPlugInstanceInfo instanceInfo);
 #if IPLUG_EDITOR
   void LayoutUI(IGraphics* pGraphics) override;
+  /** Times control iteration, dirty tracking and idle frames with 1k and 10k extra controls attached, press B to run it */
+  void BenchmarkControlIteration();
 public:
   int mNumberOfThings = 16;
   int mKindOfThing = 0;
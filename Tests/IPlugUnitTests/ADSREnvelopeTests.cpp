@@ -0,0 +1,259 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// first, to check that the header is self-contained
+#include "ADSREnvelope.h"
+
+#include "IPlugUnitTests.h"
+
+template <typename T>
+static void SetRandomTimes(TestRandom& rand, ADSREnvelope<T>& env)
+{
+  // mostly short stages, so that many transitions land inside blocks
+  env.SetStageTime(ADSREnvelope<T>::kAttack, (T) (0.01 + rand.Int(2000) * 0.01));
+  env.SetStageTime(ADSREnvelope<T>::kDecay, (T) (0.01 + rand.Int(5000) * 0.01));
+  env.SetStageTime(ADSREnvelope<T>::kRelease, (T) (0.01 + rand.Int(5000) * 0.01));
+}
+
+/** Drive two envelopes with the same random start, release, retrigger and kill sequence, one with Process() and one with ProcessBlock() in random block sizes
+ * @param expected Filled with the output of Process()
+ * @param output Filled with the output of ProcessBlock()
+ * @return The number of blocks after which GetBusy() differed */
+template <typename T>
+static int CompareBlockWithProcess(uint32_t seed, bool sustainBuffer, std::vector<T>& expected, std::vector<T>& output, int& nResetsProcess, int& nResetsBlock)
+{
+  TestRandom rand(seed);
+  ADSREnvelope<T> perSample("", [&]() { nResetsProcess++; });
+  ADSREnvelope<T> block("", [&]() { nResetsBlock++; });
+  std::vector<T> sustain(512);
+  int busyDiffers = 0;
+  expected.clear();
+  output.clear();
+
+  for (auto env : { &perSample, &block })
+    env->SetSampleRate(48000.);
+
+  for (auto step = 0; step < 400; step++)
+  {
+    switch (rand.Int(8))
+    {
+      case 0:
+      {
+        const T level = (T) (0.2 + 0.8 * std::abs(rand.Bipolar()));
+        perSample.Start(level);
+        block.Start(level);
+        break;
+      }
+      case 1:
+        perSample.Release();
+        block.Release();
+        break;
+      case 2:
+      {
+        const T level = (T) std::abs(rand.Bipolar());
+        perSample.Retrigger(level);
+        block.Retrigger(level);
+        break;
+      }
+      case 3:
+      {
+        const bool hard = rand.Int(2) == 0;
+        perSample.Kill(hard);
+        block.Kill(hard);
+        break;
+      }
+      case 4:
+      {
+        const uint32_t timesSeed = rand.Next();
+        TestRandom timesRand(timesSeed), timesRand2(timesSeed);
+        SetRandomTimes(timesRand, perSample);
+        SetRandomTimes(timesRand2, block);
+        break;
+      }
+      default:
+        break;
+    }
+
+    const int nFrames = 1 + rand.Int(512);
+    const T constantSustain = (T) std::abs(rand.Bipolar());
+    const size_t start = output.size();
+    expected.resize(start + nFrames);
+    output.resize(start + nFrames);
+
+    for (auto s = 0; s < nFrames; s++)
+      sustain[s] = sustainBuffer ? (T) (0.5 + 0.5 * std::sin(0.01 * (step * 512 + s))) : constantSustain;
+
+    for (auto s = 0; s < nFrames; s++)
+      expected[start + s] = perSample.Process(sustain[s]);
+
+    if (sustainBuffer)
+      block.ProcessBlock(output.data() + start, sustain.data(), nFrames);
+    else
+      block.ProcessBlock(output.data() + start, constantSustain, nFrames);
+
+    busyDiffers += block.GetBusy() != perSample.GetBusy();
+  }
+
+  return busyDiffers;
+}
+
+/** @return The largest difference between each output sample and the closest of the expected samples up to maxShift either side */
+template <typename T, typename U>
+static double MaxShiftedError(const std::vector<T>& expected, const std::vector<U>& output, int maxShift)
+{
+  double maxError = 0.;
+
+  for (auto s = 0; s < (int) output.size(); s++)
+  {
+    double error = 1e9;
+
+    for (auto i = std::max(0, s - maxShift); i <= std::min((int) expected.size() - 1, s + maxShift); i++)
+      error = std::min(error, std::abs((double) output[s] - (double) expected[i]));
+
+    maxError = std::max(maxError, error);
+  }
+
+  return maxError;
+}
+
+// the closed form in ProcessBlock() rounds differently from the recursion in Process(), so a stage can end a sample apart when the envelope is
+// right at a threshold. At the end of a decay or release that only changes the output by up to ENV_VALUE_LOW
+UNIT_TEST(ADSREnvelopeBlockMatchesProcess)
+{
+  std::vector<double> expected, output;
+
+  for (uint32_t seed = 1; seed <= 20; seed++)
+  {
+    for (auto sustainBuffer : { false, true })
+    {
+      int nResetsProcess = 0, nResetsBlock = 0;
+      CHECK(CompareBlockWithProcess(seed, sustainBuffer, expected, output, nResetsProcess, nResetsBlock) == 0);
+      CHECK(MaxShiftedError(expected, output, 0) <= ADSREnvelope<double>::ENV_VALUE_LOW);
+      CHECK(nResetsBlock == nResetsProcess);
+    }
+  }
+}
+
+// in float, Process() accumulates rounding over a long decay, by up to about 1% here, while ProcessBlock() raises one multiplier to a power.
+// So float ProcessBlock() is checked against double Process(), allowing for a stage to end a sample apart, with a constant sustain level so that
+// a shifted stage still lines up
+UNIT_TEST(ADSREnvelopeBlockMatchesProcessFloat)
+{
+  std::vector<double> reference, unused;
+  std::vector<float> expected, output;
+
+  for (uint32_t seed = 1; seed <= 20; seed++)
+  {
+    int nResetsReference = 0, nResetsProcess = 0, nResetsBlock = 0;
+    CompareBlockWithProcess(seed, false, reference, unused, nResetsReference, nResetsReference);
+    CompareBlockWithProcess(seed, false, expected, output, nResetsProcess, nResetsBlock);
+    CHECK(MaxShiftedError(reference, output, 1) <= 1e-5);
+    CHECK(nResetsBlock == nResetsProcess);
+  }
+}
+
+UNIT_TEST(ADSREnvelopeBankMatchesEnvelopes)
+{
+  const int nLanes = 3, nFrames = 8000, blockSize = 100;
+  ADSREnvelopeBank<double, nLanes> bank;
+  ADSREnvelope<double> single[nLanes];
+  std::vector<double> bankOutput[nLanes], singleOutput(blockSize), sustain(blockSize, 0.6);
+  double* outputs[nLanes];
+
+  bank.SetSampleRate(48000.);
+
+  for (auto l = 0; l < nLanes; l++)
+  {
+    bankOutput[l].resize(blockSize);
+    outputs[l] = bankOutput[l].data();
+    single[l].SetSampleRate(48000.);
+
+    for (auto env : { &bank.GetEnvelope(l), &single[l] })
+    {
+      env->SetStageTime(ADSREnvelope<double>::kAttack, 1. + 5. * l);
+      env->SetStageTime(ADSREnvelope<double>::kDecay, 10. + 20. * l);
+      env->SetStageTime(ADSREnvelope<double>::kRelease, 5. + 10. * l);
+      env->Start(1. - 0.2 * l);
+    }
+  }
+
+  CHECK(bank.GetBusy());
+
+  for (auto start = 0; start < nFrames; start += blockSize)
+  {
+    if (start == nFrames / 2)
+    {
+      for (auto l = 0; l < nLanes; l++)
+      {
+        bank.GetEnvelope(l).Release();
+        single[l].Release();
+      }
+    }
+
+    bank.ProcessBlock(outputs, sustain.data(), blockSize);
+
+    for (auto l = 0; l < nLanes; l++)
+    {
+      single[l].ProcessBlock(singleOutput.data(), sustain.data(), blockSize);
+
+      for (auto s = 0; s < blockSize; s++)
+        CHECK(bankOutput[l][s] == singleOutput[s]);
+    }
+  }
+
+  // every release is far shorter than the second half
+  CHECK(!bank.GetBusy());
+}
+
+BENCHMARK(ADSREnvelopeBenchmark)
+{
+  const int nFrames = 1 << 22;
+  std::vector<float> output(512), sustain(512, 0.5f);
+  float sink = 0.f;
+
+  auto run = [&](int blockSize, bool perSample) {
+    ADSREnvelope<float> env;
+    env.SetSampleRate(48000.f);
+    env.SetStageTime(ADSREnvelope<float>::kAttack, 5.f);
+    env.SetStageTime(ADSREnvelope<float>::kDecay, 50.f);
+    env.SetStageTime(ADSREnvelope<float>::kRelease, 100.f);
+
+    return TimeSeconds([&]() {
+      for (auto start = 0; start < nFrames; start += blockSize)
+      {
+        // a note every 4096 samples, released halfway through
+        if ((start & 4095) == 0)
+          env.Start(1.f);
+        else if ((start & 4095) == 2048)
+          env.Release();
+
+        if (perSample)
+        {
+          for (auto s = 0; s < blockSize; s++)
+            output[s] = env.Process(sustain[s]);
+        }
+        else
+          env.ProcessBlock(output.data(), sustain.data(), blockSize);
+
+        sink += output[0];
+      }
+    });
+  };
+
+  for (auto blockSize : { 32, 512 })
+  {
+    const double perSample = run(blockSize, true);
+    const double block = run(blockSize, false);
+    printf("  %3d-sample blocks: Process() %.2f ns/sample, ProcessBlock() %.2f ns/sample (%.1fx)\n",
+           blockSize, perSample * 1e9 / nFrames, block * 1e9 / nFrames, perSample / block);
+  }
+
+  CHECK(std::isfinite(sink));
+}
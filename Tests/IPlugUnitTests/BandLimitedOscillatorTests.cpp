@@ -0,0 +1,236 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// first, to check that the header is self-contained
+#include "BandLimitedOscillator.h"
+
+#include "IPlugUnitTests.h"
+
+static const EOscWaveform kWaveforms[] = { kOscSine, kOscSaw, kOscSquare, kOscTriangle };
+
+template <typename T>
+static bool AllFiniteAndBounded(const std::vector<T>& buffer, double bound)
+{
+  for (auto s : buffer)
+  {
+    if (!std::isfinite(s) || std::abs(s) > bound)
+      return false;
+  }
+
+  return true;
+}
+
+UNIT_TEST(PolyBLEPZeroFrequencyIsFinite)
+{
+  for (auto waveform : kWaveforms)
+  {
+    PolyBLEPOscillator<double> osc(waveform, 0.);
+    osc.SetSampleRate(48000.);
+    osc.SetFreqCPS(0.);
+    std::vector<double> output(256);
+    osc.ProcessBlock(output.data(), (int) output.size());
+    CHECK(AllFiniteAndBounded(output, 1.5));
+
+    // a frequency input that stops at 0 Hz
+    const std::vector<double> freqs(256, 0.);
+    osc.ProcessBlock(output.data(), freqs.data(), (int) output.size());
+    CHECK(AllFiniteAndBounded(output, 1.5));
+
+    // and the phases where the residuals are non-zero, at 0 Hz
+    for (auto t : { 0., 1e-12, 0.5, 1. - 1e-12 })
+    {
+      CHECK(std::isfinite(PolyBLEP::Sample<kOscSaw>(t, 0., 0.5)));
+      CHECK(std::isfinite(PolyBLEP::Sample<kOscSquare>(t, 0., 0.5)));
+      CHECK(std::isfinite(PolyBLEP::Sample<kOscTriangle>(t, 0., 0.5)));
+      CHECK(std::isfinite(PolyBLEP::Sample<kOscTriangle>((float) t, 0.f, 0.5f)));
+    }
+  }
+}
+
+// through-zero FM: the frequency sweeps from -5 kHz to 5 kHz and back, crossing 0 Hz exactly
+UNIT_TEST(PolyBLEPThroughZeroFMIsFinite)
+{
+  const int nFrames = 4800;
+  std::vector<double> freqs(nFrames), output(nFrames);
+
+  for (auto s = 0; s < nFrames; s++)
+    freqs[s] = 5000. * (1. - std::abs(2. * s / (nFrames / 2) - 2.)) * ((s / (nFrames / 4)) & 1 ? 1. : -1.);
+
+  for (auto waveform : kWaveforms)
+  {
+    PolyBLEPOscillator<double> osc(waveform, 0.25);
+    osc.SetSampleRate(48000.);
+    osc.ProcessBlock(output.data(), freqs.data(), nFrames);
+    CHECK(AllFiniteAndBounded(output, 1.5));
+
+    // a negative frequency runs the waveform backwards
+    osc.SetFreqCPS(-440.);
+    osc.ProcessBlock(output.data(), nFrames);
+    CHECK(AllFiniteAndBounded(output, 1.5));
+  }
+}
+
+// a default constructed bank has no frequency set, so every lane runs at 0 Hz
+UNIT_TEST(PolyBLEPBankDefaultIsFinite)
+{
+  for (auto waveform : kWaveforms)
+  {
+    PolyBLEPOscillatorBank<float, 4> bank(waveform);
+    std::vector<float> lanes[4], summed(200);
+    float* outputs[4];
+
+    for (auto l = 0; l < 4; l++)
+    {
+      lanes[l].resize(200);
+      outputs[l] = lanes[l].data();
+    }
+
+    bank.ProcessBlock(outputs, nullptr, 200);
+
+    for (auto& lane : lanes)
+      CHECK(AllFiniteAndBounded(lane, 1.5));
+
+    const std::vector<float> mods(200, -1.f);
+    bank.ProcessBlockSummed(summed.data(), mods.data(), 200);
+    CHECK(AllFiniteAndBounded(summed, 6.));
+  }
+}
+
+/** @return The power of the spectrum outside the harmonics of a cycle that repeats exactly nCycles times in the buffer, relative to the power of the harmonics, in dB */
+static double AliasingDB(const std::vector<double>& buffer, int nCycles)
+{
+  const int N = (int) buffer.size();
+  std::vector<double> cosTable(N), sinTable(N);
+
+  for (auto i = 0; i < N; i++)
+  {
+    cosTable[i] = std::cos(2. * PI * i / N);
+    sinTable[i] = std::sin(2. * PI * i / N);
+  }
+
+  double harmonicPower = 0., aliasPower = 0.;
+
+  for (auto k = 1; k < N / 2; k++)
+  {
+    double re = 0., im = 0.;
+
+    for (auto n = 0; n < N; n++)
+    {
+      re += buffer[n] * cosTable[(k * n) & (N - 1)];
+      im += buffer[n] * sinTable[(k * n) & (N - 1)];
+    }
+
+    (k % nCycles ? aliasPower : harmonicPower) += re * re + im * im;
+  }
+
+  return 10. * std::log10(aliasPower / harmonicPower);
+}
+
+// a saw at 373 cycles per 4096 samples (4371 Hz at 48 kHz) repeats exactly in the buffer, so everything off its harmonics is aliasing
+UNIT_TEST(BandLimitedSawAliasing)
+{
+  const int N = 4096, nCycles = 373;
+  const double sampleRate = 48000., freq = sampleRate * nCycles / N;
+  std::vector<double> naive(N), polyBLEP(N), wavetable(N);
+
+  for (auto s = 0; s < N; s++)
+    naive[s] = 2. * PolyBLEP::Fract((double) s * nCycles / N) - 1.;
+
+  PolyBLEPOscillator<double> polyBLEPOsc(kOscSaw);
+  polyBLEPOsc.SetSampleRate(sampleRate);
+  polyBLEPOsc.SetFreqCPS(freq);
+  polyBLEPOsc.ProcessBlock(polyBLEP.data(), N);
+
+  WavetableOscillator<double> wavetableOsc;
+  wavetableOsc.SetSampleRate(sampleRate);
+  wavetableOsc.SetFreqCPS(freq);
+  wavetableOsc.ProcessBlock(wavetable.data(), N);
+
+  const double naiveDB = AliasingDB(naive, nCycles);
+  const double polyBLEPDB = AliasingDB(polyBLEP, nCycles);
+  const double wavetableDB = AliasingDB(wavetable, nCycles);
+  printf("  aliasing of a %.0f Hz saw: naive %.1f dB, PolyBLEP %.1f dB, wavetable %.1f dB\n", freq, naiveDB, polyBLEPDB, wavetableDB);
+
+  CHECK(polyBLEPDB < naiveDB - 10.);
+  CHECK(wavetableDB < polyBLEPDB - 10.);
+}
+
+BENCHMARK(BandLimitedOscillatorBenchmark)
+{
+  const int blockSize = 64, nBlocks = 20000;
+  std::vector<double> output(blockSize), freqs(blockSize, 440.);
+  std::vector<float> outputFloat(blockSize), mods(blockSize, 1.f);
+  double sink = 0.;
+
+  auto report = [&](const char* name, double seconds, int nOscs) {
+    printf("  %-40s %7.1f M samples/s\n", name, (double) nOscs * blockSize * nBlocks / seconds * 1e-6);
+  };
+
+  for (auto waveform : { kOscSaw, kOscSquare, kOscTriangle })
+  {
+    PolyBLEPOscillator<double> osc(waveform);
+    osc.SetSampleRate(48000.);
+    osc.SetFreqCPS(440.);
+    const char* names[] = { "", "PolyBLEPOscillator saw", "PolyBLEPOscillator square", "PolyBLEPOscillator triangle" };
+
+    report(names[waveform], TimeSeconds([&]() {
+      for (auto b = 0; b < nBlocks; b++)
+      {
+        osc.ProcessBlock(output.data(), blockSize);
+        sink += output[0];
+      }
+    }), 1);
+  }
+
+  {
+    PolyBLEPOscillator<double> osc(kOscSaw);
+    osc.SetSampleRate(48000.);
+
+    report("PolyBLEPOscillator saw, frequency input", TimeSeconds([&]() {
+      for (auto b = 0; b < nBlocks; b++)
+      {
+        osc.ProcessBlock(output.data(), freqs.data(), blockSize);
+        sink += output[0];
+      }
+    }), 1);
+  }
+
+  {
+    PolyBLEPOscillatorBank<float, 8> bank(kOscSaw);
+    bank.SetSampleRate(48000.);
+
+    for (auto l = 0; l < 8; l++)
+      bank.SetFreqCPS(l, 440. * (1. + 0.01 * l));
+
+    report("PolyBLEPOscillatorBank<float, 8> summed", TimeSeconds([&]() {
+      for (auto b = 0; b < nBlocks; b++)
+      {
+        bank.ProcessBlockSummed(outputFloat.data(), mods.data(), blockSize);
+        sink += outputFloat[0];
+      }
+    }), 8);
+  }
+
+  {
+    WavetableOscillator<double> osc;
+    osc.SetSampleRate(48000.);
+    osc.SetFreqCPS(440.);
+
+    report("WavetableOscillator", TimeSeconds([&]() {
+      for (auto b = 0; b < nBlocks; b++)
+      {
+        osc.ProcessBlock(output.data(), blockSize);
+        sink += output[0];
+      }
+    }), 1);
+  }
+
+  CHECK(std::isfinite(sink));
+}
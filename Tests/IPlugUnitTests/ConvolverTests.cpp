@@ -0,0 +1,159 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// first, to check that the header is self-contained
+#include "Convolver.h"
+
+#include <thread>
+
+#include "IPlugUnitTests.h"
+
+static void MakeNoise(TestRandom& rand, std::vector<double>& buffer, double gain)
+{
+  for (auto& s : buffer)
+    s = rand.Bipolar() * gain;
+}
+
+// the impulse is longer than the head, so the output mixes the head from the audio thread and the tail from the worker
+UNIT_TEST(ConvolverMatchesDirectConvolution)
+{
+  const int nChans = 2, impulseLength = 12000, blockSize = 256, nBlocks = 100, nFrames = blockSize * nBlocks;
+  TestRandom rand(7);
+  std::vector<double> impulse[nChans], input[nChans], output[nChans];
+
+  for (auto c = 0; c < nChans; c++)
+  {
+    impulse[c].resize(impulseLength);
+    input[c].resize(nFrames);
+    output[c].resize(nFrames);
+    MakeNoise(rand, impulse[c], 0.01);
+    MakeNoise(rand, input[c], 1.);
+    impulse[c][0] = 1.;
+  }
+
+  const double* pImpulse[nChans] = { impulse[0].data(), impulse[1].data() };
+  Convolver<double> convolver(nChans);
+  convolver.SetImpulse(pImpulse, nChans, impulseLength);
+  convolver.Reset(blockSize);
+
+  for (auto b = 0; b < nBlocks; b++)
+  {
+    double* inputs[nChans] = { input[0].data() + (b * blockSize), input[1].data() + (b * blockSize) };
+    double* outputs[nChans] = { output[0].data() + (b * blockSize), output[1].data() + (b * blockSize) };
+    convolver.ProcessBlock(inputs, outputs, blockSize);
+
+    // give the worker the time a real-time host would
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  CHECK(convolver.GetNumTailUnderruns() == 0);
+
+  double maxError = 0.;
+
+  for (auto c = 0; c < nChans; c++)
+  {
+    for (auto s = 0; s < nFrames; s++)
+    {
+      double expected = 0.;
+
+      for (auto k = 0; k <= s && k < impulseLength; k++)
+        expected += impulse[c][k] * input[c][s - k];
+
+      maxError = std::max(maxError, std::abs(expected - output[c][s]));
+    }
+  }
+
+  // the engine computes in single precision
+  CHECK(maxError < 1e-4);
+}
+
+UNIT_TEST(ConvolverSwapsImpulsesWithoutGaps)
+{
+  const int blockSize = 128, impulseLength = 9000;
+  std::vector<double> impulse(impulseLength, 0.), ones(blockSize, 1.), output(blockSize);
+  const double* pImpulse[1] = { impulse.data() };
+  Convolver<double> convolver(1, 512);
+
+  impulse[0] = 1.;
+  convolver.SetImpulse(pImpulse, 1, impulseLength);
+  convolver.Reset(blockSize);
+
+  double* inputs[1] = { ones.data() };
+  double* outputs[1] = { output.data() };
+
+  for (auto b = 0; b < 10; b++)
+    convolver.ProcessBlock(inputs, outputs, blockSize);
+
+  CHECK_CLOSE(output[blockSize - 1], 1., 1e-5);
+
+  // a gain of 0.5 is crossfaded in, the output of a DC input moves monotonically from 1 to 0.5
+  impulse[0] = 0.5;
+  convolver.SetImpulse(pImpulse, 1, impulseLength);
+  double prev = 1.;
+  bool monotonic = true;
+
+  for (auto b = 0; b < 10; b++)
+  {
+    convolver.ProcessBlock(inputs, outputs, blockSize);
+
+    for (auto s = 0; s < blockSize; s++)
+    {
+      monotonic &= output[s] <= prev + 1e-6;
+      prev = output[s];
+    }
+  }
+
+  CHECK(monotonic);
+  CHECK_CLOSE(output[blockSize - 1], 0.5, 1e-5);
+}
+
+BENCHMARK(ConvolverBenchmark)
+{
+  // a stereo 2 s reverb impulse at 48 kHz, 10 s of audio, the audio thread's cost per block
+  const int nChans = 2, sampleRate = 48000, impulseLength = 2 * sampleRate, nFrames = 10 * sampleRate;
+  TestRandom rand(3);
+  std::vector<double> impulse[nChans];
+
+  for (auto c = 0; c < nChans; c++)
+  {
+    impulse[c].resize(impulseLength);
+    MakeNoise(rand, impulse[c], 0.01);
+  }
+
+  const double* pImpulse[nChans] = { impulse[0].data(), impulse[1].data() };
+
+  for (auto blockSize : {64, 512})
+  {
+    Convolver<double> convolver(nChans);
+    convolver.SetImpulse(pImpulse, nChans, impulseLength);
+    convolver.Reset(blockSize);
+
+    std::vector<double> buffers[nChans];
+
+    for (auto c = 0; c < nChans; c++)
+    {
+      buffers[c].resize(blockSize);
+      MakeNoise(rand, buffers[c], 1.);
+    }
+
+    double* ptrs[nChans] = { buffers[0].data(), buffers[1].data() };
+    double audioThreadTime = 0.;
+    const int nBlocks = nFrames / blockSize;
+
+    for (auto b = 0; b < nBlocks; b++)
+    {
+      audioThreadTime += TimeSeconds([&]() { convolver.ProcessBlock(ptrs, ptrs, blockSize); });
+      std::this_thread::yield();
+    }
+
+    printf("  block %i: %.2f us per block on the audio thread, %.0fx real time, %i tail underruns\n",
+           blockSize, audioThreadTime / nBlocks * 1e6, ((double) nFrames / sampleRate) / audioThreadTime, convolver.GetNumTailUnderruns());
+  }
+}
@@ -0,0 +1,231 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#include "fft.h"
+
+#include "IPlugUnitTests.h"
+
+// the scalar passes, then each SIMD level that this build and CPU support
+static std::vector<int> GetFFTLevels()
+{
+  WDL_fft_init();
+  std::vector<int> levels { 0 };
+
+  for (auto level = 1; level <= 2; level++)
+  {
+    if (WDL_fft_set_simd(level) == level)
+      levels.push_back(level);
+  }
+
+  WDL_fft_set_simd(2);
+  return levels;
+}
+
+static void MakeNoise(TestRandom& rand, WDL_FFT_COMPLEX* buffer, int size)
+{
+  for (auto i = 0; i < size; i++)
+  {
+    buffer[i].re = (WDL_FFT_REAL) rand.Bipolar();
+    buffer[i].im = (WDL_FFT_REAL) rand.Bipolar();
+  }
+}
+
+static double MaxDifference(const WDL_FFT_COMPLEX* a, const WDL_FFT_COMPLEX* b, int size)
+{
+  double maxDifference = 0.;
+  for (auto i = 0; i < size; i++)
+    maxDifference = std::max(maxDifference, (double) std::max(std::abs(a[i].re - b[i].re), std::abs(a[i].im - b[i].im)));
+  return maxDifference;
+}
+
+// WDL_fft's forward transform is X[k] = sum x[n] e^(-2 pi i k n / N), with X[k] stored at WDL_fft_permute(N, k)
+UNIT_TEST(FFTMatchesDFT)
+{
+  TestRandom rand(3);
+
+  for (auto level : GetFFTLevels())
+  {
+    WDL_fft_set_simd(level);
+
+    for (auto size = 2; size <= 4096; size *= 2)
+    {
+      std::vector<WDL_FFT_COMPLEX> input(size), buffer(size);
+      MakeNoise(rand, input.data(), size);
+      buffer = input;
+      WDL_fft(buffer.data(), size, 0);
+
+      std::vector<double> cosTable(size), sinTable(size);
+      for (auto i = 0; i < size; i++)
+      {
+        cosTable[i] = std::cos(2. * M_PI * i / size);
+        sinTable[i] = std::sin(2. * M_PI * i / size);
+      }
+
+      double maxError = 0.;
+      for (auto k = 0; k < size; k++)
+      {
+        double re = 0., im = 0.;
+        for (auto n = 0; n < size; n++)
+        {
+          const auto phase = (k * n) & (size - 1);
+          re += input[n].re * cosTable[phase] + input[n].im * sinTable[phase];
+          im += input[n].im * cosTable[phase] - input[n].re * sinTable[phase];
+        }
+        const auto& result = buffer[WDL_fft_permute(size, k)];
+        maxError = std::max(maxError, std::max(std::abs(result.re - re), std::abs(result.im - im)));
+      }
+
+      // the output grows with sqrt(size), and the rounding error with the number of passes on top of that
+      const auto tolerance = 1e-6 * std::sqrt((double) size) * std::log2((double) size);
+      if (maxError > tolerance)
+        printf("  level %d, %d points: max error %g\n", level, size, maxError);
+      CHECK(maxError <= tolerance);
+
+      // and back again, which scales by size
+      WDL_fft(buffer.data(), size, 1);
+      maxError = 0.;
+      for (auto n = 0; n < size; n++)
+        maxError = std::max(maxError, (double) std::max(std::abs(buffer[n].re / size - input[n].re), std::abs(buffer[n].im / size - input[n].im)));
+      CHECK(maxError <= 1e-6 * std::log2((double) size));
+    }
+  }
+
+  WDL_fft_set_simd(2);
+}
+
+// the SIMD passes do the same arithmetic as the scalar ones, so up to 32768 points they should agree to within rounding
+UNIT_TEST(FFTSimdMatchesScalar)
+{
+  const auto levels = GetFFTLevels();
+  TestRandom rand(5);
+
+  for (auto size = 2; size <= 32768; size *= 2)
+  {
+    std::vector<WDL_FFT_COMPLEX> input(size), reference(size), buffer(size);
+    MakeNoise(rand, input.data(), size);
+
+    for (auto isInverse = 0; isInverse < 2; isInverse++)
+    {
+      // complex
+      WDL_fft_set_simd(0);
+      reference = input;
+      WDL_fft(reference.data(), size, isInverse);
+
+      for (auto level : levels)
+      {
+        WDL_fft_set_simd(level);
+        buffer = input;
+        WDL_fft(buffer.data(), size, isInverse);
+        CHECK(MaxDifference(buffer.data(), reference.data(), size) <= 1e-6 * std::sqrt((double) size));
+      }
+
+      // real, the same number of values, in the same buffer
+      if (size < 4)
+        continue;
+
+      WDL_fft_set_simd(0);
+      reference = input;
+      WDL_real_fft((WDL_FFT_REAL*) reference.data(), size, isInverse);
+
+      for (auto level : levels)
+      {
+        WDL_fft_set_simd(level);
+        buffer = input;
+        WDL_real_fft((WDL_FFT_REAL*) buffer.data(), size, isInverse);
+        CHECK(MaxDifference(buffer.data(), reference.data(), size / 2) <= 1e-6 * std::sqrt((double) size));
+      }
+    }
+  }
+
+  WDL_fft_set_simd(2);
+}
+
+UNIT_TEST(FFTComplexMulMatchesScalar)
+{
+  const auto levels = GetFFTLevels();
+  TestRandom rand(9);
+
+  for (auto size : { 2, 4, 6, 10, 64, 1026 })
+  {
+    std::vector<WDL_FFT_COMPLEX> a(size), b(size), c(size);
+    MakeNoise(rand, a.data(), size);
+    MakeNoise(rand, b.data(), size);
+    MakeNoise(rand, c.data(), size);
+
+    for (auto level : levels)
+    {
+      WDL_fft_set_simd(level);
+      auto mul = a, mul2 = c, mul3 = c;
+      WDL_fft_complexmul(mul.data(), b.data(), size);
+      WDL_fft_complexmul2(mul2.data(), a.data(), b.data(), size);
+      WDL_fft_complexmul3(mul3.data(), a.data(), b.data(), size);
+
+      for (auto i = 0; i < size; i++)
+      {
+        const double re = (double) a[i].re * b[i].re - (double) a[i].im * b[i].im;
+        const double im = (double) a[i].re * b[i].im + (double) a[i].im * b[i].re;
+        CHECK_CLOSE(mul[i].re, re, 1e-6);
+        CHECK_CLOSE(mul[i].im, im, 1e-6);
+        CHECK_CLOSE(mul2[i].re, re, 1e-6);
+        CHECK_CLOSE(mul2[i].im, im, 1e-6);
+        CHECK_CLOSE(mul3[i].re, c[i].re + re, 1e-6);
+        CHECK_CLOSE(mul3[i].im, c[i].im + im, 1e-6);
+      }
+    }
+  }
+
+  WDL_fft_set_simd(2);
+}
+
+BENCHMARK(FFTBenchmark)
+{
+  const auto levels = GetFFTLevels();
+  TestRandom rand(11);
+
+  for (auto size : { 256, 1024, 4096, 32768 })
+  {
+    std::vector<WDL_FFT_COMPLEX> input(size), buffer(size);
+    MakeNoise(rand, input.data(), size);
+    const auto nPairs = (1 << 24) / size;
+    double scalarTime = 0.;
+
+    for (auto level : levels)
+    {
+      WDL_fft_set_simd(level);
+
+      const auto complexTime = TimeSeconds([&]() {
+        for (auto i = 0; i < nPairs; i++)
+        {
+          // start from the same values each time, the round trip scales them up
+          memcpy(buffer.data(), input.data(), size * sizeof(WDL_FFT_COMPLEX));
+          WDL_fft(buffer.data(), size, 0);
+          WDL_fft(buffer.data(), size, 1);
+        }
+      });
+
+      const auto realTime = TimeSeconds([&]() {
+        for (auto i = 0; i < nPairs; i++)
+        {
+          memcpy(buffer.data(), input.data(), size * sizeof(WDL_FFT_REAL));
+          WDL_real_fft((WDL_FFT_REAL*) buffer.data(), size, 0);
+          WDL_real_fft((WDL_FFT_REAL*) buffer.data(), size, 1);
+        }
+      });
+
+      if (level == 0)
+        scalarTime = complexTime;
+
+      printf("  %5d points, level %d: complex forward + inverse %8.2f us (%.2fx scalar), real %8.2f us\n",
+             size, level, complexTime * 1e6 / nPairs, scalarTime / complexTime, realTime * 1e6 / nPairs);
+    }
+  }
+
+  WDL_fft_set_simd(2);
+}
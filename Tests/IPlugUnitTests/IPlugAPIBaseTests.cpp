@@ -0,0 +1,96 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// first, to check that the header is self-contained
+#include "IPlugAPIBase.h"
+
+#include "IPlugUnitTests.h"
+
+/** A plug-in with two parameters whose UI changes are queued for the audio thread, which records the value each OnParamChange() sees */
+class ParamChangeTestPlugin : public IPlugAPIBase
+{
+public:
+  static constexpr int kBlockSize = 32;
+
+  ParamChangeTestPlugin()
+  : IPlugAPIBase(IPlugConfig(2, 0, "2-2", "Test", "Test", "Test", 0, 0, 0, 0, false, false, false, false, 0, false, 0, 0, "com.test"), kAPICLI)
+  {
+    for (auto p = 0; p < NParams(); p++)
+      GetParam(p)->InitDouble("Test", 0., 0., 1000., 1.);
+
+    // from the first call, changes from the UI are queued rather than applied on the UI thread
+    ProcessParamChangesFromUI(kBlockSize, 48000.);
+  }
+
+  void OnParamChange(int paramIdx, EParamSource source, int sampleOffset) override
+  {
+    mNumChanges[paramIdx]++;
+    mLastValue[paramIdx] = GetParam(paramIdx)->Value();
+    mAllFromUI &= source == kUI;
+  }
+
+  /** Change a parameter from the UI, with its non-normalized value */
+  void SetFromUI(int paramIdx, double value) { SetParameterValue(paramIdx, GetParam(paramIdx)->ToNormalized(value)); }
+
+  void ProcessBlock() { ProcessParamChangesFromUI(kBlockSize, 48000.); }
+
+  int mNumChanges[2] = {};
+  double mLastValue[2] = { -1., -1. };
+  bool mAllFromUI = true;
+};
+
+// more changes than the queue holds. The ones that don't fit are dropped, but the parameter keeps the UI's latest value, and so does the last OnParamChange()
+UNIT_TEST(IPlugAPIBaseUIParamQueueOverflow)
+{
+  ParamChangeTestPlugin plugin;
+  const int nChanges = PARAM_TRANSFER_SIZE + 88;
+
+  for (auto i = 1; i <= nChanges; i++)
+    plugin.SetFromUI(0, i);
+
+  plugin.SetFromUI(1, 5.);
+  CHECK(plugin.mNumChanges[0] == 0); // nothing is applied on the UI thread
+
+  plugin.ProcessBlock();
+  CHECK(plugin.GetParam(0)->Value() == nChanges);
+  CHECK(plugin.mLastValue[0] == nChanges);
+  CHECK(plugin.GetParam(1)->Value() == 5.);
+  CHECK(plugin.mLastValue[1] == 5.); // dropped, but the overflow updates every parameter
+  CHECK(plugin.mNumChanges[0] == PARAM_TRANSFER_SIZE + 1);
+  CHECK(plugin.mAllFromUI);
+
+  IPerformanceStats stats;
+  plugin.GetPerformanceStats(stats);
+  CHECK(stats.mNumParamQueueOverflows == nChanges + 1 - PARAM_TRANSFER_SIZE);
+  CHECK(stats.mNumUIParamChanges == PARAM_TRANSFER_SIZE);
+
+  // the queue is empty again, and the next change goes through on its own
+  plugin.SetFromUI(0, 7.);
+  plugin.ProcessBlock();
+  CHECK(plugin.mLastValue[0] == 7.);
+  CHECK(plugin.mNumChanges[0] == PARAM_TRANSFER_SIZE + 2);
+  CHECK(plugin.mNumChanges[1] == 1);
+}
+
+// host automation that lands between a UI change and the block that applies it is not undone by the queued change
+UNIT_TEST(IPlugAPIBaseUIParamChangeKeepsHostValue)
+{
+  ParamChangeTestPlugin plugin;
+
+  plugin.SetFromUI(0, 10.);
+  plugin.SetFromUI(0, 20.);
+  plugin.GetParam(0)->Set(300.); // as an API class does on the audio thread, before it calls OnParamChange() with kHost
+
+  plugin.ProcessBlock();
+  CHECK(plugin.GetParam(0)->Value() == 300.);
+  CHECK(plugin.mLastValue[0] == 300.);
+  CHECK(plugin.mNumChanges[0] == 2);
+  CHECK(plugin.mNumChanges[1] == 0);
+}
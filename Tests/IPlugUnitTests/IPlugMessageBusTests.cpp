@@ -0,0 +1,251 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// first, to check that the header is self-contained
+#include "IPlugMessageBus.h"
+
+#include "IPlugUnitTests.h"
+
+#include <atomic>
+#include <thread>
+
+/** The bytes of a test message, which depend on its producer, its sequence number and their position, so that a chunk that is out of place or overwritten shows */
+static uint8_t MessageByte(int producer, int sequence, int pos)
+{
+  return (uint8_t) ((producer * 131) + (sequence * 31) + (pos * 7));
+}
+
+/** Reassembles the messages from each producer and checks that they arrive whole, intact and in order */
+struct MessageChecker
+{
+  struct Producer
+  {
+    int nextSequence = 0;
+    int expectedOffset = 0;
+  };
+
+  std::vector<Producer> producers;
+  int nMessages = 0;
+  bool failed = false;
+
+  explicit MessageChecker(int nProducers) : producers(nProducers) {}
+
+  // the message tag is the producer and the control tag is its sequence number
+  void operator()(const IPlugMessageBus::Chunk& chunk)
+  {
+    if (chunk.messageTag < 0 || chunk.messageTag >= (int) producers.size())
+    {
+      failed = true;
+      return;
+    }
+
+    Producer& producer = producers[chunk.messageTag];
+
+    // the chunks of a message are consecutive, even with other producers pushing at the same time
+    if (chunk.controlTag != producer.nextSequence || chunk.offset != producer.expectedOffset)
+      failed = true;
+
+    for (auto i = 0; i < chunk.size; i++)
+    {
+      if (chunk.pData[i] != MessageByte(chunk.messageTag, chunk.controlTag, chunk.offset + i))
+        failed = true;
+    }
+
+    if (chunk.IsLast())
+    {
+      producer.nextSequence++;
+      producer.expectedOffset = 0;
+      nMessages++;
+    }
+    else
+      producer.expectedOffset = chunk.offset + chunk.size;
+  }
+};
+
+UNIT_TEST(IPlugMessageBusSingleThreaded)
+{
+  IPlugMessageBus bus(16, 8);
+  CHECK(bus.GetMaxMessageSize() == 128);
+  CHECK(bus.GetNumFreeChunks() == 8);
+
+  uint8_t data[200];
+  MessageChecker checker(1);
+
+  for (auto i = 0; i < (int) sizeof(data); i++)
+    data[i] = MessageByte(0, 0, i);
+
+  // a message of three chunks, the last one partly filled
+  CHECK(bus.Push(0, 0, 40, data));
+  CHECK(bus.GetNumFreeChunks() == 5);
+
+  // too large, and not enough space for 6 chunks, neither of which takes any chunks
+  CHECK(!bus.Push(0, 1, 129, data));
+  CHECK(!bus.Push(0, 1, 96, data));
+  CHECK(bus.GetNumFailedPushes() == 2);
+  CHECK(bus.GetNumFreeChunks() == 5);
+
+  // a value, and an empty message, which takes a chunk
+  for (auto i = 0; i < 8; i++)
+    data[i] = MessageByte(0, 1, i);
+
+  CHECK(bus.Push(0, 1, 8, data));
+  CHECK(bus.Push(0, 2, 0, nullptr));
+
+  CHECK(bus.Process(checker, 2) == 2); // a message can be split across calls
+  CHECK(bus.Process(checker) == 3);
+  CHECK(!checker.failed);
+  CHECK(checker.nMessages == 3);
+  CHECK(bus.GetNumFreeChunks() == 8);
+  CHECK(bus.Process(checker) == 0);
+
+  int value = 0;
+  CHECK(bus.PushValue(7, 8, 1234));
+  bus.Process([&](const IPlugMessageBus::Chunk& chunk) { CHECK(chunk.GetValue(value)); CHECK(chunk.messageTag == 7 && chunk.controlTag == 8); });
+  CHECK(value == 1234);
+}
+
+// a producer that waits for space doesn't stop another from sending a message there is space for
+UNIT_TEST(IPlugMessageBusWaitDoesNotBlockOtherProducers)
+{
+  IPlugMessageBus bus(16, 4);
+  uint8_t data[64] = {};
+  CHECK(bus.Push(0, 0, 48, data)); // 3 of the 4 chunks
+
+  std::atomic<int> waiterResult { -1 };
+
+  std::thread waiter([&]() {
+    waiterResult.store(bus.Push(1, 0, 32, data, 2000) ? 1 : 0); // needs 2 chunks, so waits for the consumer
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  bool sent = false;
+  const double seconds = TimeSeconds([&]() { sent = bus.Push(2, 0, 16, data); });
+  CHECK(sent);
+  CHECK(seconds < 0.5);
+  CHECK(waiterResult.load() == -1);
+
+  int nDelivered = 0;
+
+  while (waiterResult.load() == -1)
+  {
+    nDelivered += bus.Process([](const IPlugMessageBus::Chunk&) {});
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  waiter.join();
+  CHECK(waiterResult.load() == 1);
+  nDelivered += bus.Process([](const IPlugMessageBus::Chunk&) {});
+  CHECK(nDelivered == 6);
+}
+
+/** Several producers send messages of random sizes, some of many chunks, through a small pool while the consumer processes them in bounded batches.
+ * Producers wait for space, and yield at random so that their pushes interleave on a single core */
+static void StressBus(int nProducers, int chunkBytes, int nChunks, int nMessagesPerProducer, uint32_t seed)
+{
+  IPlugMessageBus bus(chunkBytes, nChunks);
+  std::atomic<int> nFailed { 0 };
+  std::atomic<int> nFinished { 0 };
+  std::vector<std::thread> producers;
+
+  for (auto p = 0; p < nProducers; p++)
+  {
+    producers.emplace_back([&, p]() {
+      TestRandom rand(seed + p);
+      std::vector<uint8_t> data(bus.GetMaxMessageSize() / 2);
+
+      for (auto m = 0; m < nMessagesPerProducer; m++)
+      {
+        const int size = rand.Int(4) ? rand.Int(chunkBytes + 1) : rand.Int((int) data.size() + 1);
+
+        for (auto i = 0; i < size; i++)
+          data[i] = MessageByte(p, m, i);
+
+        if (!bus.Push(p, m, size, data.data(), 10000))
+          nFailed++;
+
+        if (!rand.Int(4))
+          std::this_thread::yield();
+      }
+
+      nFinished++;
+    });
+  }
+
+  MessageChecker checker(nProducers);
+  TestRandom rand(seed + 100);
+
+  while (nFinished.load() < nProducers || bus.GetNumFreeChunks() < nChunks)
+  {
+    if (!bus.Process(checker, 1 + rand.Int(8)) || !rand.Int(4))
+      std::this_thread::yield();
+  }
+
+  for (auto& producer : producers)
+    producer.join();
+
+  CHECK(nFailed.load() == 0);
+  CHECK(!checker.failed);
+  CHECK(checker.nMessages == nProducers * nMessagesPerProducer);
+
+  for (const auto& producer : checker.producers)
+    CHECK(producer.nextSequence == nMessagesPerProducer);
+}
+
+UNIT_TEST(IPlugMessageBusMultipleProducers)
+{
+  StressBus(2, 16, 8, 5000, 1);
+  StressBus(4, 64, 32, 5000, 2);
+  StressBus(8, 1024, 256, 500, 3);
+}
+
+// the default bus of IPlugAPIBase. The producers retry a full bus with a yield rather than Push()'s 1 ms sleep, so that this measures the bus rather than the sleep
+BENCHMARK(IPlugMessageBusBenchmark)
+{
+  for (auto messageSize : { 16, 1024, 16384 })
+  {
+    for (auto nProducers : { 1, 4 })
+    {
+      const int nMessages = 20000000 / (messageSize + 256) / nProducers;
+      IPlugMessageBus bus(1024, 256);
+      std::atomic<int> nFinished { 0 };
+      std::vector<std::thread> producers;
+
+      const double seconds = TimeSeconds([&]() {
+        for (auto p = 0; p < nProducers; p++)
+        {
+          producers.emplace_back([&, p]() {
+            std::vector<uint8_t> data(messageSize, (uint8_t) p);
+
+            for (auto m = 0; m < nMessages; m++)
+            {
+              while (!bus.Push(p, m, messageSize, data.data()))
+                std::this_thread::yield();
+            }
+
+            nFinished++;
+          });
+        }
+
+        while (nFinished.load() < nProducers || bus.GetNumFreeChunks() < 256)
+        {
+          if (!bus.Process([](const IPlugMessageBus::Chunk&) {}))
+            std::this_thread::yield();
+        }
+
+        for (auto& producer : producers)
+          producer.join();
+      });
+
+      const double nBytes = (double) messageSize * nMessages * nProducers;
+      printf("  %5d byte messages, %d producers: %.0f k messages/s, %.0f MB/s\n", messageSize, nProducers, nMessages * nProducers / seconds * 1e-3, nBytes / seconds * 1e-6);
+    }
+  }
+}
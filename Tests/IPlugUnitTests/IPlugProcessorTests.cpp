@@ -0,0 +1,256 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// first, to check that the header is self-contained
+#include "IPlugProcessor.h"
+
+#include "IPlugUnitTests.h"
+
+/** A stereo effect that drives ProcessBuffers() the way an API class does, and records which of the processing methods were called */
+class SilenceTestProcessor : public IPlugProcessor<PLUG_SAMPLE_DST>
+{
+public:
+  static constexpr int kBlockSize = 32;
+
+  SilenceTestProcessor(int latency = 0)
+  : IPlugProcessor<PLUG_SAMPLE_DST>(IPlugConfig(0, 0, "2-2", "Test", "Test", "Test", 0, 0, 0, latency, false, false, false, false, 0, false, 0, 0, "com.test"), kAPICLI)
+  , mInputs(2, std::vector<PLUG_SAMPLE_DST>(kBlockSize, 0.))
+  , mOutputs(2, std::vector<PLUG_SAMPLE_DST>(kBlockSize, 0.))
+  {
+    SetChannelConnections(ERoute::kInput, 0, 2, true);
+    SetChannelConnections(ERoute::kOutput, 0, 2, true);
+    SetBlockSize(kBlockSize);
+    SetSilenceDetection(true);
+  }
+
+  void ProcessBlock(PLUG_SAMPLE_DST** inputs, PLUG_SAMPLE_DST** outputs, int nFrames) override
+  {
+    mNumProcessed++;
+    mInput0Silent = IsInputChannelSilent(0);
+    mInput1Silent = IsInputChannelSilent(1);
+
+    for (auto c = 0; c < 2; c++)
+    {
+      for (auto s = 0; s < nFrames; s++)
+        outputs[c][s] = 1.;
+    }
+  }
+
+  bool SendMidiMsg(const IMidiMsg& msg) override { return false; }
+
+  bool ProcessSilentBlock(PLUG_SAMPLE_DST** outputs, int nFrames) override
+  {
+    mNumSilentProcessed++;
+
+    if (!mRenderSilentBlocks)
+      return false;
+
+    for (auto c = 0; c < 2; c++)
+    {
+      for (auto s = 0; s < nFrames; s++)
+        outputs[c][s] = 0.5;
+    }
+
+    return true;
+  }
+
+  /** Process a block whose inputs are all value, except for the last sample of channel 1, which is lastValue */
+  void Process(PLUG_SAMPLE_DST value, PLUG_SAMPLE_DST lastValue, uint64_t hostSilenceFlags = 0)
+  {
+    for (auto c = 0; c < 2; c++)
+    {
+      std::fill(mInputs[c].begin(), mInputs[c].end(), value);
+      std::fill(mOutputs[c].begin(), mOutputs[c].end(), 123.); // not left over from the last block
+    }
+
+    mInputs[1][kBlockSize - 1] = lastValue;
+
+    PLUG_SAMPLE_DST* pInputs[] = { mInputs[0].data(), mInputs[1].data() };
+    PLUG_SAMPLE_DST* pOutputs[] = { mOutputs[0].data(), mOutputs[1].data() };
+    AttachBuffers(ERoute::kInput, 0, 2, pInputs, kBlockSize);
+    SetInputSilenceFlags(0, 2, hostSilenceFlags);
+    AttachBuffers(ERoute::kOutput, 0, 2, pOutputs, kBlockSize);
+    ProcessBuffers((PLUG_SAMPLE_DST) 0, kBlockSize);
+  }
+
+  void ProcessSilence() { Process(0., 0.); }
+
+  /** @return The number of silent blocks processed before the processor went to sleep, or -1 if it didn't within maxBlocks */
+  int CountBlocksUntilSleep(int maxBlocks)
+  {
+    for (auto b = 0; b < maxBlocks; b++)
+    {
+      ProcessSilence();
+
+      if (GetOutputsSilent())
+        return b;
+    }
+
+    return -1;
+  }
+
+  bool OutputsAre(PLUG_SAMPLE_DST value) const
+  {
+    for (const auto& output : mOutputs)
+    {
+      for (auto s : output)
+      {
+        if (s != value)
+          return false;
+      }
+    }
+
+    return true;
+  }
+
+  using IPlugProcessor<PLUG_SAMPLE_DST>::GetOutputsSilent;
+  using IPlugProcessor<PLUG_SAMPLE_DST>::SetChannelConnections;
+
+  int mNumProcessed = 0;
+  int mNumSilentProcessed = 0;
+  bool mRenderSilentBlocks = false;
+  bool mInput0Silent = false;
+  bool mInput1Silent = false;
+
+private:
+  std::vector<std::vector<PLUG_SAMPLE_DST>> mInputs;
+  std::vector<std::vector<PLUG_SAMPLE_DST>> mOutputs;
+};
+
+// the tail and the latency must be flushed out by silent input first, then ProcessBlock() is skipped and the outputs are zeroed
+UNIT_TEST(IPlugProcessorSleepsAfterTailAndLatency)
+{
+  const int kBlockSize = SilenceTestProcessor::kBlockSize;
+
+  for (auto latency : { 0, 28 })
+  {
+    SilenceTestProcessor processor(latency);
+
+    for (auto tail : { 0, 1, 100, 128 })
+    {
+      processor.SetTailSize(tail);
+      processor.mNumProcessed = 0;
+      processor.Process(0.5, 0.5);
+      CHECK(processor.mNumProcessed == 1);
+      CHECK(!processor.GetOutputsSilent());
+
+      const int expectedBlocks = (tail + latency + kBlockSize - 1) / kBlockSize;
+      CHECK(processor.CountBlocksUntilSleep(100) == expectedBlocks);
+      CHECK(processor.mNumProcessed == 1 + expectedBlocks);
+      CHECK(processor.OutputsAre(0.));
+
+      // and it stays asleep
+      for (auto b = 0; b < 10; b++)
+        processor.ProcessSilence();
+
+      CHECK(processor.GetOutputsSilent());
+      CHECK(processor.mNumProcessed == 1 + expectedBlocks);
+    }
+  }
+
+  // without silence detection, every block is processed
+  SilenceTestProcessor processor;
+  processor.SetSilenceDetection(false);
+  CHECK(processor.CountBlocksUntilSleep(100) == -1);
+  CHECK(processor.mNumProcessed == 100);
+}
+
+UNIT_TEST(IPlugProcessorInfiniteTailNeverSleeps)
+{
+  SilenceTestProcessor processor;
+  processor.SetTailSize(-1);
+  processor.Process(0.5, 0.5);
+  CHECK(processor.CountBlocksUntilSleep(10000) == -1);
+  CHECK(processor.mNumProcessed == 10001);
+  CHECK(processor.OutputsAre(1.));
+}
+
+UNIT_TEST(IPlugProcessorWakesOnInput)
+{
+  SilenceTestProcessor processor;
+  processor.SetTailSize(64);
+  processor.Process(0.5, 0.5);
+  CHECK(processor.CountBlocksUntilSleep(100) == 2);
+
+  // a single non-zero sample, at the end of the block, wakes it
+  const int nProcessed = processor.mNumProcessed;
+  processor.Process(0., 1e-30);
+  CHECK(processor.mNumProcessed == nProcessed + 1);
+  CHECK(!processor.GetOutputsSilent());
+  CHECK(processor.OutputsAre(1.));
+  CHECK(processor.mInput0Silent && !processor.mInput1Silent);
+
+  // the tail is counted again from there
+  CHECK(processor.CountBlocksUntilSleep(100) == 2);
+
+  // re-enabling silence detection restarts the count
+  processor.SetSilenceDetection(true);
+  CHECK(processor.CountBlocksUntilSleep(100) == 2);
+}
+
+// ProcessSilentBlock() renders the tail instead of ProcessBlock(), until the processor sleeps
+UNIT_TEST(IPlugProcessorProcessSilentBlock)
+{
+  SilenceTestProcessor processor;
+  processor.SetTailSize(96);
+  processor.mRenderSilentBlocks = true;
+  processor.Process(0.5, 0.5);
+
+  processor.ProcessSilence();
+  CHECK(processor.mNumSilentProcessed == 1);
+  CHECK(processor.mNumProcessed == 1);
+  CHECK(processor.OutputsAre(0.5));
+  CHECK(!processor.GetOutputsSilent());
+
+  CHECK(processor.CountBlocksUntilSleep(100) == 2);
+  CHECK(processor.mNumSilentProcessed == 3);
+  CHECK(processor.mNumProcessed == 1);
+  CHECK(processor.OutputsAre(0.));
+
+  // when it returns false, ProcessBlock() is called as normal
+  processor.mRenderSilentBlocks = false;
+  processor.Process(0.5, 0.5);
+  processor.ProcessSilence();
+  CHECK(processor.mNumSilentProcessed == 4);
+  CHECK(processor.mNumProcessed == 3);
+  CHECK(processor.OutputsAre(1.));
+}
+
+// the host's silence flags mark channels as silent without looking at their samples
+UNIT_TEST(IPlugProcessorHostSilenceHints)
+{
+  SilenceTestProcessor processor;
+  processor.SetTailSize(32);
+
+  // only channel 0 is flagged, channel 1 is not silent
+  processor.Process(0.5, 0.5, 0x1);
+  CHECK(processor.mInput0Silent && !processor.mInput1Silent);
+
+  // both flagged, so the block counts as silent even though the buffers are not zero
+  processor.Process(0.5, 0.5, 0x3);
+  CHECK(processor.mInput0Silent && processor.mInput1Silent);
+  CHECK(processor.mNumProcessed == 2);
+  processor.Process(0.5, 0.5, 0x3);
+  CHECK(processor.GetOutputsSilent());
+  CHECK(processor.mNumProcessed == 2);
+  CHECK(processor.OutputsAre(0.));
+
+  // when the host stops flagging the channels, their samples wake it
+  processor.Process(0.5, 0.5, 0);
+  CHECK(!processor.GetOutputsSilent());
+  CHECK(processor.mNumProcessed == 3);
+
+  // an unconnected input is silent
+  SilenceTestProcessor mono;
+  mono.SetChannelConnections(ERoute::kInput, 1, 1, false);
+  mono.Process(0.5, 1.);
+  CHECK(!mono.mInput0Silent && mono.mInput1Silent);
+  CHECK(mono.CountBlocksUntilSleep(10) == 0);
+}
@@ -0,0 +1,604 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// first, to check that the header is self-contained
+#include "IPlugQueue.h"
+
+#include "IPlugUnitTests.h"
+
+#include <atomic>
+#include <thread>
+
+// the size of a ParamTuple or an IMidiMsg padded to 16 bytes, like most of the items that IPlugAPIBase queues
+struct QueueItem
+{
+  uint64_t id;
+  uint64_t check;
+
+  QueueItem(uint64_t id = 0) : id(id), check(~id) {}
+
+  bool IsValid() const { return check == ~id; }
+};
+
+UNIT_TEST(IPlugQueueSingleThreaded)
+{
+  IPlugQueue<QueueItem> queue(5);
+  CHECK(queue.GetCapacity() == 8);
+  CHECK(queue.WasEmpty());
+
+  // push and pop around the ring several times, so that the indices wrap
+  uint64_t nextPush = 0;
+  uint64_t nextPop = 0;
+  bool inOrder = true;
+
+  for (auto i = 0; i < 100; i++)
+  {
+    for (auto j = 0; j < 5; j++)
+      CHECK(queue.Push(QueueItem(nextPush++)));
+
+    CHECK(queue.ElementsAvailable() == 5);
+    CHECK(queue.Peek().id == nextPop);
+
+    QueueItem item;
+
+    while (queue.Pop(item))
+      inOrder &= item.id == nextPop++ && item.IsValid();
+  }
+
+  CHECK(inOrder);
+  CHECK(nextPop == nextPush);
+
+  // a full queue fails pushes and counts them
+  for (auto j = 0; j < 8; j++)
+    CHECK(queue.Push(QueueItem(j)));
+
+  CHECK(queue.WasFull());
+  CHECK(!queue.Push(QueueItem(8)));
+  CHECK(queue.GetNumFailedPushes() == 1);
+
+  // PopN across the wrap, then PushN more than fits
+  QueueItem items[16];
+  CHECK(queue.PopN(items, 3) == 3);
+  CHECK(items[0].id == 0 && items[2].id == 2);
+
+  for (auto j = 0; j < 16; j++)
+    items[j] = QueueItem(100 + j);
+
+  CHECK(queue.PushN(items, 16) == 3);
+  CHECK(queue.GetNumFailedPushes() == 14);
+
+  // the queued items are 3 to 7 and then 100 to 102, in two spans because the ring wrapped
+  QueueItem* pFirst;
+  QueueItem* pSecond;
+  int nFirst, nSecond;
+  CHECK(queue.PeekSpans(pFirst, nFirst, pSecond, nSecond) == 8);
+  CHECK(nFirst + nSecond == 8);
+  CHECK(nFirst > 0 && nSecond > 0);
+  CHECK(pFirst[0].id == 3);
+  CHECK(pSecond[nSecond - 1].id == 102);
+
+  queue.Discard(nFirst);
+  CHECK(queue.PopN(items, 16) == nSecond);
+  CHECK(items[nSecond - 1].id == 102);
+  CHECK(queue.WasEmpty());
+  CHECK(queue.PopN(items, 16) == 0);
+  CHECK(queue.PeekSpans(pFirst, nFirst, pSecond, nSecond) == 0);
+
+  queue.Resize(100);
+  CHECK(queue.GetCapacity() == 128);
+  CHECK(queue.WasEmpty());
+}
+
+/** Producer and consumer on two threads through a small queue, so that it is often full and often empty.
+ * Both sides pick at random between the single and the batch operations, and the consumer checks every item arrives once, intact and in order.
+ * Both sides yield when they can't make progress, and at random otherwise. On a single core that stops each side from filling or emptying the queue
+ * in every time slice, which would keep the indices in step and never exercise the batches that wrap around the ring */
+static void StressQueue(int capacity, uint64_t nItems, uint32_t seed)
+{
+  IPlugQueue<QueueItem> queue(capacity);
+  std::atomic<bool> failed { false };
+
+  std::thread producer([&]() {
+    TestRandom rand(seed);
+    QueueItem batch[32];
+    uint64_t next = 0;
+
+    while (next < nItems)
+    {
+      if (rand.Int(2))
+      {
+        if (queue.Push(QueueItem(next)))
+          next++;
+        else
+          std::this_thread::yield();
+      }
+      else
+      {
+        const int nBatch = (int) std::min<uint64_t>(1 + rand.Int(32), nItems - next);
+
+        for (auto i = 0; i < nBatch; i++)
+          batch[i] = QueueItem(next + i);
+
+        const int nPushed = queue.PushN(batch, nBatch);
+        next += nPushed;
+
+        if (nPushed < nBatch)
+          std::this_thread::yield();
+      }
+
+      if (!rand.Int(16))
+        std::this_thread::yield();
+    }
+  });
+
+  TestRandom rand(seed + 1);
+  QueueItem batch[32];
+  uint64_t expected = 0;
+
+  auto receive = [&](const QueueItem& item) {
+    if (item.id != expected++ || !item.IsValid())
+      failed.store(true);
+  };
+
+  while (expected < nItems)
+  {
+    int nReceived = 0;
+
+    switch (rand.Int(3))
+    {
+      case 0:
+      {
+        QueueItem item;
+
+        if (queue.Pop(item))
+        {
+          receive(item);
+          nReceived = 1;
+        }
+        break;
+      }
+      case 1:
+      {
+        nReceived = queue.PopN(batch, 1 + rand.Int(32));
+
+        for (auto i = 0; i < nReceived; i++)
+          receive(batch[i]);
+        break;
+      }
+      default:
+      {
+        QueueItem* pFirst;
+        QueueItem* pSecond;
+        int nFirst, nSecond;
+        nReceived = std::min(queue.PeekSpans(pFirst, nFirst, pSecond, nSecond), 1 + rand.Int(32));
+
+        for (auto i = 0; i < nReceived; i++)
+          receive(i < nFirst ? pFirst[i] : pSecond[i - nFirst]);
+
+        queue.Discard(nReceived);
+        break;
+      }
+    }
+
+    if (!nReceived || !rand.Int(16))
+      std::this_thread::yield();
+  }
+
+  producer.join();
+  CHECK(!failed.load());
+  CHECK(expected == nItems);
+  CHECK(queue.WasEmpty());
+}
+
+UNIT_TEST(IPlugQueueStress)
+{
+  StressQueue(4, 200000, 1);
+  StressQueue(64, 200000, 2);
+  StressQueue(512, 500000, 3);
+}
+
+/** The bytes of a test SysEx message, which depend on its sequence number and their position */
+static uint8_t SysExByte(int sequence, int pos)
+{
+  return (uint8_t) ((sequence * 31) + (pos * 7) + 1);
+}
+
+static bool PushSysEx(IPlugSysExQueue& queue, int sequence, int size)
+{
+  std::vector<uint8_t> data(size);
+
+  for (auto i = 0; i < size; i++)
+    data[i] = SysExByte(sequence, i);
+
+  return queue.Push(sequence, data.data(), size);
+}
+
+/** Checks a message read from the queue, the sequence number travels as its offset */
+static bool IsSysExValid(const ISysEx& msg, int sequence, int size)
+{
+  if (msg.mOffset != sequence || msg.mSize != size)
+    return false;
+
+  for (auto i = 0; i < size; i++)
+  {
+    if (msg.mData[i] != SysExByte(sequence, i))
+      return false;
+  }
+
+  return true;
+}
+
+UNIT_TEST(IPlugSysExQueueSingleThreaded)
+{
+  // records are an 8 byte header and the message padded to 8 bytes, the largest message takes up half the ring
+  IPlugSysExQueue queue(64);
+  CHECK(queue.GetMaxMessageSize() == 24);
+  CHECK(queue.WasEmpty());
+
+  ISysEx msg;
+  CHECK(!queue.Read(msg));
+
+  // larger than the byte budget
+  CHECK(!PushSysEx(queue, 0, 25));
+  CHECK(!PushSysEx(queue, 0, 1000));
+  CHECK(queue.GetNumFailedPushes() == 2);
+  CHECK(queue.WasEmpty());
+
+  // a zero-length message takes a header
+  CHECK(queue.Push(3, nullptr, 0));
+  CHECK(queue.Read(msg));
+  CHECK(msg.mOffset == 3 && msg.mSize == 0);
+  CHECK(!queue.Read(msg));
+  queue.Release();
+
+  // a full ring. The write index stops a header short of the read index, so that a full ring doesn't look empty
+  int nPushed = 0;
+
+  while (PushSysEx(queue, nPushed, 8))
+    nPushed++;
+
+  CHECK(nPushed == 3);
+  CHECK(queue.GetNumFailedPushes() == 3);
+
+  // a zero-length message still fits in the last header before the end, after that the ring is full
+  CHECK(queue.Push(nPushed, nullptr, 0));
+  CHECK(!queue.Push(0, nullptr, 0));
+  CHECK(queue.GetNumFailedPushes() == 4);
+
+  ISysEx first;
+  CHECK(queue.Read(first));
+  CHECK(IsSysExValid(first, 0, 8));
+
+  for (auto i = 1; i < nPushed; i++)
+  {
+    CHECK(queue.Read(msg));
+    CHECK(IsSysExValid(msg, i, 8));
+  }
+
+  CHECK(queue.Read(msg));
+  CHECK(IsSysExValid(msg, nPushed, 0));
+
+  // until Release(), the messages that were read still hold their space and are not overwritten
+  CHECK(queue.WasEmpty());
+  CHECK(!queue.Read(msg));
+  CHECK(!PushSysEx(queue, 10, 8));
+  CHECK(IsSysExValid(first, 0, 8));
+  queue.Release();
+  CHECK(PushSysEx(queue, 10, 8));
+  CHECK(queue.Read(msg));
+  CHECK(IsSysExValid(msg, 10, 8));
+  queue.Release();
+}
+
+// a message that doesn't fit before the end of the ring is written at the start, whole, behind a marker that tells the reader to wrap
+UNIT_TEST(IPlugSysExQueueWrapsWholeMessages)
+{
+  IPlugSysExQueue queue(64);
+  ISysEx msg;
+
+  // two records of 24 bytes leave 16 at the end
+  CHECK(PushSysEx(queue, 0, 13));
+  CHECK(PushSysEx(queue, 1, 16));
+  CHECK(queue.Read(msg) && IsSysExValid(msg, 0, 13));
+  CHECK(queue.Read(msg) && IsSysExValid(msg, 1, 16));
+  const uint8_t* pEnd = msg.mData + 16;
+  queue.Release();
+
+  // this one straddles the end, so it goes to the start of the ring
+  CHECK(PushSysEx(queue, 2, 16));
+  CHECK(queue.Read(msg) && IsSysExValid(msg, 2, 16));
+  CHECK(msg.mData < pEnd - 24);
+
+  // a message that fits exactly in the space left, without wrapping
+  CHECK(PushSysEx(queue, 3, 8));
+  CHECK(queue.Read(msg) && IsSysExValid(msg, 3, 8));
+  queue.Release();
+
+  // a wrapped record that would end exactly at the read index doesn't fit either, the queue would look empty and lose the message in between
+  IPlugSysExQueue exact(64);
+  CHECK(PushSysEx(exact, 0, 16));
+  CHECK(PushSysEx(exact, 1, 16));
+  CHECK(exact.Read(msg) && IsSysExValid(msg, 0, 16));
+  exact.Release();
+  CHECK(!PushSysEx(exact, 2, 16));
+  CHECK(exact.Read(msg) && IsSysExValid(msg, 1, 16));
+  CHECK(!exact.Read(msg));
+
+  // when the read index is at the start, filling up to the end would catch up with it, so that fails
+  IPlugSysExQueue edge(32);
+  CHECK(PushSysEx(edge, 0, 8));
+  CHECK(!PushSysEx(edge, 1, 8));
+  CHECK(edge.Read(msg) && IsSysExValid(msg, 0, 8));
+  edge.Release();
+  CHECK(PushSysEx(edge, 1, 8));
+  CHECK(PushSysEx(edge, 2, 0));
+  CHECK(edge.Read(msg) && IsSysExValid(msg, 1, 8));
+  CHECK(edge.Read(msg) && IsSysExValid(msg, 2, 0));
+  CHECK(!edge.Read(msg));
+}
+
+/** Random message sizes, from empty to the largest, with reads in random batches and releases at random, compared with a list of what was pushed.
+ * Whenever everything has been released a message of any size up to GetMaxMessageSize() must fit */
+UNIT_TEST(IPlugSysExQueueMatchesReference)
+{
+  for (auto capacity : { 64, 200, 4096 })
+  {
+    IPlugSysExQueue queue(capacity);
+    TestRandom rand(capacity);
+    std::vector<int> pending; // the sizes of the pushed messages that have not been read
+    int nReadNotReleased = 0;
+    int nextPush = 0;
+    int nextRead = 0;
+    bool valid = true;
+    bool fitsWhenEmpty = true;
+
+    for (auto step = 0; step < 20000; step++)
+    {
+      if (rand.Int(2))
+      {
+        const int size = rand.Int(8) ? rand.Int(queue.GetMaxMessageSize() + 1) : queue.GetMaxMessageSize();
+        const bool isEmpty = pending.empty() && !nReadNotReleased;
+
+        if (PushSysEx(queue, nextPush, size))
+        {
+          pending.push_back(size);
+          nextPush++;
+        }
+        else if (isEmpty)
+          fitsWhenEmpty = false;
+      }
+      else
+      {
+        const int nToRead = rand.Int(4);
+        ISysEx msg;
+
+        for (auto i = 0; i < nToRead; i++)
+        {
+          const bool read = queue.Read(msg);
+
+          if (read != !pending.empty())
+            valid = false;
+
+          if (!read)
+            break;
+
+          valid &= IsSysExValid(msg, nextRead, pending.front());
+          pending.erase(pending.begin());
+          nextRead++;
+          nReadNotReleased++;
+        }
+
+        if (rand.Int(2))
+        {
+          queue.Release();
+          nReadNotReleased = 0;
+        }
+      }
+    }
+
+    CHECK(valid);
+    CHECK(fitsWhenEmpty);
+    CHECK(nextPush > 1000);
+  }
+}
+
+// the SysEx queue between two threads, with random sizes and random yields so that messages often wrap around the ring
+UNIT_TEST(IPlugSysExQueueStress)
+{
+  const int nMessages = 100000;
+  IPlugSysExQueue queue(256);
+  std::atomic<bool> failed { false };
+
+  std::thread producer([&]() {
+    TestRandom rand(1);
+
+    for (auto m = 0; m < nMessages; m++)
+    {
+      const int size = rand.Int(queue.GetMaxMessageSize() + 1);
+
+      while (!PushSysEx(queue, m, size))
+        std::this_thread::yield();
+
+      if (!rand.Int(8))
+        std::this_thread::yield();
+    }
+  });
+
+  TestRandom sizes(1);
+  TestRandom rand(2);
+  int expected = 0;
+
+  while (expected < nMessages)
+  {
+    ISysEx msg;
+    int nRead = 0;
+
+    while (nRead < 4 && queue.Read(msg))
+    {
+      // the producer draws the same sizes, in between its yields
+      const int size = sizes.Int(queue.GetMaxMessageSize() + 1);
+      sizes.Int(8);
+
+      if (!IsSysExValid(msg, expected, size))
+        failed.store(true);
+
+      expected++;
+      nRead++;
+    }
+
+    queue.Release();
+
+    if (!nRead || !rand.Int(8))
+      std::this_thread::yield();
+  }
+
+  producer.join();
+  CHECK(!failed.load());
+  CHECK(queue.WasEmpty());
+}
+
+/** Items per second through the queue from one thread to another
+ * @param batchSize 1 to use Push() and Pop(), otherwise PushN() and PopN() in batches of that size */
+static double MeasureThroughput(int capacity, int batchSize, uint64_t nItems)
+{
+  IPlugQueue<QueueItem> queue(capacity);
+  uint64_t sum = 0;
+
+  const double seconds = TimeSeconds([&]() {
+    std::thread producer([&]() {
+      QueueItem batch[64];
+      uint64_t next = 0;
+
+      while (next < nItems)
+      {
+        if (batchSize == 1)
+        {
+          if (queue.Push(QueueItem(next)))
+            next++;
+          else
+            std::this_thread::yield();
+        }
+        else
+        {
+          for (auto i = 0; i < batchSize; i++)
+            batch[i] = QueueItem(next + i);
+
+          const int nPushed = queue.PushN(batch, batchSize);
+          next += nPushed;
+
+          if (nPushed < batchSize)
+            std::this_thread::yield();
+        }
+      }
+    });
+
+    QueueItem batch[64];
+    uint64_t nReceived = 0;
+
+    while (nReceived < nItems)
+    {
+      int n = 0;
+
+      if (batchSize == 1)
+        n = queue.Pop(batch[0]) ? 1 : 0;
+      else
+        n = queue.PopN(batch, batchSize);
+
+      for (auto i = 0; i < n; i++)
+        sum += batch[i].id;
+
+      nReceived += n;
+
+      if (!n)
+        std::this_thread::yield();
+    }
+
+    producer.join();
+  });
+
+  CHECK(sum == nItems * (nItems - 1) / 2);
+  return nItems / seconds;
+}
+
+BENCHMARK(IPlugQueueBenchmark)
+{
+  const uint64_t nItems = 20000000;
+
+  printf("  two threads, 16 byte items through a 512 item queue, the size of IPlugAPIBase's parameter queues\n");
+  printf("    Push/Pop: %.1f M items/s\n", MeasureThroughput(512, 1, nItems) * 1e-6);
+  printf("    PushN/PopN, batches of 32: %.1f M items/s\n", MeasureThroughput(512, 32, nItems) * 1e-6);
+
+  // the round trip between two threads, each with its own queue
+  {
+    const int nRoundTrips = 20000;
+    IPlugQueue<QueueItem> ping(16), pong(16);
+
+    const double seconds = TimeSeconds([&]() {
+      std::thread echo([&]() {
+        QueueItem item;
+
+        for (auto i = 0; i < nRoundTrips; i++)
+        {
+          while (!ping.Pop(item))
+            std::this_thread::yield();
+
+          pong.Push(item);
+        }
+      });
+
+      QueueItem item;
+
+      for (auto i = 0; i < nRoundTrips; i++)
+      {
+        ping.Push(QueueItem(i));
+
+        while (!pong.Pop(item))
+          std::this_thread::yield();
+      }
+
+      echo.join();
+    });
+
+    printf("    round trip latency: %.2f us\n", 1e6 * seconds / nRoundTrips);
+  }
+
+  // one thread, without contention
+  {
+    const int nItemsSingle = 10000000;
+    IPlugQueue<QueueItem> queue(512);
+    QueueItem batch[32];
+    uint64_t sum = 0;
+
+    const double single = TimeSeconds([&]() {
+      QueueItem item;
+
+      for (auto i = 0; i < nItemsSingle; i++)
+      {
+        queue.Push(QueueItem(i));
+        queue.Pop(item);
+        sum += item.id;
+      }
+    });
+
+    const double batched = TimeSeconds([&]() {
+      for (auto i = 0; i < nItemsSingle; i += 32)
+      {
+        for (auto j = 0; j < 32; j++)
+          batch[j] = QueueItem(i + j);
+
+        queue.PushN(batch, 32);
+        queue.PopN(batch, 32);
+        sum += batch[31].id;
+      }
+    });
+
+    printf("  one thread: %.2f ns per push and pop, %.2f ns with PushN/PopN (%llu)\n", 1e9 * single / nItemsSingle, 1e9 * batched / nItemsSingle, (unsigned long long) sum);
+  }
+}
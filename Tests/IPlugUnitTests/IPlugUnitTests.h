@@ -0,0 +1,91 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief A minimal headless test runner for the IPlug utilities and the IPlug/Extras DSP, so that they can be checked without a host or a graphics backend.
+ * Each *Tests.cpp file registers its tests with UNIT_TEST() and its benchmarks with BENCHMARK(). Benchmarks only run when asked for, see main.cpp
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+struct UnitTest
+{
+  const char* mName;
+  void (*mFunc)();
+  bool mIsBenchmark;
+};
+
+std::vector<UnitTest>& GetUnitTests();
+
+/** Called by CHECK() when a condition fails */
+void ReportFailure(const char* file, int line, const char* expr);
+
+struct UnitTestRegistrar
+{
+  UnitTestRegistrar(const char* name, void (*func)(), bool isBenchmark)
+  {
+    GetUnitTests().push_back({name, func, isBenchmark});
+  }
+};
+
+#define UNIT_TEST(name) \
+  static void name(); \
+  static UnitTestRegistrar name##Registrar(#name, name, false); \
+  static void name()
+
+#define BENCHMARK(name) \
+  static void name(); \
+  static UnitTestRegistrar name##Registrar(#name, name, true); \
+  static void name()
+
+#define CHECK(cond) \
+  do { if (!(cond)) ReportFailure(__FILE__, __LINE__, #cond); } while (0)
+
+#define CHECK_CLOSE(a, b, tolerance) \
+  do { if (!(std::abs((double) (a) - (double) (b)) <= (double) (tolerance))) ReportFailure(__FILE__, __LINE__, #a " ~= " #b); } while (0)
+
+/** @return The time taken by func() in seconds */
+template <typename F>
+double TimeSeconds(F&& func)
+{
+  const auto start = std::chrono::steady_clock::now();
+  func();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/** A deterministic random number generator, so that failures can be reproduced */
+struct TestRandom
+{
+  uint32_t mState;
+
+  explicit TestRandom(uint32_t seed = 1) : mState(seed ? seed : 1) {}
+
+  uint32_t Next()
+  {
+    mState ^= mState << 13;
+    mState ^= mState >> 17;
+    mState ^= mState << 5;
+    return mState;
+  }
+
+  /** @return An integer from 0 to n - 1 */
+  int Int(int n) { return (int) (Next() % (uint32_t) n); }
+
+  /** @return A number from -1 to 1 */
+  double Bipolar() { return ((double) Next() / 2147483647.5) - 1.; }
+};
@@ -0,0 +1,59 @@
+# Builds the headless unit tests and benchmarks for the IPlug utilities and the IPlug/Extras DSP
+# usage, from this folder: make -f IPlugUnitTests.mk test   (or bench to run the benchmarks)
+
+IPLUG2_ROOT = ../..
+WDL_PATH = $(IPLUG2_ROOT)/WDL
+IPLUG_PATH = $(IPLUG2_ROOT)/IPlug
+IPLUG_EXTRAS_PATH = $(IPLUG_PATH)/Extras
+IPLUG_SYNTH_PATH = $(IPLUG_EXTRAS_PATH)/Synth
+
+INCLUDE_PATHS = -I$(WDL_PATH) \
+-I$(IPLUG_PATH) \
+-I$(IPLUG_EXTRAS_PATH) \
+-I$(IPLUG_SYNTH_PATH)
+
+SRC = main.cpp $(wildcard *Tests.cpp) \
+	$(WDL_PATH)/convoengine.cpp \
+	$(IPLUG_PATH)/IPlugAPIBase.cpp \
+	$(IPLUG_PATH)/IPlugPluginBase.cpp \
+	$(IPLUG_PATH)/IPlugParameter.cpp \
+	$(IPLUG_PATH)/IPlugTimer.cpp \
+	$(IPLUG_SYNTH_PATH)/MidiSynth.cpp \
+	$(IPLUG_SYNTH_PATH)/VoiceAllocator.cpp
+
+FFT_OBJ = build/fft.o
+
+CXX ?= c++
+
+CFLAGS = $(INCLUDE_PATHS) \
+-std=c++14 \
+-O2 \
+-DWDL_NO_DEFINE_MINMAX \
+-DNO_IGRAPHICS
+
+LDFLAGS = -lpthread
+
+TARGET = build/IPlugUnitTests
+
+# the code under test is mostly in headers, so any of them changing rebuilds the tests. IPlugProcessor.cpp is included by its header
+DEPS = $(wildcard *.h $(IPLUG_PATH)/*.h $(IPLUG_EXTRAS_PATH)/*.h $(IPLUG_SYNTH_PATH)/*.h) $(IPLUG_PATH)/IPlugProcessor.cpp
+
+$(TARGET): $(SRC) $(DEPS) $(FFT_OBJ) $(EXTRA_SRC)
+	mkdir -p $(dir $@)
+	$(CXX) $(CFLAGS) $(EXTRA_CFLAGS) -o $@ $(SRC) $(FFT_OBJ) $(EXTRA_SRC) $(LDFLAGS)
+
+# WDL's fft.c is C
+$(FFT_OBJ): $(WDL_PATH)/fft.c $(WDL_PATH)/fft.h
+	mkdir -p $(dir $@)
+	$(CC) -O2 $(EXTRA_CFLAGS) -c -o $@ $<
+
+test: $(TARGET)
+	$(TARGET)
+
+bench: $(TARGET)
+	$(TARGET) -b
+
+clean:
+	rm -rf build
+
+.PHONY: test bench clean
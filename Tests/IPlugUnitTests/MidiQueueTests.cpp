@@ -0,0 +1,285 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#include "IPlugUnitTests.h"
+
+#include <algorithm>
+
+#include "IPlugMidi.h"
+
+// each message carries a unique id, so that the order can be compared exactly
+static IMidiMsg MakeMsg(int offset, int id)
+{
+  IMidiMsg msg;
+  msg.mOffset = offset;
+  msg.mStatus = 0x90;
+  msg.mData1 = (uint8_t) (id & 0x7F);
+  msg.mData2 = (uint8_t) ((id >> 7) & 0x7F);
+  return msg;
+}
+
+static bool SameMsg(const IMidiMsg& a, const IMidiMsg& b)
+{
+  return a.mOffset == b.mOffset && a.mData1 == b.mData1 && a.mData2 == b.mData2;
+}
+
+static void StableSortByOffset(std::vector<IMidiMsg>& msgs)
+{
+  std::stable_sort(msgs.begin(), msgs.end(), [](const IMidiMsg& a, const IMidiMsg& b) { return a.mOffset < b.mOffset; });
+}
+
+static bool QueueMatches(IMidiQueue& queue, const std::vector<IMidiMsg>& expected)
+{
+  if (queue.ToDo() != (int) expected.size())
+    return false;
+
+  // Peek() only shows the front, so read the queue by removing and re-adding everything
+  std::vector<IMidiMsg> contents;
+
+  while (!queue.Empty())
+  {
+    contents.push_back(queue.Peek());
+    queue.Remove();
+  }
+
+  queue.Flush(0);
+
+  for (auto& msg : contents)
+    queue.Add(msg);
+
+  for (size_t i = 0; i < expected.size(); i++)
+  {
+    if (!SameMsg(contents[i], expected[i]))
+      return false;
+  }
+
+  return true;
+}
+
+// a random sorted run of messages
+static std::vector<IMidiMsg> MakeRun(TestRandom& rand, int maxMsgs, int maxOffset, int& nextId)
+{
+  std::vector<IMidiMsg> run;
+  const int nMsgs = rand.Int(maxMsgs + 1);
+
+  for (auto i = 0; i < nMsgs; i++)
+    run.push_back(MakeMsg(rand.Int(maxOffset), nextId++));
+
+  StableSortByOffset(run);
+  return run;
+}
+
+// Add(), Merge(), Remove() and Flush() against a reference model. Ties keep the order queue, source 0, source 1...
+static void FuzzQueue(IMidiQueue::EOverflowPolicy policy, int size, uint32_t seed)
+{
+  // N.B. the size is rounded up to a 4 kB page, so the fixed size queues hold 512 messages and the runs are long enough to overflow them
+  TestRandom rand(seed);
+  IMidiQueue queue(size, policy);
+  std::vector<IMidiMsg> model;
+  int nextId = 0;
+  int nDropped = 0;
+
+  for (auto step = 0; step < 2000; step++)
+  {
+    const int capacity = queue.GetSize();
+
+    switch (rand.Int(4))
+    {
+      case 0:
+      {
+        const IMidiMsg msg = MakeMsg(rand.Int(64), nextId++);
+        bool expectAdded = true;
+
+        if ((int) model.size() == capacity && policy != IMidiQueue::kGrow)
+        {
+          nDropped++;
+          expectAdded = false;
+
+          if (policy == IMidiQueue::kDropOldest)
+            model.erase(model.begin());
+        }
+
+        if (expectAdded || policy == IMidiQueue::kDropOldest)
+          model.insert(std::upper_bound(model.begin(), model.end(), msg, [](const IMidiMsg& a, const IMidiMsg& b) { return a.mOffset < b.mOffset; }), msg);
+
+        CHECK(queue.Add(msg) == expectAdded);
+        break;
+      }
+      case 1:
+      {
+        const int nSources = 1 + rand.Int(4);
+        std::vector<std::vector<IMidiMsg>> runs;
+        std::vector<IMidiQueue::Source> sources;
+        int nIncoming = 0;
+
+        for (auto s = 0; s < nSources; s++)
+        {
+          runs.push_back(MakeRun(rand, policy == IMidiQueue::kGrow ? 64 : capacity / 3, 64, nextId));
+          nIncoming += (int) runs.back().size();
+        }
+
+        for (auto& run : runs)
+          sources.push_back({run.data(), (int) run.size()});
+
+        int nExpectedDrops = policy == IMidiQueue::kGrow ? 0 : std::max(0, (int) model.size() + nIncoming - capacity);
+        int nDropFromFront = 0;
+
+        if (policy == IMidiQueue::kDropOldest)
+        {
+          const int nFromQueue = std::min(nExpectedDrops, (int) model.size());
+          model.erase(model.begin(), model.begin() + nFromQueue);
+          nDropFromFront = nExpectedDrops - nFromQueue;
+        }
+
+        for (auto& run : runs)
+          model.insert(model.end(), run.begin(), run.end());
+
+        StableSortByOffset(model);
+
+        if (policy == IMidiQueue::kDropOldest)
+          model.erase(model.begin(), model.begin() + nDropFromFront);
+        else if (policy == IMidiQueue::kDropNewest)
+          model.resize(model.size() - nExpectedDrops);
+
+        nDropped += nExpectedDrops;
+        CHECK(queue.Merge(sources.data(), nSources) == nExpectedDrops);
+
+        for (auto& src : sources)
+          CHECK(src.mNMsgs == 0);
+
+        break;
+      }
+      case 2:
+      {
+        for (auto n = rand.Int(8); n > 0 && !model.empty(); n--)
+        {
+          CHECK(SameMsg(queue.Peek(), model.front()));
+          queue.Remove();
+          model.erase(model.begin());
+        }
+        break;
+      }
+      case 3:
+      {
+        const int nFrames = rand.Int(32);
+
+        // like a block, everything due before the end of it is handled first
+        while (!model.empty() && model.front().mOffset < nFrames)
+        {
+          queue.Remove();
+          model.erase(model.begin());
+        }
+
+        queue.Flush(nFrames);
+
+        for (auto& msg : model)
+          msg.mOffset -= nFrames;
+
+        break;
+      }
+    }
+
+    CHECK(queue.ToDo() == (int) model.size());
+
+    if (step % 50 == 0)
+      CHECK(QueueMatches(queue, model));
+  }
+
+  CHECK(QueueMatches(queue, model));
+  CHECK(queue.GetNumDropped() == nDropped);
+
+  if (policy != IMidiQueue::kGrow)
+    CHECK(nDropped > 0); // the overflow paths were exercised
+}
+
+UNIT_TEST(MidiQueueFuzzGrow)
+{
+  for (uint32_t seed = 1; seed <= 20; seed++)
+    FuzzQueue(IMidiQueue::kGrow, 16, seed);
+}
+
+UNIT_TEST(MidiQueueFuzzDropNewest)
+{
+  for (uint32_t seed = 1; seed <= 20; seed++)
+    FuzzQueue(IMidiQueue::kDropNewest, 16, seed);
+}
+
+UNIT_TEST(MidiQueueFuzzDropOldest)
+{
+  for (uint32_t seed = 1; seed <= 20; seed++)
+    FuzzQueue(IMidiQueue::kDropOldest, 16, seed);
+}
+
+UNIT_TEST(MidiQueueGrowsByDefault)
+{
+  IMidiQueue queue(16);
+  const int initialSize = queue.GetSize();
+
+  for (auto i = 0; i < initialSize * 3; i++)
+    CHECK(queue.Add(MakeMsg(i, i)));
+
+  CHECK(queue.ToDo() == initialSize * 3);
+  CHECK(queue.GetSize() >= initialSize * 3);
+  CHECK(queue.GetNumDropped() == 0);
+}
+
+BENCHMARK(MidiQueueMergeBenchmark)
+{
+  // 4 sources of 128 interleaved messages each, merged behind 32 pending messages, with Merge() and with Add() for each message
+  const int nSources = 4, nPerSource = 128, nPending = 32, nReps = 20000;
+  std::vector<std::vector<IMidiMsg>> runs(nSources);
+
+  for (auto s = 0; s < nSources; s++)
+  {
+    for (auto i = 0; i < nPerSource; i++)
+      runs[s].push_back(MakeMsg((i * nSources) + s, (s * nPerSource) + i));
+  }
+
+  IMidiQueue queue(nPending + (nSources * nPerSource), IMidiQueue::kDropNewest);
+  int checksum = 0;
+
+  auto fillPending = [&]() {
+    queue.Clear();
+    for (auto i = 0; i < nPending; i++)
+      queue.Add(MakeMsg(i * 16, i));
+  };
+
+  const double mergeTime = TimeSeconds([&]() {
+    for (auto rep = 0; rep < nReps; rep++)
+    {
+      fillPending();
+      IMidiQueue::Source sources[nSources];
+
+      for (auto s = 0; s < nSources; s++)
+        sources[s] = {runs[s].data(), nPerSource};
+
+      queue.Merge(sources, nSources);
+      checksum += queue.Peek().mOffset;
+    }
+  });
+
+  const double addTime = TimeSeconds([&]() {
+    for (auto rep = 0; rep < nReps; rep++)
+    {
+      fillPending();
+
+      for (auto s = 0; s < nSources; s++)
+      {
+        for (auto& msg : runs[s])
+          queue.Add(msg);
+      }
+
+      checksum += queue.Peek().mOffset;
+    }
+  });
+
+  const double nMsgs = (double) nReps * nSources * nPerSource;
+  printf("  Merge(): %.1f M msgs/s, Add() per message: %.1f M msgs/s (checksum %i)\n", nMsgs / mergeTime * 1e-6, nMsgs / addTime * 1e-6, checksum);
+}
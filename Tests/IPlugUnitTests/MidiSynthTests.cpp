@@ -0,0 +1,284 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// first, to check that the header is self-contained
+#include "MidiSynth.h"
+
+#include "IPlugUnitTests.h"
+
+/** A voice that is busy from its trigger until its release has lasted mReleaseFrames, or until the test finishes it if that is negative */
+class MPETestVoice : public SynthVoice
+{
+public:
+  bool GetBusy() const override { return mIsBusy; }
+
+  void Trigger(double level, bool isRetrigger) override
+  {
+    mIsBusy = true;
+    mIsReleased = false;
+    mReleaseFramesLeft = mReleaseFrames;
+  }
+
+  void Release() override { mIsReleased = true; }
+
+  void ProcessSamplesAccumulating(sample** inputs, sample** outputs, int nInputs, int nOutputs, int startIdx, int nFrames) override
+  {
+    const double expression = mInputs[kVoiceControlPitchBend].endValue + mInputs[kVoiceControlPressure].endValue + mInputs[kVoiceControlTimbre].endValue;
+
+    for (auto s = startIdx; s < startIdx + nFrames; s++)
+      outputs[0][s] += expression;
+
+    if (mIsReleased && mReleaseFrames >= 0 && (mReleaseFramesLeft -= nFrames) <= 0)
+      mIsBusy = false;
+  }
+
+  bool IsHeld() const { return mIsBusy && !mIsReleased; }
+  int GetKey() const { return mKey; }
+  int GetChannel() const { return mChannel; }
+  double GetInput(int ctlIdx) const { return mInputs[ctlIdx].endValue; }
+
+  bool mIsBusy = false;
+  bool mIsReleased = false;
+  int mReleaseFrames = -1;
+  int mReleaseFramesLeft = 0;
+};
+
+/** A MidiSynth of MPETestVoices, with the MIDI messages to set it up and play it */
+struct MPETestSynth
+{
+  static constexpr int kMaxBlockSize = 512;
+
+  MidiSynth synth { VoiceAllocator::kPolyModePoly };
+  std::vector<MPETestVoice> voices;
+  std::vector<sample> output;
+
+  explicit MPETestSynth(int nVoices, int nZones = 1)
+  : voices(nVoices)
+  , output(kMaxBlockSize)
+  {
+    for (auto v = 0; v < nVoices; v++)
+      synth.AddVoice(&voices[v], (uint8_t) (v % nZones));
+
+    synth.SetSampleRateAndBlockSize(48000., kMaxBlockSize);
+    synth.SetControlGlideTime(0.);
+  }
+
+  void Send(const IMidiMsg& msg) { CHECK(synth.AddMidiMsgToQueue(msg)); }
+  void ControlChange(int channel, int idx, int value, int offset = 0) { Send(IMidiMsg(offset, (uint8_t) ((IMidiMsg::kControlChange << 4) | channel), (uint8_t) idx, (uint8_t) value)); }
+
+  /** Send a registered parameter number, e.g. 6 to configure an MPE zone from its master channel */
+  void RPN(int channel, int param, int value)
+  {
+    ControlChange(channel, 0x65, param >> 7);
+    ControlChange(channel, 0x64, param & 0x7F);
+    ControlChange(channel, 0x06, value);
+  }
+
+  void NoteOn(int channel, int key, int offset = 0) { IMidiMsg msg; msg.MakeNoteOnMsg(key, 100, offset, channel); Send(msg); }
+  void NoteOff(int channel, int key, int offset = 0) { IMidiMsg msg; msg.MakeNoteOffMsg(key, offset, channel); Send(msg); }
+  void PitchBend(int channel, double value, int offset = 0) { IMidiMsg msg; msg.MakePitchWheelMsg(value, channel, offset); Send(msg); }
+  void Pressure(int channel, int value, int offset = 0) { IMidiMsg msg; msg.MakeChannelATMsg(value, offset, channel); Send(msg); }
+  void Timbre(int channel, int value, int offset = 0) { ControlChange(channel, IMidiMsg::kCutoffFrequency, value, offset); }
+
+  void Process(int nFrames = 64)
+  {
+    sample* pOutput = output.data();
+    std::fill(output.begin(), output.begin() + nFrames, 0.);
+    synth.ProcessBlock(nullptr, &pOutput, 0, 1, nFrames);
+  }
+
+  /** @return The index of the voice playing the key on the channel with its gate on, or -1 */
+  int HeldVoice(int channel, int key) const
+  {
+    for (auto v = 0; v < (int) voices.size(); v++)
+    {
+      if (voices[v].IsHeld() && voices[v].GetKey() == key && voices[v].GetChannel() == channel)
+        return v;
+    }
+
+    return -1;
+  }
+};
+
+// the pitch bend of an MPE member channel, whose range is 48 semitones, in octaves
+static double MemberChannelBend(double value)
+{
+  return value * 48. / 12.;
+}
+
+// expression on a member channel goes to the voices that are busy on that channel, including one that is releasing, and in the zone of the channel
+UNIT_TEST(MidiSynthMPEExpressionReachesOnlyItsChannel)
+{
+  MPETestSynth test(5, 2); // voices 0, 2 and 4 are in the lower zone, 1 and 3 in the upper one
+  test.RPN(0, 6, 7); // lower zone, member channels 1 to 7
+  test.RPN(15, 6, 7); // upper zone, member channels 8 to 14
+  test.Process();
+
+  // voice allocation ignores the zone, so voice 3 plays a lower zone channel
+  test.NoteOn(1, 60);
+  test.NoteOn(9, 62);
+  test.NoteOn(2, 64);
+  test.NoteOn(3, 65);
+  test.NoteOn(4, 67);
+  test.NoteOff(4, 67, 10);
+  test.Process();
+  CHECK(test.HeldVoice(1, 60) == 0 && test.HeldVoice(9, 62) == 1 && test.HeldVoice(2, 64) == 2 && test.HeldVoice(3, 65) == 3);
+  CHECK(test.voices[4].mIsReleased && test.voices[4].mIsBusy);
+
+  test.Pressure(1, 100);
+  test.PitchBend(9, 0.25);
+  test.Timbre(4, 64);
+  test.Pressure(3, 50);
+  test.Process();
+
+  CHECK_CLOSE(test.voices[0].GetInput(kVoiceControlPressure), 100. / 127., 1e-6);
+  CHECK_CLOSE(test.voices[1].GetInput(kVoiceControlPitchBend), MemberChannelBend(0.25), 1e-6);
+  CHECK_CLOSE(test.voices[4].GetInput(kVoiceControlTimbre), 64. / 127., 1e-6);
+  CHECK(test.voices[3].GetInput(kVoiceControlPressure) == 0.); // on the channel, but in the other zone
+
+  for (auto v = 0; v < 5; v++)
+  {
+    if (v != 0)
+      CHECK(test.voices[v].GetInput(kVoiceControlPressure) == 0.);
+
+    if (v != 1)
+      CHECK(test.voices[v].GetInput(kVoiceControlPitchBend) == 0.);
+
+    if (v != 4)
+      CHECK(test.voices[v].GetInput(kVoiceControlTimbre) == 0.);
+  }
+
+  // once its release has finished, a voice no longer follows the channel it last played on
+  test.voices[4].mIsBusy = false;
+  test.Process();
+  test.Timbre(4, 127);
+  test.Process();
+  CHECK_CLOSE(test.voices[4].GetInput(kVoiceControlTimbre), 64. / 127., 1e-6);
+}
+
+// a note on that follows expression on its channel starts at that expression, in the same block and in a later one
+UNIT_TEST(MidiSynthMPENoteOnStartsAtChannelExpression)
+{
+  MPETestSynth test(1);
+  test.RPN(0, 6, 15);
+  test.Process();
+
+  test.PitchBend(5, 0.5, 0);
+  test.Pressure(5, 80, 2);
+  test.Timbre(5, 32, 4);
+  test.NoteOn(5, 60, 8);
+  test.Process();
+
+  const int v = test.HeldVoice(5, 60);
+  CHECK(v == 0);
+  CHECK_CLOSE(test.voices[v].GetInput(kVoiceControlPitchBend), MemberChannelBend(0.5), 1e-6);
+  CHECK_CLOSE(test.voices[v].GetInput(kVoiceControlPressure), 80. / 127., 1e-6);
+  CHECK_CLOSE(test.voices[v].GetInput(kVoiceControlTimbre), 32. / 127., 1e-6);
+
+  // expression sent before the block of the note on, which reuses the voice, so it doesn't start from the values of its last note
+  test.PitchBend(6, -0.25);
+  test.Process();
+  test.NoteOff(5, 60);
+  test.voices[v].mReleaseFrames = 0;
+  test.Process();
+  CHECK(!test.voices[v].mIsBusy);
+
+  test.NoteOn(6, 61, 40);
+  test.Process();
+  CHECK(test.HeldVoice(6, 61) == v);
+  CHECK_CLOSE(test.voices[v].GetInput(kVoiceControlPitchBend), MemberChannelBend(-0.25), 1e-6);
+}
+
+// setting both zones to no member channels leaves MPE mode and forgets the expression of the member channels, so notes in basic MIDI mode start without it
+UNIT_TEST(MidiSynthLeavingMPEClearsChannelExpression)
+{
+  MPETestSynth test(4);
+  test.RPN(0, 6, 15);
+  test.PitchBend(2, 0.5);
+  test.Pressure(2, 100);
+  test.Process();
+
+  test.RPN(0, 6, 0);
+  test.Process();
+
+  test.NoteOn(2, 60);
+  test.Process();
+  const int v = test.HeldVoice(2, 60);
+  CHECK(v == 0);
+  CHECK(test.voices[v].GetInput(kVoiceControlPitchBend) == 0.);
+  CHECK(test.voices[v].GetInput(kVoiceControlPressure) == 0.);
+
+  // in basic MIDI mode, expression goes through the voice allocator's queue to the voices on the channel
+  test.Pressure(2, 127);
+  test.Process();
+  CHECK_CLOSE(test.voices[v].GetInput(kVoiceControlPressure), 1., 1e-6);
+}
+
+/** Ten fingers, each on an MPE member channel of its own, sending pitch bend, pressure and timbre every 32 samples and playing a new note every few blocks,
+ * in 512 frame blocks. In basic MIDI mode the same messages go through the voice allocator's event queue */
+BENCHMARK(MidiSynthMPEBenchmark)
+{
+  const int nFingers = 10;
+  const int nFrames = MPETestSynth::kMaxBlockSize;
+  const int nBlocks = 2000;
+  const int expressionInterval = 32;
+
+  for (auto mpe : { true, false })
+  {
+    MPETestSynth test(16);
+
+    for (auto& voice : test.voices)
+      voice.mReleaseFrames = 1024;
+
+    if (mpe)
+    {
+      test.RPN(0, 6, 15);
+      test.Process();
+    }
+
+    int key[nFingers] = {};
+    int nMessages = 0;
+    TestRandom rand(11);
+
+    const double seconds = TimeSeconds([&]() {
+      for (auto b = 0; b < nBlocks; b++)
+      {
+        for (auto f = 0; f < nFingers; f++)
+        {
+          if ((b + f) % 8 == 0)
+          {
+            if (key[f])
+              test.NoteOff(1 + f, key[f]);
+
+            key[f] = 48 + rand.Int(24);
+            test.NoteOn(1 + f, key[f]);
+            nMessages += 2;
+          }
+        }
+
+        for (auto offset = 0; offset < nFrames; offset += expressionInterval)
+        {
+          for (auto f = 0; f < nFingers; f++)
+          {
+            test.PitchBend(1 + f, rand.Bipolar() * 0.1, offset);
+            test.Pressure(1 + f, rand.Int(128), offset);
+            test.Timbre(1 + f, rand.Int(128), offset);
+            nMessages += 3;
+          }
+        }
+
+        test.Process(nFrames);
+      }
+    });
+
+    printf("  %s: %.1f ns per MIDI message, %.2f us per %d frame block (%g)\n", mpe ? "MPE" : "basic MIDI", 1e9 * seconds / nMessages, 1e6 * seconds / nBlocks, nFrames, test.output[0]);
+    CHECK(test.synth.GetNumDroppedMidiMsgs() == 0);
+  }
+}
@@ -0,0 +1,340 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// first, to check that the header is self-contained
+#include "ModMatrix.h"
+
+#include "IPlugUnitTests.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+using TestMatrix = ModMatrix<double>;
+
+static double ApplyCurve(TestMatrix::ECurve curve, double x)
+{
+  switch (curve)
+  {
+    case TestMatrix::kCurveSquared: return x * std::abs(x);
+    case TestMatrix::kCurveCubed: return x * x * x;
+    case TestMatrix::kCurveBipolar: return 2. * x - 1.;
+    case TestMatrix::kCurveInverted: return 1. - x;
+    default: return x;
+  }
+}
+
+struct TestRouting
+{
+  int source;
+  int destination;
+  double depth;
+  TestMatrix::ECurve curve;
+};
+
+/** Sums depth * curve(source) for each routing, sample by sample, the way the matrix is documented to.
+ * pSources returns the buffer of a source as the voice sees it */
+template <typename F>
+static std::vector<double> ExpectedDestination(const std::vector<TestRouting>& routings, int destination, F&& pSources, int nFrames)
+{
+  std::vector<double> expected(nFrames, 0.);
+
+  for (const auto& routing : routings)
+  {
+    if (routing.destination != destination)
+      continue;
+
+    const double* pSource = pSources(routing.source);
+
+    for (auto s = 0; s < nFrames; s++)
+      expected[s] += routing.depth * ApplyCurve(routing.curve, pSource[s]);
+  }
+
+  return expected;
+}
+
+static double MaxDifference(const double* pA, const double* pB, int nFrames)
+{
+  double maxDiff = 0.;
+
+  for (auto s = 0; s < nFrames; s++)
+    maxDiff = std::max(maxDiff, std::abs(pA[s] - pB[s]));
+
+  return maxDiff;
+}
+
+// random routings with every curve, global and per voice sources, several routings per destination, all compared with sums computed by hand
+UNIT_TEST(ModMatrixMatchesReference)
+{
+  const int nSources = 6;
+  const int nDestinations = 5;
+  const int nVoices = 4;
+  const int maxFrames = 32;
+  const int hostBlock = 96;
+  TestRandom rand(7);
+
+  for (auto trial = 0; trial < 50; trial++)
+  {
+    TestMatrix matrix(nSources, nDestinations);
+    matrix.Resize(nVoices, maxFrames);
+
+    // sources 0 and 1 are global, with buffers for the whole host block
+    std::vector<std::vector<double>> globalSources(2, std::vector<double>(hostBlock));
+
+    for (auto& buffer : globalSources)
+    {
+      for (auto& s : buffer)
+        s = rand.Bipolar();
+    }
+
+    matrix.SetGlobalSource(0, globalSources[0].data());
+    matrix.SetGlobalSource(1, globalSources[1].data());
+
+    std::vector<TestRouting> routings;
+    const int nRoutings = 1 + rand.Int(12);
+
+    for (auto r = 0; r < nRoutings; r++)
+    {
+      const TestRouting routing { rand.Int(nSources), rand.Int(nDestinations), rand.Bipolar(), (TestMatrix::ECurve) rand.Int(TestMatrix::kNumCurves) };
+      CHECK(matrix.AddRouting(routing.source, routing.destination, routing.depth, routing.curve) == r);
+      routings.push_back(routing);
+    }
+
+    CHECK(matrix.NActiveRoutings() == nRoutings);
+
+    // each voice processes the host block in sub-blocks, the way MidiSynth does
+    for (auto startIdx = 0; startIdx < hostBlock; startIdx += maxFrames)
+    {
+      const int nFrames = std::min(maxFrames, hostBlock - startIdx);
+
+      for (auto v = 0; v < nVoices; v++)
+      {
+        for (auto src = 2; src < nSources; src++)
+        {
+          double* pSource = matrix.GetVoiceSource(v, src);
+
+          for (auto s = 0; s < nFrames; s++)
+            pSource[s] = rand.Bipolar();
+        }
+
+        matrix.ProcessVoice(v, startIdx, nFrames);
+
+        auto getSource = [&](int src) -> const double* {
+          return src < 2 ? globalSources[src].data() + startIdx : matrix.GetVoiceSource(v, src);
+        };
+
+        for (auto dst = 0; dst < nDestinations; dst++)
+        {
+          const auto expected = ExpectedDestination(routings, dst, getSource, nFrames);
+          CHECK(MaxDifference(matrix.GetDestination(v, dst), expected.data(), nFrames) < 1e-12);
+
+          bool isRouted = false;
+
+          for (const auto& routing : routings)
+            isRouted |= routing.destination == dst;
+
+          CHECK(matrix.IsModulated(dst) == isRouted);
+        }
+      }
+    }
+  }
+}
+
+UNIT_TEST(ModMatrixChangesRoutings)
+{
+  const int nFrames = 16;
+  TestMatrix matrix(2, 2);
+  matrix.Resize(1, nFrames);
+
+  for (auto src = 0; src < 2; src++)
+  {
+    double* pSource = matrix.GetVoiceSource(0, src);
+
+    for (auto s = 0; s < nFrames; s++)
+      pSource[s] = src + 1.;
+  }
+
+  const int a = matrix.AddRouting(0, 0, 0.5);
+  const int b = matrix.AddRouting(1, 0, 0.25);
+  CHECK(matrix.AddRouting(2, 0, 1.) == -1);
+  CHECK(matrix.AddRouting(0, 2, 1.) == -1);
+
+  matrix.ProcessVoice(0, 0, nFrames);
+  CHECK_CLOSE(matrix.GetDestination(0, 0)[nFrames - 1], 0.5 + 0.5, 1e-15);
+  CHECK(!matrix.IsModulated(1));
+  CHECK(matrix.GetDestination(0, 1)[0] == 0.);
+
+  // depth 0 keeps the routing but stops evaluating it, and the remaining routing overwrites the previous block
+  matrix.SetRoutingDepth(a, 0.);
+  CHECK(matrix.NActiveRoutings() == 1);
+  matrix.ProcessVoice(0, 0, nFrames);
+  CHECK_CLOSE(matrix.GetDestination(0, 0)[0], 0.5, 1e-15);
+
+  matrix.SetRoutingDepth(a, 1.);
+  matrix.SetRoutingCurve(b, TestMatrix::kCurveInverted);
+  matrix.ProcessVoice(0, 0, nFrames);
+  CHECK_CLOSE(matrix.GetDestination(0, 0)[0], 1. + 0.25 * (1. - 2.), 1e-15);
+
+  // moving a routing to another destination
+  CHECK(matrix.SetRouting(b, 1, 1, 2.));
+  CHECK(!matrix.SetRouting(b, 1, 5, 2.));
+  CHECK(!matrix.SetRouting(TestMatrix::kMaxRoutings, 1, 1, 2.));
+  matrix.ProcessVoice(0, 0, nFrames);
+  CHECK_CLOSE(matrix.GetDestination(0, 0)[0], 1., 1e-15);
+  CHECK_CLOSE(matrix.GetDestination(0, 1)[0], 4., 1e-15);
+
+  matrix.RemoveRouting(a);
+  CHECK(!matrix.IsModulated(0));
+  CHECK(matrix.GetDestination(0, 0)[0] == 0.);
+  CHECK(matrix.AddRouting(0, 0, 1.) == a); // the freed slot is reused
+
+  matrix.ClearRoutings();
+  CHECK(matrix.NActiveRoutings() == 0);
+
+  // every slot can be used
+  for (auto r = 0; r < TestMatrix::kMaxRoutings; r++)
+    CHECK(matrix.AddRouting(r % 2, r % 2, 1.) == r);
+
+  CHECK(matrix.AddRouting(0, 0, 1.) == -1);
+}
+
+UNIT_TEST(ModMatrixQueuedChanges)
+{
+  const int nFrames = 8;
+  TestMatrix matrix(1, 1);
+  matrix.Resize(1, nFrames);
+  double* pSource = matrix.GetVoiceSource(0, 0);
+
+  for (auto s = 0; s < nFrames; s++)
+    pSource[s] = 1.;
+
+  // queued changes only apply on ProcessQueuedChanges(), in order
+  CHECK(matrix.QueueRouting(3, 0, 0, 0.5));
+  CHECK(matrix.QueueRouting(3, 0, 0, 0.75));
+  CHECK(matrix.QueueRouting(5, 0, 0, 2., TestMatrix::kCurveInverted));
+  CHECK(matrix.QueueRouting(6, 0, 4, 1.)); // out of range, ignored
+  CHECK(matrix.NActiveRoutings() == 0);
+
+  matrix.ProcessQueuedChanges();
+  CHECK(matrix.NActiveRoutings() == 2);
+  matrix.ProcessVoice(0, 0, nFrames);
+  CHECK_CLOSE(matrix.GetDestination(0, 0)[0], 0.75, 1e-15);
+
+  CHECK(matrix.QueueRouting(3, -1, 0, 0.));
+  matrix.ProcessQueuedChanges();
+  CHECK(matrix.NActiveRoutings() == 1);
+
+  // a full queue drops changes rather than allocating
+  int nQueued = 0;
+
+  while (matrix.QueueRouting(0, 0, 0, 1.))
+    nQueued++;
+
+  CHECK(nQueued == TestMatrix::kMaxRoutings);
+  matrix.ProcessQueuedChanges();
+  CHECK(matrix.NActiveRoutings() == 2);
+}
+
+// the UI thread changes depths while the audio thread processes. The destination is always one of the depths that was queued
+UNIT_TEST(ModMatrixQueuedChangesFromAnotherThread)
+{
+  const int nFrames = 32;
+  const int nChanges = 20000;
+  TestMatrix matrix(1, 1);
+  matrix.Resize(1, nFrames);
+  double* pSource = matrix.GetVoiceSource(0, 0);
+
+  for (auto s = 0; s < nFrames; s++)
+    pSource[s] = 1.;
+
+  matrix.AddRouting(0, 0, 1.);
+
+  std::atomic<bool> done { false };
+
+  std::thread ui([&]() {
+    for (auto i = 1; i <= nChanges; i++)
+    {
+      while (!matrix.QueueRouting(0, 0, 0, (double) i))
+        std::this_thread::yield();
+    }
+
+    done.store(true);
+  });
+
+  double lastDepth = 1.;
+  bool inOrder = true;
+
+  while (true)
+  {
+    const bool finished = done.load();
+    matrix.ProcessQueuedChanges();
+    matrix.ProcessVoice(0, 0, nFrames);
+    const double* pDestination = matrix.GetDestination(0, 0);
+
+    inOrder &= pDestination[0] >= lastDepth && pDestination[0] == std::floor(pDestination[0]) && pDestination[nFrames - 1] == pDestination[0];
+    lastDepth = pDestination[0];
+
+    if (finished)
+      break;
+
+    std::this_thread::yield();
+  }
+
+  ui.join();
+  CHECK(inOrder);
+  CHECK(lastDepth == (double) nChanges);
+}
+
+// 16 routings across 32 voices at 32 frame blocks, the IPlugInstrument configuration
+BENCHMARK(ModMatrixBenchmark)
+{
+  const int nSources = 8;
+  const int nDestinations = 8;
+  const int nVoices = 32;
+  const int nFrames = 32;
+  const int nBlocks = 20000;
+  TestRandom rand(3);
+
+  for (auto nRoutings : { 4, 16, 64 })
+  {
+    ModMatrix<double> matrix(nSources, nDestinations);
+    matrix.Resize(nVoices, nFrames);
+
+    for (auto r = 0; r < nRoutings; r++)
+      matrix.AddRouting(rand.Int(nSources), rand.Int(nDestinations), 0.5, (ModMatrix<double>::ECurve) rand.Int(ModMatrix<double>::kNumCurves));
+
+    for (auto v = 0; v < nVoices; v++)
+    {
+      for (auto src = 0; src < nSources; src++)
+      {
+        double* pSource = matrix.GetVoiceSource(v, src);
+
+        for (auto s = 0; s < nFrames; s++)
+          pSource[s] = rand.Bipolar();
+      }
+    }
+
+    double sum = 0.;
+
+    const double seconds = TimeSeconds([&]() {
+      for (auto b = 0; b < nBlocks; b++)
+      {
+        for (auto v = 0; v < nVoices; v++)
+        {
+          matrix.ProcessVoice(v, 0, nFrames);
+          sum += matrix.GetDestination(v, b % nDestinations)[0];
+        }
+      }
+    });
+
+    const double nRoutingSamples = (double) nRoutings * nVoices * nFrames * nBlocks;
+    printf("  %2d routings, %d voices: %.3f ns per routing per sample (%g)\n", nRoutings, nVoices, 1e9 * seconds / nRoutingSamples, sum);
+  }
+}
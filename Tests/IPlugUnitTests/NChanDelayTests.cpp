@@ -0,0 +1,179 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// first, to check that the header is self-contained
+#include "NChanDelay.h"
+
+#include "IPlugUnitTests.h"
+
+/** A delay that keeps all of its input. The ring of NChanDelayLine forgets its input when it is cleared or reallocated, which is modelled by validFrom */
+struct ReferenceDelay
+{
+  std::vector<std::vector<double>> history;
+  int64_t validFrom = 0;
+  int delay = 0;
+
+  explicit ReferenceDelay(int nChans) : history(nChans) {}
+
+  void Process(const std::vector<std::vector<double>>& input, std::vector<std::vector<double>>& output, int nFrames)
+  {
+    for (auto c = 0; c < (int) history.size(); c++)
+    {
+      const int64_t start = (int64_t) history[c].size();
+      history[c].insert(history[c].end(), input[c].begin(), input[c].begin() + nFrames);
+
+      for (auto s = 0; s < nFrames; s++)
+      {
+        const int64_t readPos = start + s - delay;
+        output[c][s] = readPos >= validFrom ? history[c][readPos] : 0.;
+      }
+    }
+  }
+
+  int64_t NFramesProcessed() const { return (int64_t) history[0].size(); }
+};
+
+static void FillRandom(std::vector<std::vector<double>>& buffers, int nFrames, TestRandom& rand)
+{
+  for (auto& buffer : buffers)
+  {
+    for (auto s = 0; s < nFrames; s++)
+      buffer[s] = rand.Bipolar();
+  }
+}
+
+/** Runs a delay line and the reference with the same random blocks and delay changes
+ * @param nextDelay Called before each block with the frame count so far, returns the delay time for the block, or -1 to keep it
+ * @return The largest difference between them */
+template <typename F>
+static double CompareWithReference(int nChans, int maxDelay, int maxBlockSize, bool inPlace, int nBlocks, uint32_t seed, F&& nextDelay)
+{
+  NChanDelayLine<double> delay(nChans, nChans);
+  ReferenceDelay reference(nChans);
+  delay.SetMaxDelayTime(maxDelay);
+
+  TestRandom rand(seed);
+  std::vector<std::vector<double>> input(nChans, std::vector<double>(maxBlockSize));
+  std::vector<std::vector<double>> output(nChans, std::vector<double>(maxBlockSize));
+  std::vector<std::vector<double>> expected(nChans, std::vector<double>(maxBlockSize));
+  std::vector<double*> pInputs(nChans), pOutputs(nChans);
+  double maxError = 0.;
+
+  for (auto b = 0; b < nBlocks; b++)
+  {
+    const int nFrames = 1 + rand.Int(maxBlockSize);
+    const int delayTime = nextDelay(reference.NFramesProcessed());
+
+    if (delayTime >= 0 && delayTime != reference.delay)
+    {
+      // growing past the reserved storage reallocates and starting from 0 clears the ring, either way the earlier input is gone
+      if (delayTime > maxDelay || reference.delay == 0)
+        reference.validFrom = reference.NFramesProcessed();
+
+      maxDelay = std::max(maxDelay, delayTime);
+      delay.SetDelayTime(delayTime);
+      reference.delay = delayTime;
+    }
+
+    FillRandom(input, nFrames, rand);
+    reference.Process(input, expected, nFrames);
+
+    for (auto c = 0; c < nChans; c++)
+    {
+      if (inPlace)
+      {
+        output[c] = input[c];
+        pInputs[c] = pOutputs[c] = output[c].data();
+      }
+      else
+      {
+        pInputs[c] = input[c].data();
+        pOutputs[c] = output[c].data();
+      }
+    }
+
+    delay.ProcessBlock(pInputs.data(), pOutputs.data(), nFrames);
+
+    for (auto c = 0; c < nChans; c++)
+    {
+      for (auto s = 0; s < nFrames; s++)
+        maxError = std::max(maxError, std::abs(output[c][s] - expected[c][s]));
+    }
+  }
+
+  return maxError;
+}
+
+UNIT_TEST(NChanDelayMatchesReference)
+{
+  for (auto inPlace : { false, true })
+  {
+    // blocks shorter than the delay, and blocks several times kMinChunkSize, which are moved through the ring in chunks
+    CHECK(CompareWithReference(2, 100, 64, inPlace, 500, 1, [](int64_t) { return 100; }) == 0.);
+    CHECK(CompareWithReference(2, 100, 5000, inPlace, 100, 2, [](int64_t) { return 100; }) == 0.);
+    CHECK(CompareWithReference(3, 4000, 9000, inPlace, 100, 3, [](int64_t) { return 4000; }) == 0.);
+    CHECK(CompareWithReference(1, 1, 3 * NChanDelayLine<double>::kMinChunkSize, inPlace, 100, 4, [](int64_t) { return 1; }) == 0.);
+
+    // no delay copies the input
+    CHECK(CompareWithReference(2, 0, 512, inPlace, 50, 5, [](int64_t) { return 0; }) == 0.);
+  }
+}
+
+UNIT_TEST(NChanDelayChangesDelayTime)
+{
+  for (auto inPlace : { false, true })
+  {
+    // within the reserved storage, a new delay time reads back the input that is already in the ring
+    TestRandom delays(6);
+    CHECK(CompareWithReference(2, 2000, 3000, inPlace, 300, 7, [&](int64_t) { return delays.Int(4) ? -1 : delays.Int(2001); }) == 0.);
+
+    // beyond it, the ring is reallocated. The delay times only grow, a few times past each new maximum
+    int delayTime = 10;
+    CHECK(CompareWithReference(2, 10, 700, inPlace, 300, 8, [&](int64_t) { return delays.Int(16) ? -1 : (delayTime += 1 + delays.Int(500)); }) == 0.);
+
+    // from 0 to a delay and back
+    CHECK(CompareWithReference(2, 500, 700, inPlace, 300, 9, [&](int64_t) { return delays.Int(8) ? -1 : (delays.Int(2) ? 0 : delays.Int(501)); }) == 0.);
+  }
+}
+
+UNIT_TEST(NChanDelayZeroesUnmatchedOutputs)
+{
+  const int nFrames = 256;
+  NChanDelayLine<double> delay(1, 3);
+  delay.SetDelayTime(10);
+
+  std::vector<double> input(nFrames, 1.);
+  std::vector<std::vector<double>> outputs(3, std::vector<double>(nFrames, 123.));
+  double* pInputs[] = { input.data() };
+  double* pOutputs[] = { outputs[0].data(), outputs[1].data(), outputs[2].data() };
+
+  delay.ProcessBlock(pInputs, pOutputs, nFrames);
+
+  CHECK(outputs[0][9] == 0. && outputs[0][10] == 1. && outputs[0][nFrames - 1] == 1.);
+
+  for (auto c = 1; c < 3; c++)
+  {
+    bool silent = true;
+
+    for (auto s : outputs[c])
+      silent &= s == 0.;
+
+    CHECK(silent);
+  }
+
+  // more inputs than outputs, the extra inputs are ignored
+  NChanDelayLine<double> narrow(3, 1);
+  narrow.SetDelayTime(0);
+  std::vector<double> out(nFrames, 0.);
+  double* pIn3[] = { input.data(), input.data(), input.data() };
+  double* pOut1[] = { out.data() };
+  narrow.ProcessBlock(pIn3, pOut1, nFrames);
+  CHECK(out[0] == 1.);
+}
@@ -0,0 +1,150 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// first, to check that the header is self-contained
+#include "STFT.h"
+
+#include "IPlugUnitTests.h"
+
+using STFT = STFTProcessor<double>;
+
+/** Run noise through an STFT that leaves the spectrum unchanged, and @return the largest difference between the output and the delayed input */
+static double ReconstructionError(STFT& stft, int nBlocks, int blockSize, bool waitForWorker)
+{
+  const int nChans = 2, nFrames = nBlocks * blockSize, latency = stft.GetLatency();
+  TestRandom rand(13);
+  std::vector<double> input[nChans], output[nChans];
+
+  for (auto c = 0; c < nChans; c++)
+  {
+    input[c].resize(nFrames);
+    output[c].resize(nFrames);
+
+    for (auto& s : input[c])
+      s = rand.Bipolar();
+  }
+
+  for (auto b = 0; b < nBlocks; b++)
+  {
+    double* inputs[nChans] = { input[0].data() + (b * blockSize), input[1].data() + (b * blockSize) };
+    double* outputs[nChans] = { output[0].data() + (b * blockSize), output[1].data() + (b * blockSize) };
+    stft.ProcessBlock(inputs, outputs, blockSize);
+
+    // give the worker the time a real-time host would
+    if (waitForWorker)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  double maxError = 0.;
+
+  for (auto c = 0; c < nChans; c++)
+  {
+    for (auto s = latency; s < nFrames; s++)
+      maxError = std::max(maxError, std::abs(output[c][s] - input[c][s - latency]));
+  }
+
+  return maxError;
+}
+
+UNIT_TEST(STFTReconstructsInput)
+{
+  const STFT::EWindowType windows[] = { STFT::kHannWindow, STFT::kHammingWindow, STFT::kBlackmanWindow, STFT::kRectangularWindow };
+
+  for (auto window : windows)
+  {
+    for (auto overlap : { 1, 2, 4, 8 })
+    {
+      STFT stft(2);
+      stft.SetFFTSize(512, overlap, window);
+      stft.SetComplexFunc([](int, WDL_FFT_COMPLEX*, int) {});
+      const auto error = ReconstructionError(stft, 40, 100, false);
+
+      // see the class documentation: the first sample of each hop is lost, but no more than that
+      if (overlap == 1 && (window == STFT::kHannWindow || window == STFT::kBlackmanWindow))
+      {
+        CHECK(error <= 1.);
+        continue;
+      }
+
+      if (error > 1e-5)
+        printf("  window %d, overlap %d: max error %g\n", window, overlap, error);
+      CHECK(error <= 1e-5);
+    }
+  }
+}
+
+// the polar conversion round trip is not exact, but close
+UNIT_TEST(STFTPolarReconstructsInput)
+{
+  STFT stft(2);
+  stft.SetFFTSize(1024, 4);
+  stft.SetPolarFunc([](int, WDL_FFT_REAL*, WDL_FFT_REAL*, int) {});
+  CHECK(ReconstructionError(stft, 40, 128, false) <= 1e-4);
+}
+
+UNIT_TEST(STFTWorkerReconstructsInput)
+{
+  for (auto overlap : { 2, 4 })
+  {
+    STFT stft(2);
+    stft.SetFFTSize(2048, overlap, STFT::kHannWindow, true);
+    stft.SetComplexFunc([](int, WDL_FFT_COMPLEX*, int) {});
+    CHECK(stft.GetLatency() == 4096);
+    CHECK(ReconstructionError(stft, 150, 128, true) <= 1e-5);
+    CHECK(stft.GetNumWorkerUnderruns() == 0);
+  }
+}
+
+// the worker sleeps when there is nothing to do, so after a pause the next frames are still processed in time
+UNIT_TEST(STFTWorkerWakesAfterIdle)
+{
+  STFT stft(2);
+  stft.SetFFTSize(1024, 4, STFT::kHannWindow, true);
+  stft.SetComplexFunc([](int, WDL_FFT_COMPLEX*, int) {});
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  CHECK(ReconstructionError(stft, 100, 64, true) <= 1e-5);
+  CHECK(stft.GetNumWorkerUnderruns() == 0);
+  stft.Reset();
+  stft.Reset();
+}
+
+BENCHMARK(STFTBenchmark)
+{
+  const int nChans = 2, blockSize = 128, nBlocks = 4000;
+  std::vector<double> buffer[nChans];
+  TestRandom rand(17);
+
+  for (auto& b : buffer)
+  {
+    b.resize(blockSize);
+    for (auto& s : b)
+      s = rand.Bipolar();
+  }
+
+  for (auto fftSize : { 1024, 4096 })
+  {
+    for (auto useWorker : { false, true })
+    {
+      STFT stft(nChans);
+      stft.SetFFTSize(fftSize, 4, STFT::kHannWindow, useWorker);
+      stft.SetComplexFunc([](int, WDL_FFT_COMPLEX* pBins, int nBins) { for (auto k = 0; k < nBins; k++) pBins[k].re *= 0.5f; });
+      double* ptrs[nChans] = { buffer[0].data(), buffer[1].data() };
+      double worst = 0.;
+
+      const auto total = TimeSeconds([&]() {
+        for (auto b = 0; b < nBlocks; b++)
+          worst = std::max(worst, TimeSeconds([&]() { stft.ProcessBlock(ptrs, ptrs, blockSize); }));
+      });
+
+      printf("  FFT size %d, %s: %.2f us per %d-sample block on average, %.2f us worst\n",
+             fftSize, useWorker ? "worker thread" : "audio thread", total * 1e6 / nBlocks, blockSize, worst * 1e6);
+    }
+  }
+}
@@ -0,0 +1,354 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// first, to check that the header is self-contained
+#include "VoiceAllocator.h"
+
+#include "IPlugUnitTests.h"
+
+/** A voice whose envelope the test controls: it is busy from its trigger until the test finishes it */
+class TestVoice : public SynthVoice
+{
+public:
+  bool GetBusy() const override { return mIsBusy; }
+
+  void Trigger(double level, bool isRetrigger) override
+  {
+    mIsBusy = true;
+    mIsReleased = false;
+    mLevel = level;
+    mNTriggers++;
+  }
+
+  void Release() override { mIsReleased = true; }
+
+  /** @return true if the voice is playing with its gate on */
+  bool IsHeld() const { return mIsBusy && !mIsReleased; }
+
+  int GetKey() const { return mKey; }
+  int GetChannel() const { return mChannel; }
+  double GetInput(int ctlIdx) const { return mInputs[ctlIdx].endValue; }
+
+  bool mIsBusy = false;
+  bool mIsReleased = false;
+  double mLevel = 0.;
+  int mNTriggers = 0;
+};
+
+/** Sends events to an allocator of TestVoices and processes them a block at a time, the way MidiSynth does */
+struct TestAllocator
+{
+  static constexpr int kBlockSize = 32;
+
+  VoiceAllocator allocator;
+  std::vector<TestVoice> voices;
+  int64_t sampleTime = 0;
+
+  explicit TestAllocator(int nVoices, int nZones = 1)
+  : voices(nVoices)
+  {
+    allocator.SetSampleRate(48000.);
+    allocator.SetControlGlideTime(0.);
+
+    for (auto v = 0; v < nVoices; v++)
+      allocator.AddVoice(&voices[v], (uint8_t) (v % nZones));
+  }
+
+  void Event(EVoiceAction action, int key, float value, int channel = 0, int zone = 0)
+  {
+    allocator.AddEvent({{(uint8_t) zone, (uint8_t) channel, (uint8_t) key, 0}, action, 0, value, 0});
+  }
+
+  void NoteOn(int key, float velocity = 1.f, int channel = 0) { Event(kNoteOnAction, key, velocity, channel); }
+  void NoteOff(int key, int channel = 0) { Event(kNoteOffAction, key, 0.f, channel); }
+  void Sustain(bool down) { Event(kSustainAction, 0, down ? 1.f : 0.f); }
+
+  /** Process the queued events, then the voices, which frees the voices that are no longer busy */
+  void Process()
+  {
+    allocator.ProcessEvents(kBlockSize, sampleTime);
+    allocator.ProcessVoices(nullptr, nullptr, 0, 0, 0, kBlockSize);
+    sampleTime += kBlockSize;
+  }
+
+  /** The envelopes of the released voices finish */
+  void FinishReleases()
+  {
+    for (auto& voice : voices)
+    {
+      if (voice.mIsReleased)
+        voice.mIsBusy = false;
+    }
+  }
+
+  /** @return The index of the voice playing the key with its gate on, or -1 */
+  int HeldVoice(int key, int channel = 0) const
+  {
+    for (auto v = 0; v < (int) voices.size(); v++)
+    {
+      if (voices[v].IsHeld() && voices[v].GetKey() == key && voices[v].GetChannel() == channel)
+        return v;
+    }
+
+    return -1;
+  }
+};
+
+// each note takes the voice that has been free the longest, so that the voices take turns
+UNIT_TEST(VoiceAllocatorRotatesFreeVoices)
+{
+  TestAllocator test(4);
+
+  for (auto n = 0; n < 10; n++)
+  {
+    test.NoteOn(60 + n);
+    test.Process();
+    CHECK(test.HeldVoice(60 + n) == n % 4);
+
+    test.NoteOff(60 + n);
+    test.Process();
+    CHECK(test.voices[n % 4].mIsReleased);
+
+    test.FinishReleases();
+    test.Process();
+    CHECK(test.allocator.IndexesAreConsistent());
+  }
+
+  // a voice that is still releasing is not free, so the next note skips it
+  test.NoteOn(80);
+  test.NoteOff(80);
+  test.NoteOn(81);
+  test.Process();
+  CHECK(test.voices[2].mIsReleased && test.voices[2].mIsBusy);
+  CHECK(test.HeldVoice(81) == 3);
+  CHECK(test.allocator.IndexesAreConsistent());
+}
+
+// with every voice busy, a released voice is stolen before a held one, the one released longest ago first, then the oldest held voice
+UNIT_TEST(VoiceAllocatorStealsReleasedVoicesFirst)
+{
+  TestAllocator test(4);
+
+  for (auto key = 60; key < 64; key++)
+  {
+    test.NoteOn(key);
+    test.Process();
+  }
+
+  test.NoteOff(61);
+  test.Process();
+  test.NoteOn(64);
+  test.Process();
+  CHECK(test.HeldVoice(64) == 1);
+  CHECK(test.HeldVoice(60) == 0);
+  CHECK(test.voices[1].mNTriggers == 2);
+
+  test.NoteOff(62);
+  test.NoteOff(60);
+  test.Process();
+  test.NoteOn(65);
+  test.NoteOn(66);
+  test.Process();
+  CHECK(test.HeldVoice(65) == 2);
+  CHECK(test.HeldVoice(66) == 0);
+
+  // none released, so the oldest held voice, which was triggered for 63
+  test.NoteOn(67);
+  test.Process();
+  CHECK(test.HeldVoice(67) == 3);
+  CHECK(test.HeldVoice(63) == -1);
+  CHECK(test.allocator.IndexesAreConsistent());
+
+  // the stolen key no longer reaches the voice that played it
+  test.NoteOff(63);
+  test.Process();
+  CHECK(test.HeldVoice(67) == 3);
+
+  for (auto key = 64; key < 68; key++)
+    test.NoteOff(key);
+
+  test.Process();
+
+  for (const auto& voice : test.voices)
+    CHECK(voice.mIsReleased);
+
+  test.FinishReleases();
+  test.Process();
+  CHECK(test.allocator.IndexesAreConsistent());
+}
+
+// lifting the pedal stops the notes that were sustained, but not the keys that are still down
+UNIT_TEST(VoiceAllocatorSustainReleasesOnlyUnheldKeys)
+{
+  TestAllocator test(4);
+
+  test.Sustain(true);
+  test.NoteOn(60);
+  test.NoteOn(62);
+  test.NoteOff(60);
+  test.Process();
+  CHECK(test.HeldVoice(60) == 0);
+  CHECK(test.HeldVoice(62) == 1);
+
+  test.NoteOn(64);
+  test.NoteOff(64);
+  test.NoteOn(64); // pressed again while sustained, so it is down when the pedal lifts
+  test.Process();
+
+  test.Sustain(false);
+  test.Process();
+  CHECK(test.voices[0].mIsReleased);
+  CHECK(test.HeldVoice(62) == 1);
+  CHECK(test.HeldVoice(64) >= 0);
+  CHECK(test.allocator.IndexesAreConsistent());
+
+  // with the pedal up, a note off stops the note straight away
+  test.NoteOff(62);
+  test.Process();
+  CHECK(test.voices[1].mIsReleased);
+  CHECK(test.HeldVoice(64) >= 0);
+}
+
+// in mono mode, lifting the playing key goes back to the last key pressed that is still down, at the lowest velocity held
+UNIT_TEST(VoiceAllocatorMonoReplaysQueuedKey)
+{
+  TestAllocator test(3, 2); // voices 0 and 2 are in zone 0, voice 1 in zone 1
+  test.allocator.mPolyMode = VoiceAllocator::kPolyModeMono;
+
+  test.NoteOn(60, 0.8f);
+  test.Process();
+  test.NoteOn(64, 0.5f);
+  test.Process();
+  test.NoteOn(67, 0.9f);
+  test.Process();
+  CHECK(test.voices[0].GetKey() == 67 && test.voices[2].GetKey() == 67);
+  CHECK(!test.voices[1].mIsBusy);
+
+  test.NoteOff(67);
+  test.Process();
+
+  for (auto v : { 0, 2 })
+  {
+    const TestVoice& voice = test.voices[v];
+    CHECK(voice.IsHeld());
+    CHECK(voice.GetKey() == 64);
+    CHECK(voice.mNTriggers == 4);
+    CHECK_CLOSE(voice.mLevel, 0.5, 1e-6);
+    CHECK_CLOSE(voice.GetInput(kVoiceControlGate), 0.5, 1e-6);
+    CHECK_CLOSE(voice.GetInput(kVoiceControlPitch), (64. - 69.) / 12., 1e-6); // the pitch is passed as a float
+  }
+
+  CHECK(test.allocator.IndexesAreConsistent());
+
+  // lifting a key that is not playing doesn't retrigger
+  test.NoteOff(60);
+  test.Process();
+  CHECK(test.voices[0].GetKey() == 64 && test.voices[0].mNTriggers == 4);
+
+  test.NoteOff(64);
+  test.Process();
+  CHECK(test.voices[0].mIsReleased && test.voices[2].mIsReleased);
+  CHECK(!test.voices[1].mIsBusy);
+
+  test.FinishReleases();
+  test.Process();
+  CHECK(test.allocator.IndexesAreConsistent());
+}
+
+/** Random notes, pedal changes and envelopes finishing, including voices that stop while their key is down, with the indexes checked after every block.
+ * Each key plays on a channel of its own, so that the note offs and the channel expression can be checked against what is down */
+static void StressAllocator(VoiceAllocator::EPolyMode polyMode, uint32_t seed)
+{
+  const int nVoices = 6;
+  const int nChannels = 4;
+  TestAllocator test(nVoices);
+  test.allocator.mPolyMode = polyMode;
+  TestRandom rand(seed);
+  std::array<bool, VoiceAllocator::kNumKeys> isDown {};
+  bool pedalDown = false;
+  bool consistent = true;
+  bool heldKeysAreDown = true;
+  bool expressionReachesChannel = true;
+
+  for (auto block = 0; block < 5000; block++)
+  {
+    for (auto e = rand.Int(4); e > 0; e--)
+    {
+      const int key = 48 + rand.Int(12);
+      const int action = rand.Int(10);
+
+      if (action < 4 && !isDown[key])
+      {
+        test.NoteOn(key, 0.1f + 0.9f * (float) rand.Int(100) / 100.f, key % nChannels);
+        isDown[key] = true;
+      }
+      else if (action < 8 && isDown[key])
+      {
+        test.NoteOff(key, key % nChannels);
+        isDown[key] = false;
+      }
+      else if (action == 8)
+      {
+        pedalDown = !pedalDown;
+        test.Sustain(pedalDown);
+      }
+    }
+
+    test.allocator.ProcessEvents(TestAllocator::kBlockSize, test.sampleTime);
+
+    for (auto& voice : test.voices)
+    {
+      if ((voice.mIsReleased && !rand.Int(3)) || !rand.Int(50))
+        voice.mIsBusy = false;
+    }
+
+    test.allocator.ProcessVoices(nullptr, nullptr, 0, 0, 0, TestAllocator::kBlockSize);
+    test.sampleTime += TestAllocator::kBlockSize;
+    consistent &= test.allocator.IndexesAreConsistent();
+
+    if (polyMode == VoiceAllocator::kPolyModePoly && !pedalDown)
+    {
+      for (const auto& voice : test.voices)
+      {
+        if (voice.IsHeld())
+          heldKeysAreDown &= voice.GetKey() < VoiceAllocator::kNumKeys && isDown[voice.GetKey()] && voice.GetChannel() == voice.GetKey() % nChannels;
+      }
+    }
+
+    // expression reaches the busy voices on the channel, and only them
+    const int channel = rand.Int(nChannels);
+    const float pressure = (float) (block + 1);
+    std::vector<double> pressures;
+
+    for (const auto& voice : test.voices)
+      pressures.push_back(voice.GetInput(kVoiceControlPressure));
+
+    test.allocator.SendExpressionToChannel(kAllZones, channel, kVoiceControlPressure, pressure);
+    test.allocator.ProcessEvents(TestAllocator::kBlockSize, test.sampleTime);
+
+    for (auto v = 0; v < nVoices; v++)
+    {
+      const TestVoice& voice = test.voices[v];
+      const bool reached = voice.mIsBusy && voice.GetChannel() == channel;
+      expressionReachesChannel &= voice.GetInput(kVoiceControlPressure) == (reached ? pressure : pressures[v]);
+    }
+  }
+
+  CHECK(consistent);
+  CHECK(heldKeysAreDown);
+  CHECK(expressionReachesChannel);
+}
+
+UNIT_TEST(VoiceAllocatorIndexesStayConsistent)
+{
+  StressAllocator(VoiceAllocator::kPolyModePoly, 1);
+  StressAllocator(VoiceAllocator::kPolyModePoly, 2);
+  StressAllocator(VoiceAllocator::kPolyModeMono, 3);
+}
@@ -0,0 +1,61 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/**
+ * @file
+ * @brief Runs the unit tests, and the benchmarks with -b. An argument that is not an option only runs the tests whose name contains it.
+ * Exits with 1 if a check failed
+ */
+
+#include "IPlugUnitTests.h"
+
+static int sNumFailures = 0;
+
+std::vector<UnitTest>& GetUnitTests()
+{
+  static std::vector<UnitTest> tests;
+  return tests;
+}
+
+void ReportFailure(const char* file, int line, const char* expr)
+{
+  printf("  FAILED %s:%i: %s\n", file, line, expr);
+  sNumFailures++;
+}
+
+int main(int argc, char** argv)
+{
+  bool runBenchmarks = false;
+  const char* filter = nullptr;
+
+  for (auto i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "-b"))
+      runBenchmarks = true;
+    else
+      filter = argv[i];
+  }
+
+  int nRun = 0;
+
+  for (auto& test : GetUnitTests())
+  {
+    if (test.mIsBenchmark != runBenchmarks || (filter && !strstr(test.mName, filter)))
+      continue;
+
+    printf("%s\n", test.mName);
+    fflush(stdout);
+    test.mFunc();
+    nRun++;
+  }
+
+  printf("%i %s, %i failed checks\n", nRun, runBenchmarks ? "benchmarks" : "tests", sNumFailures);
+  return sNumFailures ? 1 : 0;
+}
@@ -267,6 +267,473 @@ static WDL_FFT_COMPLEX d32768[4095];
   a1.im = t4; \
   }
 
+/*
+  SIMD versions of the radix-4 passes and complex multiplies. Each vector holds WDL_FFT_VN
+  complex values (two floats pairs, or one double pair), and the butterflies compute exactly
+  the same operations as the scalar macros above, so output ordering (WDL_fft_permute) and
+  values are unchanged. Define WDL_FFT_NO_SIMD to compile only the scalar code, or call
+  WDL_fft_set_simd(0) to select it at runtime (e.g. to compare against). The NEON versions are
+  opt-in (define WDL_FFT_NEON) until they have been checked against the scalar code on ARM.
+*/
+
+#if !defined(WDL_FFT_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+  #include <emmintrin.h>
+  #define WDL_FFT_SIMD
+  #define WDL_FFT_SIMD_SSE
+#elif !defined(WDL_FFT_NO_SIMD) && defined(WDL_FFT_NEON) && (defined(__aarch64__) || (defined(__ARM_NEON) && WDL_FFT_REALSIZE == 4))
+  #include <arm_neon.h>
+  #define WDL_FFT_SIMD
+  #define WDL_FFT_SIMD_NEON
+#endif
+
+#ifdef WDL_FFT_SIMD
+
+// 0: scalar, 1: the 128-bit passes below, 2: the AVX ones (see WDL_fft_init())
+static int wdl_fft_simd_level = 1;
+
+#if defined(WDL_FFT_SIMD_SSE) && WDL_FFT_REALSIZE == 4
+
+#define WDL_FFT_VN 2
+typedef __m128 wdl_fft_v;
+#define V_LOAD(p) _mm_loadu_ps((const float *)(p))
+#define V_STORE(p,v) _mm_storeu_ps((float *)(p),v)
+#define V_ADD(a,b) _mm_add_ps(a,b)
+#define V_SUB(a,b) _mm_sub_ps(a,b)
+
+static inline __m128 v_negmask_re() { return _mm_castsi128_ps(_mm_set_epi32(0,(int)0x80000000,0,(int)0x80000000)); }
+static inline __m128 v_negmask_im() { return _mm_castsi128_ps(_mm_set_epi32((int)0x80000000,0,(int)0x80000000,0)); }
+static inline __m128 v_swapri(__m128 x) { return _mm_shuffle_ps(x,x,_MM_SHUFFLE(2,3,0,1)); }
+
+static inline __m128 V_CMUL(__m128 x, __m128 w)
+{
+  const __m128 wr = _mm_shuffle_ps(w,w,_MM_SHUFFLE(2,2,0,0));
+  const __m128 wi = _mm_shuffle_ps(w,w,_MM_SHUFFLE(3,3,1,1));
+  return _mm_add_ps(_mm_mul_ps(x,wr),_mm_mul_ps(_mm_xor_ps(v_swapri(x),v_negmask_re()),wi));
+}
+static inline __m128 V_CMULCONJ(__m128 x, __m128 w)
+{
+  const __m128 wr = _mm_shuffle_ps(w,w,_MM_SHUFFLE(2,2,0,0));
+  const __m128 wi = _mm_shuffle_ps(w,w,_MM_SHUFFLE(3,3,1,1));
+  return _mm_add_ps(_mm_mul_ps(x,wr),_mm_mul_ps(_mm_xor_ps(v_swapri(x),v_negmask_im()),wi));
+}
+static inline __m128 V_MULI(__m128 x) { return _mm_xor_ps(v_swapri(x),v_negmask_re()); }
+// twiddles p[1] then p[0], with re/im swapped
+static inline __m128 V_LOADWREV(const WDL_FFT_COMPLEX *p) { const __m128 v = V_LOAD(p); return _mm_shuffle_ps(v,v,_MM_SHUFFLE(0,1,2,3)); }
+
+#elif defined(WDL_FFT_SIMD_SSE)
+
+#define WDL_FFT_VN 1
+typedef __m128d wdl_fft_v;
+#define V_LOAD(p) _mm_loadu_pd((const double *)(p))
+#define V_STORE(p,v) _mm_storeu_pd((double *)(p),v)
+#define V_ADD(a,b) _mm_add_pd(a,b)
+#define V_SUB(a,b) _mm_sub_pd(a,b)
+
+static inline __m128d v_negmask_re() { return _mm_castsi128_pd(_mm_set_epi32(0,0,(int)0x80000000,0)); }
+static inline __m128d v_negmask_im() { return _mm_castsi128_pd(_mm_set_epi32((int)0x80000000,0,0,0)); }
+static inline __m128d v_swapri(__m128d x) { return _mm_shuffle_pd(x,x,1); }
+
+static inline __m128d V_CMUL(__m128d x, __m128d w)
+{
+  return _mm_add_pd(_mm_mul_pd(x,_mm_unpacklo_pd(w,w)),_mm_mul_pd(_mm_xor_pd(v_swapri(x),v_negmask_re()),_mm_unpackhi_pd(w,w)));
+}
+static inline __m128d V_CMULCONJ(__m128d x, __m128d w)
+{
+  return _mm_add_pd(_mm_mul_pd(x,_mm_unpacklo_pd(w,w)),_mm_mul_pd(_mm_xor_pd(v_swapri(x),v_negmask_im()),_mm_unpackhi_pd(w,w)));
+}
+static inline __m128d V_MULI(__m128d x) { return _mm_xor_pd(v_swapri(x),v_negmask_re()); }
+static inline __m128d V_LOADWREV(const WDL_FFT_COMPLEX *p) { return v_swapri(V_LOAD(p)); }
+
+#elif WDL_FFT_REALSIZE == 4 // NEON
+
+#define WDL_FFT_VN 2
+typedef float32x4_t wdl_fft_v;
+#define V_LOAD(p) vld1q_f32((const float *)(p))
+#define V_STORE(p,v) vst1q_f32((float *)(p),v)
+#define V_ADD(a,b) vaddq_f32(a,b)
+#define V_SUB(a,b) vsubq_f32(a,b)
+
+static inline float32x4_t v_negre(float32x4_t x) { static const float s[4] = { -1.f, 1.f, -1.f, 1.f }; return vmulq_f32(x,vld1q_f32(s)); }
+static inline float32x4_t v_negim(float32x4_t x) { static const float s[4] = { 1.f, -1.f, 1.f, -1.f }; return vmulq_f32(x,vld1q_f32(s)); }
+
+static inline float32x4_t V_CMUL(float32x4_t x, float32x4_t w)
+{
+  const float32x4x2_t t = vtrnq_f32(w,w);
+  return vaddq_f32(vmulq_f32(x,t.val[0]),vmulq_f32(v_negre(vrev64q_f32(x)),t.val[1]));
+}
+static inline float32x4_t V_CMULCONJ(float32x4_t x, float32x4_t w)
+{
+  const float32x4x2_t t = vtrnq_f32(w,w);
+  return vaddq_f32(vmulq_f32(x,t.val[0]),vmulq_f32(v_negim(vrev64q_f32(x)),t.val[1]));
+}
+static inline float32x4_t V_MULI(float32x4_t x) { return v_negre(vrev64q_f32(x)); }
+static inline float32x4_t V_LOADWREV(const WDL_FFT_COMPLEX *p) { const float32x4_t v = vrev64q_f32(V_LOAD(p)); return vcombine_f32(vget_high_f32(v),vget_low_f32(v)); }
+
+#else // NEON, aarch64 double
+
+#define WDL_FFT_VN 1
+typedef float64x2_t wdl_fft_v;
+#define V_LOAD(p) vld1q_f64((const double *)(p))
+#define V_STORE(p,v) vst1q_f64((double *)(p),v)
+#define V_ADD(a,b) vaddq_f64(a,b)
+#define V_SUB(a,b) vsubq_f64(a,b)
+
+static inline float64x2_t v_negre(float64x2_t x) { static const double s[2] = { -1., 1. }; return vmulq_f64(x,vld1q_f64(s)); }
+static inline float64x2_t v_negim(float64x2_t x) { static const double s[2] = { 1., -1. }; return vmulq_f64(x,vld1q_f64(s)); }
+
+static inline float64x2_t V_CMUL(float64x2_t x, float64x2_t w)
+{
+  return vaddq_f64(vmulq_f64(x,vdupq_laneq_f64(w,0)),vmulq_f64(v_negre(vextq_f64(x,x,1)),vdupq_laneq_f64(w,1)));
+}
+static inline float64x2_t V_CMULCONJ(float64x2_t x, float64x2_t w)
+{
+  return vaddq_f64(vmulq_f64(x,vdupq_laneq_f64(w,0)),vmulq_f64(v_negim(vextq_f64(x,x,1)),vdupq_laneq_f64(w,1)));
+}
+static inline float64x2_t V_MULI(float64x2_t x) { return v_negre(vextq_f64(x,x,1)); }
+static inline float64x2_t V_LOADWREV(const WDL_FFT_COMPLEX *p) { const float64x2_t v = V_LOAD(p); return vextq_f64(v,v,1); }
+
+#endif
+
+// same as TRANSFORM() on WDL_FFT_VN consecutive butterflies
+static inline void simd_transform(WDL_FFT_COMPLEX *a0, WDL_FFT_COMPLEX *a1, WDL_FFT_COMPLEX *a2, WDL_FFT_COMPLEX *a3, wdl_fft_v w)
+{
+  const wdl_fft_v x0 = V_LOAD(a0), x1 = V_LOAD(a1), x2 = V_LOAD(a2), x3 = V_LOAD(a3);
+  const wdl_fft_v d02 = V_SUB(x0,x2);
+  const wdl_fft_v id13 = V_MULI(V_SUB(x1,x3));
+  V_STORE(a0,V_ADD(x0,x2));
+  V_STORE(a1,V_ADD(x1,x3));
+  V_STORE(a2,V_CMUL(V_ADD(d02,id13),w));
+  V_STORE(a3,V_CMULCONJ(V_SUB(d02,id13),w));
+}
+
+// same as UNTRANSFORM() on WDL_FFT_VN consecutive butterflies
+static inline void simd_untransform(WDL_FFT_COMPLEX *a0, WDL_FFT_COMPLEX *a1, WDL_FFT_COMPLEX *a2, WDL_FFT_COMPLEX *a3, wdl_fft_v w)
+{
+  const wdl_fft_v x0 = V_LOAD(a0), x1 = V_LOAD(a1);
+  const wdl_fft_v p = V_CMULCONJ(V_LOAD(a2),w);
+  const wdl_fft_v q = V_CMUL(V_LOAD(a3),w);
+  const wdl_fft_v s = V_ADD(p,q);
+  const wdl_fft_v d = V_MULI(V_SUB(q,p));
+  V_STORE(a0,V_ADD(x0,s));
+  V_STORE(a2,V_SUB(x0,s));
+  V_STORE(a1,V_ADD(x1,d));
+  V_STORE(a3,V_SUB(x1,d));
+}
+
+/* a[0...8n-1], w[0...2n-2]; n >= 2 */
+static void cpass_simd(WDL_FFT_COMPLEX *a, const WDL_FFT_COMPLEX *w, unsigned int n)
+{
+  WDL_FFT_REAL t1, t2, t3, t4, t5, t6, t7, t8;
+  WDL_FFT_COMPLEX *a1 = a + 2 * n, *a2 = a + 4 * n, *a3 = a + 6 * n;
+  unsigned int j;
+
+  TRANSFORMZERO(a[0],a1[0],a2[0],a3[0]);
+  TRANSFORM(a[1],a1[1],a2[1],a3[1],w[0].re,w[0].im);
+
+  for (j = 2; j < 2 * n; j += WDL_FFT_VN)
+    simd_transform(a + j, a1 + j, a2 + j, a3 + j, V_LOAD(w + j - 1));
+}
+
+/* a[0...8n-1], w[0...n-2]; n even, n >= 4 */
+static void cpassbig_simd(WDL_FFT_COMPLEX *a, const WDL_FFT_COMPLEX *w, unsigned int n)
+{
+  WDL_FFT_REAL t1, t2, t3, t4, t5, t6, t7, t8;
+  WDL_FFT_COMPLEX *a1 = a + 2 * n, *a2 = a + 4 * n, *a3 = a + 6 * n;
+  unsigned int j;
+
+  TRANSFORMZERO(a[0],a1[0],a2[0],a3[0]);
+  TRANSFORM(a[1],a1[1],a2[1],a3[1],w[0].re,w[0].im);
+
+  for (j = 2; j < n; j += WDL_FFT_VN)
+    simd_transform(a + j, a1 + j, a2 + j, a3 + j, V_LOAD(w + j - 1));
+
+  TRANSFORMHALF(a[n],a1[n],a2[n],a3[n]);
+  TRANSFORM(a[n+1],a1[n+1],a2[n+1],a3[n+1],w[n-2].im,w[n-2].re);
+
+  // the second half runs back through the twiddles, with re/im swapped
+  for (j = n + 2; j < 2 * n; j += WDL_FFT_VN)
+    simd_transform(a + j, a1 + j, a2 + j, a3 + j, V_LOADWREV(w + 2 * n - WDL_FFT_VN - j));
+}
+
+/* a[0...8n-1], w[0...2n-2] */
+static void upass_simd(WDL_FFT_COMPLEX *a, const WDL_FFT_COMPLEX *w, unsigned int n)
+{
+  WDL_FFT_REAL t1, t2, t3, t4, t5, t6, t7, t8;
+  WDL_FFT_COMPLEX *a1 = a + 2 * n, *a2 = a + 4 * n, *a3 = a + 6 * n;
+  unsigned int j;
+
+  UNTRANSFORMZERO(a[0],a1[0],a2[0],a3[0]);
+  UNTRANSFORM(a[1],a1[1],a2[1],a3[1],w[0].re,w[0].im);
+
+  for (j = 2; j < 2 * n; j += WDL_FFT_VN)
+    simd_untransform(a + j, a1 + j, a2 + j, a3 + j, V_LOAD(w + j - 1));
+}
+
+/* a[0...8n-1], w[0...n-2]; n even, n >= 4 */
+static void upassbig_simd(WDL_FFT_COMPLEX *a, const WDL_FFT_COMPLEX *w, unsigned int n)
+{
+  WDL_FFT_REAL t1, t2, t3, t4, t5, t6, t7, t8;
+  WDL_FFT_COMPLEX *a1 = a + 2 * n, *a2 = a + 4 * n, *a3 = a + 6 * n;
+  unsigned int j;
+
+  UNTRANSFORMZERO(a[0],a1[0],a2[0],a3[0]);
+  UNTRANSFORM(a[1],a1[1],a2[1],a3[1],w[0].re,w[0].im);
+
+  for (j = 2; j < n; j += WDL_FFT_VN)
+    simd_untransform(a + j, a1 + j, a2 + j, a3 + j, V_LOAD(w + j - 1));
+
+  UNTRANSFORMHALF(a[n],a1[n],a2[n],a3[n]);
+  UNTRANSFORM(a[n+1],a1[n+1],a2[n+1],a3[n+1],w[n-2].im,w[n-2].re);
+
+  for (j = n + 2; j < 2 * n; j += WDL_FFT_VN)
+    simd_untransform(a + j, a1 + j, a2 + j, a3 + j, V_LOADWREV(w + 2 * n - WDL_FFT_VN - j));
+}
+
+/*
+  256-bit AVX versions of the same loops, for x86 builds. They are compiled with a per-function
+  target attribute, so the rest of the file (and the caller) still only needs SSE2, and they are
+  only used when WDL_fft_init() finds AVX on the CPU (and the OS saves the YMM state). Each vector
+  holds WDL_FFT_AVXN complex values, and the operations are the same as in the 128-bit versions,
+  which handle whatever is left over at the end of a loop. Define WDL_FFT_NO_AVX to leave them out.
+*/
+
+#if defined(WDL_FFT_SIMD_SSE) && !defined(WDL_FFT_NO_AVX) && (defined(_MSC_VER) || defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+  #define WDL_FFT_SIMD_AVX
+#endif
+
+#ifdef WDL_FFT_SIMD_AVX
+
+#include <immintrin.h>
+#ifdef _MSC_VER
+  #include <intrin.h>
+  #define WDL_FFT_AVX_FUNC static
+#else
+  #include <cpuid.h>
+  #define WDL_FFT_AVX_FUNC static __attribute__((target("avx")))
+#endif
+
+static int wdl_fft_cpu_has_avx()
+{
+  unsigned int regs[4] = { 0, 0, 0, 0 }, xcr0;
+#ifdef _MSC_VER
+  __cpuid((int *)regs, 1);
+#else
+  if (!__get_cpuid(1, &regs[0], &regs[1], &regs[2], &regs[3])) return 0;
+#endif
+  // AVX, and OSXSAVE so that XGETBV can tell whether the OS saves the XMM and YMM registers
+  if ((regs[2] & (1u << 28)) == 0 || (regs[2] & (1u << 27)) == 0) return 0;
+#ifdef _MSC_VER
+  xcr0 = (unsigned int)_xgetbv(0);
+#else
+  {
+    unsigned int xcr0hi;
+    __asm__ __volatile__ ("xgetbv" : "=a"(xcr0), "=d"(xcr0hi) : "c"(0));
+    (void)xcr0hi;
+  }
+#endif
+  return (xcr0 & 6) == 6;
+}
+
+#if WDL_FFT_REALSIZE == 4
+
+#define WDL_FFT_AVXN 4
+typedef __m256 wdl_fft_w;
+#define W_LOAD(p) _mm256_loadu_ps((const float *)(p))
+#define W_STORE(p,v) _mm256_storeu_ps((float *)(p),v)
+#define W_ADD(a,b) _mm256_add_ps(a,b)
+#define W_SUB(a,b) _mm256_sub_ps(a,b)
+
+WDL_FFT_AVX_FUNC inline __m256 w_negmask_re() { return _mm256_castsi256_ps(_mm256_set_epi32(0,(int)0x80000000,0,(int)0x80000000,0,(int)0x80000000,0,(int)0x80000000)); }
+WDL_FFT_AVX_FUNC inline __m256 w_negmask_im() { return _mm256_castsi256_ps(_mm256_set_epi32((int)0x80000000,0,(int)0x80000000,0,(int)0x80000000,0,(int)0x80000000,0)); }
+WDL_FFT_AVX_FUNC inline __m256 w_swapri(__m256 x) { return _mm256_permute_ps(x,_MM_SHUFFLE(2,3,0,1)); }
+
+WDL_FFT_AVX_FUNC inline __m256 W_CMUL(__m256 x, __m256 w)
+{
+  return _mm256_add_ps(_mm256_mul_ps(x,_mm256_moveldup_ps(w)),_mm256_mul_ps(_mm256_xor_ps(w_swapri(x),w_negmask_re()),_mm256_movehdup_ps(w)));
+}
+WDL_FFT_AVX_FUNC inline __m256 W_CMULCONJ(__m256 x, __m256 w)
+{
+  return _mm256_add_ps(_mm256_mul_ps(x,_mm256_moveldup_ps(w)),_mm256_mul_ps(_mm256_xor_ps(w_swapri(x),w_negmask_im()),_mm256_movehdup_ps(w)));
+}
+WDL_FFT_AVX_FUNC inline __m256 W_MULI(__m256 x) { return _mm256_xor_ps(w_swapri(x),w_negmask_re()); }
+// twiddles p[3] to p[0], with re/im swapped
+WDL_FFT_AVX_FUNC inline __m256 W_LOADWREV(const WDL_FFT_COMPLEX *p) { const __m256 v = W_LOAD(p); return _mm256_permute_ps(_mm256_permute2f128_ps(v,v,1),_MM_SHUFFLE(0,1,2,3)); }
+
+#else
+
+#define WDL_FFT_AVXN 2
+typedef __m256d wdl_fft_w;
+#define W_LOAD(p) _mm256_loadu_pd((const double *)(p))
+#define W_STORE(p,v) _mm256_storeu_pd((double *)(p),v)
+#define W_ADD(a,b) _mm256_add_pd(a,b)
+#define W_SUB(a,b) _mm256_sub_pd(a,b)
+
+WDL_FFT_AVX_FUNC inline __m256d w_negmask_re() { return _mm256_castsi256_pd(_mm256_set_epi32(0,0,(int)0x80000000,0,0,0,(int)0x80000000,0)); }
+WDL_FFT_AVX_FUNC inline __m256d w_negmask_im() { return _mm256_castsi256_pd(_mm256_set_epi32((int)0x80000000,0,0,0,(int)0x80000000,0,0,0)); }
+WDL_FFT_AVX_FUNC inline __m256d w_swapri(__m256d x) { return _mm256_permute_pd(x,5); }
+
+WDL_FFT_AVX_FUNC inline __m256d W_CMUL(__m256d x, __m256d w)
+{
+  return _mm256_add_pd(_mm256_mul_pd(x,_mm256_movedup_pd(w)),_mm256_mul_pd(_mm256_xor_pd(w_swapri(x),w_negmask_re()),_mm256_permute_pd(w,15)));
+}
+WDL_FFT_AVX_FUNC inline __m256d W_CMULCONJ(__m256d x, __m256d w)
+{
+  return _mm256_add_pd(_mm256_mul_pd(x,_mm256_movedup_pd(w)),_mm256_mul_pd(_mm256_xor_pd(w_swapri(x),w_negmask_im()),_mm256_permute_pd(w,15)));
+}
+WDL_FFT_AVX_FUNC inline __m256d W_MULI(__m256d x) { return _mm256_xor_pd(w_swapri(x),w_negmask_re()); }
+// twiddles p[1] then p[0], with re/im swapped
+WDL_FFT_AVX_FUNC inline __m256d W_LOADWREV(const WDL_FFT_COMPLEX *p) { const __m256d v = W_LOAD(p); return w_swapri(_mm256_permute2f128_pd(v,v,1)); }
+
+#endif
+
+// same as simd_transform() on WDL_FFT_AVXN consecutive butterflies
+WDL_FFT_AVX_FUNC inline void avx_transform(WDL_FFT_COMPLEX *a0, WDL_FFT_COMPLEX *a1, WDL_FFT_COMPLEX *a2, WDL_FFT_COMPLEX *a3, wdl_fft_w w)
+{
+  const wdl_fft_w x0 = W_LOAD(a0), x1 = W_LOAD(a1), x2 = W_LOAD(a2), x3 = W_LOAD(a3);
+  const wdl_fft_w d02 = W_SUB(x0,x2);
+  const wdl_fft_w id13 = W_MULI(W_SUB(x1,x3));
+  W_STORE(a0,W_ADD(x0,x2));
+  W_STORE(a1,W_ADD(x1,x3));
+  W_STORE(a2,W_CMUL(W_ADD(d02,id13),w));
+  W_STORE(a3,W_CMULCONJ(W_SUB(d02,id13),w));
+}
+
+// same as simd_untransform() on WDL_FFT_AVXN consecutive butterflies
+WDL_FFT_AVX_FUNC inline void avx_untransform(WDL_FFT_COMPLEX *a0, WDL_FFT_COMPLEX *a1, WDL_FFT_COMPLEX *a2, WDL_FFT_COMPLEX *a3, wdl_fft_w w)
+{
+  const wdl_fft_w x0 = W_LOAD(a0), x1 = W_LOAD(a1);
+  const wdl_fft_w p = W_CMULCONJ(W_LOAD(a2),w);
+  const wdl_fft_w q = W_CMUL(W_LOAD(a3),w);
+  const wdl_fft_w s = W_ADD(p,q);
+  const wdl_fft_w d = W_MULI(W_SUB(q,p));
+  W_STORE(a0,W_ADD(x0,s));
+  W_STORE(a2,W_SUB(x0,s));
+  W_STORE(a1,W_ADD(x1,d));
+  W_STORE(a3,W_SUB(x1,d));
+}
+
+WDL_FFT_AVX_FUNC void cpass_avx(WDL_FFT_COMPLEX *a, const WDL_FFT_COMPLEX *w, unsigned int n)
+{
+  WDL_FFT_REAL t1, t2, t3, t4, t5, t6, t7, t8;
+  WDL_FFT_COMPLEX *a1 = a + 2 * n, *a2 = a + 4 * n, *a3 = a + 6 * n;
+  unsigned int j;
+
+  TRANSFORMZERO(a[0],a1[0],a2[0],a3[0]);
+  TRANSFORM(a[1],a1[1],a2[1],a3[1],w[0].re,w[0].im);
+
+  for (j = 2; j + WDL_FFT_AVXN <= 2 * n; j += WDL_FFT_AVXN)
+    avx_transform(a + j, a1 + j, a2 + j, a3 + j, W_LOAD(w + j - 1));
+  for (; j < 2 * n; j += WDL_FFT_VN)
+    simd_transform(a + j, a1 + j, a2 + j, a3 + j, V_LOAD(w + j - 1));
+}
+
+WDL_FFT_AVX_FUNC void cpassbig_avx(WDL_FFT_COMPLEX *a, const WDL_FFT_COMPLEX *w, unsigned int n)
+{
+  WDL_FFT_REAL t1, t2, t3, t4, t5, t6, t7, t8;
+  WDL_FFT_COMPLEX *a1 = a + 2 * n, *a2 = a + 4 * n, *a3 = a + 6 * n;
+  unsigned int j;
+
+  TRANSFORMZERO(a[0],a1[0],a2[0],a3[0]);
+  TRANSFORM(a[1],a1[1],a2[1],a3[1],w[0].re,w[0].im);
+
+  for (j = 2; j + WDL_FFT_AVXN <= n; j += WDL_FFT_AVXN)
+    avx_transform(a + j, a1 + j, a2 + j, a3 + j, W_LOAD(w + j - 1));
+  for (; j < n; j += WDL_FFT_VN)
+    simd_transform(a + j, a1 + j, a2 + j, a3 + j, V_LOAD(w + j - 1));
+
+  TRANSFORMHALF(a[n],a1[n],a2[n],a3[n]);
+  TRANSFORM(a[n+1],a1[n+1],a2[n+1],a3[n+1],w[n-2].im,w[n-2].re);
+
+  for (j = n + 2; j + WDL_FFT_AVXN <= 2 * n; j += WDL_FFT_AVXN)
+    avx_transform(a + j, a1 + j, a2 + j, a3 + j, W_LOADWREV(w + 2 * n - WDL_FFT_AVXN - j));
+  for (; j < 2 * n; j += WDL_FFT_VN)
+    simd_transform(a + j, a1 + j, a2 + j, a3 + j, V_LOADWREV(w + 2 * n - WDL_FFT_VN - j));
+}
+
+WDL_FFT_AVX_FUNC void upass_avx(WDL_FFT_COMPLEX *a, const WDL_FFT_COMPLEX *w, unsigned int n)
+{
+  WDL_FFT_REAL t1, t2, t3, t4, t5, t6, t7, t8;
+  WDL_FFT_COMPLEX *a1 = a + 2 * n, *a2 = a + 4 * n, *a3 = a + 6 * n;
+  unsigned int j;
+
+  UNTRANSFORMZERO(a[0],a1[0],a2[0],a3[0]);
+  UNTRANSFORM(a[1],a1[1],a2[1],a3[1],w[0].re,w[0].im);
+
+  for (j = 2; j + WDL_FFT_AVXN <= 2 * n; j += WDL_FFT_AVXN)
+    avx_untransform(a + j, a1 + j, a2 + j, a3 + j, W_LOAD(w + j - 1));
+  for (; j < 2 * n; j += WDL_FFT_VN)
+    simd_untransform(a + j, a1 + j, a2 + j, a3 + j, V_LOAD(w + j - 1));
+}
+
+WDL_FFT_AVX_FUNC void upassbig_avx(WDL_FFT_COMPLEX *a, const WDL_FFT_COMPLEX *w, unsigned int n)
+{
+  WDL_FFT_REAL t1, t2, t3, t4, t5, t6, t7, t8;
+  WDL_FFT_COMPLEX *a1 = a + 2 * n, *a2 = a + 4 * n, *a3 = a + 6 * n;
+  unsigned int j;
+
+  UNTRANSFORMZERO(a[0],a1[0],a2[0],a3[0]);
+  UNTRANSFORM(a[1],a1[1],a2[1],a3[1],w[0].re,w[0].im);
+
+  for (j = 2; j + WDL_FFT_AVXN <= n; j += WDL_FFT_AVXN)
+    avx_untransform(a + j, a1 + j, a2 + j, a3 + j, W_LOAD(w + j - 1));
+  for (; j < n; j += WDL_FFT_VN)
+    simd_untransform(a + j, a1 + j, a2 + j, a3 + j, V_LOAD(w + j - 1));
+
+  UNTRANSFORMHALF(a[n],a1[n],a2[n],a3[n]);
+  UNTRANSFORM(a[n+1],a1[n+1],a2[n+1],a3[n+1],w[n-2].im,w[n-2].re);
+
+  for (j = n + 2; j + WDL_FFT_AVXN <= 2 * n; j += WDL_FFT_AVXN)
+    avx_untransform(a + j, a1 + j, a2 + j, a3 + j, W_LOADWREV(w + 2 * n - WDL_FFT_AVXN - j));
+  for (; j < 2 * n; j += WDL_FFT_VN)
+    simd_untransform(a + j, a1 + j, a2 + j, a3 + j, V_LOADWREV(w + 2 * n - WDL_FFT_VN - j));
+}
+
+// c = a * b, or c += a * b if accumulate is set; n even
+WDL_FFT_AVX_FUNC void complexmul_avx(WDL_FFT_COMPLEX *c, const WDL_FFT_COMPLEX *a, const WDL_FFT_COMPLEX *b, int n, int accumulate)
+{
+  int i;
+  if (accumulate)
+  {
+    for (i = 0; i + WDL_FFT_AVXN <= n; i += WDL_FFT_AVXN) W_STORE(c + i, W_ADD(W_LOAD(c + i), W_CMUL(W_LOAD(a + i), W_LOAD(b + i))));
+    for (; i < n; i += WDL_FFT_VN) V_STORE(c + i, V_ADD(V_LOAD(c + i), V_CMUL(V_LOAD(a + i), V_LOAD(b + i))));
+  }
+  else
+  {
+    for (i = 0; i + WDL_FFT_AVXN <= n; i += WDL_FFT_AVXN) W_STORE(c + i, W_CMUL(W_LOAD(a + i), W_LOAD(b + i)));
+    for (; i < n; i += WDL_FFT_VN) V_STORE(c + i, V_CMUL(V_LOAD(a + i), V_LOAD(b + i)));
+  }
+}
+
+#define WDL_FFT_DISPATCH(func, a, w, n) \
+  if (wdl_fft_simd_level >= 2) { func##_avx(a, w, n); return; } \
+  if (wdl_fft_simd_level) { func##_simd(a, w, n); return; }
+
+#else
+
+#define WDL_FFT_DISPATCH(func, a, w, n) if (wdl_fft_simd_level) { func##_simd(a, w, n); return; }
+
+#endif // WDL_FFT_SIMD_AVX
+
+#else
+
+#define WDL_FFT_DISPATCH(func, a, w, n)
+
+#endif // WDL_FFT_SIMD
+
+int WDL_fft_set_simd(int enable)
+{
+#if defined(WDL_FFT_SIMD_AVX)
+  WDL_fft_init();
+  wdl_fft_simd_level = enable <= 0 ? 0 : (enable >= 2 && wdl_fft_cpu_has_avx()) ? 2 : 1;
+  return wdl_fft_simd_level;
+#elif defined(WDL_FFT_SIMD)
+  wdl_fft_simd_level = enable > 0;
+  return wdl_fft_simd_level;
+#else
+  return 0;
+#endif
+}
+
 static void c2(register WDL_FFT_COMPLEX *a)
 {
   register WDL_FFT_REAL t1;
@@ -416,6 +883,8 @@ static void cpass(register WDL_FFT_COMPLEX *a,register const WDL_FFT_COMPLEX *w,
   register WDL_FFT_COMPLEX *a2;
   register WDL_FFT_COMPLEX *a3;
 
+  WDL_FFT_DISPATCH(cpass, a, w, n)
+
   a2 = a + 4 * n;
   a1 = a + 2 * n;
   a3 = a2 + 2 * n;
@@ -485,6 +954,8 @@ static void cpassbig(register WDL_FFT_COMPLEX *a,register const WDL_FFT_COMPLEX
   register WDL_FFT_COMPLEX *a3;
   register unsigned int k;
 
+  WDL_FFT_DISPATCH(cpassbig, a, w, n)
+
   a2 = a + 4 * n;
   a1 = a + 2 * n;
   a3 = a2 + 2 * n;
@@ -582,6 +1053,18 @@ void WDL_fft_complexmul(WDL_FFT_COMPLEX *a,WDL_FFT_COMPLEX *b,int n)
   register WDL_FFT_REAL t1, t2, t3, t4, t5, t6, t7, t8;
   if (n<2 || (n&1)) return;
 
+#ifdef WDL_FFT_SIMD
+  if (wdl_fft_simd_level)
+  {
+    int i;
+#ifdef WDL_FFT_SIMD_AVX
+    if (wdl_fft_simd_level >= 2) { complexmul_avx(a, a, b, n, 0); return; }
+#endif
+    for (i = 0; i < n; i += WDL_FFT_VN) V_STORE(a + i, V_CMUL(V_LOAD(a + i), V_LOAD(b + i)));
+    return;
+  }
+#endif
+
   do {
     t1 = a[0].re * b[0].re;
     t2 = a[0].im * b[0].im;
@@ -609,6 +1092,18 @@ void WDL_fft_complexmul2(WDL_FFT_COMPLEX *c, WDL_FFT_COMPLEX *a, WDL_FFT_COMPLEX
   register WDL_FFT_REAL t1, t2, t3, t4, t5, t6, t7, t8;
   if (n<2 || (n&1)) return;
 
+#ifdef WDL_FFT_SIMD
+  if (wdl_fft_simd_level)
+  {
+    int i;
+#ifdef WDL_FFT_SIMD_AVX
+    if (wdl_fft_simd_level >= 2) { complexmul_avx(c, a, b, n, 0); return; }
+#endif
+    for (i = 0; i < n; i += WDL_FFT_VN) V_STORE(c + i, V_CMUL(V_LOAD(a + i), V_LOAD(b + i)));
+    return;
+  }
+#endif
+
   do {
     t1 = a[0].re * b[0].re;
     t2 = a[0].im * b[0].im;
@@ -636,6 +1131,18 @@ void WDL_fft_complexmul3(WDL_FFT_COMPLEX *c, WDL_FFT_COMPLEX *a, WDL_FFT_COMPLEX
   register WDL_FFT_REAL t1, t2, t3, t4, t5, t6, t7, t8;
   if (n<2 || (n&1)) return;
 
+#ifdef WDL_FFT_SIMD
+  if (wdl_fft_simd_level)
+  {
+    int i;
+#ifdef WDL_FFT_SIMD_AVX
+    if (wdl_fft_simd_level >= 2) { complexmul_avx(c, a, b, n, 1); return; }
+#endif
+    for (i = 0; i < n; i += WDL_FFT_VN) V_STORE(c + i, V_ADD(V_LOAD(c + i), V_CMUL(V_LOAD(a + i), V_LOAD(b + i))));
+    return;
+  }
+#endif
+
   do {
     t1 = a[0].re * b[0].re;
     t2 = a[0].im * b[0].im;
@@ -800,6 +1307,8 @@ static void upass(register WDL_FFT_COMPLEX *a,register const WDL_FFT_COMPLEX *w,
   register WDL_FFT_COMPLEX *a2;
   register WDL_FFT_COMPLEX *a3;
 
+  WDL_FFT_DISPATCH(upass, a, w, n)
+
   a2 = a + 4 * n;
   a1 = a + 2 * n;
   a3 = a2 + 2 * n;
@@ -870,6 +1379,8 @@ static void upassbig(register WDL_FFT_COMPLEX *a,register const WDL_FFT_COMPLEX
   register WDL_FFT_COMPLEX *a3;
   register unsigned int k;
 
+  WDL_FFT_DISPATCH(upassbig, a, w, n)
+
   a2 = a + 4 * n;
   a1 = a + 2 * n;
   a3 = a2 + 2 * n;
@@ -1050,6 +1561,10 @@ void WDL_fft_init()
     fft_gen(d32768,d16384,0);
 #undef fft_gen
 
+#ifdef WDL_FFT_SIMD_AVX
+    if (wdl_fft_simd_level == 1 && wdl_fft_cpu_has_avx()) wdl_fft_simd_level = 2;
+#endif
+
 #ifndef WDL_FFT_NO_PERMUTE
 	  offs = 0;
 	  for (i = 2; i <= 32768; i *= 2) 
@@ -70,6 +70,12 @@ extern void WDL_real_fft(WDL_FFT_REAL *, int len, int isInverse);
 extern int WDL_fft_permute(int fftsize, int idx);
 extern int *WDL_fft_permute_tab(int fftsize);
 
+/* Selects the scalar passes (0), the 128-bit SSE2/NEON ones (1) or, on x86
+CPUs that support it, the AVX ones (2). Returns the level now in use, which
+may be lower than asked for. WDL_fft_init() picks the best one available;
+NEON is only compiled in if WDL_FFT_NEON is defined. */
+extern int WDL_fft_set_simd(int enable);
+
 #ifdef __cplusplus
 };
 #endif
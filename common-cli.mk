@@ -0,0 +1,55 @@
+# Builds a plug-in as a command line offline host (CLI_API), for profiling and regression testing DSP on headless machines
+# A project's -cli.mk sets IPLUG2_ROOT, includes this file and adds its sources to SRC, see Examples/IPlugEffect/projects/IPlugEffect-cli.mk
+# usage, from the project's projects folder: make -f IPlugEffect-cli.mk
+
+PROJECT_ROOT = $(PWD)/..
+DEPS_PATH = $(IPLUG2_ROOT)/Dependencies
+WDL_PATH = $(IPLUG2_ROOT)/WDL
+IPLUG_PATH = $(IPLUG2_ROOT)/IPlug
+IPLUG_EXTRAS_PATH = $(IPLUG_PATH)/Extras
+IPLUG_SYNTH_PATH = $(IPLUG_EXTRAS_PATH)/Synth
+IPLUG_CLI_PATH = $(IPLUG_PATH)/CLI
+IGRAPHICS_PATH = $(IPLUG2_ROOT)/IGraphics
+CONTROLS_PATH = $(IGRAPHICS_PATH)/Controls
+PLATFORMS_PATH = $(IGRAPHICS_PATH)/Platforms
+DRAWING_PATH = $(IGRAPHICS_PATH)/Drawing
+NANOVG_PATH = $(DEPS_PATH)/IGraphics/NanoVG/src
+NANOSVG_PATH = $(DEPS_PATH)/IGraphics/NanoSVG/src
+STB_PATH = $(DEPS_PATH)/IGraphics/STB
+
+IPLUG_SRC = $(IPLUG_PATH)/IPlugAPIBase.cpp \
+	$(IPLUG_PATH)/IPlugParameter.cpp \
+	$(IPLUG_PATH)/IPlugPluginBase.cpp \
+	$(IPLUG_PATH)/IPlugTimer.cpp
+
+CLI_SRC = $(IPLUG_CLI_PATH)/IPlugCLI.cpp \
+	$(IPLUG_CLI_PATH)/IPlugCLI_main.cpp
+
+INCLUDE_PATHS = -I$(PROJECT_ROOT) \
+-I$(WDL_PATH) \
+-I$(IPLUG_PATH) \
+-I$(IPLUG_EXTRAS_PATH) \
+-I$(IPLUG_SYNTH_PATH) \
+-I$(IPLUG_CLI_PATH) \
+-I$(IGRAPHICS_PATH) \
+-I$(DRAWING_PATH) \
+-I$(CONTROLS_PATH) \
+-I$(PLATFORMS_PATH) \
+-I$(NANOVG_PATH) \
+-I$(NANOSVG_PATH) \
+-I$(STB_PATH)
+
+SRC = $(IPLUG_SRC) $(CLI_SRC)
+
+CXX ?= c++
+
+CFLAGS = $(INCLUDE_PATHS) \
+-std=c++14 \
+-O2 \
+-DCLI_API \
+-DIPLUG_DSP=1 \
+-DNO_IGRAPHICS \
+-DWDL_NO_DEFINE_MINMAX \
+-DNDEBUG
+
+LDFLAGS = -lpthread